@@ -1,7 +1,24 @@
 #include "common-ggml.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
 #include <regex>
 #include <map>
+#include <thread>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
 
 static const std::map<std::string, enum ggml_ftype> GGML_FTYPE_MAP = {
     {"q4_0", GGML_FTYPE_MOSTLY_Q4_0},
@@ -244,3 +261,418 @@ bool ggml_common_quantize_0(
 
     return true;
 }
+
+//
+// container
+//
+
+static uint64_t ggml_container_pad(uint64_t x, uint64_t n) {
+    return (x + n - 1) & ~(n - 1);
+}
+
+static bool ggml_container_map(ggml_container & ctr) {
+#if defined(_WIN32)
+    HANDLE hfile = CreateFileA(ctr.fname.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (hfile == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+
+    LARGE_INTEGER fsize;
+    GetFileSizeEx(hfile, &fsize);
+
+    HANDLE hmap = CreateFileMappingA(hfile, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(hfile);
+    if (hmap == NULL) {
+        return false;
+    }
+
+    void * addr = MapViewOfFile(hmap, FILE_MAP_READ, 0, 0, 0);
+    if (addr == NULL) {
+        CloseHandle(hmap);
+        return false;
+    }
+
+    ctr.addr    = (uint8_t *) addr;
+    ctr.size    = (size_t) fsize.QuadPart;
+    ctr.mapping = hmap;
+#else
+    const int fd = open(ctr.fname.c_str(), O_RDONLY);
+    if (fd == -1) {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return false;
+    }
+
+    void * addr = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        return false;
+    }
+
+    ctr.addr = (uint8_t *) addr;
+    ctr.size = (size_t) st.st_size;
+#endif
+    return true;
+}
+
+// the bytes of the data of t by its type and shape, 0 if the shape is invalid or takes more than max_size
+static uint64_t ggml_container_tensor_size(const ggml_container_tensor & t, uint64_t max_size) {
+    const uint64_t blck = ggml_blck_size(t.type);
+
+    if (t.ne[0] < 1 || t.ne[0] % blck != 0) {
+        return 0;
+    }
+
+    uint64_t n_blocks = 1;
+    for (int i = 0; i < 4; ++i) {
+        const uint64_t ne = i == 0 ? t.ne[0]/blck : t.ne[i];
+        if (t.ne[i] < 1 || ne > max_size/n_blocks) {
+            return 0;
+        }
+        n_blocks *= ne;
+    }
+
+    if (n_blocks > max_size/ggml_type_size(t.type)) {
+        return 0;
+    }
+
+    return n_blocks*ggml_type_size(t.type);
+}
+
+bool ggml_container_open(ggml_container & ctr, const std::string & fname, bool use_mmap) {
+    ggml_container_close(ctr);
+
+    std::ifstream fin(fname, std::ios::binary);
+    if (!fin) {
+        fprintf(stderr, "%s: failed to open '%s'\n", __func__, fname.c_str());
+        return false;
+    }
+
+    uint32_t hdr[4];
+    uint64_t sizes[2];
+    fin.read((char *) hdr,   sizeof(hdr));
+    fin.read((char *) sizes, sizeof(sizes));
+
+    if (!fin || hdr[0] != GGML_CONTAINER_MAGIC) {
+        fprintf(stderr, "%s: invalid container '%s' (bad magic)\n", __func__, fname.c_str());
+        return false;
+    }
+
+    if (hdr[1] != GGML_CONTAINER_VERSION) {
+        fprintf(stderr, "%s: unsupported container version %u in '%s'\n", __func__, hdr[1], fname.c_str());
+        return false;
+    }
+
+    const uint32_t alignment = hdr[2];
+    const uint32_t n_tensors = hdr[3];
+
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0 || sizes[1] % alignment != 0) {
+        fprintf(stderr, "%s: invalid container '%s' (bad alignment %u)\n", __func__, fname.c_str(), alignment);
+        return false;
+    }
+
+    fin.seekg(0, std::ios::end);
+    const uint64_t file_size = fin.tellg();
+    fin.seekg(sizeof(hdr) + sizeof(sizes));
+
+    const uint64_t dir_start = sizeof(hdr) + sizeof(sizes) + sizes[0];
+
+    // every entry of the directory takes at least its fixed fields
+    const uint64_t entry_min_size = sizeof(uint32_t) + 2*sizeof(int32_t) + sizeof(ctr.tensors[0].ne) + 2*sizeof(uint64_t);
+
+    if (sizes[0] > file_size || sizes[1] > file_size || dir_start > file_size ||
+        n_tensors > (file_size - dir_start)/entry_min_size) {
+        fprintf(stderr, "%s: invalid container '%s' (truncated)\n", __func__, fname.c_str());
+        return false;
+    }
+
+    ctr.fname       = fname;
+    ctr.version     = hdr[1];
+    ctr.alignment   = alignment;
+    ctr.data_offset = sizes[1];
+
+    ctr.header.resize(sizes[0]);
+    fin.read(&ctr.header[0], sizes[0]);
+
+    ctr.tensors.resize(n_tensors);
+    for (uint32_t i = 0; i < n_tensors; ++i) {
+        auto & t = ctr.tensors[i];
+
+        uint32_t len = 0;
+        fin.read((char *) &len, sizeof(len));
+        if (!fin || len > file_size) {
+            fprintf(stderr, "%s: invalid container '%s' (bad name of tensor %u)\n", __func__, fname.c_str(), i);
+            ggml_container_close(ctr);
+            return false;
+        }
+
+        t.name.resize(len);
+        fin.read(&t.name[0], len);
+
+        int32_t type = 0;
+        fin.read((char *) &type,     sizeof(type));
+        fin.read((char *) &t.n_dims, sizeof(t.n_dims));
+        fin.read((char *) t.ne,      sizeof(t.ne));
+        fin.read((char *) &t.offset, sizeof(t.offset));
+        fin.read((char *) &t.size,   sizeof(t.size));
+
+        t.type = (enum ggml_type) type;
+
+        const uint64_t data_size = file_size - ctr.data_offset;
+
+        if (!fin || type < 0 || type >= GGML_TYPE_COUNT || t.n_dims < 1 || t.n_dims > 4 ||
+            t.offset % alignment != 0 || t.offset > data_size || t.size > data_size - t.offset ||
+            t.size != ggml_container_tensor_size(t, data_size)) {
+            fprintf(stderr, "%s: invalid container '%s' (bad entry for tensor '%s')\n", __func__, fname.c_str(), t.name.c_str());
+            ggml_container_close(ctr);
+            return false;
+        }
+
+        ctr.index[t.name] = i;
+    }
+
+    if (!fin) {
+        fprintf(stderr, "%s: invalid container '%s' (truncated directory)\n", __func__, fname.c_str());
+        ggml_container_close(ctr);
+        return false;
+    }
+
+    if (use_mmap && !ggml_container_map(ctr)) {
+        fprintf(stderr, "%s: failed to mmap '%s', falling back to reads\n", __func__, fname.c_str());
+    }
+
+    return true;
+}
+
+void ggml_container_close(ggml_container & ctr) {
+    if (ctr.addr) {
+#if defined(_WIN32)
+        UnmapViewOfFile(ctr.addr);
+        CloseHandle((HANDLE) ctr.mapping);
+#else
+        munmap(ctr.addr, ctr.size);
+#endif
+    }
+
+    ctr = ggml_container();
+}
+
+const ggml_container_tensor * ggml_container_find(const ggml_container & ctr, const std::string & name) {
+    const auto it = ctr.index.find(name);
+    if (it == ctr.index.end()) {
+        return nullptr;
+    }
+
+    return &ctr.tensors[it->second];
+}
+
+const void * ggml_container_data(const ggml_container & ctr, const ggml_container_tensor & t) {
+    if (!ctr.addr) {
+        return nullptr;
+    }
+
+    return ctr.addr + ctr.data_offset + t.offset;
+}
+
+static bool ggml_container_read_from(std::ifstream & fin, const ggml_container & ctr, const ggml_container_tensor & t, void * dst) {
+    fin.seekg(ctr.data_offset + t.offset);
+    fin.read((char *) dst, t.size);
+
+    return (bool) fin;
+}
+
+bool ggml_container_read(const ggml_container & ctr, const ggml_container_tensor & t, void * dst) {
+    if (ctr.addr) {
+        memcpy(dst, ggml_container_data(ctr, t), t.size);
+        return true;
+    }
+
+    std::ifstream fin(ctr.fname, std::ios::binary);
+
+    return fin && ggml_container_read_from(fin, ctr, t, dst);
+}
+
+bool ggml_container_read_all(
+        const ggml_container & ctr,
+        const std::vector<std::pair<const ggml_container_tensor *, void *>> & reads,
+        int n_threads) {
+    // biggest tensors first, so that the last ones to be picked up are short
+    std::vector<size_t> order(reads.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        order[i] = i;
+    }
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return reads[a].first->size > reads[b].first->size;
+    });
+
+    n_threads = std::max(1, std::min(n_threads, (int) reads.size()));
+
+    std::atomic<size_t> next(0);
+    std::atomic<bool>   ok(true);
+
+    auto worker = [&]() {
+        std::ifstream fin;
+        if (!ctr.addr) {
+            fin.open(ctr.fname, std::ios::binary);
+            if (!fin) {
+                ok = false;
+                return;
+            }
+        }
+
+        for (size_t i = next++; i < order.size() && ok; i = next++) {
+            const auto & r = reads[order[i]];
+
+            if (ctr.addr) {
+                memcpy(r.second, ggml_container_data(ctr, *r.first), r.first->size);
+            } else if (!ggml_container_read_from(fin, ctr, *r.first, r.second)) {
+                fprintf(stderr, "%s: failed to read tensor '%s'\n", __func__, r.first->name.c_str());
+                ok = false;
+            }
+        }
+    };
+
+    std::vector<std::thread> workers(n_threads - 1);
+    for (auto & w : workers) {
+        w = std::thread(worker);
+    }
+
+    worker();
+
+    for (auto & w : workers) {
+        w.join();
+    }
+
+    return ok;
+}
+
+bool ggml_container_convert(
+        std::ifstream & finp,
+        std::ofstream & fout,
+        const std::string & header,
+        uint32_t alignment) {
+    if (alignment == 0 || (alignment & (alignment - 1)) != 0) {
+        fprintf(stderr, "%s: alignment must be a power of two, got %u\n", __func__, alignment);
+        return false;
+    }
+
+    const uint64_t header_size = header.size();
+
+    // first pass: build the directory and remember where the data of each tensor is
+    std::vector<ggml_container_tensor> tensors;
+    std::vector<uint64_t> src;
+
+    uint64_t dir_size  = 0;
+    uint64_t data_size = 0;
+
+    while (true) {
+        int32_t n_dims;
+        int32_t length;
+        int32_t ttype;
+
+        finp.read(reinterpret_cast<char *>(&n_dims), sizeof(n_dims));
+        finp.read(reinterpret_cast<char *>(&length), sizeof(length));
+        finp.read(reinterpret_cast<char *>(&ttype),  sizeof(ttype));
+
+        if (finp.eof()) {
+            break;
+        }
+
+        if (n_dims < 1 || n_dims > 4 || length < 0 || ttype < 0 || ttype >= GGML_TYPE_COUNT) {
+            fprintf(stderr, "%s: invalid tensor header (n_dims = %d, type = %d)\n", __func__, n_dims, ttype);
+            return false;
+        }
+
+        ggml_container_tensor t;
+        t.type   = (enum ggml_type) ttype;
+        t.n_dims = n_dims;
+
+        int64_t nelements = 1;
+        for (int i = 0; i < 4; ++i) {
+            int32_t ne = 1;
+            if (i < n_dims) {
+                finp.read(reinterpret_cast<char *>(&ne), sizeof(ne));
+            }
+            t.ne[i] = ne;
+            nelements *= ne;
+        }
+
+        t.name.resize(length);
+        finp.read(&t.name[0], length);
+
+        t.size   = (nelements*ggml_type_size(t.type))/ggml_blck_size(t.type);
+        t.offset = ggml_container_pad(data_size, alignment);
+
+        data_size = t.offset + t.size;
+        dir_size += sizeof(uint32_t) + length + 2*sizeof(int32_t) + sizeof(t.ne) + 2*sizeof(uint64_t);
+
+        src.push_back(finp.tellg());
+        finp.seekg(t.size, std::ios::cur);
+
+        if (!finp) {
+            fprintf(stderr, "%s: truncated data for tensor '%s'\n", __func__, t.name.c_str());
+            return false;
+        }
+
+        tensors.push_back(std::move(t));
+    }
+
+    finp.clear();
+
+    const uint32_t hdr[4] = { GGML_CONTAINER_MAGIC, GGML_CONTAINER_VERSION, alignment, (uint32_t) tensors.size() };
+    const uint64_t data_offset = ggml_container_pad(sizeof(hdr) + 2*sizeof(uint64_t) + header_size + dir_size, alignment);
+    const uint64_t sizes[2] = { header_size, data_offset };
+
+    fout.write((const char *) hdr,   sizeof(hdr));
+    fout.write((const char *) sizes, sizeof(sizes));
+    fout.write(header.data(), header_size);
+
+    for (const auto & t : tensors) {
+        const uint32_t len  = t.name.size();
+        const int32_t  type = t.type;
+
+        fout.write((const char *) &len,      sizeof(len));
+        fout.write(t.name.data(),            len);
+        fout.write((const char *) &type,     sizeof(type));
+        fout.write((const char *) &t.n_dims, sizeof(t.n_dims));
+        fout.write((const char *) t.ne,      sizeof(t.ne));
+        fout.write((const char *) &t.offset, sizeof(t.offset));
+        fout.write((const char *) &t.size,   sizeof(t.size));
+    }
+
+    // second pass: copy the data, padding every tensor to the alignment
+    std::vector<char> buf;
+    const std::vector<char> zeros(alignment, 0);
+
+    uint64_t pos = data_offset;
+    fout.write(zeros.data(), data_offset - (uint64_t) fout.tellp());
+
+    for (size_t i = 0; i < tensors.size(); ++i) {
+        const auto & t = tensors[i];
+
+        fout.write(zeros.data(), data_offset + t.offset - pos);
+
+        buf.resize(t.size);
+        finp.seekg(src[i]);
+        finp.read(buf.data(), t.size);
+        fout.write(buf.data(), t.size);
+
+        pos = data_offset + t.offset + t.size;
+
+        printf("%64s - [%5d, %5d, %5d], type = %6s, offset = %10llu\n", t.name.c_str(),
+                (int) t.ne[0], (int) t.ne[1], (int) t.ne[2], ggml_type_name(t.type), (unsigned long long) t.offset);
+    }
+
+    if (!finp || !fout) {
+        fprintf(stderr, "%s: I/O error while copying tensor data\n", __func__);
+        return false;
+    }
+
+    printf("%s: %zu tensors, data size = %8.2f MB, alignment = %u\n", __func__, tensors.size(), data_size/1024.0/1024.0, alignment);
+
+    return true;
+}
@@ -3,6 +3,7 @@
 #include "ggml.h"
 
 #include <fstream>
+#include <map>
 #include <vector>
 #include <string>
 
@@ -16,3 +17,94 @@ bool ggml_common_quantize_0(
         const ggml_ftype ftype,
         const std::vector<std::string> & to_quant,
         const std::vector<std::string> & to_skip);
+
+//
+// Aligned, indexed model container
+//
+// Legacy GGML_FILE_MAGIC files interleave tensor headers and data, so a loader has to
+// stream the whole file in order. The container keeps the model-specific header (hparams
+// + vocab, as in the legacy file or with a precompiled vocab section) as an opaque blob and
+// moves the tensor headers into a directory in front of the data, so tensors can be mmap-ed,
+// read in parallel or loaded lazily. Layout (little-endian):
+//
+//   uint32_t magic          GGML_CONTAINER_MAGIC
+//   uint32_t version        GGML_CONTAINER_VERSION
+//   uint32_t alignment      of the data section and of every tensor in it (power of two)
+//   uint32_t n_tensors
+//   uint64_t header_size
+//   uint64_t data_offset    file offset of the data section, multiple of alignment
+//   uint8_t  header[header_size]
+//   directory, n_tensors times:
+//     uint32_t name_len
+//     char     name[name_len]
+//     int32_t  type
+//     int32_t  n_dims
+//     int64_t  ne[4]
+//     uint64_t offset       from data_offset, multiple of alignment
+//     uint64_t size         in bytes
+//   zero padding up to data_offset
+//   tensor data
+//
+
+#define GGML_CONTAINER_MAGIC     0x67676d63 // "ggmc"
+#define GGML_CONTAINER_VERSION   1
+#define GGML_CONTAINER_ALIGNMENT 64
+
+struct ggml_container_tensor {
+    std::string name;
+
+    enum ggml_type type;
+
+    int32_t n_dims;
+    int64_t ne[4];
+
+    uint64_t offset;
+    uint64_t size;
+};
+
+struct ggml_container {
+    std::string fname;
+
+    uint32_t version     = 0;
+    uint32_t alignment   = 0;
+    uint64_t data_offset = 0;
+
+    std::string header; // model-specific, parse with std::istringstream
+
+    std::vector<ggml_container_tensor> tensors;
+    std::map<std::string, size_t> index; // name -> position in tensors
+
+    // read-only mapping of the whole file, null when opened without mmap
+    uint8_t * addr     = nullptr;
+    size_t    size     = 0;
+    void    * mapping  = nullptr; // platform handle
+};
+
+// reads the header and the directory; with use_mmap the file is also mapped read-only
+// (falls back to plain reads when mapping fails or is not supported)
+bool ggml_container_open(ggml_container & ctr, const std::string & fname, bool use_mmap);
+
+void ggml_container_close(ggml_container & ctr);
+
+// nullptr if there is no tensor with this name
+const ggml_container_tensor * ggml_container_find(const ggml_container & ctr, const std::string & name);
+
+// pointer into the mapping, nullptr when the container is not mapped
+const void * ggml_container_data(const ggml_container & ctr, const ggml_container_tensor & t);
+
+// copies the data of one tensor into dst (t.size bytes) - for lazy loading
+bool ggml_container_read(const ggml_container & ctr, const ggml_container_tensor & t, void * dst);
+
+// copies the data of many tensors using n_threads readers, each with its own file handle
+bool ggml_container_read_all(
+        const ggml_container & ctr,
+        const std::vector<std::pair<const ggml_container_tensor *, void *>> & reads,
+        int n_threads);
+
+// converts a legacy file: finp must be positioned at the first tensor and header holds
+// the model-specific bytes that are stored in the container instead of those before it
+bool ggml_container_convert(
+        std::ifstream & finp,
+        std::ofstream & fout,
+        const std::string & header,
+        uint32_t alignment = GGML_CONTAINER_ALIGNMENT);
@@ -5,14 +5,23 @@
 #define DR_WAV_IMPLEMENTATION
 #include "dr_wav.h"
 
+#include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstring>
+#include <functional>
 #include <fstream>
 #include <regex>
 #include <locale>
 #include <codecvt>
 #include <sstream>
 
+#if defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
 #ifndef M_PI
 #define M_PI 3.14159265358979323846
 #endif
@@ -156,6 +165,246 @@ void gpt_vocab::add_special_token(const std::string & token) {
     special_tokens.push_back(token);
 }
 
+int32_t gpt_vocab::size() const {
+    return index.size() > 0 ? index.size() : (int32_t) id_to_token.size();
+}
+
+gpt_vocab::token gpt_vocab::get_token(id token_id) const {
+    if (index.size() > 0) {
+        if (token_id < 0 || token_id >= index.size()) {
+            return token();
+        }
+        return token(index.data(token_id), index.len(token_id));
+    }
+
+    const auto it = id_to_token.find(token_id);
+    return it != id_to_token.end() ? it->second : token();
+}
+
+gpt_vocab::id gpt_vocab::get_id(const token & str) const {
+    if (index.size() > 0) {
+        return index.find(str.data(), str.size());
+    }
+
+    const auto it = token_to_id.find(str);
+    return it != token_to_id.end() ? it->second : -1;
+}
+
+static inline uint32_t gpt_hash(const char * str, size_t len) {
+    // FNV-1a - do not change, the hash table is stored in the model files
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; ++i) {
+        h ^= (uint8_t) str[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+int32_t gpt_vocab_index::find(const char * str, size_t len) const {
+    if (table.empty() || len == 0) {
+        return -1;
+    }
+
+    uint32_t slot = gpt_hash(str, len) & table_mask;
+    while (true) {
+        const int32_t id = table[slot];
+        if (id < 0) {
+            return -1;
+        }
+        const uint32_t offs = offsets[id];
+        if (offsets[id + 1] - offs == len && memcmp(arena.data() + offs, str, len) == 0) {
+            return id;
+        }
+        slot = (slot + 1) & table_mask;
+    }
+}
+
+// insert all tokens of the arena into a new hash table
+static void gpt_vocab_index_hash(gpt_vocab_index & index) {
+    const int32_t n_ids = index.size();
+
+    // keep the load factor below 0.5
+    uint32_t n_slots = 64;
+    while (n_slots < 2u*n_ids) {
+        n_slots *= 2;
+    }
+    index.table.assign(n_slots, -1);
+    index.table_mask = n_slots - 1;
+
+    for (int32_t id = 0; id < n_ids; ++id) {
+        const char * str = index.data(id);
+        const size_t len = index.len(id);
+        if (len == 0) {
+            continue;
+        }
+
+        // on duplicates the last id wins, same as when filling token_to_id
+        uint32_t slot = gpt_hash(str, len) & index.table_mask;
+        while (true) {
+            const int32_t cur = index.table[slot];
+            if (cur < 0 || (index.len(cur) == len && memcmp(index.data(cur), str, len) == 0)) {
+                index.table[slot] = id;
+                break;
+            }
+            slot = (slot + 1) & index.table_mask;
+        }
+    }
+}
+
+void gpt_vocab_index_build(gpt_vocab_index & index, const std::map<int32_t, std::string> & id_to_token) {
+    const int32_t n_ids = id_to_token.empty() ? 0 : id_to_token.rbegin()->first + 1;
+
+    index.arena.clear();
+    index.offsets.assign(n_ids + 1, 0);
+
+    {
+        size_t n_bytes = 0;
+        for (const auto & kv : id_to_token) {
+            n_bytes += kv.second.size();
+        }
+        index.arena.reserve(n_bytes);
+    }
+
+    {
+        auto it = id_to_token.begin();
+        for (int32_t id = 0; id < n_ids; ++id) {
+            index.offsets[id] = index.arena.size();
+            if (it != id_to_token.end() && it->first == id) {
+                index.arena += it->second;
+                ++it;
+            }
+        }
+        index.offsets[n_ids] = index.arena.size();
+    }
+
+    gpt_vocab_index_hash(index);
+}
+
+// decode utf-8 in place, keeping the low byte of each codepoint
+static size_t gpt_utf8_to_bytes(char * str, size_t len) {
+    size_t n = 0;
+    for (size_t i = 0; i < len; ) {
+        const uint8_t c = str[i];
+        uint32_t cp;
+        size_t   cl;
+        if      (c < 0x80) { cp = c;        cl = 1; }
+        else if (c < 0xe0) { cp = c & 0x1f; cl = 2; }
+        else if (c < 0xf0) { cp = c & 0x0f; cl = 3; }
+        else               { cp = c & 0x07; cl = 4; }
+        for (size_t j = 1; j < cl && i + j < len; ++j) {
+            cp = (cp << 6) | (str[i + j] & 0x3f);
+        }
+        str[n++] = (char) (uint8_t) cp;
+        i += cl;
+    }
+    return n;
+}
+
+bool gpt_vocab_read(std::istream & fin, int32_t n_vocab, bool utf8_bytes, gpt_vocab & vocab) {
+    auto & index = vocab.index;
+
+    uint32_t magic = 0;
+    fin.read((char *) &magic, sizeof(magic));
+    if (!fin) {
+        return false;
+    }
+
+    if (magic == GPT_VOCAB_MAGIC) {
+        uint32_t hdr[3];
+        fin.read((char *) hdr, sizeof(hdr));
+
+        const uint32_t n_ids   = hdr[0];
+        const uint32_t n_bytes = hdr[1];
+        const uint32_t n_slots = hdr[2];
+
+        if (!fin || (int32_t) n_ids != n_vocab || n_slots <= n_ids || (n_slots & (n_slots - 1)) != 0) {
+            fprintf(stderr, "%s: invalid vocab section (n_vocab = %u, n_slots = %u)\n", __func__, n_ids, n_slots);
+            return false;
+        }
+
+        index.offsets.resize(n_ids + 1);
+        index.table.resize(n_slots);
+        index.arena.resize(n_bytes);
+        index.table_mask = n_slots - 1;
+
+        fin.read((char *) index.offsets.data(), index.offsets.size()*sizeof(uint32_t));
+        fin.read((char *) index.table.data(),   index.table.size()*sizeof(int32_t));
+        fin.read((char *) &index.arena[0],      n_bytes);
+        if (!fin) {
+            fprintf(stderr, "%s: truncated vocab section\n", __func__);
+            return false;
+        }
+
+        // a broken section must not send find() out of bounds or into an endless probe
+        bool ok = index.offsets[0] == 0 && index.offsets[n_ids] == n_bytes;
+        for (uint32_t i = 0; ok && i < n_ids; ++i) {
+            ok = index.offsets[i] <= index.offsets[i + 1];
+        }
+        bool has_empty = false;
+        for (uint32_t i = 0; ok && i < n_slots; ++i) {
+            ok = index.table[i] >= -1 && index.table[i] < (int32_t) n_ids;
+            has_empty = has_empty || index.table[i] < 0;
+        }
+        if (!ok || !has_empty) {
+            fprintf(stderr, "%s: corrupted vocab section\n", __func__);
+            index = gpt_vocab_index();
+            return false;
+        }
+
+        return true;
+    }
+
+    // original layout - the first word we read is the length of token 0
+    index.arena.clear();
+    index.offsets.resize(n_vocab + 1);
+
+    std::vector<char> buf;
+
+    uint32_t len = magic;
+    for (int32_t i = 0; i < n_vocab; ++i) {
+        if (i > 0) {
+            fin.read((char *) &len, sizeof(len));
+        }
+
+        buf.resize(len);
+        fin.read(buf.data(), len);
+        if (!fin) {
+            fprintf(stderr, "%s: truncated vocab at token %d\n", __func__, i);
+            return false;
+        }
+
+        const size_t n = utf8_bytes ? gpt_utf8_to_bytes(buf.data(), len) : len;
+
+        index.offsets[i] = index.arena.size();
+        index.arena.append(buf.data(), n);
+    }
+    index.offsets[n_vocab] = index.arena.size();
+
+    gpt_vocab_index_hash(index);
+
+    return true;
+}
+
+void gpt_vocab_write(std::ostream & fout, const gpt_vocab & vocab) {
+    gpt_vocab_index index_tmp;
+    if (vocab.index.size() == 0) {
+        gpt_vocab_index_build(index_tmp, vocab.id_to_token);
+    }
+    const gpt_vocab_index & index = vocab.index.size() > 0 ? vocab.index : index_tmp;
+
+    const uint32_t hdr[4] = {
+        GPT_VOCAB_MAGIC,
+        (uint32_t) index.size(),
+        (uint32_t) index.arena.size(),
+        (uint32_t) index.table.size(),
+    };
+
+    fout.write((const char *) hdr, sizeof(hdr));
+    fout.write((const char *) index.offsets.data(), index.offsets.size()*sizeof(uint32_t));
+    fout.write((const char *) index.table.data(),   index.table.size()*sizeof(int32_t));
+    fout.write(index.arena.data(), index.arena.size());
+}
+
 std::map<std::string, int32_t> json_parse(const std::string & fname) {
     std::map<std::string, int32_t> result;
 
@@ -271,63 +520,451 @@ void gpt_split_words(std::string str, std::vector<std::string>& words) {
     }
 }
 
-std::vector<gpt_vocab::id> gpt_tokenize(const gpt_vocab & vocab, const std::string & text) {
-    std::vector<std::string> words;
+//
+// tokenizer
+//
+
+void gpt_tokenizer_init(gpt_tokenizer & tokenizer, const gpt_vocab & vocab) {
+    if (vocab.index.size() > 0) {
+        tokenizer.index = vocab.index;
+    } else {
+        gpt_vocab_index_build(tokenizer.index, vocab.id_to_token);
+    }
+
+    tokenizer.special_tokens = vocab.special_tokens;
+    std::fill(std::begin(tokenizer.special_first), std::end(tokenizer.special_first), false);
+    for (const auto & token : tokenizer.special_tokens) {
+        if (!token.empty()) {
+            tokenizer.special_first[(uint8_t) token[0]] = true;
+        }
+    }
+}
+
+static inline bool gpt_is_space(uint8_t c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+static inline bool gpt_is_alpha(uint8_t c) { return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'); }
+static inline bool gpt_is_digit(uint8_t c) { return c >= '0' && c <= '9'; }
+
+// 0 - space, 1 - alpha, 2 - digit, 3 - other
+// bytes >= 0x80 are "other", same as [[:alpha:]] in the C locale
+static inline int gpt_char_class(uint8_t c) {
+    return gpt_is_space(c) ? 0 : gpt_is_alpha(c) ? 1 : gpt_is_digit(c) ? 2 : 3;
+}
+
+// length of the next word in s[0..n), n > 0
+//
+// matches the same words as the gpt_split_words() regex:
+// 's|'t|'re|'ve|'m|'ll|'d| ?[[:alpha:]]+| ?[[:digit:]]+| ?[^\s[:alpha:][:digit:]]+|\s+(?!\S)|\s+
+//
+static size_t gpt_next_word(const uint8_t * s, size_t n) {
+    if (s[0] == '\'' && n >= 2) {
+        const uint8_t c = s[1];
+        if (c == 's' || c == 't' || c == 'm' || c == 'd') {
+            return 2;
+        }
+        if (n >= 3 && ((c == 'r' && s[2] == 'e') || (c == 'v' && s[2] == 'e') || (c == 'l' && s[2] == 'l'))) {
+            return 3;
+        }
+    }
+
+    const size_t i = (s[0] == ' ' && n >= 2) ? 1 : 0;
+    const int cls = gpt_char_class(s[i]);
+    if (cls != 0) {
+        size_t j = i + 1;
+        while (j < n && gpt_char_class(s[j]) == cls) {
+            ++j;
+        }
+        return j;
+    }
+
+    size_t j = 1;
+    while (j < n && gpt_is_space(s[j])) {
+        ++j;
+    }
 
-    // first split the text into words
+    // leave the last space for the next word, unless this is the end of the text
+    return (j < n && j > 1) ? j - 1 : j;
+}
+
+struct gpt_bpe_symbol {
+    uint32_t start;
+    uint32_t len;
+    int      prev;
+    int      next;
+};
+
+struct gpt_bpe_bigram {
+    gpt_vocab::id rank;
+    int           left;
+    int           right;
+    uint32_t      len;
+};
+
+struct gpt_bpe_bigram_cmp {
+    bool operator()(const gpt_bpe_bigram & a, const gpt_bpe_bigram & b) const {
+        return a.rank > b.rank || (a.rank == b.rank && a.left > b.left);
+    }
+};
+
+struct gpt_bpe_workspace {
+    std::vector<gpt_bpe_symbol> symbols;
+    std::vector<gpt_bpe_bigram> queue;
+};
+
+static void gpt_bpe_try_add_bigram(const gpt_tokenizer & tokenizer, const char * word, gpt_bpe_workspace & ws, int left, int right) {
+    if (left < 0 || right < 0) {
+        return;
+    }
+
+    const gpt_bpe_symbol & l = ws.symbols[left];
+    const gpt_bpe_symbol & r = ws.symbols[right];
+
+    const gpt_vocab::id id = tokenizer.find(word + l.start, l.len + r.len);
+    if (id < 0) {
+        return;
+    }
+
+    ws.queue.push_back({ id, left, right, l.len + r.len });
+    std::push_heap(ws.queue.begin(), ws.queue.end(), gpt_bpe_bigram_cmp());
+}
+
+static void gpt_bpe_word(const gpt_tokenizer & tokenizer, const char * word, size_t n, gpt_bpe_workspace & ws, std::vector<gpt_vocab::id> & tokens) {
+    // most words are a single token
     {
-        std::string str = text;
-
-        // Generate the subpattern from the special_tokens vector if it's not empty
-        if (!vocab.special_tokens.empty()) {
-            const std::regex escape(R"([\[\\\^\$\.\|\?\*\+\(\)\{\}])");
-            std::string special_tokens_subpattern;
-            for (const auto & token : vocab.special_tokens) {
-                if (!special_tokens_subpattern.empty()) {
-                    special_tokens_subpattern += "|";
-                }
-                special_tokens_subpattern += std::regex_replace(token, escape, R"(\$&)");
+        const gpt_vocab::id id = tokenizer.find(word, n);
+        if (id >= 0) {
+            tokens.push_back(id);
+            return;
+        }
+    }
+
+    // start from the utf-8 characters of the word
+    ws.symbols.clear();
+    ws.queue.clear();
+
+    for (size_t i = 0; i < n; ) {
+        const uint8_t c = word[i];
+        size_t len = c < 0x80 ? 1 : c < 0xe0 ? 2 : c < 0xf0 ? 3 : 4;
+        len = std::min(len, n - i);
+
+        const int idx = ws.symbols.size();
+        ws.symbols.push_back({ (uint32_t) i, (uint32_t) len, idx - 1, i + len < n ? idx + 1 : -1 });
+        i += len;
+    }
+
+    for (int i = 1; i < (int) ws.symbols.size(); ++i) {
+        gpt_bpe_try_add_bigram(tokenizer, word, ws, i - 1, i);
+    }
+
+    // merge the lowest ranked pair until no more merges are possible
+    while (!ws.queue.empty()) {
+        std::pop_heap(ws.queue.begin(), ws.queue.end(), gpt_bpe_bigram_cmp());
+        const gpt_bpe_bigram bigram = ws.queue.back();
+        ws.queue.pop_back();
+
+        gpt_bpe_symbol & l = ws.symbols[bigram.left];
+        gpt_bpe_symbol & r = ws.symbols[bigram.right];
+
+        // skip outdated bigrams
+        if (l.len == 0 || r.len == 0 || l.len + r.len != bigram.len) {
+            continue;
+        }
+
+        l.len += r.len;
+        r.len  = 0;
+        l.next = r.next;
+        if (r.next >= 0) {
+            ws.symbols[r.next].prev = bigram.left;
+        }
+
+        gpt_bpe_try_add_bigram(tokenizer, word, ws, l.prev, bigram.left);
+        gpt_bpe_try_add_bigram(tokenizer, word, ws, bigram.left, l.next);
+    }
+
+    for (int i = 0; i >= 0; i = ws.symbols[i].next) {
+        const gpt_bpe_symbol & sym = ws.symbols[i];
+
+        const gpt_vocab::id id = tokenizer.find(word + sym.start, sym.len);
+        if (id >= 0) {
+            tokens.push_back(id);
+            continue;
+        }
+
+        // not in the vocab - fall back to single bytes
+        for (uint32_t j = 0; j < sym.len; ++j) {
+            const gpt_vocab::id id_byte = tokenizer.find(word + sym.start + j, 1);
+            if (id_byte >= 0) {
+                tokens.push_back(id_byte);
+            } else {
+                fprintf(stderr, "%s: unknown token '%.*s'\n", __func__, 1, word + sym.start + j);
             }
+        }
+    }
+}
 
-            std::regex re(special_tokens_subpattern);
-            std::smatch m;
-            // Split the text by special tokens.
-            while (std::regex_search(str, m, re)) {
-                // Split the substrings in-between special tokens into words.
-                gpt_split_words(m.prefix(), words);
-                // Add matched special tokens as words.
-                for (auto x : m) {
-                    words.push_back(x);
-                }
-                str = m.suffix();
+static void gpt_tokenize_words(const gpt_tokenizer & tokenizer, const char * text, size_t len, gpt_bpe_workspace & ws, std::vector<gpt_vocab::id> & tokens) {
+    const uint8_t * s = (const uint8_t *) text;
+    for (size_t i = 0; i < len; ) {
+        const size_t n = gpt_next_word(s + i, len - i);
+        gpt_bpe_word(tokenizer, text + i, n, ws, tokens);
+        i += n;
+    }
+}
+
+static void gpt_tokenize(const gpt_tokenizer & tokenizer, const char * text, size_t len, gpt_bpe_workspace & ws, std::vector<gpt_vocab::id> & tokens) {
+    if (tokenizer.special_tokens.empty()) {
+        gpt_tokenize_words(tokenizer, text, len, ws, tokens);
+        return;
+    }
+
+    // split the text by special tokens - the first one in the list wins, same as the regex alternation
+    size_t start = 0;
+    for (size_t i = 0; i < len; ) {
+        if (!tokenizer.special_first[(uint8_t) text[i]]) {
+            ++i;
+            continue;
+        }
+
+        size_t n_match = 0;
+        for (const auto & token : tokenizer.special_tokens) {
+            if (!token.empty() && token.size() <= len - i && memcmp(text + i, token.data(), token.size()) == 0) {
+                n_match = token.size();
+                break;
             }
-            // Remaining text without special tokens will be handled below.
         }
 
-        gpt_split_words(str, words);
+        if (n_match == 0) {
+            ++i;
+            continue;
+        }
+
+        gpt_tokenize_words(tokenizer, text + start, i - start, ws, tokens);
+        gpt_bpe_word(tokenizer, text + i, n_match, ws, tokens);
+
+        i += n_match;
+        start = i;
     }
 
-    // find the longest token that forms each word in words:
+    gpt_tokenize_words(tokenizer, text + start, len - start, ws, tokens);
+}
+
+void gpt_tokenize(const gpt_tokenizer & tokenizer, const char * text, size_t len, std::vector<gpt_vocab::id> & tokens) {
+    gpt_bpe_workspace ws;
+    gpt_tokenize(tokenizer, text, len, ws, tokens);
+}
+
+std::vector<gpt_vocab::id> gpt_tokenize(const gpt_tokenizer & tokenizer, const std::string & text) {
     std::vector<gpt_vocab::id> tokens;
-    for (const auto & word : words) {
-        for (int i = 0; i < (int) word.size(); ){
-            for (int j = word.size() - 1; j >= i; j--){
-                auto cand = word.substr(i, j-i+1);
-                auto it = vocab.token_to_id.find(cand);
-                if (it != vocab.token_to_id.end()){ // word.substr(i, j-i+1) in vocab
-                    tokens.push_back(it->second);
-                    i = j + 1;
-                    break;
-                }
-                else if (j == i){ // word.substr(i, 1) has no matching
-                    fprintf(stderr, "%s: unknown token '%s'\n", __func__, word.substr(i, 1).data());
-                    i++;
-                }
+    tokens.reserve(text.size()/4);
+
+    gpt_tokenize(tokenizer, text.data(), text.size(), tokens);
+
+    return tokens;
+}
+
+void gpt_detokenize(const gpt_tokenizer & tokenizer, const gpt_vocab::id * tokens, size_t n_tokens, std::string & text) {
+    const int32_t n_ids = tokenizer.index.size();
+
+    for (size_t i = 0; i < n_tokens; ++i) {
+        const gpt_vocab::id id = tokens[i];
+        if (id < 0 || id >= n_ids) {
+            continue;
+        }
+        text.append(tokenizer.index.data(id), tokenizer.index.len(id));
+    }
+}
+
+gpt_worker_pool::gpt_worker_pool(int n_threads) {
+    workers.reserve(std::max(0, n_threads - 1));
+    for (int i = 1; i < n_threads; ++i) {
+        workers.emplace_back(&gpt_worker_pool::worker, this, i);
+    }
+}
+
+gpt_worker_pool::~gpt_worker_pool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stop = true;
+    }
+    cond_work.notify_all();
+
+    for (auto & w : workers) {
+        w.join();
+    }
+}
+
+void gpt_worker_pool::worker(int ith) {
+    unsigned seen = 0;
+
+    while (true) {
+        const std::function<void()> * fn = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cond_work.wait(lock, [&] { return stop || generation != seen; });
+            if (stop) {
+                return;
             }
+            seen = generation;
+            if (ith < n_job) {
+                fn = job;
+            }
+        }
+
+        if (fn == nullptr) {
+            continue;
+        }
+
+        (*fn)();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (--n_pending == 0) {
+            cond_done.notify_one();
         }
     }
+}
 
-    return tokens;
+void gpt_worker_pool::run(int n, const std::function<void()> & fn) {
+    n = std::max(1, std::min(n, size()));
+
+    std::lock_guard<std::mutex> lock_run(mutex_run);
+
+    if (n > 1) {
+        std::lock_guard<std::mutex> lock(mutex);
+        job       = &fn;
+        n_job     = n;
+        n_pending = n - 1;
+        generation++;
+        cond_work.notify_all();
+    }
+
+    fn();
+
+    if (n > 1) {
+        std::unique_lock<std::mutex> lock(mutex);
+        cond_done.wait(lock, [&] { return n_pending == 0; });
+        job   = nullptr;
+        n_job = 0;
+    }
+}
+
+// texts are handed out to the threads in chunks of this many texts
+#define GPT_TOKENIZE_BATCH_CHUNK 64
+
+void gpt_tokenize_batch(
+        const gpt_tokenizer & tokenizer,
+        const std::vector<std::string> & texts,
+        gpt_worker_pool & pool,
+        std::vector<gpt_vocab::id> & tokens,
+        std::vector<size_t> & offsets) {
+    const int n_texts  = texts.size();
+    const int n_chunks = (n_texts + GPT_TOKENIZE_BATCH_CHUNK - 1)/GPT_TOKENIZE_BATCH_CHUNK;
+
+    offsets.assign(n_texts + 1, 0);
+
+    // each chunk is tokenized into its own buffer, the chunks are claimed
+    // dynamically so that threads with short texts pick up more work
+    std::vector<std::vector<gpt_vocab::id>> chunk_tokens(n_chunks);
+    std::atomic<int> next_chunk(0);
+
+    pool.run(n_chunks, [&]() {
+        gpt_bpe_workspace ws;
+        while (true) {
+            const int ic = next_chunk.fetch_add(1);
+            if (ic >= n_chunks) {
+                break;
+            }
+
+            const int i0 = ic*GPT_TOKENIZE_BATCH_CHUNK;
+            const int i1 = std::min(n_texts, i0 + GPT_TOKENIZE_BATCH_CHUNK);
+
+            size_t n_bytes = 0;
+            for (int i = i0; i < i1; ++i) {
+                n_bytes += texts[i].size();
+            }
+
+            auto & cur = chunk_tokens[ic];
+            cur.reserve(n_bytes/4);
+
+            for (int i = i0; i < i1; ++i) {
+                gpt_tokenize(tokenizer, texts[i].data(), texts[i].size(), ws, cur);
+                // number of tokens of text i, turned into offsets below
+                offsets[i + 1] = cur.size();
+            }
+        }
+    });
+
+    // chunk-relative end positions -> global offsets
+    std::vector<size_t> chunk_offs(n_chunks + 1, 0);
+    for (int ic = 0; ic < n_chunks; ++ic) {
+        const int i0 = ic*GPT_TOKENIZE_BATCH_CHUNK;
+        const int i1 = std::min(n_texts, i0 + GPT_TOKENIZE_BATCH_CHUNK);
+        for (int i = i0; i < i1; ++i) {
+            offsets[i + 1] += chunk_offs[ic];
+        }
+        chunk_offs[ic + 1] = chunk_offs[ic] + chunk_tokens[ic].size();
+    }
+
+    tokens.resize(chunk_offs[n_chunks]);
+
+    // gather the chunks into the flat buffer, on the same threads
+    next_chunk = 0;
+    pool.run(n_chunks, [&]() {
+        while (true) {
+            const int ic = next_chunk.fetch_add(1);
+            if (ic >= n_chunks) {
+                break;
+            }
+            std::copy(chunk_tokens[ic].begin(), chunk_tokens[ic].end(), tokens.begin() + chunk_offs[ic]);
+            std::vector<gpt_vocab::id>().swap(chunk_tokens[ic]);
+        }
+    });
+}
+
+bool gpt_detokenize_batch(
+        const gpt_tokenizer & tokenizer,
+        const std::vector<gpt_vocab::id> & tokens,
+        const std::vector<size_t> & offsets,
+        gpt_worker_pool & pool,
+        std::vector<std::string> & texts) {
+    texts.clear();
+
+    // the offsets come from the caller, every text has to be inside of tokens
+    if (offsets.empty() || offsets.front() != 0 || offsets.back() != tokens.size() ||
+        !std::is_sorted(offsets.begin(), offsets.end())) {
+        fprintf(stderr, "%s: invalid offsets, %zu of them for %zu tokens\n", __func__, offsets.size(), tokens.size());
+        return false;
+    }
+
+    const int n_texts  = offsets.size() - 1;
+    const int n_chunks = (n_texts + GPT_TOKENIZE_BATCH_CHUNK - 1)/GPT_TOKENIZE_BATCH_CHUNK;
+
+    texts.resize(n_texts);
+
+    std::atomic<int> next_chunk(0);
+
+    pool.run(n_chunks, [&]() {
+        while (true) {
+            const int ic = next_chunk.fetch_add(1);
+            if (ic >= n_chunks) {
+                break;
+            }
+
+            const int i0 = ic*GPT_TOKENIZE_BATCH_CHUNK;
+            const int i1 = std::min(n_texts, i0 + GPT_TOKENIZE_BATCH_CHUNK);
+
+            for (int i = i0; i < i1; ++i) {
+                gpt_detokenize(tokenizer, tokens.data() + offsets[i], offsets[i + 1] - offsets[i], texts[i]);
+            }
+        }
+    });
+
+    return true;
+}
+
+std::vector<gpt_vocab::id> gpt_tokenize(const gpt_vocab & vocab, const std::string & text) {
+    gpt_tokenizer tokenizer;
+    gpt_tokenizer_init(tokenizer, vocab);
+
+    return gpt_tokenize(tokenizer, text);
 }
 
 std::vector<gpt_vocab::id> parse_tokens_from_string(const std::string& input, char delimiter) {
@@ -370,8 +1007,11 @@ void test_gpt_tokenizer(gpt_vocab & vocab, const std::string & fpath_test){
 
     size_t n_fails = 0;
 
+    gpt_tokenizer tokenizer;
+    gpt_tokenizer_init(tokenizer, vocab);
+
     for (const auto & test : tests) {
-        std::vector<gpt_vocab::id> tokens = gpt_tokenize(vocab, test.first);
+        std::vector<gpt_vocab::id> tokens = gpt_tokenize(tokenizer, test.first);
 
         if (tokens != test.second){
             n_fails++;
@@ -380,12 +1020,12 @@ void test_gpt_tokenizer(gpt_vocab & vocab, const std::string & fpath_test){
             fprintf(stderr, "%s : failed test: '%s'\n", __func__, test.first.c_str());
             fprintf(stderr, "%s : tokens in hf:   ", __func__);
             for (const auto & t : test.second) {
-                fprintf(stderr, "%s(%d), ", vocab.id_to_token[t].c_str(), t);
+                fprintf(stderr, "%s(%d), ", vocab.get_token(t).c_str(), t);
             }
             fprintf(stderr, "\n");
             fprintf(stderr, "%s : tokens in ggml: ", __func__);
             for (const auto & t : tokens) {
-                fprintf(stderr, "%s(%d), ", vocab.id_to_token[t].c_str(), t);
+                fprintf(stderr, "%s(%d), ", vocab.get_token(t).c_str(), t);
             }
             fprintf(stderr, "\n");
         }
@@ -413,84 +1053,149 @@ bool gpt_vocab_init(const std::string & fname, gpt_vocab & vocab) {
     return true;
 }
 
-gpt_vocab::id gpt_sample_top_k_top_p(
-        const gpt_vocab & vocab,
-        const float * logits,
-        int    top_k,
-        double top_p,
-        double temp,
-        std::mt19937 & rng) {
-    int n_logits = vocab.id_to_token.size();
-
-    std::vector<std::pair<double, gpt_vocab::id>> logits_id;
-    logits_id.reserve(n_logits);
-
-    {
-        const double scale = 1.0/temp;
-        for (int i = 0; i < n_logits; ++i) {
-            logits_id.push_back(std::make_pair(logits[i]*scale, i));
+//
+// sampling helpers
+//
+
+// max of x[0..n)
+static float gpt_vec_max(const float * x, int n) {
+    int i = 0;
+    float res = -INFINITY;
+#if defined(__SSE2__) || defined(_M_X64)
+    if (n >= 4) {
+        __m128 vmax = _mm_loadu_ps(x);
+        for (i = 4; i + 4 <= n; i += 4) {
+            vmax = _mm_max_ps(vmax, _mm_loadu_ps(x + i));
         }
+        vmax = _mm_max_ps(vmax, _mm_shuffle_ps(vmax, vmax, _MM_SHUFFLE(2, 3, 0, 1)));
+        vmax = _mm_max_ps(vmax, _mm_shuffle_ps(vmax, vmax, _MM_SHUFFLE(1, 0, 3, 2)));
+        res = _mm_cvtss_f32(vmax);
     }
-
-    // find the top K tokens
-    std::partial_sort(
-            logits_id.begin(),
-            logits_id.begin() + top_k, logits_id.end(),
-            [](const std::pair<double, gpt_vocab::id> & a, const std::pair<double, gpt_vocab::id> & b) {
-        return a.first > b.first;
-    });
-
-    logits_id.resize(top_k);
-
-    double maxl = -INFINITY;
-    for (const auto & kv : logits_id) {
-        maxl = std::max(maxl, kv.first);
+#elif defined(__ARM_NEON)
+    if (n >= 4) {
+        float32x4_t vmax = vld1q_f32(x);
+        for (i = 4; i + 4 <= n; i += 4) {
+            vmax = vmaxq_f32(vmax, vld1q_f32(x + i));
+        }
+        float32x2_t m2 = vpmax_f32(vget_low_f32(vmax), vget_high_f32(vmax));
+        m2 = vpmax_f32(m2, m2);
+        res = vget_lane_f32(m2, 0);
     }
+#endif
+    for (; i < n; ++i) {
+        res = std::max(res, x[i]);
+    }
+    return res;
+}
 
-    // compute probs for the top K tokens
-    std::vector<double> probs;
-    probs.reserve(logits_id.size());
-
+// x[i] = exp(x[i] - max), returns the sum of the results
+//
+// the SIMD paths use the Cephes expf polynomial - the arguments are always <= 0,
+// so only the lower bound has to be clamped
+//
+static float gpt_vec_soft_max_inplace(float * x, int n, float max) {
+    int i = 0;
     double sum = 0.0;
-    for (const auto & kv : logits_id) {
-        double p = exp(kv.first - maxl);
-        probs.push_back(p);
-        sum += p;
-    }
+#if defined(__SSE2__) || defined(_M_X64)
+    {
+        const __m128 vmax  = _mm_set1_ps(max);
+        const __m128 vlo   = _mm_set1_ps(-87.3f);
+        const __m128 log2e = _mm_set1_ps(1.44269504088896341f);
+        const __m128 half  = _mm_set1_ps(0.5f);
+        const __m128 c1    = _mm_set1_ps(0.693359375f);
+        const __m128 c2    = _mm_set1_ps(-2.12194440e-4f);
+        const __m128 one   = _mm_set1_ps(1.0f);
+
+        __m128 vsum = _mm_setzero_ps();
+        for (; i + 4 <= n; i += 4) {
+            __m128 v = _mm_max_ps(_mm_sub_ps(_mm_loadu_ps(x + i), vmax), vlo);
+
+            // round to nearest - v is never positive
+            const __m128i k = _mm_cvttps_epi32(_mm_sub_ps(_mm_mul_ps(v, log2e), half));
+            const __m128  fk = _mm_cvtepi32_ps(k);
+
+            v = _mm_sub_ps(v, _mm_mul_ps(fk, c1));
+            v = _mm_sub_ps(v, _mm_mul_ps(fk, c2));
+
+            __m128 p = _mm_set1_ps(1.9875691500e-4f);
+            p = _mm_add_ps(_mm_mul_ps(p, v), _mm_set1_ps(1.3981999507e-3f));
+            p = _mm_add_ps(_mm_mul_ps(p, v), _mm_set1_ps(8.3334519073e-3f));
+            p = _mm_add_ps(_mm_mul_ps(p, v), _mm_set1_ps(4.1665795894e-2f));
+            p = _mm_add_ps(_mm_mul_ps(p, v), _mm_set1_ps(1.6666665459e-1f));
+            p = _mm_add_ps(_mm_mul_ps(p, v), _mm_set1_ps(5.0000001201e-1f));
+            p = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, v), v), _mm_add_ps(v, one));
+
+            // scale by 2^k
+            const __m128i e = _mm_slli_epi32(_mm_add_epi32(k, _mm_set1_epi32(127)), 23);
+            p = _mm_mul_ps(p, _mm_castsi128_ps(e));
+
+            _mm_storeu_ps(x + i, p);
+            vsum = _mm_add_ps(vsum, p);
+        }
 
-    // normalize the probs
-    for (auto & p : probs) {
-        p /= sum;
+        float tmp[4];
+        _mm_storeu_ps(tmp, vsum);
+        sum += (double) tmp[0] + tmp[1] + tmp[2] + tmp[3];
     }
-
-    if (top_p < 1.0f) {
-        double cumsum = 0.0f;
-        for (int i = 0; i < top_k; i++) {
-            cumsum += probs[i];
-            if (cumsum >= top_p) {
-                top_k = i + 1;
-                probs.resize(top_k);
-                logits_id.resize(top_k);
-                break;
-            }
+#elif defined(__ARM_NEON)
+    {
+        const float32x4_t vmax  = vdupq_n_f32(max);
+        const float32x4_t vlo   = vdupq_n_f32(-87.3f);
+        const float32x4_t log2e = vdupq_n_f32(1.44269504088896341f);
+        const float32x4_t half  = vdupq_n_f32(0.5f);
+        const float32x4_t c1    = vdupq_n_f32(0.693359375f);
+        const float32x4_t c2    = vdupq_n_f32(-2.12194440e-4f);
+        const float32x4_t one   = vdupq_n_f32(1.0f);
+
+        float32x4_t vsum = vdupq_n_f32(0.0f);
+        for (; i + 4 <= n; i += 4) {
+            float32x4_t v = vmaxq_f32(vsubq_f32(vld1q_f32(x + i), vmax), vlo);
+
+            // round to nearest - v is never positive
+            const int32x4_t   k  = vcvtq_s32_f32(vsubq_f32(vmulq_f32(v, log2e), half));
+            const float32x4_t fk = vcvtq_f32_s32(k);
+
+            v = vmlsq_f32(v, fk, c1);
+            v = vmlsq_f32(v, fk, c2);
+
+            float32x4_t p = vdupq_n_f32(1.9875691500e-4f);
+            p = vmlaq_f32(vdupq_n_f32(1.3981999507e-3f), p, v);
+            p = vmlaq_f32(vdupq_n_f32(8.3334519073e-3f), p, v);
+            p = vmlaq_f32(vdupq_n_f32(4.1665795894e-2f), p, v);
+            p = vmlaq_f32(vdupq_n_f32(1.6666665459e-1f), p, v);
+            p = vmlaq_f32(vdupq_n_f32(5.0000001201e-1f), p, v);
+            p = vmlaq_f32(vaddq_f32(v, one), vmulq_f32(p, v), v);
+
+            // scale by 2^k
+            const int32x4_t e = vshlq_n_s32(vaddq_s32(k, vdupq_n_s32(127)), 23);
+            p = vmulq_f32(p, vreinterpretq_f32_s32(e));
+
+            vst1q_f32(x + i, p);
+            vsum = vaddq_f32(vsum, p);
         }
 
-        cumsum = 1.0/cumsum;
-        for (int i = 0; i < (int) probs.size(); i++) {
-            probs[i] *= cumsum;
-        }
+        float tmp[4];
+        vst1q_f32(tmp, vsum);
+        sum += (double) tmp[0] + tmp[1] + tmp[2] + tmp[3];
     }
+#endif
+    for (; i < n; ++i) {
+        x[i] = expf(x[i] - max);
+        sum += x[i];
+    }
+    return sum;
+}
 
-    //printf("\n");
-    //for (int i = 0; i < (int) probs.size(); i++) {
-    //    printf("%d: '%s' %f\n", i, vocab.id_to_token.at(logits_id[i].second).c_str(), probs[i]);
-    //}
-    //exit(0);
-
-    std::discrete_distribution<> dist(probs.begin(), probs.end());
-    int idx = dist(rng);
+gpt_vocab::id gpt_sample_top_k_top_p(
+        const gpt_vocab & vocab,
+        const float * logits,
+        int    top_k,
+        double top_p,
+        double temp,
+        std::mt19937 & rng) {
+    static thread_local gpt_sample_workspace ws;
 
-    return logits_id[idx].second;
+    return gpt_sample_top_k_top_p_repeat(vocab, logits, nullptr, 0, top_k, top_p, temp, 0, 1.0f, ws, rng);
 }
 
 gpt_vocab::id gpt_sample_top_k_top_p_repeat(
@@ -504,109 +1209,213 @@ gpt_vocab::id gpt_sample_top_k_top_p_repeat(
         int repeat_last_n,
         float repeat_penalty,
         std::mt19937 & rng) {
+    static thread_local gpt_sample_workspace ws;
 
-    int n_logits = vocab.id_to_token.size();
-
-    const auto * plogits = logits;
+    return gpt_sample_top_k_top_p_repeat(vocab, logits, last_n_tokens_data, last_n_tokens_data_size, top_k, top_p, temp, repeat_last_n, repeat_penalty, ws, rng);
+}
 
-    const auto last_n_tokens = std::vector<int32_t>(last_n_tokens_data, last_n_tokens_data + last_n_tokens_data_size);
+gpt_vocab::id gpt_sample_top_k_top_p_repeat(
+        const gpt_vocab & vocab,
+        const float * logits,
+        const int32_t * last_n_tokens_data,
+        size_t last_n_tokens_data_size,
+        int    top_k,
+        double top_p,
+        double temp,
+        int repeat_last_n,
+        float repeat_penalty,
+        gpt_sample_workspace & ws,
+        std::mt19937 & rng) {
+    const int n_logits = vocab.size();
 
     if (temp <= 0) {
         // select the token with the highest logit directly
-        float max_logit = plogits[0];
+        float max_logit = logits[0];
         gpt_vocab::id max_id = 0;
 
         for (int i = 1; i < n_logits; ++i) {
-            if (plogits[i] > max_logit) {
-                max_logit = plogits[i];
+            if (logits[i] > max_logit) {
+                max_logit = logits[i];
                 max_id = i;
             }
         }
         return max_id;
     }
 
+    if (top_k <= 0 || top_k > n_logits) {
+        top_k = n_logits;
+    }
 
-    std::vector<std::pair<double, gpt_vocab::id>> logits_id;
-    logits_id.reserve(n_logits);
+    ws.logits.resize(n_logits);
 
     {
         const float scale = 1.0f/temp;
+        float * wl = ws.logits.data();
         for (int i = 0; i < n_logits; ++i) {
-            // repetition penalty from ctrl paper (https://arxiv.org/abs/1909.05858)
-            // credit https://github.com/facebookresearch/llama/compare/main...shawwn:llama:main
-            if (repeat_last_n > 0 && std::find(last_n_tokens.end()-repeat_last_n, last_n_tokens.end(), i) != last_n_tokens.end()) {
-                // if score < 0 then repetition penalty has to multiplied to reduce the previous token probability
-                if (plogits[i] < 0.0f) {
-                    logits_id.push_back(std::make_pair(plogits[i]*scale*repeat_penalty, i));
-                } else {
-                    logits_id.push_back(std::make_pair(plogits[i]*scale/repeat_penalty, i));
-                }
+            wl[i] = logits[i]*scale;
+        }
+    }
+
+    // repetition penalty from ctrl paper (https://arxiv.org/abs/1909.05858)
+    // credit https://github.com/facebookresearch/llama/compare/main...shawwn:llama:main
+    if (repeat_last_n > 0 && repeat_penalty != 1.0f && last_n_tokens_data_size > 0) {
+        if ((int) ws.seen.size() != n_logits) {
+            ws.seen.assign(n_logits, 0);
+            ws.stamp = 0;
+        }
+        if (++ws.stamp == 0) {
+            std::fill(ws.seen.begin(), ws.seen.end(), 0);
+            ws.stamp = 1;
+        }
+
+        const size_t n_last = std::min((size_t) repeat_last_n, last_n_tokens_data_size);
+        const int32_t * last = last_n_tokens_data + (last_n_tokens_data_size - n_last);
+
+        for (size_t i = 0; i < n_last; ++i) {
+            const int32_t id = last[i];
+            if (id < 0 || id >= n_logits || ws.seen[id] == ws.stamp) {
+                continue;
+            }
+            ws.seen[id] = ws.stamp;
+
+            // if score < 0 then repetition penalty has to multiplied to reduce the previous token probability
+            if (ws.logits[id] < 0.0f) {
+                ws.logits[id] *= repeat_penalty;
             } else {
-                logits_id.push_back(std::make_pair(plogits[i]*scale, i));
+                ws.logits[id] /= repeat_penalty;
             }
         }
     }
 
-    // find the top K tokens
-    std::partial_sort(
-            logits_id.begin(),
-            logits_id.begin() + top_k, logits_id.end(),
-            [](const std::pair<double, gpt_vocab::id> & a, const std::pair<double, gpt_vocab::id> & b) {
-        return a.first > b.first;
-    });
+    // the max logit is always part of the top K tokens
+    const float maxl = gpt_vec_max(ws.logits.data(), n_logits);
 
-    logits_id.resize(top_k);
+    // find the top K tokens
+    ws.ids.resize(top_k);
+    ws.probs.resize(n_logits);
+
+    if (top_k <= n_logits/64) {
+        // small K - keep a min-heap of the best K tokens, most logits are
+        // rejected with a single compare against the heap top
+        const float * wl = ws.logits.data();
+        const auto cmp = [wl](gpt_vocab::id a, gpt_vocab::id b) {
+            return wl[a] > wl[b];
+        };
+
+        for (int i = 0; i < top_k; ++i) {
+            ws.ids[i] = i;
+        }
+        std::make_heap(ws.ids.begin(), ws.ids.end(), cmp);
 
-    double maxl = -INFINITY;
-    for (const auto & kv : logits_id) {
-        maxl = std::max(maxl, kv.first);
+        for (int i = top_k; i < n_logits; ++i) {
+            if (wl[i] > wl[ws.ids[0]]) {
+                std::pop_heap(ws.ids.begin(), ws.ids.end(), cmp);
+                ws.ids[top_k - 1] = i;
+                std::push_heap(ws.ids.begin(), ws.ids.end(), cmp);
+            }
+        }
+    } else if (top_k < n_logits) {
+        // select the K-th largest logit on a plain copy of the logits, then
+        // gather the tokens above it - much cheaper than an indirect sort
+        std::copy(ws.logits.begin(), ws.logits.end(), ws.probs.begin());
+        std::nth_element(ws.probs.begin(), ws.probs.begin() + top_k - 1, ws.probs.end(), std::greater<float>());
+
+        const float kth = ws.probs[top_k - 1];
+
+        int n_ids = 0;
+        for (int i = 0; i < n_logits && n_ids < top_k; ++i) {
+            if (ws.logits[i] > kth) {
+                ws.ids[n_ids++] = i;
+            }
+        }
+        for (int i = 0; i < n_logits && n_ids < top_k; ++i) {
+            if (ws.logits[i] == kth) {
+                ws.ids[n_ids++] = i;
+            }
+        }
+    } else {
+        for (int i = 0; i < n_logits; ++i) {
+            ws.ids[i] = i;
+        }
     }
 
     // compute probs for the top K tokens
-    std::vector<double> probs;
-    probs.reserve(logits_id.size());
-
-    double sum = 0.0;
-    for (const auto & kv : logits_id) {
-        double p = exp(kv.first - maxl);
-        probs.push_back(p);
-        sum += p;
+    ws.probs.resize(top_k);
+    for (int i = 0; i < top_k; ++i) {
+        ws.probs[i] = ws.logits[ws.ids[i]];
     }
 
-    // normalize the probs
-    for (auto & p : probs) {
-        p /= sum;
-    }
+    const double sum = gpt_vec_soft_max_inplace(ws.probs.data(), top_k, maxl);
+
+    std::uniform_real_distribution<double> dist(0.0, 1.0);
 
     if (top_p < 1.0f) {
-        double cumsum = 0.0f;
-        for (int i = 0; i < top_k; i++) {
-            cumsum += probs[i];
-            if (cumsum >= top_p) {
-                top_k = i + 1;
-                probs.resize(top_k);
-                logits_id.resize(top_k);
+        // sort the candidates by prob in growing chunks, until the cumulative
+        // probability reaches top_p - usually only a handful of tokens
+        ws.order.resize(top_k);
+        for (int i = 0; i < top_k; ++i) {
+            ws.order[i] = i;
+        }
+
+        const float * probs = ws.probs.data();
+        const auto cmp = [probs](int32_t a, int32_t b) {
+            return probs[a] > probs[b];
+        };
+
+        const double threshold = top_p*sum;
+
+        // tokens below eps sum up to less than (1 - top_p) in total, so they
+        // can never be part of the nucleus - drop them before sorting
+        const float eps = (1.0 - top_p)*sum/top_k;
+        const int n_cand = std::partition(ws.order.begin(), ws.order.end(), [probs, eps](int32_t i) {
+            return probs[i] >= eps;
+        }) - ws.order.begin();
+
+        double cumsum = 0.0;
+        int n_top = n_cand;
+        int n_sorted = 0;
+        int chunk = 64;
+
+        while (n_sorted < n_cand) {
+            const int end = std::min(n_cand, n_sorted + chunk);
+            std::partial_sort(ws.order.begin() + n_sorted, ws.order.begin() + end, ws.order.begin() + n_cand, cmp);
+
+            for (int i = n_sorted; i < end; ++i) {
+                cumsum += probs[ws.order[i]];
+                if (cumsum >= threshold) {
+                    n_top = i + 1;
+                    break;
+                }
+            }
+
+            if (n_top < n_cand) {
                 break;
             }
-        }
 
-        cumsum = 1.0/cumsum;
-        for (int i = 0; i < (int) probs.size(); i++) {
-            probs[i] *= cumsum;
+            n_sorted = end;
+            chunk *= 4;
         }
-    }
 
-//    printf("\n");
-//    for (int i = 0; i < (int) probs.size(); i++) {
-//    for (int i = 0; i < 10; i++) {
-//        printf("%d: '%s' %f\n", i, vocab.id_to_token.at(logits_id[i].second).c_str(), probs[i]);
-//    }
+        double r = dist(rng)*cumsum;
+        for (int i = 0; i < n_top; ++i) {
+            r -= probs[ws.order[i]];
+            if (r < 0.0) {
+                return ws.ids[ws.order[i]];
+            }
+        }
 
-    std::discrete_distribution<> dist(probs.begin(), probs.end());
-    int idx = dist(rng);
+        return ws.ids[ws.order[n_top - 1]];
+    }
 
-    return logits_id[idx].second;
+    double r = dist(rng)*sum;
+    for (int i = 0; i < top_k; ++i) {
+        r -= ws.probs[i];
+        if (r < 0.0) {
+            return ws.ids[i];
+        }
+    }
 
+    return ws.ids[top_k - 1];
 }
 
 bool read_wav(const std::string & fname, std::vector<float>& pcmf32, std::vector<std::vector<float>>& pcmf32s, bool stereo) {
@@ -2,11 +2,15 @@
 
 #pragma once
 
+#include <iosfwd>
 #include <string>
 #include <map>
 #include <vector>
 #include <random>
 #include <thread>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
 
 #define COMMON_SAMPLE_RATE 16000
 
@@ -54,6 +58,39 @@ std::string replace(
         const std::string & from,
         const std::string & to);
 
+// contiguous vocab: all token strings in one arena + a hash index over them
+//
+// can be stored in the header of a model container as a precompiled section (gpt_vocab_write) and
+// loaded back with a few bulk reads, without parsing or hashing every token:
+//
+//   uint32_t magic;                // GPT_VOCAB_MAGIC
+//   uint32_t n_vocab;
+//   uint32_t n_bytes;              // size of the arena
+//   uint32_t n_slots;              // size of the hash table, power of 2
+//   uint32_t offsets[n_vocab + 1]; // token id -> offset in the arena
+//   int32_t  table[n_slots];       // FNV-1a hash slot -> token id, -1 if empty
+//   char     arena[n_bytes];
+//
+#define GPT_VOCAB_MAGIC 0x67677662 // "ggvb"
+
+struct gpt_vocab_index {
+    std::string           arena;
+    std::vector<uint32_t> offsets;
+    std::vector<int32_t>  table;
+    uint32_t              table_mask = 0;
+
+    int32_t size() const { return offsets.empty() ? 0 : (int32_t) offsets.size() - 1; }
+
+    // lookup a token string, -1 if it is not in the vocab
+    int32_t find(const char * str, size_t len) const;
+
+    const char * data(int32_t id) const { return arena.data() + offsets[id]; }
+    size_t       len (int32_t id) const { return offsets[id + 1] - offsets[id]; }
+};
+
+// build the index from a id -> token map, on duplicate tokens the last id wins
+void gpt_vocab_index_build(gpt_vocab_index & index, const std::map<int32_t, std::string> & id_to_token);
+
 struct gpt_vocab {
     using id    = int32_t;
     using token = std::string;
@@ -62,9 +99,29 @@ struct gpt_vocab {
     std::map<id, token> id_to_token;
     std::vector<std::string> special_tokens;
 
+    // filled by gpt_vocab_read() instead of the maps above - the lookups below
+    // use it when it is not empty
+    gpt_vocab_index index;
+
     void add_special_token(const std::string & token);
+
+    int32_t size() const;
+    token   get_token(id token_id) const;
+    id      get_id(const token & str) const; // -1 if not found
 };
 
+// read the n_vocab tokens of a model file into vocab.index
+//
+// accepts either a precompiled section (see gpt_vocab_index) or the original
+// n_vocab x (uint32_t len, char[len]) layout. with utf8_bytes the original
+// tokens are decoded one utf-8 codepoint per byte, as needed for the GPT-2
+// byte-level vocabs
+//
+bool gpt_vocab_read(std::istream & fin, int32_t n_vocab, bool utf8_bytes, gpt_vocab & vocab);
+
+// write vocab.index as a precompiled section
+void gpt_vocab_write(std::ostream & fout, const gpt_vocab & vocab);
+
 // poor-man's JSON parsing
 std::map<std::string, int32_t> json_parse(const std::string & fname);
 
@@ -84,8 +141,96 @@ void gpt_split_words(std::string str, std::vector<std::string>& words);
 // Regex (C++):
 // R"('s|'t|'re|'ve|'m|'ll|'d| ?[[:alpha:]]+| ?[[:digit:]]+| ?[^\s[:alpha:][:digit:]]+|\s+(?!\S)|\s+)"
 //
+// builds a temporary gpt_tokenizer - keep a gpt_tokenizer around when tokenizing
+// more than once
+//
 std::vector<gpt_vocab::id> gpt_tokenize(const gpt_vocab & vocab, const std::string & text);
 
+// BPE tokenizer
+//
+// built once from a vocab with gpt_tokenizer_init(), read-only afterwards - can be
+// shared by any number of threads calling gpt_tokenize() on it
+//
+//   - hand-written pre-tokenizer, splits the text exactly like the regex above
+//   - tokens are looked up in a flat open-addressing hash over a string arena,
+//     without creating temporary strings
+//   - words that are not a single token are split with BPE merges. the model
+//     files do not store the merges, so the rank of a merge is the id of the
+//     merged token - the GPT-2 and GPT-NeoX vocabs are numbered in merge order
+//
+struct gpt_tokenizer {
+    gpt_vocab_index index;
+
+    std::vector<std::string> special_tokens;
+    bool                     special_first[256] = {}; // first bytes of the special tokens
+
+    gpt_vocab::id find(const char * str, size_t len) const { return index.find(str, len); }
+};
+
+void gpt_tokenizer_init(gpt_tokenizer & tokenizer, const gpt_vocab & vocab);
+
+// tokenize text[0..len) and append the tokens to tokens
+void gpt_tokenize(const gpt_tokenizer & tokenizer, const char * text, size_t len, std::vector<gpt_vocab::id> & tokens);
+
+std::vector<gpt_vocab::id> gpt_tokenize(const gpt_tokenizer & tokenizer, const std::string & text);
+
+// append the text of tokens[0..n_tokens) to text
+void gpt_detokenize(const gpt_tokenizer & tokenizer, const gpt_vocab::id * tokens, size_t n_tokens, std::string & text);
+
+// threads that are started once and then run one job after the other, for the batch tokenizer
+//
+// run(n, fn) calls fn on n of the threads - the calling thread is one of them - and returns when
+// all of them are through; the workers sleep in between, jobs of several callers run one at a time
+//
+struct gpt_worker_pool {
+    explicit gpt_worker_pool(int n_threads);
+    ~gpt_worker_pool();
+
+    gpt_worker_pool(const gpt_worker_pool &) = delete;
+    gpt_worker_pool & operator=(const gpt_worker_pool &) = delete;
+
+    int size() const { return (int) workers.size() + 1; }
+
+    void run(int n, const std::function<void()> & fn);
+
+private:
+    void worker(int ith);
+
+    std::vector<std::thread> workers;
+
+    std::mutex              mutex_run; // held for the whole of a job
+    std::mutex              mutex;
+    std::condition_variable cond_work;
+    std::condition_variable cond_done;
+
+    const std::function<void()> * job = nullptr;
+    int      n_job      = 0; // threads of the job, the caller included
+    int      n_pending  = 0; // workers of the job that are not through yet
+    unsigned generation = 0; // bumped for every job
+    bool     stop       = false;
+};
+
+// tokenize many texts on the threads of pool
+//
+// the tokens of all texts are stored back to back in tokens, the tokens of text i
+// are tokens[offsets[i] .. offsets[i + 1]) - offsets has texts.size() + 1 entries
+//
+void gpt_tokenize_batch(
+        const gpt_tokenizer & tokenizer,
+        const std::vector<std::string> & texts,
+        gpt_worker_pool & pool,
+        std::vector<gpt_vocab::id> & tokens,
+        std::vector<size_t> & offsets);
+
+// inverse of gpt_tokenize_batch() - texts is resized to offsets.size() - 1
+// returns false, with texts empty, if offsets do not start at 0, decrease or do not end at tokens.size()
+bool gpt_detokenize_batch(
+        const gpt_tokenizer & tokenizer,
+        const std::vector<gpt_vocab::id> & tokens,
+        const std::vector<size_t> & offsets,
+        gpt_worker_pool & pool,
+        std::vector<std::string> & texts);
+
 // test outputs of gpt_tokenize
 //
 //   - compare with tokens generated by the huggingface tokenizer
@@ -126,6 +271,62 @@ gpt_vocab::id gpt_sample_top_k_top_p_repeat(
         float repeat_penalty,
         std::mt19937 & rng);
 
+// scratch memory of the samplers
+//
+// keep one per generation loop so the n_vocab sized buffers are allocated once
+// instead of for every sampled token
+//
+struct gpt_sample_workspace {
+    std::vector<float>         logits; // scaled and penalized logits, indexed by token id
+    std::vector<gpt_vocab::id> ids;    // top-k candidate token ids
+    std::vector<float>         probs;  // unnormalized probs of the candidates
+    std::vector<int32_t>       order;  // candidate indices sorted by prob (top-p only)
+
+    // per-token stamp, used to apply the repeat penalty once per unique token
+    std::vector<uint32_t> seen;
+    uint32_t              stamp = 0;
+};
+
+// same as above, but uses the provided workspace
+//
+//   - the repeat penalty is applied once to each unique token in the window
+//   - the top K tokens are selected with nth_element instead of sorting
+//   - the candidates are sorted by probability only as far as top P requires
+//
+gpt_vocab::id gpt_sample_top_k_top_p_repeat(
+        const gpt_vocab & vocab,
+        const float * logits,
+        const int32_t * last_n_tokens_data,
+        size_t last_n_tokens_data_size,
+        int    top_k,
+        double top_p,
+        double temp,
+        int repeat_last_n,
+        float repeat_penalty,
+        gpt_sample_workspace & ws,
+        std::mt19937 & rng);
+
+// window of the last N tokens for the repeat penalty
+//
+// ring buffer - push() is O(1) and the order of the tokens in data is not
+// preserved, which is fine since the samplers only care about which tokens
+// are in the window
+//
+struct gpt_last_n_tokens {
+    std::vector<int32_t> data;
+    size_t head = 0;
+
+    gpt_last_n_tokens(size_t n) : data(n, 0) {}
+
+    void push(int32_t id) {
+        if (data.empty()) {
+            return;
+        }
+        data[head] = id;
+        head = (head + 1) % data.size();
+    }
+};
+
 //
 // Audio utils
 //
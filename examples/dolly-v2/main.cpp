@@ -419,17 +419,17 @@ ggml_tensor * gpt_neox_ff(
 
     cur = ggml_add(ctx0,
         ggml_mul(ctx0,
-            ggml_repeat(ctx0, layer.ln_2_g, cur),
-            cur),
-        ggml_repeat(ctx0, layer.ln_2_b, cur));
+            cur,
+            layer.ln_2_g),
+        layer.ln_2_b);
 
     cur = ggml_mul_mat(ctx0,
             layer.c_mlp_fc_w,
             cur);
 
     cur = ggml_add(ctx0,
-            ggml_repeat(ctx0, layer.c_mlp_fc_b, cur),
-            cur);
+            cur,
+            layer.c_mlp_fc_b);
 
     // GELU activation
     cur = ggml_gelu(ctx0, cur);
@@ -441,8 +441,8 @@ ggml_tensor * gpt_neox_ff(
             cur);
 
     cur = ggml_add(ctx0,
-            ggml_repeat(ctx0, layer.c_mlp_proj_b, cur),
-            cur);
+            cur,
+            layer.c_mlp_proj_b);
     return cur;
 }
 
@@ -513,9 +513,9 @@ bool dollyv2_eval(
 
                 cur = ggml_add(ctx0,
                         ggml_mul(ctx0,
-                            ggml_repeat(ctx0, model.layers[il].ln_1_g, cur),
-                            cur),
-                        ggml_repeat(ctx0, model.layers[il].ln_1_b, cur));
+                            cur,
+                            model.layers[il].ln_1_g),
+                        model.layers[il].ln_1_b);
             }
 
             // compute QKV
@@ -525,8 +525,8 @@ bool dollyv2_eval(
                         cur);
 
                 cur = ggml_add(ctx0,
-                        ggml_repeat(ctx0, model.layers[il].c_attn_attn_b, cur),
-                        cur);
+                        cur,
+                        model.layers[il].c_attn_attn_b);
             }
 
             struct ggml_tensor * Qcur = ggml_cont(ctx0, ggml_view_3d(ctx0, cur, n_embd/n_head, n_head, N, cur->nb[1]/n_head, cur->nb[1], 0*sizeof(float)*n_embd/n_head));
@@ -605,7 +605,7 @@ bool dollyv2_eval(
                         model.layers[il].c_attn_proj_w,
                         cur);
 
-                cur = ggml_add(ctx0, ggml_repeat(ctx0, model.layers[il].c_attn_proj_b, cur), cur);
+                cur = ggml_add(ctx0, cur, model.layers[il].c_attn_proj_b);
             }
         }
 
@@ -639,9 +639,9 @@ bool dollyv2_eval(
         // inpL = ln_f_g*inpL + ln_f_b
         inpL = ggml_add(ctx0,
                 ggml_mul(ctx0,
-                    ggml_repeat(ctx0, model.ln_f_g, inpL),
-                    inpL),
-                ggml_repeat(ctx0, model.ln_f_b, inpL));
+                    inpL,
+                    model.ln_f_g),
+                model.ln_f_b);
     }
 
     // lm_head
@@ -658,6 +658,7 @@ bool dollyv2_eval(
 
     // run the computation
     ggml_build_forward_expand(&gf, inpL);
+    ggml_graph_fuse(&gf);
     ggml_graph_compute_with_ctx(ctx0, &gf, n_threads);
 
     //if (n_past%100 == 0) {
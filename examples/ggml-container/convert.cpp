@@ -0,0 +1,168 @@
+#include "ggml/ggml.h"
+
+#include "common-ggml.h"
+#include "common.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+
+// how the model-specific header of a legacy file is laid out
+enum container_vocab_kind {
+    CONTAINER_VOCAB_COUNTED, // int32 n_vocab, then n_vocab x (uint32 len, bytes)
+    CONTAINER_VOCAB_PLAIN,   // n_vocab x (uint32 len, bytes) or a precompiled vocab section
+    CONTAINER_VOCAB_SCORED,  // n_vocab x (uint32 len, bytes, float score)
+};
+
+struct container_model {
+    const char * name;
+
+    int n_hparams; // int32/float fields after the magic
+    int i_vocab;   // which of them is n_vocab
+
+    container_vocab_kind vocab;
+
+    // store the vocab as a precompiled section (gpt_vocab_write), for the loaders that
+    // read it with gpt_vocab_read(utf8_bytes = true)
+    bool vocab_section;
+};
+
+static const container_model CONTAINER_MODELS[] = {
+    { "gpt-2",     6, 0, CONTAINER_VOCAB_COUNTED, false },
+    { "gpt-j",     7, 0, CONTAINER_VOCAB_COUNTED, false },
+    { "starcoder", 6, 0, CONTAINER_VOCAB_COUNTED, false },
+    { "gpt-neox",  8, 0, CONTAINER_VOCAB_PLAIN,   false },
+    { "dolly-v2",  8, 0, CONTAINER_VOCAB_PLAIN,   false },
+    { "mpt",       8, 4, CONTAINER_VOCAB_PLAIN,   true  },
+    { "replit",    6, 4, CONTAINER_VOCAB_SCORED,  false },
+};
+
+// read hparams + vocab into header, leaving finp at the first tensor
+static bool container_header(std::ifstream & finp, const container_model & model, std::string & header) {
+    const std::streamoff start = finp.tellg();
+
+    int32_t hparams[16];
+    finp.read((char *) hparams, model.n_hparams*sizeof(int32_t));
+
+    int32_t n_vocab = hparams[model.i_vocab];
+
+    gpt_vocab vocab;
+
+    switch (model.vocab) {
+        case CONTAINER_VOCAB_COUNTED:
+        case CONTAINER_VOCAB_PLAIN:
+            {
+                if (model.vocab == CONTAINER_VOCAB_COUNTED) {
+                    finp.read((char *) &n_vocab, sizeof(n_vocab));
+                }
+
+                if (!gpt_vocab_read(finp, n_vocab, model.vocab_section, vocab)) {
+                    return false;
+                }
+            } break;
+        case CONTAINER_VOCAB_SCORED:
+            {
+                for (int i = 0; i < n_vocab; ++i) {
+                    uint32_t len;
+                    finp.read((char *) &len, sizeof(len));
+                    finp.seekg(len + sizeof(float), std::ios::cur);
+                }
+            } break;
+    }
+
+    if (!finp) {
+        return false;
+    }
+
+    const std::streamoff end = finp.tellg();
+
+    // the hparams are copied as they are, the vocab too unless it becomes a section
+    if (model.vocab_section) {
+        std::ostringstream out;
+        out.write((const char *) hparams, model.n_hparams*sizeof(int32_t));
+        gpt_vocab_write(out, vocab);
+        header = out.str();
+    } else {
+        header.resize(end - start);
+        finp.seekg(start);
+        finp.read(&header[0], header.size());
+    }
+
+    return (bool) finp;
+}
+
+// usage:
+//  ./ggml-container-convert mpt models/mpt/ggml-model.bin models/mpt/ggml-model.ggmc [alignment]
+//
+int main(int argc, char ** argv) {
+    if (argc != 4 && argc != 5) {
+        fprintf(stderr, "usage: %s model-type model.bin model.ggmc [alignment]\n", argv[0]);
+        fprintf(stderr, "  model-type:");
+        for (const auto & m : CONTAINER_MODELS) {
+            fprintf(stderr, " %s", m.name);
+        }
+        fprintf(stderr, "\n  alignment: power of two, default %d (use the page size to mmap tensors individually)\n", GGML_CONTAINER_ALIGNMENT);
+        return 1;
+    }
+
+    const container_model * model = nullptr;
+    for (const auto & m : CONTAINER_MODELS) {
+        if (strcmp(m.name, argv[1]) == 0) {
+            model = &m;
+        }
+    }
+
+    if (!model) {
+        fprintf(stderr, "%s: unknown model type '%s'\n", __func__, argv[1]);
+        return 1;
+    }
+
+    const std::string fname_inp = argv[2];
+    const std::string fname_out = argv[3];
+
+    const uint32_t alignment = argc == 5 ? (uint32_t) atoi(argv[4]) : GGML_CONTAINER_ALIGNMENT;
+
+    ggml_time_init();
+
+    const int64_t t_start_us = ggml_time_us();
+
+    auto finp = std::ifstream(fname_inp, std::ios::binary);
+    if (!finp) {
+        fprintf(stderr, "%s: failed to open '%s' for reading\n", __func__, fname_inp.c_str());
+        return 1;
+    }
+
+    // verify magic
+    {
+        uint32_t magic;
+        finp.read((char *) &magic, sizeof(magic));
+        if (magic != GGML_FILE_MAGIC) {
+            fprintf(stderr, "%s: invalid model file '%s' (bad magic)\n", __func__, fname_inp.c_str());
+            return 1;
+        }
+    }
+
+    std::string header;
+    if (!container_header(finp, *model, header)) {
+        fprintf(stderr, "%s: invalid model file '%s' (bad %s header)\n", __func__, fname_inp.c_str(), model->name);
+        return 1;
+    }
+
+    auto fout = std::ofstream(fname_out, std::ios::binary);
+    if (!fout) {
+        fprintf(stderr, "%s: failed to open '%s' for writing\n", __func__, fname_out.c_str());
+        return 1;
+    }
+
+    if (!ggml_container_convert(finp, fout, header, alignment)) {
+        fprintf(stderr, "%s: failed to convert '%s'\n", __func__, fname_inp.c_str());
+        return 1;
+    }
+
+    printf("%s: convert time = %8.2f ms\n", __func__, (ggml_time_us() - t_start_us)/1000.0f);
+
+    return 0;
+}
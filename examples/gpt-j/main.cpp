@@ -442,9 +442,9 @@ bool gptj_eval(
             // cur = ln_1_g*cur + ln_1_b
             cur = ggml_add(ctx0,
                     ggml_mul(ctx0,
-                        ggml_repeat(ctx0, model.layers[il].ln_1_g, cur),
-                        cur),
-                    ggml_repeat(ctx0, model.layers[il].ln_1_b, cur));
+                        cur,
+                        model.layers[il].ln_1_g),
+                    model.layers[il].ln_1_b);
         }
 
         struct ggml_tensor * inpSA = cur;
@@ -533,8 +533,8 @@ bool gptj_eval(
                     inpSA);
 
             cur = ggml_add(ctx0,
-                    ggml_repeat(ctx0, model.layers[il].c_mlp_fc_b, cur),
-                    cur);
+                    cur,
+                    model.layers[il].c_mlp_fc_b);
 
             // GELU activation
             cur = ggml_gelu(ctx0, cur);
@@ -546,8 +546,8 @@ bool gptj_eval(
                     cur);
 
             cur = ggml_add(ctx0,
-                    ggml_repeat(ctx0, model.layers[il].c_mlp_proj_b, cur),
-                    cur);
+                    cur,
+                    model.layers[il].c_mlp_proj_b);
         }
 
         // self-attention + FF
@@ -564,9 +564,9 @@ bool gptj_eval(
         // inpL = ln_f_g*inpL + ln_f_b
         inpL = ggml_add(ctx0,
                 ggml_mul(ctx0,
-                    ggml_repeat(ctx0, model.ln_f_g, inpL),
-                    inpL),
-                ggml_repeat(ctx0, model.ln_f_b, inpL));
+                    inpL,
+                    model.ln_f_g),
+                model.ln_f_b);
     }
 
     // lm_head
@@ -574,8 +574,8 @@ bool gptj_eval(
         inpL = ggml_mul_mat(ctx0, model.lmh_g, inpL);
 
         inpL = ggml_add(ctx0,
-                ggml_repeat(ctx0, model.lmh_b, inpL),
-                inpL);
+                inpL,
+                model.lmh_b);
     }
 
     // logits -> probs
@@ -583,6 +583,7 @@ bool gptj_eval(
 
     // run the computation
     ggml_build_forward_expand(&gf, inpL);
+    ggml_graph_fuse(&gf);
     ggml_graph_compute_with_ctx(ctx0, &gf, n_threads);
 
     //if (n_past%100 == 0) {
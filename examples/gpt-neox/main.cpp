@@ -391,17 +391,17 @@ ggml_tensor * gpt_neox_ff(
 
     cur = ggml_add(ctx0,
         ggml_mul(ctx0,
-            ggml_repeat(ctx0, layer.ln_2_g, cur),
-            cur),
-        ggml_repeat(ctx0, layer.ln_2_b, cur));
+            cur,
+            layer.ln_2_g),
+        layer.ln_2_b);
 
     cur = ggml_mul_mat(ctx0,
             layer.c_mlp_fc_w,
             cur);
 
     cur = ggml_add(ctx0,
-            ggml_repeat(ctx0, layer.c_mlp_fc_b, cur),
-            cur);
+            cur,
+            layer.c_mlp_fc_b);
 
     // GELU activation
     cur = ggml_gelu(ctx0, cur);
@@ -413,8 +413,8 @@ ggml_tensor * gpt_neox_ff(
             cur);
 
     cur = ggml_add(ctx0,
-            ggml_repeat(ctx0, layer.c_mlp_proj_b, cur),
-            cur);
+            cur,
+            layer.c_mlp_proj_b);
     return cur;
 }
 
@@ -495,9 +495,9 @@ bool gpt_neox_eval(
 
                 cur = ggml_add(ctx0,
                         ggml_mul(ctx0,
-                            ggml_repeat(ctx0, model.layers[il].ln_1_g, cur),
-                            cur),
-                        ggml_repeat(ctx0, model.layers[il].ln_1_b, cur));
+                            cur,
+                            model.layers[il].ln_1_g),
+                        model.layers[il].ln_1_b);
             }
 
             // compute QKV
@@ -507,8 +507,8 @@ bool gpt_neox_eval(
                         cur);
 
                 cur = ggml_add(ctx0,
-                        ggml_repeat(ctx0, model.layers[il].c_attn_attn_b, cur),
-                        cur);
+                        cur,
+                        model.layers[il].c_attn_attn_b);
             }
 
             struct ggml_tensor * Qcur = ggml_cont(ctx0, ggml_view_3d(ctx0, cur, n_embd/n_head, n_head, N, cur->nb[1]/n_head, cur->nb[1], 0*sizeof(float)*n_embd/n_head));
@@ -587,7 +587,7 @@ bool gpt_neox_eval(
                         model.layers[il].c_attn_proj_w,
                         cur);
 
-                cur = ggml_add(ctx0, ggml_repeat(ctx0, model.layers[il].c_attn_proj_b, cur), cur);
+                cur = ggml_add(ctx0, cur, model.layers[il].c_attn_proj_b);
             }
         }
 
@@ -624,9 +624,9 @@ bool gpt_neox_eval(
         // inpL = ln_f_g*inpL + ln_f_b
         inpL = ggml_add(ctx0,
                 ggml_mul(ctx0,
-                    ggml_repeat(ctx0, model.ln_f_g, inpL),
-                    inpL),
-                ggml_repeat(ctx0, model.ln_f_b, inpL));
+                    inpL,
+                    model.ln_f_g),
+                model.ln_f_b);
     }
 
     ggml_set_scratch(ctx0, { 0, 0, nullptr, });
@@ -645,6 +645,7 @@ bool gpt_neox_eval(
 
     // run the computation
     ggml_build_forward_expand(&gf, inpL);
+    ggml_graph_fuse(&gf);
     ggml_graph_compute_with_ctx(ctx0, &gf, n_threads);
 
     //if (n_past%100 == 0) {
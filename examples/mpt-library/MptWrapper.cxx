@@ -1025,6 +1025,213 @@ SWIGINTERN void std_vector_Sl_int32_t_Sg__SetRange(std::vector< int32_t > *self,
           throw std::out_of_range("index");
         std::copy(values.begin(), values.end(), self->begin()+index);
       }
+SWIGINTERN std::vector< std::string > *new_std_vector_Sl_std_string_Sg___SWIG_2(int capacity){
+        std::vector< std::string >* pv = 0;
+        if (capacity >= 0) {
+          pv = new std::vector< std::string >();
+          pv->reserve(capacity);
+       } else {
+          throw std::out_of_range("capacity");
+       }
+       return pv;
+      }
+SWIGINTERN std::string std_vector_Sl_std_string_Sg__getitemcopy(std::vector< std::string > *self,int index){
+        if (index>=0 && index<(int)self->size())
+          return (*self)[index];
+        else
+          throw std::out_of_range("index");
+      }
+SWIGINTERN std::vector< std::string >::value_type const &std_vector_Sl_std_string_Sg__getitem(std::vector< std::string > *self,int index){
+        if (index>=0 && index<(int)self->size())
+          return (*self)[index];
+        else
+          throw std::out_of_range("index");
+      }
+SWIGINTERN void std_vector_Sl_std_string_Sg__setitem(std::vector< std::string > *self,int index,std::string const &val){
+        if (index>=0 && index<(int)self->size())
+          (*self)[index] = val;
+        else
+          throw std::out_of_range("index");
+      }
+SWIGINTERN void std_vector_Sl_std_string_Sg__AddRange(std::vector< std::string > *self,std::vector< std::string > const &values){
+        self->insert(self->end(), values.begin(), values.end());
+      }
+SWIGINTERN std::vector< std::string > *std_vector_Sl_std_string_Sg__GetRange(std::vector< std::string > *self,int index,int count){
+        if (index < 0)
+          throw std::out_of_range("index");
+        if (count < 0)
+          throw std::out_of_range("count");
+        if (index >= (int)self->size()+1 || index+count > (int)self->size())
+          throw std::invalid_argument("invalid range");
+        return new std::vector< std::string >(self->begin()+index, self->begin()+index+count);
+      }
+SWIGINTERN void std_vector_Sl_std_string_Sg__Insert(std::vector< std::string > *self,int index,std::string const &x){
+        if (index>=0 && index<(int)self->size()+1)
+          self->insert(self->begin()+index, x);
+        else
+          throw std::out_of_range("index");
+      }
+SWIGINTERN void std_vector_Sl_std_string_Sg__InsertRange(std::vector< std::string > *self,int index,std::vector< std::string > const &values){
+        if (index>=0 && index<(int)self->size()+1)
+          self->insert(self->begin()+index, values.begin(), values.end());
+        else
+          throw std::out_of_range("index");
+      }
+SWIGINTERN void std_vector_Sl_std_string_Sg__RemoveAt(std::vector< std::string > *self,int index){
+        if (index>=0 && index<(int)self->size())
+          self->erase(self->begin() + index);
+        else
+          throw std::out_of_range("index");
+      }
+SWIGINTERN void std_vector_Sl_std_string_Sg__RemoveRange(std::vector< std::string > *self,int index,int count){
+        if (index < 0)
+          throw std::out_of_range("index");
+        if (count < 0)
+          throw std::out_of_range("count");
+        if (index >= (int)self->size()+1 || index+count > (int)self->size())
+          throw std::invalid_argument("invalid range");
+        self->erase(self->begin()+index, self->begin()+index+count);
+      }
+SWIGINTERN std::vector< std::string > *std_vector_Sl_std_string_Sg__Repeat(std::string const &value,int count){
+        if (count < 0)
+          throw std::out_of_range("count");
+        return new std::vector< std::string >(count, value);
+      }
+SWIGINTERN void std_vector_Sl_std_string_Sg__Reverse__SWIG_0(std::vector< std::string > *self){
+        std::reverse(self->begin(), self->end());
+      }
+SWIGINTERN void std_vector_Sl_std_string_Sg__Reverse__SWIG_1(std::vector< std::string > *self,int index,int count){
+        if (index < 0)
+          throw std::out_of_range("index");
+        if (count < 0)
+          throw std::out_of_range("count");
+        if (index >= (int)self->size()+1 || index+count > (int)self->size())
+          throw std::invalid_argument("invalid range");
+        std::reverse(self->begin()+index, self->begin()+index+count);
+      }
+SWIGINTERN void std_vector_Sl_std_string_Sg__SetRange(std::vector< std::string > *self,int index,std::vector< std::string > const &values){
+        if (index < 0)
+          throw std::out_of_range("index");
+        if (index+values.size() > self->size())
+          throw std::out_of_range("index");
+        std::copy(values.begin(), values.end(), self->begin()+index);
+      }
+SWIGINTERN bool std_vector_Sl_std_string_Sg__Contains(std::vector< std::string > *self,std::string const &value){
+        return std::find(self->begin(), self->end(), value) != self->end();
+      }
+SWIGINTERN int std_vector_Sl_std_string_Sg__IndexOf(std::vector< std::string > *self,std::string const &value){
+        int index = -1;
+        std::vector< std::string >::iterator it = std::find(self->begin(), self->end(), value);
+        if (it != self->end())
+          index = (int)(it - self->begin());
+        return index;
+      }
+SWIGINTERN int std_vector_Sl_std_string_Sg__LastIndexOf(std::vector< std::string > *self,std::string const &value){
+        int index = -1;
+        std::vector< std::string >::reverse_iterator rit = std::find(self->rbegin(), self->rend(), value);
+        if (rit != self->rend())
+          index = (int)(self->rend() - 1 - rit);
+        return index;
+      }
+SWIGINTERN bool std_vector_Sl_std_string_Sg__Remove(std::vector< std::string > *self,std::string const &value){
+        std::vector< std::string >::iterator it = std::find(self->begin(), self->end(), value);
+        if (it != self->end()) {
+          self->erase(it);
+          return true;
+        }
+        return false;
+      }
+SWIGINTERN std::vector< size_t > *new_std_vector_Sl_size_t_Sg___SWIG_2(int capacity){
+        std::vector< size_t >* pv = 0;
+        if (capacity >= 0) {
+          pv = new std::vector< size_t >();
+          pv->reserve(capacity);
+       } else {
+          throw std::out_of_range("capacity");
+       }
+       return pv;
+      }
+SWIGINTERN size_t std_vector_Sl_size_t_Sg__getitemcopy(std::vector< size_t > *self,int index){
+        if (index>=0 && index<(int)self->size())
+          return (*self)[index];
+        else
+          throw std::out_of_range("index");
+      }
+SWIGINTERN std::vector< size_t >::value_type const &std_vector_Sl_size_t_Sg__getitem(std::vector< size_t > *self,int index){
+        if (index>=0 && index<(int)self->size())
+          return (*self)[index];
+        else
+          throw std::out_of_range("index");
+      }
+SWIGINTERN void std_vector_Sl_size_t_Sg__setitem(std::vector< size_t > *self,int index,size_t const &val){
+        if (index>=0 && index<(int)self->size())
+          (*self)[index] = val;
+        else
+          throw std::out_of_range("index");
+      }
+SWIGINTERN void std_vector_Sl_size_t_Sg__AddRange(std::vector< size_t > *self,std::vector< size_t > const &values){
+        self->insert(self->end(), values.begin(), values.end());
+      }
+SWIGINTERN std::vector< size_t > *std_vector_Sl_size_t_Sg__GetRange(std::vector< size_t > *self,int index,int count){
+        if (index < 0)
+          throw std::out_of_range("index");
+        if (count < 0)
+          throw std::out_of_range("count");
+        if (index >= (int)self->size()+1 || index+count > (int)self->size())
+          throw std::invalid_argument("invalid range");
+        return new std::vector< size_t >(self->begin()+index, self->begin()+index+count);
+      }
+SWIGINTERN void std_vector_Sl_size_t_Sg__Insert(std::vector< size_t > *self,int index,size_t const &x){
+        if (index>=0 && index<(int)self->size()+1)
+          self->insert(self->begin()+index, x);
+        else
+          throw std::out_of_range("index");
+      }
+SWIGINTERN void std_vector_Sl_size_t_Sg__InsertRange(std::vector< size_t > *self,int index,std::vector< size_t > const &values){
+        if (index>=0 && index<(int)self->size()+1)
+          self->insert(self->begin()+index, values.begin(), values.end());
+        else
+          throw std::out_of_range("index");
+      }
+SWIGINTERN void std_vector_Sl_size_t_Sg__RemoveAt(std::vector< size_t > *self,int index){
+        if (index>=0 && index<(int)self->size())
+          self->erase(self->begin() + index);
+        else
+          throw std::out_of_range("index");
+      }
+SWIGINTERN void std_vector_Sl_size_t_Sg__RemoveRange(std::vector< size_t > *self,int index,int count){
+        if (index < 0)
+          throw std::out_of_range("index");
+        if (count < 0)
+          throw std::out_of_range("count");
+        if (index >= (int)self->size()+1 || index+count > (int)self->size())
+          throw std::invalid_argument("invalid range");
+        self->erase(self->begin()+index, self->begin()+index+count);
+      }
+SWIGINTERN std::vector< size_t > *std_vector_Sl_size_t_Sg__Repeat(size_t const &value,int count){
+        if (count < 0)
+          throw std::out_of_range("count");
+        return new std::vector< size_t >(count, value);
+      }
+SWIGINTERN void std_vector_Sl_size_t_Sg__Reverse__SWIG_0(std::vector< size_t > *self){
+        std::reverse(self->begin(), self->end());
+      }
+SWIGINTERN void std_vector_Sl_size_t_Sg__Reverse__SWIG_1(std::vector< size_t > *self,int index,int count){
+        if (index < 0)
+          throw std::out_of_range("index");
+        if (count < 0)
+          throw std::out_of_range("count");
+        if (index >= (int)self->size()+1 || index+count > (int)self->size())
+          throw std::invalid_argument("invalid range");
+        std::reverse(self->begin()+index, self->begin()+index+count);
+      }
+SWIGINTERN void std_vector_Sl_size_t_Sg__SetRange(std::vector< size_t > *self,int index,std::vector< size_t > const &values){
+        if (index < 0)
+          throw std::out_of_range("index");
+        if (index+values.size() > self->size())
+          throw std::out_of_range("index");
+        std::copy(values.begin(), values.end(), self->begin()+index);
+      }
 SWIGINTERN std::map< std::string,struct ggml_tensor * >::mapped_type const &std_map_Sl_std_string_Sc_struct_SS_ggml_tensor_Sm__Sg__getitem(std::map< std::string,struct ggml_tensor * > *self,std::map< std::string,struct ggml_tensor * >::key_type const &key){
         std::map< std::string, struct ggml_tensor *, std::less< std::string > >::iterator iter = self->find(key);
         if (iter != self->end())
@@ -3406,93 +3613,871 @@ SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_delete_LastNTokens(void * jarg1) {
 }
 
 
-SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_new_Tensors__SWIG_0() {
-  void * jresult ;
-  std::map< std::string,struct ggml_tensor * > *result = 0 ;
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_Messages_Clear(void * jarg1) {
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
   
-  result = (std::map< std::string,struct ggml_tensor * > *)new std::map< std::string,struct ggml_tensor * >();
-  jresult = (void *)result; 
-  return jresult;
+  arg1 = (std::vector< std::string > *)jarg1; 
+  (arg1)->clear();
 }
 
 
-SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_new_Tensors__SWIG_1(void * jarg1) {
-  void * jresult ;
-  std::map< std::string,ggml_tensor * > *arg1 = 0 ;
-  std::map< std::string,struct ggml_tensor * > *result = 0 ;
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_Messages_Add(void * jarg1, const char * jarg2) {
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  std::string *arg2 = 0 ;
   
-  arg1 = (std::map< std::string,ggml_tensor * > *)jarg1;
-  if (!arg1) {
-    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "std::map< std::string,ggml_tensor * > const & is null", 0);
-    return 0;
-  } 
-  result = (std::map< std::string,struct ggml_tensor * > *)new std::map< std::string,struct ggml_tensor * >((std::map< std::string,ggml_tensor * > const &)*arg1);
-  jresult = (void *)result; 
+  arg1 = (std::vector< std::string > *)jarg1; 
+  if (!jarg2) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "null string", 0);
+    return ;
+  }
+  std::string arg2_str(jarg2);
+  arg2 = &arg2_str; 
+  (arg1)->push_back((std::string const &)*arg2);
+}
+
+
+SWIGEXPORT unsigned long SWIGSTDCALL CSharp_MptLibrary_Messages_size(void * jarg1) {
+  unsigned long jresult ;
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  std::vector< std::string >::size_type result;
+  
+  arg1 = (std::vector< std::string > *)jarg1; 
+  result = ((std::vector< std::string > const *)arg1)->size();
+  jresult = (unsigned long)result; 
   return jresult;
 }
 
 
-SWIGEXPORT unsigned long SWIGSTDCALL CSharp_MptLibrary_Tensors_size(void * jarg1) {
+SWIGEXPORT unsigned long SWIGSTDCALL CSharp_MptLibrary_Messages_capacity(void * jarg1) {
   unsigned long jresult ;
-  std::map< std::string,struct ggml_tensor * > *arg1 = (std::map< std::string,struct ggml_tensor * > *) 0 ;
-  std::map< std::string,struct ggml_tensor * >::size_type result;
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  std::vector< std::string >::size_type result;
   
-  arg1 = (std::map< std::string,struct ggml_tensor * > *)jarg1; 
-  result = ((std::map< std::string,struct ggml_tensor * > const *)arg1)->size();
+  arg1 = (std::vector< std::string > *)jarg1; 
+  result = ((std::vector< std::string > const *)arg1)->capacity();
   jresult = (unsigned long)result; 
   return jresult;
 }
 
 
-SWIGEXPORT unsigned int SWIGSTDCALL CSharp_MptLibrary_Tensors_empty(void * jarg1) {
-  unsigned int jresult ;
-  std::map< std::string,struct ggml_tensor * > *arg1 = (std::map< std::string,struct ggml_tensor * > *) 0 ;
-  bool result;
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_Messages_reserve(void * jarg1, unsigned long jarg2) {
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  std::vector< std::string >::size_type arg2 ;
   
-  arg1 = (std::map< std::string,struct ggml_tensor * > *)jarg1; 
-  result = (bool)((std::map< std::string,struct ggml_tensor * > const *)arg1)->empty();
-  jresult = result; 
+  arg1 = (std::vector< std::string > *)jarg1; 
+  arg2 = (std::vector< std::string >::size_type)jarg2; 
+  (arg1)->reserve(arg2);
+}
+
+
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_new_Messages__SWIG_0() {
+  void * jresult ;
+  std::vector< std::string > *result = 0 ;
+  
+  result = (std::vector< std::string > *)new std::vector< std::string >();
+  jresult = (void *)result; 
   return jresult;
 }
 
 
-SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_Tensors_Clear(void * jarg1) {
-  std::map< std::string,struct ggml_tensor * > *arg1 = (std::map< std::string,struct ggml_tensor * > *) 0 ;
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_new_Messages__SWIG_1(void * jarg1) {
+  void * jresult ;
+  std::vector< std::string > *arg1 = 0 ;
+  std::vector< std::string > *result = 0 ;
   
-  arg1 = (std::map< std::string,struct ggml_tensor * > *)jarg1; 
-  (arg1)->clear();
+  arg1 = (std::vector< std::string > *)jarg1;
+  if (!arg1) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "std::vector< std::string > const & is null", 0);
+    return 0;
+  } 
+  result = (std::vector< std::string > *)new std::vector< std::string >((std::vector< std::string > const &)*arg1);
+  jresult = (void *)result; 
+  return jresult;
 }
 
 
-SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_Tensors_getitem(void * jarg1, const char * jarg2) {
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_new_Messages__SWIG_2(int jarg1) {
   void * jresult ;
-  std::map< std::string,struct ggml_tensor * > *arg1 = (std::map< std::string,struct ggml_tensor * > *) 0 ;
-  std::map< std::string,struct ggml_tensor * >::key_type *arg2 = 0 ;
-  std::map< std::string,struct ggml_tensor * >::mapped_type *result = 0 ;
+  int arg1 ;
+  std::vector< std::string > *result = 0 ;
   
-  arg1 = (std::map< std::string,struct ggml_tensor * > *)jarg1; 
-  if (!jarg2) {
-    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "null string", 0);
+  arg1 = (int)jarg1; 
+  try {
+    result = (std::vector< std::string > *)new_std_vector_Sl_std_string_Sg___SWIG_2(arg1);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
     return 0;
   }
-  std::map< std::string,struct ggml_tensor * >::key_type arg2_str(jarg2);
-  arg2 = &arg2_str; 
+  jresult = (void *)result; 
+  return jresult;
+}
+
+
+SWIGEXPORT const char * SWIGSTDCALL CSharp_MptLibrary_Messages_getitemcopy(void * jarg1, int jarg2) {
+  const char * jresult ;
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  int arg2 ;
+  std::string result;
+  
+  arg1 = (std::vector< std::string > *)jarg1; 
+  arg2 = (int)jarg2; 
   try {
-    result = (std::map< std::string,struct ggml_tensor * >::mapped_type *) &std_map_Sl_std_string_Sc_struct_SS_ggml_tensor_Sm__Sg__getitem(arg1,(std::string const &)*arg2);
+    result = std_vector_Sl_std_string_Sg__getitemcopy(arg1,arg2);
   } catch(std::out_of_range &_e) {
     SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
     return 0;
   }
-  jresult = (void *)*result; 
+  jresult = SWIG_csharp_string_callback((&result)->c_str()); 
   return jresult;
 }
 
 
-SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_Tensors_setitem(void * jarg1, const char * jarg2, void * jarg3) {
-  std::map< std::string,struct ggml_tensor * > *arg1 = (std::map< std::string,struct ggml_tensor * > *) 0 ;
-  std::map< std::string,struct ggml_tensor * >::key_type *arg2 = 0 ;
-  std::map< std::string,struct ggml_tensor * >::mapped_type *arg3 = 0 ;
-  std::map< std::string,struct ggml_tensor * >::mapped_type temp3 = 0 ;
+SWIGEXPORT const char * SWIGSTDCALL CSharp_MptLibrary_Messages_getitem(void * jarg1, int jarg2) {
+  const char * jresult ;
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  int arg2 ;
+  std::vector< std::string >::value_type *result = 0 ;
+  
+  arg1 = (std::vector< std::string > *)jarg1; 
+  arg2 = (int)jarg2; 
+  try {
+    result = (std::vector< std::string >::value_type *) &std_vector_Sl_std_string_Sg__getitem(arg1,arg2);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return 0;
+  }
+  jresult = SWIG_csharp_string_callback(result->c_str()); 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_Messages_setitem(void * jarg1, int jarg2, const char * jarg3) {
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  int arg2 ;
+  std::string *arg3 = 0 ;
+  
+  arg1 = (std::vector< std::string > *)jarg1; 
+  arg2 = (int)jarg2; 
+  if (!jarg3) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "null string", 0);
+    return ;
+  }
+  std::string arg3_str(jarg3);
+  arg3 = &arg3_str; 
+  try {
+    std_vector_Sl_std_string_Sg__setitem(arg1,arg2,(std::string const &)*arg3);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return ;
+  }
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_Messages_AddRange(void * jarg1, void * jarg2) {
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  std::vector< std::string > *arg2 = 0 ;
+  
+  arg1 = (std::vector< std::string > *)jarg1; 
+  arg2 = (std::vector< std::string > *)jarg2;
+  if (!arg2) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "std::vector< std::string > const & is null", 0);
+    return ;
+  } 
+  std_vector_Sl_std_string_Sg__AddRange(arg1,(std::vector< std::string > const &)*arg2);
+}
+
+
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_Messages_GetRange(void * jarg1, int jarg2, int jarg3) {
+  void * jresult ;
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  int arg2 ;
+  int arg3 ;
+  std::vector< std::string > *result = 0 ;
+  
+  arg1 = (std::vector< std::string > *)jarg1; 
+  arg2 = (int)jarg2; 
+  arg3 = (int)jarg3; 
+  try {
+    result = (std::vector< std::string > *)std_vector_Sl_std_string_Sg__GetRange(arg1,arg2,arg3);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return 0;
+  } catch(std::invalid_argument &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentException, (&_e)->what(), "");
+    return 0;
+  }
+  jresult = (void *)result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_Messages_Insert(void * jarg1, int jarg2, const char * jarg3) {
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  int arg2 ;
+  std::string *arg3 = 0 ;
+  
+  arg1 = (std::vector< std::string > *)jarg1; 
+  arg2 = (int)jarg2; 
+  if (!jarg3) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "null string", 0);
+    return ;
+  }
+  std::string arg3_str(jarg3);
+  arg3 = &arg3_str; 
+  try {
+    std_vector_Sl_std_string_Sg__Insert(arg1,arg2,(std::string const &)*arg3);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return ;
+  }
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_Messages_InsertRange(void * jarg1, int jarg2, void * jarg3) {
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  int arg2 ;
+  std::vector< std::string > *arg3 = 0 ;
+  
+  arg1 = (std::vector< std::string > *)jarg1; 
+  arg2 = (int)jarg2; 
+  arg3 = (std::vector< std::string > *)jarg3;
+  if (!arg3) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "std::vector< std::string > const & is null", 0);
+    return ;
+  } 
+  try {
+    std_vector_Sl_std_string_Sg__InsertRange(arg1,arg2,(std::vector< std::string > const &)*arg3);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return ;
+  }
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_Messages_RemoveAt(void * jarg1, int jarg2) {
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  int arg2 ;
+  
+  arg1 = (std::vector< std::string > *)jarg1; 
+  arg2 = (int)jarg2; 
+  try {
+    std_vector_Sl_std_string_Sg__RemoveAt(arg1,arg2);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return ;
+  }
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_Messages_RemoveRange(void * jarg1, int jarg2, int jarg3) {
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  int arg2 ;
+  int arg3 ;
+  
+  arg1 = (std::vector< std::string > *)jarg1; 
+  arg2 = (int)jarg2; 
+  arg3 = (int)jarg3; 
+  try {
+    std_vector_Sl_std_string_Sg__RemoveRange(arg1,arg2,arg3);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return ;
+  } catch(std::invalid_argument &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentException, (&_e)->what(), "");
+    return ;
+  }
+}
+
+
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_Messages_Repeat(const char * jarg1, int jarg2) {
+  void * jresult ;
+  std::string *arg1 = 0 ;
+  int arg2 ;
+  std::vector< std::string > *result = 0 ;
+  
+  if (!jarg1) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "null string", 0);
+    return 0;
+  }
+  std::string arg1_str(jarg1);
+  arg1 = &arg1_str; 
+  arg2 = (int)jarg2; 
+  try {
+    result = (std::vector< std::string > *)std_vector_Sl_std_string_Sg__Repeat((std::string const &)*arg1,arg2);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return 0;
+  }
+  jresult = (void *)result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_Messages_Reverse__SWIG_0(void * jarg1) {
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  
+  arg1 = (std::vector< std::string > *)jarg1; 
+  std_vector_Sl_std_string_Sg__Reverse__SWIG_0(arg1);
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_Messages_Reverse__SWIG_1(void * jarg1, int jarg2, int jarg3) {
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  int arg2 ;
+  int arg3 ;
+  
+  arg1 = (std::vector< std::string > *)jarg1; 
+  arg2 = (int)jarg2; 
+  arg3 = (int)jarg3; 
+  try {
+    std_vector_Sl_std_string_Sg__Reverse__SWIG_1(arg1,arg2,arg3);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return ;
+  } catch(std::invalid_argument &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentException, (&_e)->what(), "");
+    return ;
+  }
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_Messages_SetRange(void * jarg1, int jarg2, void * jarg3) {
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  int arg2 ;
+  std::vector< std::string > *arg3 = 0 ;
+  
+  arg1 = (std::vector< std::string > *)jarg1; 
+  arg2 = (int)jarg2; 
+  arg3 = (std::vector< std::string > *)jarg3;
+  if (!arg3) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "std::vector< std::string > const & is null", 0);
+    return ;
+  } 
+  try {
+    std_vector_Sl_std_string_Sg__SetRange(arg1,arg2,(std::vector< std::string > const &)*arg3);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return ;
+  }
+}
+
+
+SWIGEXPORT unsigned int SWIGSTDCALL CSharp_MptLibrary_Messages_Contains(void * jarg1, const char * jarg2) {
+  unsigned int jresult ;
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  std::string *arg2 = 0 ;
+  bool result;
+  
+  arg1 = (std::vector< std::string > *)jarg1; 
+  if (!jarg2) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "null string", 0);
+    return 0;
+  }
+  std::string arg2_str(jarg2);
+  arg2 = &arg2_str; 
+  result = (bool)std_vector_Sl_std_string_Sg__Contains(arg1,(std::string const &)*arg2);
+  jresult = result; 
+  return jresult;
+}
+
+
+SWIGEXPORT int SWIGSTDCALL CSharp_MptLibrary_Messages_IndexOf(void * jarg1, const char * jarg2) {
+  int jresult ;
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  std::string *arg2 = 0 ;
+  int result;
+  
+  arg1 = (std::vector< std::string > *)jarg1; 
+  if (!jarg2) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "null string", 0);
+    return 0;
+  }
+  std::string arg2_str(jarg2);
+  arg2 = &arg2_str; 
+  result = (int)std_vector_Sl_std_string_Sg__IndexOf(arg1,(std::string const &)*arg2);
+  jresult = result; 
+  return jresult;
+}
+
+
+SWIGEXPORT int SWIGSTDCALL CSharp_MptLibrary_Messages_LastIndexOf(void * jarg1, const char * jarg2) {
+  int jresult ;
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  std::string *arg2 = 0 ;
+  int result;
+  
+  arg1 = (std::vector< std::string > *)jarg1; 
+  if (!jarg2) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "null string", 0);
+    return 0;
+  }
+  std::string arg2_str(jarg2);
+  arg2 = &arg2_str; 
+  result = (int)std_vector_Sl_std_string_Sg__LastIndexOf(arg1,(std::string const &)*arg2);
+  jresult = result; 
+  return jresult;
+}
+
+
+SWIGEXPORT unsigned int SWIGSTDCALL CSharp_MptLibrary_Messages_Remove(void * jarg1, const char * jarg2) {
+  unsigned int jresult ;
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  std::string *arg2 = 0 ;
+  bool result;
+  
+  arg1 = (std::vector< std::string > *)jarg1; 
+  if (!jarg2) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "null string", 0);
+    return 0;
+  }
+  std::string arg2_str(jarg2);
+  arg2 = &arg2_str; 
+  result = (bool)std_vector_Sl_std_string_Sg__Remove(arg1,(std::string const &)*arg2);
+  jresult = result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_delete_Messages(void * jarg1) {
+  std::vector< std::string > *arg1 = (std::vector< std::string > *) 0 ;
+  
+  arg1 = (std::vector< std::string > *)jarg1; 
+  delete arg1;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_TokenOffsets_Clear(void * jarg1) {
+  std::vector< size_t > *arg1 = (std::vector< size_t > *) 0 ;
+  
+  arg1 = (std::vector< size_t > *)jarg1; 
+  (arg1)->clear();
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_TokenOffsets_Add(void * jarg1, unsigned long jarg2) {
+  std::vector< size_t > *arg1 = (std::vector< size_t > *) 0 ;
+  size_t *arg2 = 0 ;
+  size_t temp2 ;
+  
+  arg1 = (std::vector< size_t > *)jarg1; 
+  temp2 = (size_t)jarg2; 
+  arg2 = &temp2; 
+  (arg1)->push_back((size_t const &)*arg2);
+}
+
+
+SWIGEXPORT unsigned long SWIGSTDCALL CSharp_MptLibrary_TokenOffsets_size(void * jarg1) {
+  unsigned long jresult ;
+  std::vector< size_t > *arg1 = (std::vector< size_t > *) 0 ;
+  std::vector< size_t >::size_type result;
+  
+  arg1 = (std::vector< size_t > *)jarg1; 
+  result = ((std::vector< size_t > const *)arg1)->size();
+  jresult = (unsigned long)result; 
+  return jresult;
+}
+
+
+SWIGEXPORT unsigned long SWIGSTDCALL CSharp_MptLibrary_TokenOffsets_capacity(void * jarg1) {
+  unsigned long jresult ;
+  std::vector< size_t > *arg1 = (std::vector< size_t > *) 0 ;
+  std::vector< size_t >::size_type result;
+  
+  arg1 = (std::vector< size_t > *)jarg1; 
+  result = ((std::vector< size_t > const *)arg1)->capacity();
+  jresult = (unsigned long)result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_TokenOffsets_reserve(void * jarg1, unsigned long jarg2) {
+  std::vector< size_t > *arg1 = (std::vector< size_t > *) 0 ;
+  std::vector< size_t >::size_type arg2 ;
+  
+  arg1 = (std::vector< size_t > *)jarg1; 
+  arg2 = (std::vector< size_t >::size_type)jarg2; 
+  (arg1)->reserve(arg2);
+}
+
+
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_new_TokenOffsets__SWIG_0() {
+  void * jresult ;
+  std::vector< size_t > *result = 0 ;
+  
+  result = (std::vector< size_t > *)new std::vector< size_t >();
+  jresult = (void *)result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_new_TokenOffsets__SWIG_1(void * jarg1) {
+  void * jresult ;
+  std::vector< size_t > *arg1 = 0 ;
+  std::vector< size_t > *result = 0 ;
+  
+  arg1 = (std::vector< size_t > *)jarg1;
+  if (!arg1) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "std::vector< size_t > const & is null", 0);
+    return 0;
+  } 
+  result = (std::vector< size_t > *)new std::vector< size_t >((std::vector< size_t > const &)*arg1);
+  jresult = (void *)result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_new_TokenOffsets__SWIG_2(int jarg1) {
+  void * jresult ;
+  int arg1 ;
+  std::vector< size_t > *result = 0 ;
+  
+  arg1 = (int)jarg1; 
+  try {
+    result = (std::vector< size_t > *)new_std_vector_Sl_size_t_Sg___SWIG_2(arg1);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return 0;
+  }
+  jresult = (void *)result; 
+  return jresult;
+}
+
+
+SWIGEXPORT unsigned long SWIGSTDCALL CSharp_MptLibrary_TokenOffsets_getitemcopy(void * jarg1, int jarg2) {
+  unsigned long jresult ;
+  std::vector< size_t > *arg1 = (std::vector< size_t > *) 0 ;
+  int arg2 ;
+  size_t result;
+  
+  arg1 = (std::vector< size_t > *)jarg1; 
+  arg2 = (int)jarg2; 
+  try {
+    result = (size_t)std_vector_Sl_size_t_Sg__getitemcopy(arg1,arg2);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return 0;
+  }
+  jresult = (unsigned long)result; 
+  return jresult;
+}
+
+
+SWIGEXPORT unsigned long SWIGSTDCALL CSharp_MptLibrary_TokenOffsets_getitem(void * jarg1, int jarg2) {
+  unsigned long jresult ;
+  std::vector< size_t > *arg1 = (std::vector< size_t > *) 0 ;
+  int arg2 ;
+  std::vector< size_t >::value_type *result = 0 ;
+  
+  arg1 = (std::vector< size_t > *)jarg1; 
+  arg2 = (int)jarg2; 
+  try {
+    result = (std::vector< size_t >::value_type *) &std_vector_Sl_size_t_Sg__getitem(arg1,arg2);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return 0;
+  }
+  jresult = (unsigned long)*result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_TokenOffsets_setitem(void * jarg1, int jarg2, unsigned long jarg3) {
+  std::vector< size_t > *arg1 = (std::vector< size_t > *) 0 ;
+  int arg2 ;
+  size_t *arg3 = 0 ;
+  size_t temp3 ;
+  
+  arg1 = (std::vector< size_t > *)jarg1; 
+  arg2 = (int)jarg2; 
+  temp3 = (size_t)jarg3; 
+  arg3 = &temp3; 
+  try {
+    std_vector_Sl_size_t_Sg__setitem(arg1,arg2,(size_t const &)*arg3);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return ;
+  }
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_TokenOffsets_AddRange(void * jarg1, void * jarg2) {
+  std::vector< size_t > *arg1 = (std::vector< size_t > *) 0 ;
+  std::vector< size_t > *arg2 = 0 ;
+  
+  arg1 = (std::vector< size_t > *)jarg1; 
+  arg2 = (std::vector< size_t > *)jarg2;
+  if (!arg2) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "std::vector< size_t > const & is null", 0);
+    return ;
+  } 
+  std_vector_Sl_size_t_Sg__AddRange(arg1,(std::vector< size_t > const &)*arg2);
+}
+
+
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_TokenOffsets_GetRange(void * jarg1, int jarg2, int jarg3) {
+  void * jresult ;
+  std::vector< size_t > *arg1 = (std::vector< size_t > *) 0 ;
+  int arg2 ;
+  int arg3 ;
+  std::vector< size_t > *result = 0 ;
+  
+  arg1 = (std::vector< size_t > *)jarg1; 
+  arg2 = (int)jarg2; 
+  arg3 = (int)jarg3; 
+  try {
+    result = (std::vector< size_t > *)std_vector_Sl_size_t_Sg__GetRange(arg1,arg2,arg3);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return 0;
+  } catch(std::invalid_argument &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentException, (&_e)->what(), "");
+    return 0;
+  }
+  jresult = (void *)result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_TokenOffsets_Insert(void * jarg1, int jarg2, unsigned long jarg3) {
+  std::vector< size_t > *arg1 = (std::vector< size_t > *) 0 ;
+  int arg2 ;
+  size_t *arg3 = 0 ;
+  size_t temp3 ;
+  
+  arg1 = (std::vector< size_t > *)jarg1; 
+  arg2 = (int)jarg2; 
+  temp3 = (size_t)jarg3; 
+  arg3 = &temp3; 
+  try {
+    std_vector_Sl_size_t_Sg__Insert(arg1,arg2,(size_t const &)*arg3);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return ;
+  }
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_TokenOffsets_InsertRange(void * jarg1, int jarg2, void * jarg3) {
+  std::vector< size_t > *arg1 = (std::vector< size_t > *) 0 ;
+  int arg2 ;
+  std::vector< size_t > *arg3 = 0 ;
+  
+  arg1 = (std::vector< size_t > *)jarg1; 
+  arg2 = (int)jarg2; 
+  arg3 = (std::vector< size_t > *)jarg3;
+  if (!arg3) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "std::vector< size_t > const & is null", 0);
+    return ;
+  } 
+  try {
+    std_vector_Sl_size_t_Sg__InsertRange(arg1,arg2,(std::vector< size_t > const &)*arg3);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return ;
+  }
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_TokenOffsets_RemoveAt(void * jarg1, int jarg2) {
+  std::vector< size_t > *arg1 = (std::vector< size_t > *) 0 ;
+  int arg2 ;
+  
+  arg1 = (std::vector< size_t > *)jarg1; 
+  arg2 = (int)jarg2; 
+  try {
+    std_vector_Sl_size_t_Sg__RemoveAt(arg1,arg2);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return ;
+  }
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_TokenOffsets_RemoveRange(void * jarg1, int jarg2, int jarg3) {
+  std::vector< size_t > *arg1 = (std::vector< size_t > *) 0 ;
+  int arg2 ;
+  int arg3 ;
+  
+  arg1 = (std::vector< size_t > *)jarg1; 
+  arg2 = (int)jarg2; 
+  arg3 = (int)jarg3; 
+  try {
+    std_vector_Sl_size_t_Sg__RemoveRange(arg1,arg2,arg3);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return ;
+  } catch(std::invalid_argument &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentException, (&_e)->what(), "");
+    return ;
+  }
+}
+
+
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_TokenOffsets_Repeat(unsigned long jarg1, int jarg2) {
+  void * jresult ;
+  size_t *arg1 = 0 ;
+  int arg2 ;
+  size_t temp1 ;
+  std::vector< size_t > *result = 0 ;
+  
+  temp1 = (size_t)jarg1; 
+  arg1 = &temp1; 
+  arg2 = (int)jarg2; 
+  try {
+    result = (std::vector< size_t > *)std_vector_Sl_size_t_Sg__Repeat((size_t const &)*arg1,arg2);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return 0;
+  }
+  jresult = (void *)result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_TokenOffsets_Reverse__SWIG_0(void * jarg1) {
+  std::vector< size_t > *arg1 = (std::vector< size_t > *) 0 ;
+  
+  arg1 = (std::vector< size_t > *)jarg1; 
+  std_vector_Sl_size_t_Sg__Reverse__SWIG_0(arg1);
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_TokenOffsets_Reverse__SWIG_1(void * jarg1, int jarg2, int jarg3) {
+  std::vector< size_t > *arg1 = (std::vector< size_t > *) 0 ;
+  int arg2 ;
+  int arg3 ;
+  
+  arg1 = (std::vector< size_t > *)jarg1; 
+  arg2 = (int)jarg2; 
+  arg3 = (int)jarg3; 
+  try {
+    std_vector_Sl_size_t_Sg__Reverse__SWIG_1(arg1,arg2,arg3);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return ;
+  } catch(std::invalid_argument &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentException, (&_e)->what(), "");
+    return ;
+  }
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_TokenOffsets_SetRange(void * jarg1, int jarg2, void * jarg3) {
+  std::vector< size_t > *arg1 = (std::vector< size_t > *) 0 ;
+  int arg2 ;
+  std::vector< size_t > *arg3 = 0 ;
+  
+  arg1 = (std::vector< size_t > *)jarg1; 
+  arg2 = (int)jarg2; 
+  arg3 = (std::vector< size_t > *)jarg3;
+  if (!arg3) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "std::vector< size_t > const & is null", 0);
+    return ;
+  } 
+  try {
+    std_vector_Sl_size_t_Sg__SetRange(arg1,arg2,(std::vector< size_t > const &)*arg3);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return ;
+  }
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_delete_TokenOffsets(void * jarg1) {
+  std::vector< size_t > *arg1 = (std::vector< size_t > *) 0 ;
+  
+  arg1 = (std::vector< size_t > *)jarg1; 
+  delete arg1;
+}
+
+
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_new_Tensors__SWIG_0() {
+  void * jresult ;
+  std::map< std::string,struct ggml_tensor * > *result = 0 ;
+  
+  result = (std::map< std::string,struct ggml_tensor * > *)new std::map< std::string,struct ggml_tensor * >();
+  jresult = (void *)result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_new_Tensors__SWIG_1(void * jarg1) {
+  void * jresult ;
+  std::map< std::string,ggml_tensor * > *arg1 = 0 ;
+  std::map< std::string,struct ggml_tensor * > *result = 0 ;
+  
+  arg1 = (std::map< std::string,ggml_tensor * > *)jarg1;
+  if (!arg1) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "std::map< std::string,ggml_tensor * > const & is null", 0);
+    return 0;
+  } 
+  result = (std::map< std::string,struct ggml_tensor * > *)new std::map< std::string,struct ggml_tensor * >((std::map< std::string,ggml_tensor * > const &)*arg1);
+  jresult = (void *)result; 
+  return jresult;
+}
+
+
+SWIGEXPORT unsigned long SWIGSTDCALL CSharp_MptLibrary_Tensors_size(void * jarg1) {
+  unsigned long jresult ;
+  std::map< std::string,struct ggml_tensor * > *arg1 = (std::map< std::string,struct ggml_tensor * > *) 0 ;
+  std::map< std::string,struct ggml_tensor * >::size_type result;
+  
+  arg1 = (std::map< std::string,struct ggml_tensor * > *)jarg1; 
+  result = ((std::map< std::string,struct ggml_tensor * > const *)arg1)->size();
+  jresult = (unsigned long)result; 
+  return jresult;
+}
+
+
+SWIGEXPORT unsigned int SWIGSTDCALL CSharp_MptLibrary_Tensors_empty(void * jarg1) {
+  unsigned int jresult ;
+  std::map< std::string,struct ggml_tensor * > *arg1 = (std::map< std::string,struct ggml_tensor * > *) 0 ;
+  bool result;
+  
+  arg1 = (std::map< std::string,struct ggml_tensor * > *)jarg1; 
+  result = (bool)((std::map< std::string,struct ggml_tensor * > const *)arg1)->empty();
+  jresult = result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_Tensors_Clear(void * jarg1) {
+  std::map< std::string,struct ggml_tensor * > *arg1 = (std::map< std::string,struct ggml_tensor * > *) 0 ;
+  
+  arg1 = (std::map< std::string,struct ggml_tensor * > *)jarg1; 
+  (arg1)->clear();
+}
+
+
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_Tensors_getitem(void * jarg1, const char * jarg2) {
+  void * jresult ;
+  std::map< std::string,struct ggml_tensor * > *arg1 = (std::map< std::string,struct ggml_tensor * > *) 0 ;
+  std::map< std::string,struct ggml_tensor * >::key_type *arg2 = 0 ;
+  std::map< std::string,struct ggml_tensor * >::mapped_type *result = 0 ;
+  
+  arg1 = (std::map< std::string,struct ggml_tensor * > *)jarg1; 
+  if (!jarg2) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "null string", 0);
+    return 0;
+  }
+  std::map< std::string,struct ggml_tensor * >::key_type arg2_str(jarg2);
+  arg2 = &arg2_str; 
+  try {
+    result = (std::map< std::string,struct ggml_tensor * >::mapped_type *) &std_map_Sl_std_string_Sc_struct_SS_ggml_tensor_Sm__Sg__getitem(arg1,(std::string const &)*arg2);
+  } catch(std::out_of_range &_e) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentOutOfRangeException, 0, (&_e)->what());
+    return 0;
+  }
+  jresult = (void *)*result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_Tensors_setitem(void * jarg1, const char * jarg2, void * jarg3) {
+  std::map< std::string,struct ggml_tensor * > *arg1 = (std::map< std::string,struct ggml_tensor * > *) 0 ;
+  std::map< std::string,struct ggml_tensor * >::key_type *arg2 = 0 ;
+  std::map< std::string,struct ggml_tensor * >::mapped_type *arg3 = 0 ;
+  std::map< std::string,struct ggml_tensor * >::mapped_type temp3 = 0 ;
   
   arg1 = (std::map< std::string,struct ggml_tensor * > *)jarg1; 
   if (!jarg2) {
@@ -4077,79 +5062,145 @@ SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_model_memory_k_set(void * jarg
 }
 
 
-SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_mpt_model_memory_k_get(void * jarg1) {
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_mpt_model_memory_k_get(void * jarg1) {
+  void * jresult ;
+  mpt_model *arg1 = (mpt_model *) 0 ;
+  ggml_tensor *result = 0 ;
+  
+  arg1 = (mpt_model *)jarg1; 
+  result = (ggml_tensor *) ((arg1)->memory_k);
+  jresult = (void *)result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_model_memory_v_set(void * jarg1, void * jarg2) {
+  mpt_model *arg1 = (mpt_model *) 0 ;
+  ggml_tensor *arg2 = (ggml_tensor *) 0 ;
+  
+  arg1 = (mpt_model *)jarg1; 
+  arg2 = (ggml_tensor *)jarg2; 
+  if (arg1) (arg1)->memory_v = arg2;
+}
+
+
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_mpt_model_memory_v_get(void * jarg1) {
+  void * jresult ;
+  mpt_model *arg1 = (mpt_model *) 0 ;
+  ggml_tensor *result = 0 ;
+  
+  arg1 = (mpt_model *)jarg1; 
+  result = (ggml_tensor *) ((arg1)->memory_v);
+  jresult = (void *)result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_model_ctx_set(void * jarg1, void * jarg2) {
+  mpt_model *arg1 = (mpt_model *) 0 ;
+  ggml_context *arg2 = (ggml_context *) 0 ;
+  
+  arg1 = (mpt_model *)jarg1; 
+  arg2 = (ggml_context *)jarg2; 
+  if (arg1) (arg1)->ctx = arg2;
+}
+
+
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_mpt_model_ctx_get(void * jarg1) {
+  void * jresult ;
+  mpt_model *arg1 = (mpt_model *) 0 ;
+  ggml_context *result = 0 ;
+  
+  arg1 = (mpt_model *)jarg1; 
+  result = (ggml_context *) ((arg1)->ctx);
+  jresult = (void *)result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_model_tensors_set(void * jarg1, void * jarg2) {
+  mpt_model *arg1 = (mpt_model *) 0 ;
+  std::map< std::string,ggml_tensor *,std::less< std::string > > *arg2 = (std::map< std::string,ggml_tensor *,std::less< std::string > > *) 0 ;
+  
+  arg1 = (mpt_model *)jarg1; 
+  arg2 = (std::map< std::string,ggml_tensor *,std::less< std::string > > *)jarg2; 
+  if (arg1) (arg1)->tensors = *arg2;
+}
+
+
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_mpt_model_tensors_get(void * jarg1) {
   void * jresult ;
   mpt_model *arg1 = (mpt_model *) 0 ;
-  ggml_tensor *result = 0 ;
+  std::map< std::string,ggml_tensor *,std::less< std::string > > *result = 0 ;
   
   arg1 = (mpt_model *)jarg1; 
-  result = (ggml_tensor *) ((arg1)->memory_k);
+  result = (std::map< std::string,ggml_tensor *,std::less< std::string > > *)& ((arg1)->tensors);
   jresult = (void *)result; 
   return jresult;
 }
 
 
-SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_model_memory_v_set(void * jarg1, void * jarg2) {
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_model_buf_set(void * jarg1, void * jarg2) {
   mpt_model *arg1 = (mpt_model *) 0 ;
-  ggml_tensor *arg2 = (ggml_tensor *) 0 ;
+  ggml_mem_buffer *arg2 = (ggml_mem_buffer *) 0 ;
   
   arg1 = (mpt_model *)jarg1; 
-  arg2 = (ggml_tensor *)jarg2; 
-  if (arg1) (arg1)->memory_v = arg2;
+  arg2 = (ggml_mem_buffer *)jarg2; 
+  if (arg1) (arg1)->buf = *arg2;
 }
 
 
-SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_mpt_model_memory_v_get(void * jarg1) {
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_mpt_model_buf_get(void * jarg1) {
   void * jresult ;
   mpt_model *arg1 = (mpt_model *) 0 ;
-  ggml_tensor *result = 0 ;
+  ggml_mem_buffer *result = 0 ;
   
   arg1 = (mpt_model *)jarg1; 
-  result = (ggml_tensor *) ((arg1)->memory_v);
+  result = (ggml_mem_buffer *)& ((arg1)->buf);
   jresult = (void *)result; 
   return jresult;
 }
 
 
-SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_model_ctx_set(void * jarg1, void * jarg2) {
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_model_mem_flags_set(void * jarg1, int jarg2) {
   mpt_model *arg1 = (mpt_model *) 0 ;
-  ggml_context *arg2 = (ggml_context *) 0 ;
+  int arg2 ;
   
   arg1 = (mpt_model *)jarg1; 
-  arg2 = (ggml_context *)jarg2; 
-  if (arg1) (arg1)->ctx = arg2;
+  arg2 = (int)jarg2; 
+  if (arg1) (arg1)->mem_flags = arg2;
 }
 
 
-SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_mpt_model_ctx_get(void * jarg1) {
-  void * jresult ;
+SWIGEXPORT int SWIGSTDCALL CSharp_MptLibrary_mpt_model_mem_flags_get(void * jarg1) {
+  int jresult ;
   mpt_model *arg1 = (mpt_model *) 0 ;
-  ggml_context *result = 0 ;
+  int result;
   
   arg1 = (mpt_model *)jarg1; 
-  result = (ggml_context *) ((arg1)->ctx);
-  jresult = (void *)result; 
+  result = (int) ((arg1)->mem_flags);
+  jresult = result; 
   return jresult;
 }
 
 
-SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_model_tensors_set(void * jarg1, void * jarg2) {
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_model_container_set(void * jarg1, void * jarg2) {
   mpt_model *arg1 = (mpt_model *) 0 ;
-  std::map< std::string,ggml_tensor *,std::less< std::string > > *arg2 = (std::map< std::string,ggml_tensor *,std::less< std::string > > *) 0 ;
+  ggml_container *arg2 = (ggml_container *) 0 ;
   
   arg1 = (mpt_model *)jarg1; 
-  arg2 = (std::map< std::string,ggml_tensor *,std::less< std::string > > *)jarg2; 
-  if (arg1) (arg1)->tensors = *arg2;
+  arg2 = (ggml_container *)jarg2; 
+  if (arg1) (arg1)->container = *arg2;
 }
 
 
-SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_mpt_model_tensors_get(void * jarg1) {
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_mpt_model_container_get(void * jarg1) {
   void * jresult ;
   mpt_model *arg1 = (mpt_model *) 0 ;
-  std::map< std::string,ggml_tensor *,std::less< std::string > > *result = 0 ;
+  ggml_container *result = 0 ;
   
   arg1 = (mpt_model *)jarg1; 
-  result = (std::map< std::string,ggml_tensor *,std::less< std::string > > *)& ((arg1)->tensors);
+  result = (ggml_container *)& ((arg1)->container);
   jresult = (void *)result; 
   return jresult;
 }
@@ -4261,6 +5312,28 @@ SWIGEXPORT int SWIGSTDCALL CSharp_MptLibrary_mpt_params_n_batch_get(void * jarg1
 }
 
 
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_params_n_threads_batch_set(void * jarg1, int jarg2) {
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  int arg2 ;
+  
+  arg1 = (mpt_params *)jarg1; 
+  arg2 = (int)jarg2; 
+  if (arg1) (arg1)->n_threads_batch = arg2;
+}
+
+
+SWIGEXPORT int SWIGSTDCALL CSharp_MptLibrary_mpt_params_n_threads_batch_get(void * jarg1) {
+  int jresult ;
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  int result;
+  
+  arg1 = (mpt_params *)jarg1; 
+  result = (int) ((arg1)->n_threads_batch);
+  jresult = result; 
+  return jresult;
+}
+
+
 SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_params_n_ctx_set(void * jarg1, int jarg2) {
   mpt_params *arg1 = (mpt_params *) 0 ;
   int arg2 ;
@@ -4283,6 +5356,28 @@ SWIGEXPORT int SWIGSTDCALL CSharp_MptLibrary_mpt_params_n_ctx_get(void * jarg1)
 }
 
 
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_params_n_threads_tokenize_set(void * jarg1, int jarg2) {
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  int arg2 ;
+  
+  arg1 = (mpt_params *)jarg1; 
+  arg2 = (int)jarg2; 
+  if (arg1) (arg1)->n_threads_tokenize = arg2;
+}
+
+
+SWIGEXPORT int SWIGSTDCALL CSharp_MptLibrary_mpt_params_n_threads_tokenize_get(void * jarg1) {
+  int jresult ;
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  int result;
+  
+  arg1 = (mpt_params *)jarg1; 
+  result = (int) ((arg1)->n_threads_tokenize);
+  jresult = result; 
+  return jresult;
+}
+
+
 SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_params_model_set(void * jarg1, const char * jarg2) {
   mpt_params *arg1 = (mpt_params *) 0 ;
   std::string *arg2 = 0 ;
@@ -4310,6 +5405,209 @@ SWIGEXPORT const char * SWIGSTDCALL CSharp_MptLibrary_mpt_params_model_get(void
 }
 
 
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_params_use_mmap_set(void * jarg1, unsigned int jarg2) {
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  bool arg2 ;
+  
+  arg1 = (mpt_params *)jarg1; 
+  arg2 = jarg2 ? true : false; 
+  if (arg1) (arg1)->use_mmap = arg2;
+}
+
+
+SWIGEXPORT unsigned int SWIGSTDCALL CSharp_MptLibrary_mpt_params_use_mmap_get(void * jarg1) {
+  unsigned int jresult ;
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  bool result;
+  
+  arg1 = (mpt_params *)jarg1; 
+  result = (bool) ((arg1)->use_mmap);
+  jresult = result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_params_numa_set(void * jarg1, unsigned int jarg2) {
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  bool arg2 ;
+  
+  arg1 = (mpt_params *)jarg1; 
+  arg2 = jarg2 ? true : false; 
+  if (arg1) (arg1)->numa = arg2;
+}
+
+
+SWIGEXPORT unsigned int SWIGSTDCALL CSharp_MptLibrary_mpt_params_numa_get(void * jarg1) {
+  unsigned int jresult ;
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  bool result;
+  
+  arg1 = (mpt_params *)jarg1; 
+  result = (bool) ((arg1)->numa);
+  jresult = result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_params_hugepages_set(void * jarg1, int jarg2) {
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  int arg2 ;
+  
+  arg1 = (mpt_params *)jarg1; 
+  arg2 = (int)jarg2; 
+  if (arg1) (arg1)->hugepages = arg2;
+}
+
+
+SWIGEXPORT int SWIGSTDCALL CSharp_MptLibrary_mpt_params_hugepages_get(void * jarg1) {
+  int jresult ;
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  int result;
+  
+  arg1 = (mpt_params *)jarg1; 
+  result = (int) ((arg1)->hugepages);
+  jresult = result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_params_use_mlock_set(void * jarg1, unsigned int jarg2) {
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  bool arg2 ;
+  
+  arg1 = (mpt_params *)jarg1; 
+  arg2 = jarg2 ? true : false; 
+  if (arg1) (arg1)->use_mlock = arg2;
+}
+
+
+SWIGEXPORT unsigned int SWIGSTDCALL CSharp_MptLibrary_mpt_params_use_mlock_get(void * jarg1) {
+  unsigned int jresult ;
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  bool result;
+  
+  arg1 = (mpt_params *)jarg1; 
+  result = (bool) ((arg1)->use_mlock);
+  jresult = result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_params_prefault_set(void * jarg1, unsigned int jarg2) {
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  bool arg2 ;
+  
+  arg1 = (mpt_params *)jarg1; 
+  arg2 = jarg2 ? true : false; 
+  if (arg1) (arg1)->prefault = arg2;
+}
+
+
+SWIGEXPORT unsigned int SWIGSTDCALL CSharp_MptLibrary_mpt_params_prefault_get(void * jarg1) {
+  unsigned int jresult ;
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  bool result;
+  
+  arg1 = (mpt_params *)jarg1; 
+  result = (bool) ((arg1)->prefault);
+  jresult = result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_params_cpus_set(void * jarg1, void * jarg2) {
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  std::vector< int > *arg2 = (std::vector< int > *) 0 ;
+  
+  arg1 = (mpt_params *)jarg1; 
+  arg2 = (std::vector< int > *)jarg2; 
+  if (arg1) (arg1)->cpus = *arg2;
+}
+
+
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_mpt_params_cpus_get(void * jarg1) {
+  void * jresult ;
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  std::vector< int > *result = 0 ;
+  
+  arg1 = (mpt_params *)jarg1; 
+  result = (std::vector< int > *)& ((arg1)->cpus);
+  jresult = (void *)result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_params_physical_cores_set(void * jarg1, unsigned int jarg2) {
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  bool arg2 ;
+  
+  arg1 = (mpt_params *)jarg1; 
+  arg2 = jarg2 ? true : false; 
+  if (arg1) (arg1)->physical_cores = arg2;
+}
+
+
+SWIGEXPORT unsigned int SWIGSTDCALL CSharp_MptLibrary_mpt_params_physical_cores_get(void * jarg1) {
+  unsigned int jresult ;
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  bool result;
+  
+  arg1 = (mpt_params *)jarg1; 
+  result = (bool) ((arg1)->physical_cores);
+  jresult = result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_params_autotune_set(void * jarg1, unsigned int jarg2) {
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  bool arg2 ;
+  
+  arg1 = (mpt_params *)jarg1; 
+  arg2 = jarg2 ? true : false; 
+  if (arg1) (arg1)->autotune = arg2;
+}
+
+
+SWIGEXPORT unsigned int SWIGSTDCALL CSharp_MptLibrary_mpt_params_autotune_get(void * jarg1) {
+  unsigned int jresult ;
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  bool result;
+  
+  arg1 = (mpt_params *)jarg1; 
+  result = (bool) ((arg1)->autotune);
+  jresult = result; 
+  return jresult;
+}
+
+
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_params_autotune_file_set(void * jarg1, const char * jarg2) {
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  std::string *arg2 = 0 ;
+  
+  arg1 = (mpt_params *)jarg1; 
+  if (!jarg2) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "null string", 0);
+    return ;
+  }
+  std::string arg2_str(jarg2);
+  arg2 = &arg2_str; 
+  if (arg1) (arg1)->autotune_file = *arg2;
+}
+
+
+SWIGEXPORT const char * SWIGSTDCALL CSharp_MptLibrary_mpt_params_autotune_file_get(void * jarg1) {
+  const char * jresult ;
+  mpt_params *arg1 = (mpt_params *) 0 ;
+  std::string *result = 0 ;
+  
+  arg1 = (mpt_params *)jarg1; 
+  result = (std::string *) & ((arg1)->autotune_file);
+  jresult = SWIG_csharp_string_callback(result->c_str()); 
+  return jresult;
+}
+
+
 SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_mpt_params_top_k_set(void * jarg1, int jarg2) {
   mpt_params *arg1 = (mpt_params *) 0 ;
   int arg2 ;
@@ -4554,6 +5852,56 @@ SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_Mpt_TokenizeMessage(void * jarg1
 }
 
 
+SWIGEXPORT void SWIGSTDCALL CSharp_MptLibrary_Mpt_TokenizeMessages(void * jarg1, void * jarg2, void * jarg3, void * jarg4) {
+  Mpt *arg1 = (Mpt *) 0 ;
+  std::vector< std::string > *arg2 = 0 ;
+  std::vector< int > *arg3 = 0 ;
+  std::vector< size_t > *arg4 = 0 ;
+  
+  arg1 = (Mpt *)jarg1; 
+  arg2 = (std::vector< std::string > *)jarg2;
+  if (!arg2) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "std::vector< std::string > const & is null", 0);
+    return ;
+  } 
+  arg3 = (std::vector< int > *)jarg3;
+  if (!arg3) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "std::vector< int > & is null", 0);
+    return ;
+  } 
+  arg4 = (std::vector< size_t > *)jarg4;
+  if (!arg4) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "std::vector< size_t > & is null", 0);
+    return ;
+  } 
+  (arg1)->TokenizeMessages((std::vector< std::string > const &)*arg2,*arg3,*arg4);
+}
+
+
+SWIGEXPORT void * SWIGSTDCALL CSharp_MptLibrary_Mpt_DetokenizeMessages(void * jarg1, void * jarg2, void * jarg3) {
+  void * jresult ;
+  Mpt *arg1 = (Mpt *) 0 ;
+  std::vector< int > *arg2 = 0 ;
+  std::vector< size_t > *arg3 = 0 ;
+  std::vector< std::string > result;
+  
+  arg1 = (Mpt *)jarg1; 
+  arg2 = (std::vector< int > *)jarg2;
+  if (!arg2) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "std::vector< int > const & is null", 0);
+    return 0;
+  } 
+  arg3 = (std::vector< size_t > *)jarg3;
+  if (!arg3) {
+    SWIG_CSharpSetPendingExceptionArgument(SWIG_CSharpArgumentNullException, "std::vector< size_t > const & is null", 0);
+    return 0;
+  } 
+  result = (arg1)->DetokenizeMessages((std::vector< int > const &)*arg2,(std::vector< size_t > const &)*arg3);
+  jresult = new std::vector< std::string >(result); 
+  return jresult;
+}
+
+
 SWIGEXPORT const char * SWIGSTDCALL CSharp_MptLibrary_Mpt_ProcessTokenizedMessage(void * jarg1, void * jarg2) {
   const char * jresult ;
   Mpt *arg1 = (Mpt *) 0 ;
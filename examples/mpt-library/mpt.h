@@ -55,6 +55,13 @@ struct mpt_model {
 
     struct ggml_context * ctx;
     std::map<std::string, struct ggml_tensor *> tensors;
+
+    // memory of ctx, with the ggml_mem_flags that are also used for the compute buffers
+    ggml_mem_buffer buf = {};
+    int mem_flags = 0;
+
+    // set when loaded from an aligned container, mapped weights point into it
+    ggml_container container;
 };
 
 struct mpt_params {
@@ -63,9 +70,24 @@ struct mpt_params {
     int seed           = -1; // RNG seed
     int n_predict      = 200; // new tokens to predict
     int n_batch        = 8; // batch size for prompt processing
+    int n_threads_batch = -1; // threads for prompt batches, -1 for n_threads - decode is bandwidth bound and wants fewer
     int n_ctx          = 512;
+    int n_threads_tokenize = std::max(1, (int32_t) std::thread::hardware_concurrency()); // for TokenizeMessages/DetokenizeMessages
 
     std::string model      = ""; // model path
+    bool use_mmap          = true; // mmap aligned containers instead of reading them
+    bool numa              = false; // spread the threads and the weight rows over the NUMA nodes
+    int  hugepages         = 0; // 2 or 1024: weights, KV cache and compute buffers on huge pages of that many MB (no mmap then)
+    bool use_mlock         = false; // lock the weights, KV cache and compute buffers in RAM
+    bool prefault          = false; // touch all of their pages at load for a predictable first token
+
+    std::vector<int> cpus;          // CPUs for the compute threads, e.g. cores reserved for this instance; empty for any
+    bool physical_cores    = false; // one compute thread per physical core (of cpus if set), SMT siblings stay free
+
+    // time mpt_eval at startup and pick n_threads, n_threads_batch and n_batch for this machine,
+    // kept in autotune_file (if set) for the same model, n_ctx and CPU count
+    bool autotune          = false;
+    std::string autotune_file = "";
 	
     // sampling parameters
     int top_k          = 0;
@@ -90,6 +112,13 @@ struct Mpt {
 	// Push in message - get tokens vector (it has tokens count in it!)
 	std::vector<int> TokenizeMessage(const std::string& message);
 	
+	// Push in many messages - get all their tokens in one flat buffer, tokenized in parallel
+	// tokens of messages[i] are tokens[offsets[i]] .. tokens[offsets[i+1] - 1], no per-token logs
+	void TokenizeMessages(const std::vector<std::string>& messages, std::vector<int>& tokens, std::vector<size_t>& offsets);
+	
+	// Push in flat tokens + offsets from TokenizeMessages - get one string per message
+	std::vector<std::string> DetokenizeMessages(const std::vector<int>& tokens, const std::vector<size_t>& offsets);
+	
 	// Push in tokens - get string results
 	std::string ProcessTokenizedMessage(const std::vector<int>& embd_inp);	
 	
@@ -102,7 +131,18 @@ struct Mpt {
     virtual ~Mpt();    
 private:
     gpt_vocab vocab;
+    gpt_tokenizer tokenizer;
     mpt_model model; 
     mpt_params params; 
     std::mt19937 rng;  
+    gpt_sample_workspace sample_ws;
+    struct ggml_threadpool * threadpool = nullptr;
+    struct ggml_compute_cache * compute_cache = nullptr; // plan of the last graph and a work buffer that stays warm from token to token
+    enum ggml_affinity affinity = GGML_AFFINITY_NONE; // placement of the threadpool, from params
+    gpt_worker_pool * tokenize_pool = nullptr; // n_threads_tokenize threads of TokenizeMessages/DetokenizeMessages, started on first use
+
+    gpt_worker_pool & TokenizePool();
+
+    // sets params.n_threads, n_threads_batch and n_batch from autotune_file or measurements
+    void Autotune(int max_threads);
 };
\ No newline at end of file
@@ -20,6 +20,8 @@ swig -c++ -csharp -namespace MptLibrary -outdir ./C#/ -o MptWrapper.cxx mpt.i
 %template(Logits) std::vector<float>; //most of the time here
 %template(Tokens) std::vector<int>;
 %template(LastNTokens) std::vector<int32_t>;
+%template(Messages) std::vector<std::string>;
+%template(TokenOffsets) std::vector<size_t>;
 %template(Tensors) std::map<std::string, struct ggml_tensor *>;
 
 %include "mpt.h"
@@ -26,8 +26,91 @@ void cleasr_log_stream() {
 }
 
 // load the model's weights from a file
+// point the weights into the mapping or read them with n_threads readers
+static bool mpt_model_load_container(Mpt &mpt_ctx,
+                                     const ggml_container &container,
+                                     mpt_model &model, int n_threads,
+                                     int &n_tensors, size_t &total_size) {
+  std::vector<std::pair<const ggml_container_tensor *, void *>> reads;
+
+  for (const auto &t : container.tensors) {
+    if (model.tensors.find(t.name) == model.tensors.end()) {
+      oss << "error " << __func__ << ": unknown tensor '" << t.name
+          << "' in model file\n";
+
+      log_message = oss.str();
+      mpt_ctx.OnLogMessage(log_message);
+      cleasr_log_stream();
+      return false;
+    }
+  }
+
+  for (const auto &it : model.tensors) {
+    const auto &name = it.first;
+    auto tensor = it.second;
+
+    const ggml_container_tensor *t = ggml_container_find(container, name);
+    if (!t) {
+      oss << "error " << __func__ << ": tensor '" << name
+          << "' is missing from model file\n";
+
+      log_message = oss.str();
+      mpt_ctx.OnLogMessage(log_message);
+      cleasr_log_stream();
+      return false;
+    }
+
+    if (t->type != tensor->type || t->ne[0] != tensor->ne[0] ||
+        t->ne[1] != tensor->ne[1] || t->size != ggml_nbytes(tensor)) {
+      oss << "error " << __func__ << ": tensor '" << name
+          << "' has wrong shape or type in model file: got ["
+          << std::setw(5) << t->ne[0] << ", " << std::setw(5) << t->ne[1]
+          << "] " << ggml_type_name(t->type) << ", expected [" << std::setw(5)
+          << (int)tensor->ne[0] << ", " << std::setw(5) << (int)tensor->ne[1]
+          << "] " << ggml_type_name(tensor->type) << "\n";
+
+      log_message = oss.str();
+      mpt_ctx.OnLogMessage(log_message);
+      cleasr_log_stream();
+      return false;
+    }
+
+    if (container.addr) {
+      tensor->data = (void *)ggml_container_data(container, *t);
+    } else {
+      reads.emplace_back(t, tensor->data);
+    }
+
+    total_size += t->size;
+    n_tensors++;
+  }
+
+  if (!ggml_container_read_all(container, reads, n_threads)) {
+    oss << "error " << __func__ << ": failed to read tensor data\n";
+
+    log_message = oss.str();
+    mpt_ctx.OnLogMessage(log_message);
+    cleasr_log_stream();
+    return false;
+  }
+
+  // mapped weights are not in the context buffer
+  if (container.addr) {
+    if (model.mem_flags & GGML_MEM_LOCK) {
+      ggml_mem_lock(container.addr, container.size);
+    }
+    if (model.mem_flags & GGML_MEM_PREFAULT) {
+      ggml_mem_prefault(container.addr, container.size);
+    }
+  }
+
+  return true;
+}
+
+// legacy GGML_FILE_MAGIC files are streamed, aligned containers
+// (see ggml_container in common-ggml.h) are mmap-ed or read in parallel
 bool mpt_model_load(Mpt &mpt_ctx, const std::string &fname, mpt_model &model,
-                    gpt_vocab &vocab) {
+                    gpt_vocab &vocab, bool use_mmap, int n_threads) {
   oss << __func__ << ": loading model from '" << fname
       << "' - please wait ...\n";
   log_message = oss.str();
@@ -47,10 +130,31 @@ bool mpt_model_load(Mpt &mpt_ctx, const std::string &fname, mpt_model &model,
   }
 
   // verify magic
+  auto &container = model.container;
+  std::istringstream fhdr;
+  bool is_container = false;
+
   {
     uint32_t magic;
     fin.read((char *)&magic, sizeof(magic));
-    if (magic != GGML_FILE_MAGIC) {
+    if (magic == GGML_CONTAINER_MAGIC) {
+      fin.close();
+
+      if (!ggml_container_open(container, fname, use_mmap)) {
+        oss << "error " << __func__ << ": invalid model file '" << fname
+            << "' (bad container)\n";
+        log_message = oss.str();
+
+        mpt_ctx.OnLogMessage(log_message);
+        cleasr_log_stream();
+
+        return false;
+      }
+
+      // hparams + vocab are stored exactly as in the legacy file
+      fhdr.str(container.header);
+      is_container = true;
+    } else if (magic != GGML_FILE_MAGIC) {
       oss << "error " << __func__ << ": invalid model file '" << fname
           << "' (bad magic)\n";
       log_message = oss.str();
@@ -62,18 +166,20 @@ bool mpt_model_load(Mpt &mpt_ctx, const std::string &fname, mpt_model &model,
     }
   }
 
+  std::istream &fhp = is_container ? fhdr : (std::istream &)fin;
+
   // load hparams
   {
     auto &hparams = model.hparams;
 
-    fin.read((char *)&hparams.d_model, sizeof(hparams.d_model));
-    fin.read((char *)&hparams.max_seq_len, sizeof(hparams.max_seq_len));
-    fin.read((char *)&hparams.n_heads, sizeof(hparams.n_heads));
-    fin.read((char *)&hparams.n_layers, sizeof(hparams.n_layers));
-    fin.read((char *)&hparams.n_vocab, sizeof(hparams.n_vocab));
-    fin.read((char *)&hparams.alibi_bias_max, sizeof(hparams.alibi_bias_max));
-    fin.read((char *)&hparams.clip_qkv, sizeof(hparams.clip_qkv));
-    fin.read((char *)&hparams.ftype, sizeof(hparams.ftype));
+    fhp.read((char *)&hparams.d_model, sizeof(hparams.d_model));
+    fhp.read((char *)&hparams.max_seq_len, sizeof(hparams.max_seq_len));
+    fhp.read((char *)&hparams.n_heads, sizeof(hparams.n_heads));
+    fhp.read((char *)&hparams.n_layers, sizeof(hparams.n_layers));
+    fhp.read((char *)&hparams.n_vocab, sizeof(hparams.n_vocab));
+    fhp.read((char *)&hparams.alibi_bias_max, sizeof(hparams.alibi_bias_max));
+    fhp.read((char *)&hparams.clip_qkv, sizeof(hparams.clip_qkv));
+    fhp.read((char *)&hparams.ftype, sizeof(hparams.ftype));
 
     hparams.n_ctx = std::min(hparams.max_seq_len, hparams.n_ctx);
 
@@ -98,30 +204,15 @@ bool mpt_model_load(Mpt &mpt_ctx, const std::string &fname, mpt_model &model,
   }
 
   // load vocab
-  {
-    const int32_t n_vocab = model.hparams.n_vocab;
-
-    std::string word;
-    std::vector<char> buf(128);
-
-    for (int i = 0; i < n_vocab; i++) {
-      uint32_t len;
-      fin.read((char *)&len, sizeof(len));
-
-      buf.resize(len);
-      fin.read((char *)buf.data(), len);
-      word.assign(buf.data(), len);
+  if (!gpt_vocab_read(fhp, model.hparams.n_vocab, true, vocab)) {
+    oss << "error " << __func__ << ": invalid model file '" << fname
+        << "' (bad vocab)\n";
+    log_message = oss.str();
 
-      // Convert token from utf-8
-      std::wstring word_multibytes = convert_to_wstring(word);
-      word.resize(word_multibytes.size());
-      for (int w = 0; w < word_multibytes.size(); w++) {
-        word[w] = uint8_t(word_multibytes[w]);
-      }
+    mpt_ctx.OnLogMessage(log_message);
+    cleasr_log_stream();
 
-      vocab.token_to_id[word] = i;
-      vocab.id_to_token[i] = word;
-    }
+    return false;
   }
 
   // for the big tensors, we have the option to store the data in 16-bit
@@ -145,27 +236,31 @@ bool mpt_model_load(Mpt &mpt_ctx, const std::string &fname, mpt_model &model,
 
   const auto &hparams = model.hparams;
   const size_t n_ctx = hparams.n_ctx;
+  const bool mapped = container.addr != nullptr;
 
   {
     const size_t n_embd = hparams.d_model;
     const size_t n_layer = hparams.n_layers;
     const size_t n_vocab = hparams.n_vocab;
 
-    ctx_size += n_embd * n_vocab * ggml_type_sizef(wtype); // wte_weight
-    ctx_size += n_embd * ggml_type_sizef(GGML_TYPE_F32);   // norm_f_weight
-
-    ctx_size +=
-        n_layer * (n_embd * ggml_type_sizef(GGML_TYPE_F32)); // ln_1_weight
-    ctx_size += n_layer * (3 * n_embd * n_embd *
-                           ggml_type_sizef(wtype)); // attn_Wqkv_weight
-    ctx_size += n_layer * (n_embd * n_embd *
-                           ggml_type_sizef(wtype)); // attn_out_proj_weight
-    ctx_size +=
-        n_layer * (n_embd * ggml_type_sizef(GGML_TYPE_F32)); // ln_2_weight
-    ctx_size += n_layer * (4 * n_embd * n_embd *
-                           ggml_type_sizef(wtype)); // mlp_mlp_up_weight
-    ctx_size += n_layer * (n_embd * n_embd * 4 *
-                           ggml_type_sizef(wtype)); // mlp_mlp_down_weight
+    // mapped weights point into the container and take no space in the context
+    if (!mapped) {
+      ctx_size += n_embd * n_vocab * ggml_type_sizef(wtype); // wte_weight
+      ctx_size += n_embd * ggml_type_sizef(GGML_TYPE_F32);   // norm_f_weight
+
+      ctx_size +=
+          n_layer * (n_embd * ggml_type_sizef(GGML_TYPE_F32)); // ln_1_weight
+      ctx_size += n_layer * (3 * n_embd * n_embd *
+                             ggml_type_sizef(wtype)); // attn_Wqkv_weight
+      ctx_size += n_layer * (n_embd * n_embd *
+                             ggml_type_sizef(wtype)); // attn_out_proj_weight
+      ctx_size +=
+          n_layer * (n_embd * ggml_type_sizef(GGML_TYPE_F32)); // ln_2_weight
+      ctx_size += n_layer * (4 * n_embd * n_embd *
+                             ggml_type_sizef(wtype)); // mlp_mlp_up_weight
+      ctx_size += n_layer * (n_embd * n_embd * 4 *
+                             ggml_type_sizef(wtype)); // mlp_mlp_down_weight
+    }
 
     ctx_size +=
         n_ctx * n_layer * n_embd * ggml_type_sizef(GGML_TYPE_F16); // memory_k
@@ -185,9 +280,21 @@ bool mpt_model_load(Mpt &mpt_ctx, const std::string &fname, mpt_model &model,
 
   // create the ggml context
   {
+    model.buf = ggml_mem_buffer_alloc(ctx_size, model.mem_flags);
+    if (!model.buf.data) {
+      oss << "error " << __func__ << ": failed to allocate " << ctx_size
+          << " bytes\n";
+
+      log_message = oss.str();
+
+      mpt_ctx.OnLogMessage(log_message);
+      cleasr_log_stream();
+      return false;
+    }
+
     struct ggml_init_params params = {
-        /*.mem_size   =*/ctx_size,
-        /*.mem_buffer =*/NULL,
+        /*.mem_size   =*/model.buf.size,
+        /*.mem_buffer =*/model.buf.data,
         /*.no_alloc   =*/false,
     };
 
@@ -213,6 +320,8 @@ bool mpt_model_load(Mpt &mpt_ctx, const std::string &fname, mpt_model &model,
 
     model.layers.resize(n_layer);
 
+    ggml_set_no_alloc(ctx, mapped);
+
     model.wte_weight = ggml_new_tensor_2d(ctx, wtype, n_embd, n_vocab);
     model.norm_f_weight = ggml_new_tensor_1d(ctx, GGML_TYPE_F32, n_embd);
 
@@ -246,6 +355,8 @@ bool mpt_model_load(Mpt &mpt_ctx, const std::string &fname, mpt_model &model,
       model.tensors["transformer.blocks." + std::to_string(i) +
                     ".ffn.down_proj.weight"] = layer.ffn_down_proj;
     }
+
+    ggml_set_no_alloc(ctx, false);
   }
 
   // key + value memory
@@ -285,7 +396,13 @@ bool mpt_model_load(Mpt &mpt_ctx, const std::string &fname, mpt_model &model,
     mpt_ctx.OnLogMessage(log_message);
     cleasr_log_stream();
 
-    while (true) {
+    if (is_container &&
+        !mpt_model_load_container(mpt_ctx, container, model, n_threads,
+                                  n_tensors, total_size)) {
+      return false;
+    }
+
+    while (!is_container) {
       int32_t n_dims;
       int32_t length;
       int32_t ttype;
@@ -400,11 +517,16 @@ bool mpt_model_load(Mpt &mpt_ctx, const std::string &fname, mpt_model &model,
 //
 //   - model:     the model
 //   - n_threads: number of threads to use
+//   - pool:      persistent threads to run the graph on, at least n_threads
+//   - cache:     the plan of the last graph and a work buffer that stays warm, of this instance
+//   - affinity:  where the threads run, on cpus for GGML_AFFINITY_CPUS (see ggml_cplan)
 //   - n_past:    the context size so far
 //   - embd_inp:  the embeddings of the tokens in the context
 //   - embd_w:    the predicted logits for the next token
 //
 bool mpt_eval(Mpt &mpt_ctx, const mpt_model &model, const int n_threads,
+              ggml_threadpool *pool, ggml_compute_cache *cache,
+              enum ggml_affinity affinity, const std::vector<int> &cpus,
               const int n_past, const std::vector<gpt_vocab::id> &embd_inp,
               std::vector<float> &embd_w, bool logits_all,
               size_t &mem_per_token) {
@@ -418,16 +540,17 @@ bool mpt_eval(Mpt &mpt_ctx, const mpt_model &model, const int n_threads,
   const int n_vocab = hparams.n_vocab;
   const int n_ctx = hparams.n_ctx;
 
+  // allocated by the first call, with the ggml_mem_flags of its model
   static size_t buf_size = 256u * 1024 * 1024;
-  static void *buf = malloc(buf_size);
+  static ggml_mem_buffer buf = ggml_mem_buffer_alloc(buf_size, model.mem_flags);
 
   // use 2 scratch buffers
   // TODO: very hacky solution - reimplement in a more elegant way
   static size_t scr0_size = 256u * 1024 * 1024;
-  static void *scr0 = malloc(scr0_size);
+  static void *scr0 = ggml_mem_buffer_alloc(scr0_size, model.mem_flags).data;
 
   static size_t scr1_size = 256u * 1024 * 1024;
-  static void *scr1 = malloc(scr1_size);
+  static void *scr1 = ggml_mem_buffer_alloc(scr1_size, model.mem_flags).data;
 
   if (mem_per_token > 0 && mem_per_token * N > buf_size) {
     const size_t buf_size_new =
@@ -436,10 +559,11 @@ bool mpt_eval(Mpt &mpt_ctx, const mpt_model &model, const int n_threads,
     // printf("\n%s: reallocating buffer from %zu to %zu bytes\n", __func__,
     // buf_size, buf_size_new);
 
-    // reallocate
+    // reallocate, the graph is built from scratch so nothing is copied
     buf_size = buf_size_new;
-    buf = realloc(buf, buf_size);
-    if (buf == nullptr) {
+    ggml_mem_buffer_free(&buf);
+    buf = ggml_mem_buffer_alloc(buf_size, model.mem_flags);
+    if (buf.data == nullptr) {
       oss << "error " << __func__ << ": failed to allocate " << buf_size
           << " bytes\n";
 
@@ -452,7 +576,7 @@ bool mpt_eval(Mpt &mpt_ctx, const mpt_model &model, const int n_threads,
 
   struct ggml_init_params params = {
       /*.mem_size   =*/buf_size,
-      /*.mem_buffer =*/buf,
+      /*.mem_buffer =*/buf.data,
       /*.no_alloc   =*/false,
   };
 
@@ -479,7 +603,7 @@ bool mpt_eval(Mpt &mpt_ctx, const mpt_model &model, const int n_threads,
       cur = ggml_norm(ctx0, inpL);
 
       cur = ggml_mul(
-          ctx0, ggml_repeat(ctx0, model.layers[il].norm_1_weight, cur), cur);
+          ctx0, cur, model.layers[il].norm_1_weight);
     }
 
     // self-attention
@@ -599,7 +723,7 @@ bool mpt_eval(Mpt &mpt_ctx, const mpt_model &model, const int n_threads,
       cur = ggml_norm(ctx0, inpL);
 
       cur = ggml_mul(
-          ctx0, ggml_repeat(ctx0, model.layers[il].norm_2_weight, cur), cur);
+          ctx0, cur, model.layers[il].norm_2_weight);
     }
 
     // n = self.mlp(m)
@@ -629,7 +753,7 @@ bool mpt_eval(Mpt &mpt_ctx, const mpt_model &model, const int n_threads,
   {
     inpL = ggml_norm(ctx0, inpL);
     // inpL = ln_f_g*inpL
-    inpL = ggml_mul(ctx0, ggml_repeat(ctx0, model.norm_f_weight, inpL), inpL);
+    inpL = ggml_mul(ctx0, inpL, model.norm_f_weight);
   }
 
   ggml_set_scratch(ctx0, {
@@ -646,7 +770,16 @@ bool mpt_eval(Mpt &mpt_ctx, const mpt_model &model, const int n_threads,
 
   // run the computation
   ggml_build_forward_expand(&gf, inpL);
-  ggml_graph_compute_with_ctx(ctx0, &gf, n_threads);
+  ggml_graph_fuse(&gf);
+  {
+    struct ggml_cplan *plan =
+        ggml_compute_cache_plan(cache, &gf, n_threads, pool);
+    plan->affinity = affinity;
+    plan->affinity_cpus = cpus.empty() ? nullptr : cpus.data();
+    plan->n_affinity_cpus = cpus.size();
+
+    ggml_graph_compute(&gf, plan);
+  }
 
   // std::cout << "Qcur" << std::endl;
   // print_tensor(Qcur);
@@ -704,7 +837,7 @@ void Mpt::LogPerplexity(const std::string &message) {
   std::vector<float> logits;
 
   // tokenize the prompt
-  std::vector<int> embd_inp = ::gpt_tokenize(vocab, message);
+  std::vector<int> embd_inp = ::gpt_tokenize(tokenizer, message);
 
   oss << __func__ << ": number of tokens in prompt = " << embd_inp.size()
       << "\n";
@@ -714,8 +847,8 @@ void Mpt::LogPerplexity(const std::string &message) {
   cleasr_log_stream();
   // determine the required inference memory per token:
   size_t mem_per_token = 0;
-  mpt_eval(*this, model, params.n_threads, 0, {0, 1, 2, 3}, logits, false,
-           mem_per_token);
+  mpt_eval(*this, model, params.n_threads_batch, threadpool, compute_cache, affinity,
+           params.cpus, 0, {0, 1, 2, 3}, logits, false, mem_per_token);
 
   int count = 0;
 
@@ -758,8 +891,9 @@ void Mpt::LogPerplexity(const std::string &message) {
 
       const int64_t t_start_us = ggml_time_us();
 
-      if (!mpt_eval(*this, model, params.n_threads, j * batch_size, embd,
-                    batch_logits, true, mem_per_token)) {
+      if (!mpt_eval(*this, model, params.n_threads_batch, threadpool, compute_cache, affinity,
+                    params.cpus, j * batch_size, embd, batch_logits, true,
+                    mem_per_token)) {
         oss << "error " << __func__ << ": failed to evaluate model\n";
 
         log_message = oss.str();
@@ -865,7 +999,14 @@ void Mpt::LogPerplexity(const std::string &message) {
 
 void Mpt::OnNewTokenProcessed(const std::string &token) {}
 
-Mpt::~Mpt() { ggml_free(model.ctx); }
+Mpt::~Mpt() {
+  delete tokenize_pool;
+  ggml_compute_cache_free(compute_cache);
+  ggml_threadpool_free(threadpool);
+  ggml_free(model.ctx);
+  ggml_mem_buffer_free(&model.buf);
+  ggml_container_close(model.container);
+}
 
 void Mpt::OnLogMessage(const std::string &information) {}
 
@@ -884,8 +1025,13 @@ Mpt::Mpt(mpt_params _params) {
     params.n_predict = 0;
   }
 
+  if (params.n_threads_batch <= 0) {
+    params.n_threads_batch = params.n_threads;
+  }
+
   oss << __func__ << ": seed      = " << params.seed << "\n"
       << __func__ << ": n_threads = " << params.n_threads << "\n"
+      << __func__ << ": n_threads_batch = " << params.n_threads_batch << "\n"
       << __func__ << ": n_batch   = " << params.n_batch << "\n"
       << __func__ << ": n_ctx     = " << params.n_ctx << "\n"
       << __func__ << ": n_predict = " << params.n_predict << "\n\n";
@@ -898,11 +1044,38 @@ Mpt::Mpt(mpt_params _params) {
 
   model.hparams.n_ctx = params.n_ctx;
 
+  if (params.numa) {
+    ggml_numa_init();
+  }
+
+  // the same threads serve every mpt_eval of this instance, the tuner may try up to all CPUs
+  int max_threads = std::max(params.n_threads, params.n_threads_batch);
+  if (params.autotune) {
+    max_threads = std::max(max_threads, params.cpus.empty()
+                                            ? (int)std::thread::hardware_concurrency()
+                                            : (int)params.cpus.size());
+  }
+
+  threadpool = ggml_threadpool_new(max_threads);
+  compute_cache = ggml_compute_cache_new();
+
+  affinity = params.physical_cores ? GGML_AFFINITY_PHYSICAL :
+             !params.cpus.empty()  ? GGML_AFFINITY_CPUS : GGML_AFFINITY_NONE;
+
+  model.mem_flags = (params.hugepages >= 1024 ? GGML_MEM_HUGE_1G :
+                     params.hugepages > 0     ? GGML_MEM_HUGE_2M : 0) |
+                    (params.use_mlock ? GGML_MEM_LOCK : 0) |
+                    (params.prefault ? GGML_MEM_PREFAULT : 0);
+
   // load the model
   {
     const int64_t t_start_us = ggml_time_us();
 
-    if (!mpt_model_load(*this, params.model, model, vocab)) {
+    // huge pages and NUMA placement are for anonymous memory only, the container is read into
+    // the context instead - mbind() does not move the page cache pages of a shared file mapping
+    if (!mpt_model_load(*this, params.model, model, vocab,
+                        params.use_mmap && params.hugepages == 0 && !params.numa,
+                        params.n_threads)) {
       oss << "error " << __func__ << ": failed to load model from '"
           << params.model << "'\n";
 
@@ -912,9 +1085,27 @@ Mpt::Mpt(mpt_params _params) {
       return;
     }
 
+    // each node keeps the weight rows that its threads multiply with
+    if (params.numa) {
+      ggml_numa_place(model.wte_weight);
+
+      for (auto &layer : model.layers) {
+        ggml_numa_place(layer.c_attn_wqkv_weight);
+        ggml_numa_place(layer.c_attn_out_proj_weight);
+        ggml_numa_place(layer.ffn_up_proj);
+        ggml_numa_place(layer.ffn_down_proj);
+      }
+    }
+
     t_load_us = ggml_time_us() - t_start_us;
   }
 
+  if (params.autotune) {
+    Autotune(max_threads);
+  }
+
+  gpt_tokenizer_init(tokenizer, vocab);
+
   if (params.top_k == 0) {
     params.top_k = model.hparams.n_vocab;
   }
@@ -940,6 +1131,167 @@ Mpt::Mpt(mpt_params _params) {
   cleasr_log_stream();
 }
 
+// microseconds per token of an mpt_eval of n_tokens tokens on n_threads threads, best of 3 runs
+static double mpt_eval_time(Mpt &mpt_ctx, const mpt_model &model, int n_threads,
+                            ggml_threadpool *pool, ggml_compute_cache *cache,
+                            enum ggml_affinity affinity,
+                            const std::vector<int> &cpus, int n_tokens,
+                            size_t &mem_per_token) {
+  const std::vector<gpt_vocab::id> embd(n_tokens, 0);
+  std::vector<float> logits;
+
+  int64_t t_best_us = INT64_MAX;
+
+  for (int i = 0; i < 3; ++i) {
+    const int64_t t_start_us = ggml_time_us();
+
+    if (!mpt_eval(mpt_ctx, model, n_threads, pool, cache, affinity, cpus, 0, embd,
+                  logits, false, mem_per_token)) {
+      return INFINITY;
+    }
+
+    t_best_us = std::min(t_best_us, ggml_time_us() - t_start_us);
+  }
+
+  return (double)t_best_us / n_tokens;
+}
+
+// the value with the lowest time, trying them in order until one is 10% slower
+// than the best so far - past the knee more threads or bigger batches only lose
+template <typename F>
+static int mpt_autotune_pick(const std::vector<int> &values, F time) {
+  int best = values[0];
+  double t_best = INFINITY;
+
+  for (int v : values) {
+    const double t = time(v);
+    if (t < t_best) {
+      best = v;
+      t_best = t;
+    } else if (t > 1.1 * t_best) {
+      break;
+    }
+  }
+
+  return best;
+}
+
+void Mpt::Autotune(int max_threads) {
+  std::ostringstream key;
+  {
+    std::ifstream fin(params.model, std::ios::binary | std::ios::ate);
+    key << "model " << params.model << " " << (int64_t)fin.tellg() << " n_ctx "
+        << model.hparams.n_ctx << " cpus " << max_threads << " affinity "
+        << affinity;
+  }
+
+  if (!params.autotune_file.empty()) {
+    std::ifstream fin(params.autotune_file);
+    std::string line;
+    int n_threads = 0, n_threads_batch = 0, n_batch = 0;
+    size_t task_min_bytes = 0;
+
+    if (std::getline(fin, line) && line == key.str() &&
+        fin >> n_threads >> n_threads_batch >> n_batch >> task_min_bytes &&
+        n_threads > 0 && n_threads <= max_threads && n_threads_batch > 0 &&
+        n_threads_batch <= max_threads && n_batch > 0 && task_min_bytes > 0) {
+      params.n_threads = n_threads;
+      params.n_threads_batch = n_threads_batch;
+      params.n_batch = n_batch;
+      ggml_threadpool_set_task_min_bytes(threadpool, task_min_bytes);
+
+      oss << __func__ << ": from " << params.autotune_file
+          << ": n_threads = " << n_threads
+          << ", n_threads_batch = " << n_threads_batch
+          << ", n_batch = " << n_batch
+          << ", task_min_bytes = " << task_min_bytes << "\n";
+
+      log_message = oss.str();
+      OnLogMessage(log_message);
+      cleasr_log_stream();
+      return;
+    }
+  }
+
+  // one thread per physical core at most
+  if (params.physical_cores && params.cpus.empty()) {
+    const int n_cores = ggml_cpu_physical_cores(nullptr, 0);
+    if (n_cores > 0) {
+      max_threads = std::min(max_threads, n_cores);
+    }
+  }
+
+  std::vector<int> threads;
+  for (int t = 1; t < max_threads; t *= 2) {
+    threads.push_back(t);
+  }
+  threads.push_back(max_threads);
+
+  const int n_ctx = model.hparams.n_ctx;
+
+  std::vector<int> batches;
+  for (int b = 8; b <= std::min(128, n_ctx / 2); b *= 2) {
+    batches.push_back(b);
+  }
+  if (batches.empty()) {
+    batches.push_back(std::max(1, n_ctx / 2));
+  }
+
+  // the smallest node worth splitting over the threads, before timing the threads themselves
+  ggml_task_cost_calibrate(max_threads, threadpool);
+
+  size_t mem_per_token = 0;
+
+  auto measure = [&](const char *what, int n_threads, int n_tokens) {
+    const double t = mpt_eval_time(*this, model, n_threads, threadpool,
+                                   compute_cache, affinity, params.cpus, n_tokens,
+                                   mem_per_token);
+
+    oss << __func__ << ": " << what << " " << n_tokens << " tokens on "
+        << n_threads << " threads: " << std::fixed << std::setprecision(2)
+        << t / 1000.0 << " ms/token\n";
+
+    log_message = oss.str();
+    OnLogMessage(log_message);
+    cleasr_log_stream();
+
+    return t;
+  };
+
+  // sets mem_per_token for the bigger batches
+  mpt_eval_time(*this, model, params.n_threads, threadpool, compute_cache, affinity,
+                params.cpus, 4, mem_per_token);
+
+  params.n_threads = mpt_autotune_pick(
+      threads, [&](int t) { return measure("decode", t, 1); });
+
+  // threads at a mid-size batch first, then the batch size on those threads
+  const int n_batch_probe = batches[batches.size() / 2];
+
+  params.n_threads_batch = mpt_autotune_pick(
+      threads, [&](int t) { return measure("prefill", t, n_batch_probe); });
+
+  params.n_batch = mpt_autotune_pick(batches, [&](int b) {
+    return measure("prefill", params.n_threads_batch, b);
+  });
+
+  oss << __func__ << ": n_threads = " << params.n_threads
+      << ", n_threads_batch = " << params.n_threads_batch
+      << ", n_batch = " << params.n_batch
+      << ", task_min_bytes = " << ggml_threadpool_get_task_min_bytes(threadpool) << "\n";
+
+  log_message = oss.str();
+  OnLogMessage(log_message);
+  cleasr_log_stream();
+
+  if (!params.autotune_file.empty()) {
+    std::ofstream fout(params.autotune_file);
+    fout << key.str() << "\n"
+         << params.n_threads << " " << params.n_threads_batch << " "
+         << params.n_batch << " " << ggml_threadpool_get_task_min_bytes(threadpool) << "\n";
+  }
+}
+
 std::string Mpt::GetRandomMessage() { return gpt_random_prompt(rng); }
 
 std::string Mpt::Process(const std::string &message) {
@@ -948,7 +1300,7 @@ std::string Mpt::Process(const std::string &message) {
 }
 
 std::vector<int> Mpt::TokenizeMessage(const std::string &message) {
-  std::vector<int> embd_inp = ::gpt_tokenize(vocab, message);
+  std::vector<int> embd_inp = ::gpt_tokenize(tokenizer, message);
 
   oss << "\n";
   oss << __func__ << ": number of tokens in prompt = " << embd_inp.size()
@@ -970,21 +1322,45 @@ std::vector<int> Mpt::TokenizeMessage(const std::string &message) {
   return embd_inp;
 }
 
+gpt_worker_pool &Mpt::TokenizePool() {
+  if (tokenize_pool == nullptr) {
+    tokenize_pool = new gpt_worker_pool(std::max(1, params.n_threads_tokenize));
+  }
+  return *tokenize_pool;
+}
+
+void Mpt::TokenizeMessages(const std::vector<std::string> &messages,
+                           std::vector<int> &tokens,
+                           std::vector<size_t> &offsets) {
+  gpt_tokenize_batch(tokenizer, messages, TokenizePool(), tokens, offsets);
+}
+
+std::vector<std::string>
+Mpt::DetokenizeMessages(const std::vector<int> &tokens,
+                        const std::vector<size_t> &offsets) {
+  std::vector<std::string> messages;
+  if (!gpt_detokenize_batch(tokenizer, tokens, offsets, TokenizePool(),
+                            messages)) {
+    OnLogMessage("DetokenizeMessages: offsets have to start at 0, not "
+                 "decrease and end at the number of tokens\n");
+  }
+  return messages;
+}
+
 std::string Mpt::ProcessTokenizedMessage(const std::vector<int> &embd_inp) {
   int64_t t_sample_us = 0;
   int64_t t_predict_us = 0;
   const int64_t t_main_start_us = ggml_time_us();
 
-  std::vector<int32_t> last_n_tokens(params.n_ctx);
-  std::fill(last_n_tokens.begin(), last_n_tokens.end(), 0);
+  gpt_last_n_tokens last_n_tokens(std::max(params.repeat_last_n, 0));
 
   std::vector<gpt_vocab::id> embd;
   std::vector<float> logits;
 
   // determine the required inference memory per token:
   size_t mem_per_token = 0;
-  mpt_eval(*this, model, params.n_threads, 0, {0, 1, 2, 3}, logits, false,
-           mem_per_token);
+  mpt_eval(*this, model, params.n_threads_batch, threadpool, compute_cache, affinity,
+           params.cpus, 0, {0, 1, 2, 3}, logits, false, mem_per_token);
 
   int n_past = 0;
   int n_consumed = 0;
@@ -995,8 +1371,12 @@ std::string Mpt::ProcessTokenizedMessage(const std::vector<int> &embd_inp) {
     if (embd.size() > 0) {
       const int64_t t_start_us = ggml_time_us();
 
-      if (!mpt_eval(*this, model, params.n_threads, n_past, embd, logits, false,
-                    mem_per_token)) {
+      // prompt batches are compute bound, single tokens bandwidth bound
+      const int n_threads =
+          embd.size() > 1 ? params.n_threads_batch : params.n_threads;
+
+      if (!mpt_eval(*this, model, n_threads, threadpool, compute_cache, affinity,
+                    params.cpus, n_past, embd, logits, false, mem_per_token)) {
         oss << __func__ << ": failed to predict\n";
 
         log_message = oss.str();
@@ -1027,11 +1407,10 @@ std::string Mpt::ProcessTokenizedMessage(const std::vector<int> &embd_inp) {
 
         id = gpt_sample_top_k_top_p_repeat(
             vocab, logits.data() + (logits.size() - model.hparams.n_vocab),
-            last_n_tokens.data(), last_n_tokens.size(), top_k, top_p, temp,
-            repeat_last_n, repeat_penalty, rng);
+            last_n_tokens.data.data(), last_n_tokens.data.size(), top_k, top_p,
+            temp, repeat_last_n, repeat_penalty, sample_ws, rng);
 
-        last_n_tokens.erase(last_n_tokens.begin());
-        last_n_tokens.push_back(id);
+        last_n_tokens.push(id);
 
         t_sample_us += ggml_time_us() - t_start_sample_us;
       }
@@ -1045,8 +1424,7 @@ std::string Mpt::ProcessTokenizedMessage(const std::vector<int> &embd_inp) {
       while ((int)embd_inp.size() > n_consumed) {
         embd.push_back(embd_inp[n_consumed]);
 
-        last_n_tokens.erase(last_n_tokens.begin());
-        last_n_tokens.push_back(embd_inp[n_consumed]);
+        last_n_tokens.push(embd_inp[n_consumed]);
 
         ++n_consumed;
         if ((int)embd.size() >= params.n_batch) {
@@ -1057,7 +1435,7 @@ std::string Mpt::ProcessTokenizedMessage(const std::vector<int> &embd_inp) {
 
     // display text
     for (auto id : embd) {
-      auto token = vocab.id_to_token[id];
+      auto token = vocab.get_token(id);
       OnNewTokenProcessed(token);
       result += token;
     }
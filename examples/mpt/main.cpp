@@ -226,30 +226,9 @@ bool mpt_model_load(const std::string & fname, mpt_model & model, gpt_vocab & vo
     }
 
     // load vocab
-    {
-        const int32_t n_vocab = model.hparams.n_vocab;
-
-        std::string word;
-        std::vector<char> buf(128);
-
-        for (int i = 0; i < n_vocab; i++) {
-            uint32_t len;
-            fin.read((char *) &len, sizeof(len));
-
-            buf.resize(len);
-            fin.read((char *) buf.data(), len);
-            word.assign(buf.data(), len);
-
-            // Convert token from utf-8
-            std::wstring word_multibytes = convert_to_wstring(word);
-            word.resize(word_multibytes.size());
-            for (int w = 0; w < word_multibytes.size(); w++) {
-                word[w] = uint8_t(word_multibytes[w]);
-            }
-
-            vocab.token_to_id[word] = i;
-            vocab.id_to_token[i] = word;
-        }
+    if (!gpt_vocab_read(fin, model.hparams.n_vocab, true, vocab)) {
+        fprintf(stderr, "%s: invalid model file '%s' (bad vocab)\n", __func__, fname.c_str());
+        return false;
     }
 
     // for the big tensors, we have the option to store the data in 16-bit
@@ -515,7 +494,7 @@ bool mpt_eval(const mpt_model & model, const int n_threads, const int n_past,
         {
             cur = ggml_norm(ctx0, inpL);
 
-            cur = ggml_mul(ctx0, ggml_repeat(ctx0, model.layers[il].norm_1_weight, cur), cur);
+            cur = ggml_mul(ctx0, cur, model.layers[il].norm_1_weight);
         }
 
         // self-attention
@@ -611,7 +590,7 @@ bool mpt_eval(const mpt_model & model, const int n_threads, const int n_past,
         {
             cur = ggml_norm(ctx0, inpL);
 
-            cur = ggml_mul(ctx0, ggml_repeat(ctx0, model.layers[il].norm_2_weight, cur), cur);
+            cur = ggml_mul(ctx0, cur, model.layers[il].norm_2_weight);
         }
 
         // n = self.mlp(m)
@@ -637,7 +616,7 @@ bool mpt_eval(const mpt_model & model, const int n_threads, const int n_past,
     {
         inpL = ggml_norm(ctx0, inpL);
         // inpL = ln_f_g*inpL
-        inpL = ggml_mul(ctx0, ggml_repeat(ctx0, model.norm_f_weight, inpL), inpL);
+        inpL = ggml_mul(ctx0, inpL, model.norm_f_weight);
     }
 
     ggml_set_scratch(ctx0, { 0, 0, nullptr, });
@@ -650,6 +629,7 @@ bool mpt_eval(const mpt_model & model, const int n_threads, const int n_past,
 
     // run the computation
     ggml_build_forward_expand(&gf, inpL);
+    ggml_graph_fuse(&gf);
     ggml_graph_compute_with_ctx(ctx0, &gf, n_threads);
 
     // std::cout << "Qcur" << std::endl;
@@ -925,8 +905,8 @@ int main(int argc, char ** argv) {
     int64_t t_sample_us = 0;
     int64_t t_predict_us = 0;
 
-    std::vector<int32_t> last_n_tokens(params.n_ctx);
-    std::fill(last_n_tokens.begin(), last_n_tokens.end(), 0);
+    gpt_last_n_tokens last_n_tokens(std::max(params.repeat_last_n, 0));
+    gpt_sample_workspace sample_ws;
 
     // tokenize the prompt
     std::vector<int> embd_inp = ::gpt_tokenize(vocab, params.prompt);
@@ -980,10 +960,9 @@ int main(int argc, char ** argv) {
             {
                 const int64_t t_start_sample_us = ggml_time_us();
 
-                id = gpt_sample_top_k_top_p_repeat(vocab, logits.data() + (logits.size() - model.hparams.n_vocab), last_n_tokens.data(), last_n_tokens.size(), top_k, top_p, temp, repeat_last_n, repeat_penalty, rng);
+                id = gpt_sample_top_k_top_p_repeat(vocab, logits.data() + (logits.size() - model.hparams.n_vocab), last_n_tokens.data.data(), last_n_tokens.data.size(), top_k, top_p, temp, repeat_last_n, repeat_penalty, sample_ws, rng);
 
-                last_n_tokens.erase(last_n_tokens.begin());
-                last_n_tokens.push_back(id);
+                last_n_tokens.push(id);
 
                 t_sample_us += ggml_time_us() - t_start_sample_us;
             }
@@ -997,8 +976,7 @@ int main(int argc, char ** argv) {
             while ((int) embd_inp.size() > n_consumed) {
                 embd.push_back(embd_inp[n_consumed]);
 
-                last_n_tokens.erase(last_n_tokens.begin());
-                last_n_tokens.push_back(embd_inp[n_consumed]);
+                last_n_tokens.push(embd_inp[n_consumed]);
 
                 ++n_consumed;
                 if ((int) embd.size() >= params.n_batch) {
@@ -1009,7 +987,7 @@ int main(int argc, char ** argv) {
 
         // display text
         for (auto id : embd) {
-           printf("%s", vocab.id_to_token[id].c_str());
+           printf("%s", vocab.get_token(id).c_str());
         }
         fflush(stdout);
 
@@ -490,7 +490,7 @@ bool replit_eval(const replit_model & model, const int n_threads, const int n_pa
         {
             cur = ggml_norm(ctx0, inpL);
 
-            cur = ggml_mul(ctx0, ggml_repeat(ctx0, model.layers[il].norm_1_weight, cur), cur);
+            cur = ggml_mul(ctx0, cur, model.layers[il].norm_1_weight);
         }
 
         // self-attention
@@ -579,7 +579,7 @@ bool replit_eval(const replit_model & model, const int n_threads, const int n_pa
         {
             cur = ggml_norm(ctx0, inpL);
 
-            cur = ggml_mul(ctx0, ggml_repeat(ctx0, model.layers[il].norm_2_weight, cur), cur);
+            cur = ggml_mul(ctx0, cur, model.layers[il].norm_2_weight);
         }
 
         // n = self.mlp(m)
@@ -603,7 +603,7 @@ bool replit_eval(const replit_model & model, const int n_threads, const int n_pa
     {
         inpL = ggml_norm(ctx0, inpL);
         // inpL = ln_f_g*inpL
-        inpL = ggml_mul(ctx0, ggml_repeat(ctx0, model.norm_f_weight, inpL), inpL);
+        inpL = ggml_mul(ctx0, inpL, model.norm_f_weight);
     }
 
     // output embedding weight tied to input embedding
@@ -614,6 +614,7 @@ bool replit_eval(const replit_model & model, const int n_threads, const int n_pa
 
     // run the computation
     ggml_build_forward_expand(&gf, inpL);
+    ggml_graph_fuse(&gf);
     ggml_graph_compute_with_ctx(ctx0, &gf, n_threads);
 
     // std::cout << "Qcur" << std::endl;
@@ -646,6 +646,9 @@ struct whisper_state {
     int    buf_last = 0;
     size_t buf_max_size[WHISPER_MAX_SCRATCH_BUFFERS] = { 0 };
 
+    // plan of the last graph and the work buffer of the encode / decode graphs
+    ggml_compute_cache * compute_cache = nullptr;
+
     // decode output (2-dimensional array: [n_tokens][n_vocab])
     std::vector<float> logits;
 
@@ -1560,9 +1563,9 @@ static bool whisper_encode_internal(
                 // cur = ln_0_w*cur + ln_0_b
                 cur = ggml_add(ctx0,
                         ggml_mul(ctx0,
-                            ggml_repeat(ctx0, layer.attn_ln_0_w, cur),
-                            cur),
-                        ggml_repeat(ctx0, layer.attn_ln_0_b, cur));
+                            cur,
+                            layer.attn_ln_0_w),
+                        layer.attn_ln_0_b);
             }
 
             // self-attention
@@ -1574,10 +1577,8 @@ static bool whisper_encode_internal(
                         cur);
 
                 Qcur = ggml_add(ctx0,
-                        ggml_repeat(ctx0,
-                            layer.attn_q_b,
-                            Qcur),
-                        Qcur);
+                        Qcur,
+                        layer.attn_q_b);
 
                 //Qcur = ggml_scale_inplace(ctx0, Qcur, ggml_new_f32(ctx0, pow(float(n_state)/n_head, -0.25)));
 
@@ -1593,10 +1594,8 @@ static bool whisper_encode_internal(
                         cur);
 
                 Vcur = ggml_add(ctx0,
-                        ggml_repeat(ctx0,
-                            layer.attn_v_b,
-                            Vcur),
-                        Vcur);
+                        Vcur,
+                        layer.attn_v_b);
 
                 // ------
 
@@ -1685,8 +1684,8 @@ static bool whisper_encode_internal(
                 wstate.use_buf(ctx0, 1);
 
                 cur = ggml_add(ctx0,
-                        ggml_repeat(ctx0, layer.attn_ln_1_b, cur),
-                        cur);
+                        cur,
+                        layer.attn_ln_1_b);
             }
 
             wstate.use_buf(ctx0, 2);
@@ -1709,9 +1708,9 @@ static bool whisper_encode_internal(
                     // cur = mlp_ln_w*cur + mlp_ln_b
                     cur = ggml_add(ctx0,
                             ggml_mul(ctx0,
-                                ggml_repeat(ctx0, layer.mlp_ln_w, cur),
-                                cur),
-                            ggml_repeat(ctx0, layer.mlp_ln_b, cur));
+                                cur,
+                                layer.mlp_ln_w),
+                            layer.mlp_ln_b);
                 }
 
 #ifdef WHISPER_USE_FLASH_FF
@@ -1731,8 +1730,8 @@ static bool whisper_encode_internal(
                 wstate.use_buf(ctx0, 1);
 
                 cur = ggml_add(ctx0,
-                        ggml_repeat(ctx0, layer.mlp_0_b, cur),
-                        cur);
+                        cur,
+                        layer.mlp_0_b);
 
                 wstate.use_buf(ctx0, 0);
 
@@ -1749,8 +1748,8 @@ static bool whisper_encode_internal(
                 wstate.use_buf(ctx0, 0);
 
                 cur = ggml_add(ctx0,
-                        ggml_repeat(ctx0, layer.mlp_1_b, cur),
-                        cur);
+                        cur,
+                        layer.mlp_1_b);
 #endif
             }
 
@@ -1772,9 +1771,9 @@ static bool whisper_encode_internal(
             // cur = ln_f_g*cur + ln_f_b
             cur = ggml_add(ctx0,
                     ggml_mul(ctx0,
-                        ggml_repeat(ctx0, model.e_ln_w, cur),
-                        cur),
-                    ggml_repeat(ctx0, model.e_ln_b, cur));
+                        cur,
+                        model.e_ln_w),
+                    model.e_ln_b);
         }
 
         wstate.use_buf(ctx0, -1);
@@ -1784,7 +1783,7 @@ static bool whisper_encode_internal(
             struct ggml_cgraph gf = {};
 
             ggml_build_forward_expand(&gf, cur);
-            ggml_graph_compute_with_ctx(ctx0, &gf, n_threads);
+            ggml_graph_compute_with_cache(wstate.compute_cache, &gf, n_threads);
 
             //ggml_graph_print(&gf);
         }
@@ -1851,10 +1850,8 @@ static bool whisper_encode_internal(
                 cur);
 
             Vcross = ggml_add(ctx0,
-                ggml_repeat(ctx0,
-                    layer.cross_attn_v_b,
-                    Vcross),
-                Vcross);
+                Vcross,
+                layer.cross_attn_v_b);
 
             wstate.use_buf(ctx0, -1);
 
@@ -1869,7 +1866,7 @@ static bool whisper_encode_internal(
             ggml_build_forward_expand(&gf, ggml_cpy(ctx0, Vcross, v));
         }
 
-        ggml_graph_compute_with_ctx(ctx0, &gf, n_threads);
+        ggml_graph_compute_with_cache(wstate.compute_cache, &gf, n_threads);
         //ggml_graph_print(&gf);
     }
 
@@ -1971,9 +1968,9 @@ static bool whisper_decode_internal(
             // cur = ln_0_w*cur + ln_0_b
             cur = ggml_add(ctx0,
                     ggml_mul(ctx0,
-                        ggml_repeat(ctx0, layer.attn_ln_0_w, cur),
-                        cur),
-                    ggml_repeat(ctx0, layer.attn_ln_0_b, cur));
+                        cur,
+                        layer.attn_ln_0_w),
+                    layer.attn_ln_0_b);
         }
 
         // self-attention
@@ -1983,10 +1980,8 @@ static bool whisper_decode_internal(
                     cur);
 
             Qcur = ggml_add(ctx0,
-                    ggml_repeat(ctx0,
-                        layer.attn_q_b,
-                        Qcur),
-                    Qcur);
+                    Qcur,
+                    layer.attn_q_b);
 
             Qcur = ggml_scale_inplace(ctx0, Qcur, ggml_new_f32(ctx0, pow(float(n_state)/n_head, -0.25)));
 
@@ -2004,10 +1999,8 @@ static bool whisper_decode_internal(
                         cur);
 
                 Vcur = ggml_add(ctx0,
-                        ggml_repeat(ctx0,
-                            layer.attn_v_b,
-                            Vcur),
-                        Vcur);
+                        Vcur,
+                        layer.attn_v_b);
 
                 Vcur = ggml_transpose(ctx0, ggml_reshape_2d(ctx0, Vcur, n_state, N));
 
@@ -2080,8 +2073,8 @@ static bool whisper_decode_internal(
             wstate.use_buf(ctx0, 1);
 
             cur = ggml_add(ctx0,
-                    ggml_repeat(ctx0, layer.attn_ln_1_b, cur),
-                    cur);
+                    cur,
+                    layer.attn_ln_1_b);
         }
 
         wstate.use_buf(ctx0, 2);
@@ -2098,9 +2091,9 @@ static bool whisper_decode_internal(
             // cur = ln_0_w*cur + ln_0_b
             cur = ggml_add(ctx0,
                     ggml_mul(ctx0,
-                        ggml_repeat(ctx0, layer.cross_attn_ln_0_w, cur),
-                        cur),
-                    ggml_repeat(ctx0, layer.cross_attn_ln_0_b, cur));
+                        cur,
+                        layer.cross_attn_ln_0_w),
+                    layer.cross_attn_ln_0_b);
         }
 
         // cross-attention
@@ -2110,10 +2103,8 @@ static bool whisper_decode_internal(
                     cur);
 
             Qcur = ggml_add(ctx0,
-                    ggml_repeat(ctx0,
-                        layer.cross_attn_q_b,
-                        Qcur),
-                    Qcur);
+                    Qcur,
+                    layer.cross_attn_q_b);
 
             Qcur = ggml_scale_inplace(ctx0, Qcur, ggml_new_f32(ctx0, pow(float(n_state)/n_head, -0.25)));
 
@@ -2186,8 +2177,8 @@ static bool whisper_decode_internal(
             wstate.use_buf(ctx0, 1);
 
             cur = ggml_add(ctx0,
-                    ggml_repeat(ctx0, layer.cross_attn_ln_1_b, cur),
-                    cur);
+                    cur,
+                    layer.cross_attn_ln_1_b);
         }
 
         wstate.use_buf(ctx0, 2);
@@ -2210,9 +2201,9 @@ static bool whisper_decode_internal(
                 // cur = mlp_ln_w*cur + mlp_ln_b
                 cur = ggml_add(ctx0,
                         ggml_mul(ctx0,
-                            ggml_repeat(ctx0, layer.mlp_ln_w, cur),
-                            cur),
-                        ggml_repeat(ctx0, layer.mlp_ln_b, cur));
+                            cur,
+                            layer.mlp_ln_w),
+                        layer.mlp_ln_b);
             }
 
             wstate.use_buf(ctx0, 0);
@@ -2225,8 +2216,8 @@ static bool whisper_decode_internal(
             wstate.use_buf(ctx0, 1);
 
             cur = ggml_add(ctx0,
-                    ggml_repeat(ctx0, layer.mlp_0_b, cur),
-                    cur);
+                    cur,
+                    layer.mlp_0_b);
 
             wstate.use_buf(ctx0, 0);
 
@@ -2243,8 +2234,8 @@ static bool whisper_decode_internal(
             wstate.use_buf(ctx0, 0);
 
             cur = ggml_add(ctx0,
-                    ggml_repeat(ctx0, layer.mlp_1_b, cur),
-                    cur);
+                    cur,
+                    layer.mlp_1_b);
         }
 
         wstate.use_buf(ctx0, 3);
@@ -2264,9 +2255,9 @@ static bool whisper_decode_internal(
 
         cur = ggml_add(ctx0,
                 ggml_mul(ctx0,
-                    ggml_repeat(ctx0, model.d_ln_w, cur),
-                    cur),
-                ggml_repeat(ctx0, model.d_ln_b, cur));
+                    cur,
+                    model.d_ln_w),
+                model.d_ln_b);
     }
 
     wstate.use_buf(ctx0, 0);
@@ -2283,7 +2274,7 @@ static bool whisper_decode_internal(
     // run the computation
     {
         ggml_build_forward_expand(&gf, logits);
-        ggml_graph_compute_with_ctx(ctx0, &gf, n_threads);
+        ggml_graph_compute_with_cache(wstate.compute_cache, &gf, n_threads);
     }
 
     // extract logits for all N tokens
@@ -2735,6 +2726,8 @@ struct whisper_state * whisper_init_state(whisper_context * ctx) {
     state->buf_scratch[2].resize(MEM_REQ_SCRATCH2.at(ctx->model.type));
     state->buf_scratch[3].resize(MEM_REQ_SCRATCH3.at(ctx->model.type));
 
+    state->compute_cache = ggml_compute_cache_new();
+
     state->rng = std::mt19937(0);
 
     return state;
@@ -2936,6 +2929,8 @@ void whisper_free_state(struct whisper_state * state)
             kv_cache_free(state->decoders[i].kv_self);
         }
 
+        ggml_compute_cache_free(state->compute_cache);
+
 #ifdef WHISPER_USE_COREML
         if (state->ctx_coreml != nullptr) {
             whisper_coreml_free(state->ctx_coreml);
@@ -5097,13 +5092,16 @@ WHISPER_API const char * whisper_bench_ggml_mul_mat_str(int n_threads) {
 
             double tsum = 0.0;
 
+            // planned once, outside of the timings
+            ggml_compute_cache * cache = ggml_compute_cache_new();
+
             // heat-up
-            ggml_graph_compute_with_ctx(ctx0, &gf, n_threads);
+            ggml_graph_compute_with_cache(cache, &gf, n_threads);
 
             for (int i = 0; i < n_max; ++i) {
                 const int64_t t0 = ggml_time_us();
 
-                ggml_graph_compute_with_ctx(ctx0, &gf, n_threads);
+                ggml_graph_compute_with_cache(cache, &gf, n_threads);
 
                 const int64_t t1 = ggml_time_us();
 
@@ -5115,6 +5113,7 @@ WHISPER_API const char * whisper_bench_ggml_mul_mat_str(int n_threads) {
                 }
             }
 
+            ggml_compute_cache_free(cache);
             ggml_free(ctx0);
 
             s = ((2.0*N*N*N*n)/tsum)*1e-9;
@@ -16,6 +16,17 @@ GGML_API void   ggml_allocr_reset(struct ggml_allocr * alloc);
 GGML_API void   ggml_allocr_alloc(struct ggml_allocr * alloc, struct ggml_tensor * tensor);
 GGML_API size_t ggml_allocr_alloc_graph(struct ggml_allocr * alloc, struct ggml_cgraph * graph);
 
+// same as ggml_allocr_alloc_graph(), but the tensors are placed once their lifetimes over the whole graph are
+// known, the largest first at the lowest offset that is free for all of their lifetime; the plan is kept and
+// used again for the next graph with the same allocations, which is then placed without any search - and
+// without the walk over the graph if it has the same tensors, e.g. built again in the same context memory
+// returns the max size of the buffer, like ggml_allocr_alloc_graph()
+GGML_API size_t ggml_allocr_alloc_graph_planned(struct ggml_allocr * alloc, struct ggml_cgraph * graph);
+
+// the size of the last plan, and what ggml_allocr_alloc_graph() needs for the same graph
+GGML_API size_t ggml_allocr_planned_size(struct ggml_allocr * alloc);
+GGML_API size_t ggml_allocr_greedy_size (struct ggml_allocr * alloc);
+
 
 #ifdef  __cplusplus
 }
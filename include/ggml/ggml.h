@@ -210,6 +210,8 @@
 #define GGML_MAX_NAME          48
 #define GGML_MAX_OP_PARAMS     32
 #define GGML_DEFAULT_N_THREADS 4
+#define GGML_DEFAULT_WAIT_SPIN_US 200
+#define GGML_DEFAULT_TASK_MIN_BYTES (64*1024)
 
 
 #define GGML_EXIT_SUCCESS 0
@@ -271,6 +273,7 @@ extern "C" {
 
     struct ggml_object;
     struct ggml_context;
+    struct ggml_threadpool;
 
     enum ggml_type {
         GGML_TYPE_F32  = 0,
@@ -474,6 +477,14 @@ extern "C" {
 
     // the compute plan that needs to be prepared for ggml_graph_compute()
     // since https://github.com/ggerganov/ggml/issues/287
+    // where the compute threads of a plan run
+    enum ggml_affinity {
+        GGML_AFFINITY_NONE,     // left to the OS, or spread over the nodes after ggml_numa_init()
+        GGML_AFFINITY_CPUS,     // thread i runs on affinity_cpus[i], the threads past n_affinity_cpus on any of them
+        GGML_AFFINITY_PHYSICAL, // one thread per physical core, SMT siblings stay free - of affinity_cpus if set;
+                                // the threads past the cores run on any of these cores
+    };
+
     struct ggml_cplan {
         size_t    work_size; // size of work buffer, calculated by `ggml_graph_plan()`
         uint8_t * work_data; // work buffer, to be allocated by caller before calling to `ggml_graph_compute()`
@@ -483,9 +494,32 @@ extern "C" {
         // the `n_tasks` of nodes, 1:1 mapping to cgraph nodes
         int n_tasks[GGML_MAX_NODES];
 
+        // MUL_MAT nodes that reuse the src1 converted by an earlier MUL_MAT, from `ggml_graph_plan()`
+        bool src1_converted[GGML_MAX_NODES];
+
         // abort ggml_graph_compute when true
         bool (*abort_callback)(void * data);
         void * abort_callback_data;
+
+        // optional persistent threads from ggml_threadpool_new(), NULL to create n_threads - 1 threads
+        // for this call; n_threads must not exceed the size of the pool
+        struct ggml_threadpool * threadpool;
+
+        // how a compute thread waits for the others to finish a node: spin for up to wait_spin_us,
+        // then sleep until woken; -1 always spins, 0 sleeps right away
+        // set to GGML_DEFAULT_WAIT_SPIN_US by ggml_graph_plan()
+        int wait_spin_us;
+
+        // let runs of consecutive nodes that do not touch each other's data share the threads,
+        // instead of running one node at a time; set to true by ggml_graph_plan()
+        bool concurrent_nodes;
+
+        // pin the compute threads to CPUs (Linux only), the calling thread gets its own affinity back
+        // when ggml_graph_compute() returns; GGML_AFFINITY_NONE from ggml_graph_plan()
+        // with NUMA, list the CPUs node by node so that the threads stay on the nodes of their rows
+        enum ggml_affinity affinity;
+        const int *        affinity_cpus;
+        int                n_affinity_cpus;
     };
 
     // next prime after GGML_MAX_NODES
@@ -508,6 +542,8 @@ extern "C" {
         int     perf_runs;
         int64_t perf_cycles;
         int64_t perf_time_us;
+        int64_t perf_spin_us;  // time compute threads spent spinning for each other, summed over threads
+        int64_t perf_sleep_us; // time compute threads spent sleeping for each other, summed over threads
     };
 
     static const size_t GGML_GRAPH_SIZE = sizeof(struct ggml_cgraph);
@@ -526,6 +562,21 @@ extern "C" {
         bool   no_alloc;   // don't allocate memory for the tensor data
     };
 
+    // options of ggml_mem_buffer_alloc, each one is best effort
+    enum ggml_mem_flags {
+        GGML_MEM_HUGE_2M  = 1 << 0, // 2 MB huge pages (MAP_HUGETLB), transparent huge pages if none are reserved
+        GGML_MEM_HUGE_1G  = 1 << 1, // 1 GB huge pages, then as GGML_MEM_HUGE_2M
+        GGML_MEM_LOCK     = 1 << 2, // mlock the pages so that they are never swapped out
+        GGML_MEM_PREFAULT = 1 << 3, // touch every page at allocation instead of on first use
+    };
+
+    // page-aligned host memory for weights, KV cache and compute buffers - pass data as the mem_buffer of ggml_init
+    struct ggml_mem_buffer {
+        void * data;
+        size_t size;  // mapped bytes, the requested size rounded up to the page size
+        int    flags; // the ggml_mem_flags that took effect
+    };
+
 
     // compute types
 
@@ -546,6 +597,9 @@ extern "C" {
         // work buffer for all threads
         size_t wsize;
         void * wdata;
+
+        // MUL_MAT: src1 is still converted to the vec_dot_type at the start of wdata by an earlier node
+        bool src1_converted;
     };
 
     // misc
@@ -559,6 +613,22 @@ extern "C" {
     GGML_API void    ggml_numa_init(void); // call once for better performance on NUMA systems
     GGML_API bool    ggml_is_numa(void); // true if init detected that system has >1 NUMA node
 
+    // move the rows of a weight to the NUMA nodes whose threads compute them in ggml_mul_mat,
+    // node n gets rows [n*ne1/n_nodes, (n + 1)*ne1/n_nodes) of each matrix, no-op without NUMA
+    GGML_API void    ggml_numa_place(struct ggml_tensor * tensor);
+
+    // data is NULL if no memory could be mapped at all, a flag that fails only prints a warning
+    GGML_API struct ggml_mem_buffer ggml_mem_buffer_alloc(size_t size, int flags);
+    GGML_API void                   ggml_mem_buffer_free (struct ggml_mem_buffer * buf);
+
+    // the same for memory mapped elsewhere, e.g. an mmap-ed model file - prefault only reads
+    GGML_API bool    ggml_mem_lock    (const void * data, size_t size);
+    GGML_API void    ggml_mem_prefault(const void * data, size_t size);
+
+    // the first CPU of every physical core that the process may run on, from /sys/devices/system/cpu at the
+    // first ggml_init(): writes at most n_max of them and returns how many there are, 0 if unknown
+    GGML_API int     ggml_cpu_physical_cores(int * cpus, int n_max);
+
     GGML_API void    ggml_print_object (const struct ggml_object * obj);
     GGML_API void    ggml_print_objects(const struct ggml_context * ctx);
 
@@ -678,6 +748,9 @@ extern "C" {
             struct ggml_context * ctx,
             struct ggml_tensor  * a);
 
+    // ggml_add, ggml_mul and ggml_div broadcast the rows of b over an f32 a: b has the same number of
+    // columns and its other dimensions divide those of a, so a row of weights needs no ggml_repeat
+    // broadcasting has no backward pass yet
     GGML_API struct ggml_tensor * ggml_add(
             struct ggml_context * ctx,
             struct ggml_tensor  * a,
@@ -1555,16 +1628,80 @@ extern "C" {
     GGML_API struct ggml_cgraph * ggml_build_forward_ctx(struct ggml_context * ctx, struct ggml_tensor * tensor);
     GGML_API size_t ggml_graph_overhead(void);
 
+    // fold chains of nodes of a forward graph into single nodes that skip the intermediate results:
+    // norm followed by a per-row scale and shift, an add followed by norm, and mul_mat followed by
+    // a bias and/or relu/gelu/silu; returns the number of fused chains
+    // call after the graph is built and before it is allocated and planned; only the CPU kernels
+    // know the fused nodes, and the removed intermediate tensors are not computed anymore - except for the
+    // sum of an add folded into a norm, which the fused node writes and ggml_allocr keeps in memory of its own
+    GGML_API int ggml_graph_fuse(struct ggml_cgraph * cgraph);
+
     // ggml_graph_plan() has to be called before ggml_graph_compute()
     // when plan.work_size > 0, caller must allocate memory for plan.work_data
     GGML_API struct ggml_cplan ggml_graph_plan   (struct ggml_cgraph * cgraph, int n_threads /*= GGML_DEFAULT_N_THREADS*/);
+    // the same for computing on pool, with the task_min_bytes of the pool; sets cplan.threadpool
+    GGML_API struct ggml_cplan ggml_graph_plan_pool(struct ggml_cgraph * cgraph, int n_threads, struct ggml_threadpool * pool);
     GGML_API               int ggml_graph_compute(struct ggml_cgraph * cgraph, struct ggml_cplan * cplan);
     GGML_API              void ggml_graph_reset  (struct ggml_cgraph * cgraph);
 
+    // ggml_graph_plan() gives element-wise, row and mul_mat nodes one task per task_min_bytes of data they move,
+    // so that small nodes run on fewer threads or on the calling thread alone, which does not wake the others
+    // ggml_set_task_min_bytes() sets the process default, a threadpool can have its own value for the graphs
+    // planned for it with ggml_graph_plan_pool(), 0 goes back to the default
+    // ggml_task_cost_calibrate() measures what waking n_threads and waiting for them costs on this machine,
+    // in bytes one thread moves meanwhile, and sets the task_min_bytes of pool to that, or the default if NULL
+    GGML_API   void ggml_set_task_min_bytes(size_t task_min_bytes);
+    GGML_API size_t ggml_get_task_min_bytes(void);
+    GGML_API   void ggml_threadpool_set_task_min_bytes(struct ggml_threadpool * pool, size_t task_min_bytes);
+    GGML_API size_t ggml_threadpool_get_task_min_bytes(const struct ggml_threadpool * pool);
+    GGML_API size_t ggml_task_cost_calibrate(int n_threads, struct ggml_threadpool * pool);
+
+    // persistent compute threads that can be shared by many ggml_graph_compute() calls and contexts
+    // a pool of n_threads runs n_threads - 1 workers, the thread calling ggml_graph_compute() is the last one
+    // graphs submitted concurrently to the same pool are computed one after the other
+    GGML_API struct ggml_threadpool * ggml_threadpool_new      (int n_threads);
+    GGML_API                    void ggml_threadpool_free     (struct ggml_threadpool * pool);
+    GGML_API                     int ggml_threadpool_n_threads(const struct ggml_threadpool * pool);
+
+    // queue the graph on cplan->threadpool and return right away, the graphs queued on a pool are computed
+    // in order by a thread of the pool that takes the part of the caller of ggml_graph_compute()
+    // the plan is copied, the graph, its tensors and the work buffer must stay valid until the graph is done
+    // callback, if not NULL, is called with the status of ggml_graph_compute() on the thread of the pool,
+    // before the future is done; free the futures of a pool before the pool
+    struct ggml_compute_future;
+
+    GGML_API struct ggml_compute_future * ggml_graph_compute_async(
+            struct ggml_cgraph      * cgraph,
+            const struct ggml_cplan * cplan,
+            void (*callback)(void * data, int status),
+            void  * callback_data);
+
+    // true once the graph is done, does not block
+    GGML_API bool ggml_compute_future_poll(struct ggml_compute_future * future);
+    // blocks until the graph is done and returns its status, GGML_EXIT_SUCCESS or GGML_EXIT_ABORTED
+    GGML_API  int ggml_compute_future_wait(struct ggml_compute_future * future);
+    // waits for the graph if it is not done yet
+    GGML_API void ggml_compute_future_free(struct ggml_compute_future * future);
+
     // same as ggml_graph_compute() but the work data is allocated as a part of the context
     // note: the drawback of this API is that you must have ensured that the context has enough memory for the work data
     GGML_API void ggml_graph_compute_with_ctx(struct ggml_context * ctx, struct ggml_cgraph * cgraph, int n_threads);
 
+    // a plan and a work buffer kept from one graph to the next: a graph with the same ops, shapes and data
+    // as the last one computes with its plan, other graphs are planned again, and the work buffer only grows
+    // to the largest plan so far, instead of a new one in the context of every graph
+    struct ggml_compute_cache;
+
+    GGML_API struct ggml_compute_cache * ggml_compute_cache_new (void);
+    GGML_API void                        ggml_compute_cache_free(struct ggml_compute_cache * cache);
+
+    // the plan for cgraph on pool (may be NULL), with the work buffer of the cache; it belongs to the cache and
+    // is valid until the next call, the options the caller sets on it (affinity, abort callback, ...) carry over
+    GGML_API struct ggml_cplan * ggml_compute_cache_plan(struct ggml_compute_cache * cache, struct ggml_cgraph * cgraph, int n_threads, struct ggml_threadpool * pool);
+
+    // same as ggml_graph_compute_with_ctx() with the plan and work buffer of the cache
+    GGML_API int ggml_graph_compute_with_cache(struct ggml_compute_cache * cache, struct ggml_cgraph * cgraph, int n_threads);
+
     GGML_API struct ggml_tensor * ggml_graph_get_tensor(struct ggml_cgraph * cgraph, const char * name);
 
     GGML_API void               ggml_graph_export(const struct ggml_cgraph * cgraph, const char * fname);
@@ -1762,6 +1899,7 @@ extern "C" {
     GGML_API int ggml_cpu_has_avx512     (void);
     GGML_API int ggml_cpu_has_avx512_vbmi(void);
     GGML_API int ggml_cpu_has_avx512_vnni(void);
+    GGML_API int ggml_cpu_has_avx_vnni   (void);
     GGML_API int ggml_cpu_has_fma        (void);
     GGML_API int ggml_cpu_has_neon       (void);
     GGML_API int ggml_cpu_has_arm_fma    (void);
@@ -1788,6 +1926,8 @@ extern "C" {
     typedef void (*ggml_to_float_t)  (const void  * GGML_RESTRICT x, float * GGML_RESTRICT y, int k);
     typedef void (*ggml_from_float_t)(const float * GGML_RESTRICT x, void  * GGML_RESTRICT y, int k);
     typedef void (*ggml_vec_dot_t)   (const int n, float * GGML_RESTRICT s, const void * GGML_RESTRICT x, const void * GGML_RESTRICT y);
+    // 4 dot products of x with the y rows ys bytes apart, unpacking each block of x once, into s[0], s[bs], s[2*bs], s[3*bs]
+    typedef void (*ggml_vec_dot_x4_t)(const int n, float * GGML_RESTRICT s, size_t bs, const void * GGML_RESTRICT x, const void * GGML_RESTRICT y, size_t ys);
 
     typedef struct {
         ggml_to_float_t   to_float;
@@ -1795,6 +1935,7 @@ extern "C" {
         ggml_from_float_t from_float_reference;
         ggml_vec_dot_t    vec_dot;
         enum ggml_type    vec_dot_type;
+        ggml_vec_dot_x4_t vec_dot_x4; // NULL if the type has none, last to keep the layout of the fields above
     } ggml_type_traits_t;
 
     ggml_type_traits_t ggml_internal_get_type_traits(enum ggml_type i);
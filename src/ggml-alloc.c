@@ -1,7 +1,9 @@
 #include "ggml-alloc.h"
 #include "ggml.h"
 #include <assert.h>
+#include <limits.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -58,6 +60,35 @@ struct free_block {
 
 #define MAX_FREE_BLOCKS 128
 
+// an allocation of the walk over a graph by ggml_allocr_alloc_graph_planned(), live from the node
+// that allocates it to the last node that uses it
+struct plan_block {
+    size_t vaddr;  // offset in the address space of the walk
+    size_t size;
+    int    start;
+    int    end;    // INT_MAX if it is never freed
+    size_t offset; // in the buffer, relative to the start of the plan
+};
+
+// a node or a parent of a node of the graph of a plan, as the walk found it - a graph with the same
+// tensors is placed from their offsets without the walk
+struct plan_tensor {
+    struct ggml_tensor * tensor;
+    enum ggml_op   op;
+    enum ggml_type type;
+    int64_t ne[GGML_MAX_DIMS];
+    size_t  nb[GGML_MAX_DIMS];
+    int32_t op_params[GGML_MAX_OP_PARAMS / sizeof(int32_t)];
+    struct ggml_tensor * src[GGML_MAX_SRC];
+    void * data;   // before the walk, NULL for the tensors it allocates
+};
+
+// where the walk put a tensor of plan_tensors
+struct plan_place {
+    size_t offset; // in the plan, SIZE_MAX if it is not in it
+    void * data;   // outside of the plan (views of other tensors), NULL if the walk did not set it
+};
+
 struct ggml_allocr {
     void * data;
     size_t size;
@@ -68,11 +99,56 @@ struct ggml_allocr {
     size_t max_size;
     bool measure;
 
+    // offline planning, see ggml_allocr_alloc_graph_planned()
+    bool planning;   // the walk records the blocks instead of allocating them
+    int  plan_step;  // node of the walk
+    size_t plan_top; // end of the blocks of the walk
+    struct plan_block * blocks; // of the walk
+    int n_blocks;
+    int blocks_cap;
+    struct plan_block * plan;   // of the last solved graph, with offsets
+    int n_plan;
+    size_t planned_size;
+    size_t greedy_size;
+    struct plan_tensor * plan_tensors;     // of the last solved graph
+    struct plan_tensor * plan_tensors_new; // of the graph asked for
+    struct plan_place * plan_places;       // of each of plan_tensors
+    int n_plan_tensors;
+    int plan_tensors_cap;
+
 #ifdef GGML_ALLOCATOR_DEBUG
     struct ggml_tensor * allocated_tensors[1024];
 #endif
 };
 
+// addresses of the walk of a plan, after the measure buffer and as unlikely to overlap with real buffers
+static void * const PLAN_BASE_ADDR = (void *) (0x1000 + (1ULL<<40));
+static const size_t PLAN_MAX_SIZE  = 1ULL<<40; // 1 TB
+
+static bool ggml_allocr_is_planned_addr(const struct ggml_allocr * alloc, const void * ptr) {
+    return (const char *) ptr >= (const char *) PLAN_BASE_ADDR && (const char *) ptr < (const char *) PLAN_BASE_ADDR + alloc->plan_top;
+}
+
+// the block of the walk that holds ptr
+static struct plan_block * ggml_allocr_plan_find_block(struct ggml_allocr * alloc, const void * ptr) {
+    const size_t vaddr = (size_t) ((const char *) ptr - (const char *) PLAN_BASE_ADDR);
+
+    int lo = 0;
+    int hi = alloc->n_blocks - 1;
+    while (lo < hi) {
+        const int mid = (lo + hi + 1)/2;
+        if (alloc->blocks[mid].vaddr <= vaddr) {
+            lo = mid;
+        } else {
+            hi = mid - 1;
+        }
+    }
+
+    GGML_ASSERT(alloc->n_blocks > 0 && vaddr < alloc->blocks[lo].vaddr + alloc->blocks[lo].size);
+
+    return &alloc->blocks[lo];
+}
+
 #ifdef GGML_ALLOCATOR_DEBUG
 static void add_allocated_tensor(struct ggml_allocr * alloc, struct ggml_tensor * tensor) {
     for (int i = 0; i < 1024; i++) {
@@ -103,12 +179,8 @@ static size_t ggml_allocator_get_alloc_size(struct ggml_allocr * alloc, struct g
     UNUSED(alloc);
 }
 
-void ggml_allocr_alloc(struct ggml_allocr * alloc, struct ggml_tensor * tensor) {
-    size_t size = ggml_allocator_get_alloc_size(alloc, tensor);
-    size = aligned_offset(NULL, size, alloc->alignment);
-
-    AT_PRINTF("%s: allocating %s (%zu bytes) - ", __func__, tensor->name, size);
-
+// best fit of an aligned size in the free blocks
+static void * ggml_allocr_alloc_size(struct ggml_allocr * alloc, size_t size) {
     size_t max_avail = 0;
 
     // find the best fitting free block
@@ -129,7 +201,7 @@ void ggml_allocr_alloc(struct ggml_allocr * alloc, struct ggml_tensor * tensor)
         fprintf(stderr, "%s: not enough space in the buffer (needed %zu, largest block available %zu)\n",
                 __func__, size, max_avail);
         GGML_ASSERT(!"not enough space in the buffer");
-        return;
+        return NULL;
     }
     struct free_block * block = &alloc->free_blocks[best_fit_block];
     void * addr = block->addr;
@@ -143,6 +215,42 @@ void ggml_allocr_alloc(struct ggml_allocr * alloc, struct ggml_tensor * tensor)
         }
     }
 
+    alloc->max_size = MAX(alloc->max_size, (char*)addr - (char*)alloc->data + size);
+
+    return addr;
+}
+
+void ggml_allocr_alloc(struct ggml_allocr * alloc, struct ggml_tensor * tensor) {
+    size_t size = ggml_allocator_get_alloc_size(alloc, tensor);
+    size = aligned_offset(NULL, size, alloc->alignment);
+
+    AT_PRINTF("%s: allocating %s (%zu bytes) - ", __func__, tensor->name, size);
+
+    if (alloc->planning) {
+        // a block of its own, placed once the lifetimes of all blocks are known
+        GGML_ASSERT(alloc->plan_top + size <= PLAN_MAX_SIZE);
+
+        if (alloc->n_blocks == alloc->blocks_cap) {
+            alloc->blocks_cap = MAX(2*alloc->blocks_cap, 256);
+            alloc->blocks = realloc(alloc->blocks, alloc->blocks_cap*sizeof(struct plan_block));
+            GGML_ASSERT(alloc->blocks);
+        }
+
+        alloc->blocks[alloc->n_blocks++] = (struct plan_block) {
+            /*.vaddr  = */ alloc->plan_top,
+            /*.size   = */ size,
+            /*.start  = */ alloc->plan_step,
+            /*.end    = */ INT_MAX,
+            /*.offset = */ 0,
+        };
+
+        tensor->data = (char *) PLAN_BASE_ADDR + alloc->plan_top;
+        alloc->plan_top += size;
+        return;
+    }
+
+    void * addr = ggml_allocr_alloc_size(alloc, size);
+
     tensor->data = addr;
 
 #ifdef GGML_ALLOCATOR_DEBUG
@@ -158,29 +266,10 @@ void ggml_allocr_alloc(struct ggml_allocr * alloc, struct ggml_tensor * tensor)
         printf("\n");
     }
 #endif
-
-    alloc->max_size = MAX(alloc->max_size, (char*)addr - (char*)alloc->data + size);
 }
 
 // this is a very naive implementation, but for our case the number of free blocks should be very small
-static void ggml_allocator_free_tensor(struct ggml_allocr * alloc, struct ggml_tensor * tensor) {
-    void * ptr = tensor->data;
-
-    if (ptr < alloc->data || (char*)ptr >= (char*)alloc->data + alloc->max_size) {
-        // the tensor was not allocated in this buffer
-        // this can happen because the graph allocator will try to free weights and other tensors from different buffers
-        // the easiest way to deal with this is just to ignore it
-        return;
-    }
-
-    size_t size = ggml_allocator_get_alloc_size(alloc, tensor);
-    size = aligned_offset(NULL, size, alloc->alignment);
-    AT_PRINTF("%s: freeing %s (%zu bytes) - n_free_blocks = %d\n", __func__, tensor->name, size, alloc->n_free_blocks);
-
-#ifdef GGML_ALLOCATOR_DEBUG
-    remove_allocated_tensor(alloc, tensor);
-#endif
-
+static void ggml_allocr_free_size(struct ggml_allocr * alloc, void * ptr, size_t size) {
     // see if we can merge with an existing block
     for (int i = 0; i < alloc->n_free_blocks; i++) {
         struct free_block * block = &alloc->free_blocks[i];
@@ -229,6 +318,36 @@ static void ggml_allocator_free_tensor(struct ggml_allocr * alloc, struct ggml_t
     alloc->n_free_blocks++;
 }
 
+static void ggml_allocator_free_tensor(struct ggml_allocr * alloc, struct ggml_tensor * tensor) {
+    void * ptr = tensor->data;
+
+    if (alloc->planning) {
+        // the block lives up to this node, tensors from elsewhere are ignored as below
+        if (ggml_allocr_is_planned_addr(alloc, ptr)) {
+            struct plan_block * block = ggml_allocr_plan_find_block(alloc, ptr);
+            block->end = block->end == INT_MAX ? alloc->plan_step : MAX(block->end, alloc->plan_step);
+        }
+        return;
+    }
+
+    if (ptr < alloc->data || (char*)ptr >= (char*)alloc->data + alloc->max_size) {
+        // the tensor was not allocated in this buffer
+        // this can happen because the graph allocator will try to free weights and other tensors from different buffers
+        // the easiest way to deal with this is just to ignore it
+        return;
+    }
+
+    size_t size = ggml_allocator_get_alloc_size(alloc, tensor);
+    size = aligned_offset(NULL, size, alloc->alignment);
+    AT_PRINTF("%s: freeing %s (%zu bytes) - n_free_blocks = %d\n", __func__, tensor->name, size, alloc->n_free_blocks);
+
+#ifdef GGML_ALLOCATOR_DEBUG
+    remove_allocated_tensor(alloc, tensor);
+#endif
+
+    ggml_allocr_free_size(alloc, ptr, size);
+}
+
 void ggml_allocr_reset(struct ggml_allocr * alloc) {
     alloc->n_free_blocks = 1;
     size_t align_offset = aligned_offset(alloc->data, 0, alloc->alignment);
@@ -248,6 +367,21 @@ struct ggml_allocr * ggml_allocr_new(void * data, size_t size, size_t alignment)
         /*.hash_table    = */ {{0}},
         /*.max_size      = */ 0,
         /*.measure       = */ false,
+        /*.planning      = */ false,
+        /*.plan_step     = */ 0,
+        /*.plan_top      = */ 0,
+        /*.blocks        = */ NULL,
+        /*.n_blocks      = */ 0,
+        /*.blocks_cap    = */ 0,
+        /*.plan          = */ NULL,
+        /*.n_plan        = */ 0,
+        /*.planned_size  = */ 0,
+        /*.greedy_size   = */ 0,
+        /*.plan_tensors     = */ NULL,
+        /*.plan_tensors_new = */ NULL,
+        /*.plan_places      = */ NULL,
+        /*.n_plan_tensors   = */ 0,
+        /*.plan_tensors_cap = */ 0,
 #ifdef GGML_ALLOCATOR_DEBUG
         /* .allocated_tensors = */ {0},
 #endif
@@ -275,6 +409,21 @@ struct ggml_allocr * ggml_allocr_new_measure(size_t alignment) {
         /*.hash_table    = */ {{0}},
         /*.max_size      = */ 0,
         /*.measure       = */ true,
+        /*.planning      = */ false,
+        /*.plan_step     = */ 0,
+        /*.plan_top      = */ 0,
+        /*.blocks        = */ NULL,
+        /*.n_blocks      = */ 0,
+        /*.blocks_cap    = */ 0,
+        /*.plan          = */ NULL,
+        /*.n_plan        = */ 0,
+        /*.planned_size  = */ 0,
+        /*.greedy_size   = */ 0,
+        /*.plan_tensors     = */ NULL,
+        /*.plan_tensors_new = */ NULL,
+        /*.plan_places      = */ NULL,
+        /*.n_plan_tensors   = */ 0,
+        /*.plan_tensors_cap = */ 0,
 #ifdef GGML_ALLOCATOR_DEBUG
         /*.allocated_tensors = */ {0},
 #endif
@@ -286,6 +435,11 @@ struct ggml_allocr * ggml_allocr_new_measure(size_t alignment) {
 }
 
 void ggml_allocr_free(struct ggml_allocr * alloc) {
+    free(alloc->blocks);
+    free(alloc->plan);
+    free(alloc->plan_tensors);
+    free(alloc->plan_tensors_new);
+    free(alloc->plan_places);
     free(alloc);
 }
 
@@ -364,7 +518,9 @@ static bool ggml_op_can_inplace(enum ggml_op op) {
     }
 }
 
-static void allocate_node(struct ggml_allocr * alloc, struct ggml_tensor * node) {
+// a tensor that is only a parent of the nodes, like the sum a fused norm writes (see ggml_graph_fuse()),
+// is not computed by a node of its own and cannot take over the memory of its parents
+static void allocate_node(struct ggml_allocr * alloc, struct ggml_tensor * node, bool is_node) {
     struct hash_node * ht = alloc->hash_table;
     if (node->data == NULL) {
         if (ggml_is_view(node)) {
@@ -388,7 +544,7 @@ static void allocate_node(struct ggml_allocr * alloc, struct ggml_tensor * node)
             }
         } else {
             // see if we can reuse a parent's buffer (inplace)
-            if (ggml_op_can_inplace(node->op)) {
+            if (is_node && ggml_op_can_inplace(node->op)) {
                 for (int i = 0; i < GGML_MAX_SRC; i++) {
                     struct ggml_tensor * parent = node->src[i];
                     if (parent == NULL) {
@@ -396,8 +552,9 @@ static void allocate_node(struct ggml_allocr * alloc, struct ggml_tensor * node)
                     }
 
                     // if the node's data is external, then we cannot re-use it
-                    if ((char *) parent->data < (char *) alloc->data ||
-                        (char *) parent->data >= ((char *) alloc->data + alloc->size)) {
+                    if (((char *) parent->data < (char *) alloc->data ||
+                         (char *) parent->data >= ((char *) alloc->data + alloc->size)) &&
+                        !(alloc->planning && ggml_allocr_is_planned_addr(alloc, parent->data))) {
                         AT_PRINTF("not reusing parent %s for %s as %p is external\n", parent->name, node->name, parent->data);
                         continue;
                     }
@@ -462,6 +619,8 @@ static size_t ggml_allocator_alloc_graph_tensors_n(
     }
 
     // allocate tensors
+    alloc->plan_step = 0;
+
     for (int g = 0; g < n_graphs; g++) {
         struct ggml_cgraph * gf = graphs[g];
         AT_PRINTF("####### graph %d/%d\n", g, n_graphs);
@@ -470,7 +629,7 @@ static size_t ggml_allocator_alloc_graph_tensors_n(
             for (int i = 0; inputs[g][i] != NULL; i++) {
                 struct ggml_tensor * input = inputs[g][i];
                 AT_PRINTF("input: %s\n", input->name);
-                allocate_node(alloc, input);
+                allocate_node(alloc, input, false);
             }
         }
         for (int i = 0; i < gf->n_nodes; i++) {
@@ -482,11 +641,11 @@ static size_t ggml_allocator_alloc_graph_tensors_n(
                 if (parent == NULL) {
                     break;
                 }
-                allocate_node(alloc, parent);
+                allocate_node(alloc, parent, false);
             }
 
             // allocate node
-            allocate_node(alloc, node);
+            allocate_node(alloc, node, true);
 
             AT_PRINTF("exec: %s (%s) <= ", ggml_op_name(node->op), node->name);
             for (int j = 0; j < GGML_MAX_SRC; j++) {
@@ -530,6 +689,8 @@ static size_t ggml_allocator_alloc_graph_tensors_n(
                 }
             }
             AT_PRINTF("\n");
+
+            alloc->plan_step++;
         }
         // free graph outputs here that wouldn't be freed otherwise because they have no children
         if (outputs != NULL && outputs[g] != NULL) {
@@ -547,3 +708,295 @@ static size_t ggml_allocator_alloc_graph_tensors_n(
 size_t ggml_allocr_alloc_graph(struct ggml_allocr * alloc, struct ggml_cgraph * graph) {
     return ggml_allocator_alloc_graph_tensors_n(alloc, &graph, 1, NULL, NULL);
 }
+
+//////////// offline planner
+
+static int plan_block_cmp_size(const void * a, const void * b) {
+    const struct plan_block * x = *(const struct plan_block * const *) a;
+    const struct plan_block * y = *(const struct plan_block * const *) b;
+
+    if (x->size != y->size) {
+        return x->size > y->size ? -1 : 1;
+    }
+    return (x->start > y->start) - (x->start < y->start);
+}
+
+static int plan_block_cmp_offset(const void * a, const void * b) {
+    const struct plan_block * x = *(const struct plan_block * const *) a;
+    const struct plan_block * y = *(const struct plan_block * const *) b;
+
+    return (x->offset > y->offset) - (x->offset < y->offset);
+}
+
+static int plan_block_cmp_end(const void * a, const void * b) {
+    const struct plan_block * x = *(const struct plan_block * const *) a;
+    const struct plan_block * y = *(const struct plan_block * const *) b;
+
+    return (x->end > y->end) - (x->end < y->end);
+}
+
+// greedy by size: the largest blocks first, each at the lowest offset that no block living at
+// the same time covers; returns the size of the plan
+static size_t ggml_allocr_plan_solve(struct plan_block * blocks, int n_blocks) {
+    struct plan_block ** order = malloc(n_blocks*sizeof(struct plan_block *));
+    struct plan_block ** live  = malloc(n_blocks*sizeof(struct plan_block *));
+    GGML_ASSERT(n_blocks == 0 || (order && live));
+
+    for (int i = 0; i < n_blocks; i++) {
+        order[i] = &blocks[i];
+    }
+    qsort(order, n_blocks, sizeof(struct plan_block *), plan_block_cmp_size);
+
+    size_t total = 0;
+
+    for (int i = 0; i < n_blocks; i++) {
+        struct plan_block * block = order[i];
+
+        // the placed blocks that overlap in time, by offset
+        int n_live = 0;
+        for (int j = 0; j < i; j++) {
+            if (order[j]->start <= block->end && block->start <= order[j]->end) {
+                live[n_live++] = order[j];
+            }
+        }
+        qsort(live, n_live, sizeof(struct plan_block *), plan_block_cmp_offset);
+
+        // sizes are aligned, so are the gaps between them
+        size_t offset = 0;
+        for (int j = 0; j < n_live; j++) {
+            if (live[j]->offset >= offset + block->size) {
+                break;
+            }
+            offset = MAX(offset, live[j]->offset + live[j]->size);
+        }
+
+        block->offset = offset;
+        total = MAX(total, offset + block->size);
+    }
+
+    free(live);
+    free(order);
+
+    return total;
+}
+
+// what ggml_allocr_alloc_graph() would have needed for the same blocks
+static size_t ggml_allocr_plan_greedy_size(struct plan_block * blocks, int n_blocks, size_t alignment) {
+    struct ggml_allocr * greedy = ggml_allocr_new_measure(alignment);
+
+    struct plan_block ** by_end = malloc(n_blocks*sizeof(struct plan_block *));
+    void ** addr = malloc(n_blocks*sizeof(void *));
+    GGML_ASSERT(n_blocks == 0 || (by_end && addr));
+
+    for (int i = 0; i < n_blocks; i++) {
+        by_end[i] = &blocks[i];
+    }
+    qsort(by_end, n_blocks, sizeof(struct plan_block *), plan_block_cmp_end);
+
+    // the blocks are in the order of their allocation, at each node the allocations come before the frees
+    int i_free = 0;
+    for (int i = 0; i < n_blocks; i++) {
+        while (i_free < n_blocks && by_end[i_free]->end < blocks[i].start) {
+            ggml_allocr_free_size(greedy, addr[by_end[i_free] - blocks], by_end[i_free]->size);
+            i_free++;
+        }
+        addr[i] = ggml_allocr_alloc_size(greedy, blocks[i].size);
+    }
+
+    const size_t size = greedy->max_size;
+
+    free(addr);
+    free(by_end);
+    ggml_allocr_free(greedy);
+
+    return size;
+}
+
+static void ggml_allocr_plan_relocate(struct ggml_allocr * alloc, struct ggml_tensor * tensor, char * base) {
+    if (tensor == NULL || !ggml_allocr_is_planned_addr(alloc, tensor->data)) {
+        return;
+    }
+
+    const struct plan_block * block = ggml_allocr_plan_find_block(alloc, tensor->data);
+
+    tensor->data = base + block->offset + ((char *) tensor->data - (char *) PLAN_BASE_ADDR - block->vaddr);
+}
+
+static bool ggml_allocr_plan_matches(const struct ggml_allocr * alloc) {
+    if (alloc->plan == NULL || alloc->n_plan != alloc->n_blocks) {
+        return false;
+    }
+    for (int i = 0; i < alloc->n_blocks; i++) {
+        if (alloc->plan[i].size  != alloc->blocks[i].size  ||
+            alloc->plan[i].start != alloc->blocks[i].start ||
+            alloc->plan[i].end   != alloc->blocks[i].end) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// zeroed first, so that the padding compares equal too
+static void ggml_allocr_plan_tensor_set(struct plan_tensor * pt, struct ggml_tensor * tensor) {
+    memset(pt, 0, sizeof(*pt));
+
+    if (tensor == NULL) {
+        return;
+    }
+
+    pt->tensor = tensor;
+    pt->op     = tensor->op;
+    pt->type   = tensor->type;
+    pt->data   = tensor->data;
+    memcpy(pt->ne,        tensor->ne,        sizeof(pt->ne));
+    memcpy(pt->nb,        tensor->nb,        sizeof(pt->nb));
+    memcpy(pt->op_params, tensor->op_params, sizeof(pt->op_params));
+    memcpy(pt->src,       tensor->src,       sizeof(pt->src));
+}
+
+// the nodes of graph and their parents, in the order of the walk
+static int ggml_allocr_plan_tensors(struct ggml_allocr * alloc, struct ggml_cgraph * graph) {
+    const int n = graph->n_nodes*(1 + GGML_MAX_SRC);
+
+    if (n > alloc->plan_tensors_cap) {
+        free(alloc->plan_tensors);
+        free(alloc->plan_tensors_new);
+        free(alloc->plan_places);
+
+        alloc->plan_tensors     = malloc(n*sizeof(struct plan_tensor));
+        alloc->plan_tensors_new = malloc(n*sizeof(struct plan_tensor));
+        alloc->plan_places      = malloc(n*sizeof(struct plan_place));
+        alloc->plan_tensors_cap = n;
+        alloc->n_plan_tensors   = 0; // the tensors of the plan are gone
+        GGML_ASSERT(alloc->plan_tensors && alloc->plan_tensors_new && alloc->plan_places);
+    }
+
+    for (int i = 0; i < graph->n_nodes; i++) {
+        struct ggml_tensor * node = graph->nodes[i];
+        struct plan_tensor * pt   = &alloc->plan_tensors_new[i*(1 + GGML_MAX_SRC)];
+
+        for (int j = 0; j < GGML_MAX_SRC; j++) {
+            ggml_allocr_plan_tensor_set(&pt[j], node->src[j]);
+        }
+        ggml_allocr_plan_tensor_set(&pt[GGML_MAX_SRC], node);
+    }
+
+    return n;
+}
+
+// the top free block, where the plan goes, above the tensors allocated since the last reset
+static char * ggml_allocr_plan_base(struct ggml_allocr * alloc) {
+    struct free_block * top = NULL;
+    for (int i = 0; i < alloc->n_free_blocks; i++) {
+        if ((char *) alloc->free_blocks[i].addr + alloc->free_blocks[i].size == (char *) alloc->data + alloc->size) {
+            top = &alloc->free_blocks[i];
+        }
+    }
+
+    if (top == NULL || top->size < alloc->planned_size) {
+        fprintf(stderr, "%s: not enough space in the buffer (needed %zu, available %zu)\n",
+                __func__, alloc->planned_size, top ? top->size : 0);
+        GGML_ASSERT(!"not enough space in the buffer");
+    }
+
+    char * base = top->addr;
+
+    top->addr  = base + alloc->planned_size;
+    top->size -= alloc->planned_size;
+
+    alloc->max_size = MAX(alloc->max_size, (size_t) (base - (char *) alloc->data) + alloc->planned_size);
+
+    return base;
+}
+
+size_t ggml_allocr_alloc_graph_planned(struct ggml_allocr * alloc, struct ggml_cgraph * graph) {
+    const int n_tensors = ggml_allocr_plan_tensors(alloc, graph);
+
+    // the same tensors as the last plan, as they were then: placed at the same offsets, without the walk
+    if (alloc->n_plan_tensors == n_tensors &&
+        memcmp(alloc->plan_tensors, alloc->plan_tensors_new, n_tensors*sizeof(struct plan_tensor)) == 0) {
+        char * base = ggml_allocr_plan_base(alloc);
+
+        for (int i = 0; i < n_tensors; i++) {
+            const struct plan_place * place = &alloc->plan_places[i];
+            if (place->offset != SIZE_MAX) {
+                alloc->plan_tensors[i].tensor->data = base + place->offset;
+            } else if (place->data != NULL) {
+                alloc->plan_tensors[i].tensor->data = place->data;
+            }
+        }
+
+        return alloc->max_size;
+    }
+
+    // the same walk as ggml_allocr_alloc_graph(), for the lifetimes of the blocks
+    alloc->planning = true;
+    alloc->plan_top = 0;
+    alloc->n_blocks = 0;
+
+    ggml_allocator_alloc_graph_tensors_n(alloc, &graph, 1, NULL, NULL);
+
+    alloc->planning = false;
+
+    // placed only for a graph that is not the one of the last plan
+    if (ggml_allocr_plan_matches(alloc)) {
+        for (int i = 0; i < alloc->n_blocks; i++) {
+            alloc->blocks[i].offset = alloc->plan[i].offset;
+        }
+    } else {
+        alloc->planned_size = ggml_allocr_plan_solve(alloc->blocks, alloc->n_blocks);
+        alloc->greedy_size  = ggml_allocr_plan_greedy_size(alloc->blocks, alloc->n_blocks, alloc->alignment);
+
+        free(alloc->plan);
+        alloc->plan = malloc(MAX(alloc->n_blocks, 1)*sizeof(struct plan_block));
+        GGML_ASSERT(alloc->plan);
+        memcpy(alloc->plan, alloc->blocks, alloc->n_blocks*sizeof(struct plan_block));
+        alloc->n_plan = alloc->n_blocks;
+    }
+
+    char * base = ggml_allocr_plan_base(alloc);
+
+    for (int i = 0; i < graph->n_nodes; i++) {
+        struct ggml_tensor * node = graph->nodes[i];
+
+        for (int j = 0; j < GGML_MAX_SRC; j++) {
+            ggml_allocr_plan_relocate(alloc, node->src[j], base);
+        }
+        ggml_allocr_plan_relocate(alloc, node, base);
+    }
+
+    // where the walk put the tensors, for the next graph with the same ones
+    for (int i = 0; i < n_tensors; i++) {
+        const struct plan_tensor * pt = &alloc->plan_tensors_new[i];
+        struct plan_place * place     = &alloc->plan_places[i];
+
+        place->offset = SIZE_MAX;
+        place->data   = NULL;
+
+        if (pt->tensor == NULL || pt->data != NULL) {
+            continue;
+        }
+
+        char * data = pt->tensor->data;
+        if (data >= base && data < base + alloc->planned_size) {
+            place->offset = (size_t) (data - base);
+        } else {
+            place->data = data;
+        }
+    }
+
+    struct plan_tensor * tensors = alloc->plan_tensors;
+    alloc->plan_tensors     = alloc->plan_tensors_new;
+    alloc->plan_tensors_new = tensors;
+    alloc->n_plan_tensors   = n_tensors;
+
+    return alloc->max_size;
+}
+
+size_t ggml_allocr_planned_size(struct ggml_allocr * alloc) {
+    return alloc->planned_size;
+}
+
+size_t ggml_allocr_greedy_size(struct ggml_allocr * alloc) {
+    return alloc->greedy_size;
+}
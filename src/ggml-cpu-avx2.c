@@ -0,0 +1,10 @@
+// the type_traits kernels of ggml.c built for AVX2 + FMA + F16C
+// ggml_init copies them into type_traits when the CPU supports these
+
+#define GGML_CPU_KERNELS_ONLY
+
+#define type_traits           ggml_type_traits_avx2
+#define ggml_fp16_to_fp32_row ggml_fp16_to_fp32_row_avx2
+#define ggml_fp32_to_fp16_row ggml_fp32_to_fp16_row_avx2
+
+#include "ggml.c"
@@ -27,6 +27,10 @@
 #include <stdarg.h>
 #include <signal.h>
 
+#if defined(GGML_CPU_DISPATCH)
+#include <cpuid.h>
+#endif
+
 #ifdef GGML_USE_METAL
 #include <unistd.h>
 #endif
@@ -93,6 +97,51 @@ static int sched_yield (void) {
     Sleep (0);
     return 0;
 }
+
+typedef SRWLOCK            pthread_mutex_t;
+typedef CONDITION_VARIABLE pthread_cond_t;
+
+static int pthread_mutex_init(pthread_mutex_t * mutex, void * unused) {
+    (void) unused;
+    InitializeSRWLock(mutex);
+    return 0;
+}
+
+static int pthread_mutex_destroy(pthread_mutex_t * mutex) {
+    (void) mutex;
+    return 0;
+}
+
+static int pthread_mutex_lock(pthread_mutex_t * mutex) {
+    AcquireSRWLockExclusive(mutex);
+    return 0;
+}
+
+static int pthread_mutex_unlock(pthread_mutex_t * mutex) {
+    ReleaseSRWLockExclusive(mutex);
+    return 0;
+}
+
+static int pthread_cond_init(pthread_cond_t * cond, void * unused) {
+    (void) unused;
+    InitializeConditionVariable(cond);
+    return 0;
+}
+
+static int pthread_cond_destroy(pthread_cond_t * cond) {
+    (void) cond;
+    return 0;
+}
+
+static int pthread_cond_wait(pthread_cond_t * cond, pthread_mutex_t * mutex) {
+    SleepConditionVariableSRW(cond, mutex, INFINITE, 0);
+    return 0;
+}
+
+static int pthread_cond_broadcast(pthread_cond_t * cond) {
+    WakeAllConditionVariable(cond);
+    return 0;
+}
 #else
 #include <pthread.h>
 #include <stdatomic.h>
@@ -101,8 +150,13 @@ typedef void * thread_ret_t;
 
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <unistd.h>
 
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
 #endif
 
 // __FMA__ and __F16C__ are not defined in MSVC, however they are implied with AVX2/AVX512
@@ -118,6 +172,12 @@ typedef void * thread_ret_t;
 #endif
 #endif
 
+// GGML_CPU_KERNELS_ONLY builds only the kernels referenced by type_traits, for one extra ISA level
+// the fp16 lookup table is filled by ggml_init of the base build, so the extra levels convert with F16C
+#if defined(GGML_CPU_KERNELS_ONLY) && !defined(__F16C__)
+#error "ggml: kernel variants require F16C"
+#endif
+
 /*#define GGML_PERF*/
 #define GGML_DEBUG 0
 #define GGML_GELU_FP16
@@ -441,11 +501,13 @@ static ggml_fp16_t table_gelu_quick_f16[1 << 16];
 // precomputed silu table for f16 (128 KB)
 static ggml_fp16_t table_silu_f16[1 << 16];
 
+#ifndef GGML_CPU_KERNELS_ONLY
 // precomputed exp table for f16 (128 KB)
 static ggml_fp16_t table_exp_f16[1 << 16];
 
 // precomputed f32 table for f16 (256 KB)
 static float table_f32_f16[1 << 16];
+#endif
 
 #if defined(__ARM_NEON) || defined(__wasm_simd128__)
 #define B1(c,s,n)  0x ## n ## c ,  0x ## n ## s
@@ -462,6 +524,11 @@ static const uint64_t table_b2b_0[1 << 8] = { B8(00, 10) }; // ( b) << 4
 static const uint64_t table_b2b_1[1 << 8] = { B8(10, 00) }; // (!b) << 4
 #endif
 
+#ifdef GGML_CPU_KERNELS_ONLY
+#define GGML_FP16_TO_FP32(x) GGML_COMPUTE_FP16_TO_FP32(x)
+#define GGML_FP32_TO_FP16(x) GGML_COMPUTE_FP32_TO_FP16(x)
+#endif
+
 // On ARM NEON, it's quicker to directly convert x -> x instead of calling into ggml_lookup_fp16_to_fp32,
 // so we define GGML_FP16_TO_FP32 and GGML_FP32_TO_FP16 elsewhere for NEON.
 // This is also true for POWER9.
@@ -478,6 +545,7 @@ inline static float ggml_lookup_fp16_to_fp32(ggml_fp16_t f) {
 
 #endif
 
+#ifndef GGML_CPU_KERNELS_ONLY
 // note: do not use these inside ggml.c
 // these are meant to be used via the ggml.h API
 float ggml_fp16_to_fp32(ggml_fp16_t x) {
@@ -487,9 +555,18 @@ float ggml_fp16_to_fp32(ggml_fp16_t x) {
 ggml_fp16_t ggml_fp32_to_fp16(float x) {
     return GGML_FP32_TO_FP16(x);
 }
+#endif
 
 void ggml_fp16_to_fp32_row(const ggml_fp16_t * x, float * y, int n) {
-    for (int i = 0; i < n; i++) {
+    int i = 0;
+#if defined(__F16C__)
+    for (; i + 7 < n; i += 8) {
+        __m128i x_vec = _mm_loadu_si128((const __m128i *)(x + i));
+        __m256 y_vec = _mm256_cvtph_ps(x_vec);
+        _mm256_storeu_ps(y + i, y_vec);
+    }
+#endif
+    for (; i < n; i++) {
         y[i] = GGML_FP16_TO_FP32(x[i]);
     }
 }
@@ -513,6 +590,7 @@ void ggml_fp32_to_fp16_row(const float * x, ggml_fp16_t * y, int n) {
     }
 }
 
+#ifndef GGML_CPU_KERNELS_ONLY
 //
 // timing
 //
@@ -562,6 +640,7 @@ int64_t ggml_cycles(void) {
 int64_t ggml_cycles_per_ms(void) {
     return CLOCKS_PER_SEC/1000;
 }
+#endif // GGML_CPU_KERNELS_ONLY
 
 #ifdef GGML_PERF
 #define ggml_perf_time_ms()       ggml_time_ms()
@@ -669,8 +748,13 @@ static inline __m256 sum_i16_pairs_float(const __m256i x) {
     return _mm256_cvtepi32_ps(summed_pairs);
 }
 
+// vpdpbusd multiplies uint8_t with int8_t and adds groups of 4 into int32_t in one instruction
+#if __AVXVNNI__ || (__AVX512VNNI__ && __AVX512VL__)
+#define GGML_VNNI
+#endif
+
 static inline __m256 mul_sum_us8_pairs_float(const __m256i ax, const __m256i sy) {
-#if __AVXVNNI__
+#if defined(GGML_VNNI)
     const __m256i zero = _mm256_setzero_si256();
     const __m256i summed_pairs = _mm256_dpbusd_epi32(zero, ax, sy);
     return _mm256_cvtepi32_ps(summed_pairs);
@@ -696,6 +780,19 @@ static inline __m256 mul_sum_i8_pairs_float(const __m256i x, const __m256i y) {
 #endif
 }
 
+// multiply q4_0 nibbles in [ 0 .. 15 ], taken as x - 8, with int8_t and add groups of 4 as float vector
+static inline __m256 mul_sum_q4_0_q8_pairs_float(const __m256i qx, const __m256i y) {
+#if defined(GGML_VNNI) && !__AVXVNNIINT8__
+    // the nibbles are already unsigned, so (x - 8)*y = x*y - 8*y needs no sign trick
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i xy = _mm256_dpbusd_epi32(zero, qx, y);
+    const __m256i y8 = _mm256_dpbusd_epi32(zero, _mm256_set1_epi8(8), y);
+    return _mm256_cvtepi32_ps(_mm256_sub_epi32(xy, y8));
+#else
+    return mul_sum_i8_pairs_float(_mm256_sub_epi8(qx, _mm256_set1_epi8(8)), y);
+#endif
+}
+
 static inline __m128i packNibbles( __m256i bytes )
 {
     // Move bits within 16-bit lanes from 0000_abcd_0000_efgh into 0000_0000_abcd_efgh
@@ -1300,6 +1397,7 @@ static void quantize_row_q8_0(const float * restrict x, void * restrict vy, int
     }
 #else
     // scalar
+    UNUSED(nb);
     quantize_row_q8_0_reference(x, y, k);
 #endif
 }
@@ -1518,6 +1616,7 @@ static void quantize_row_q8_1(const float * restrict x, void * restrict vy, int
     }
 #else
     // scalar
+    UNUSED(nb);
     quantize_row_q8_1_reference(x, y, k);
 #endif
 }
@@ -1642,7 +1741,30 @@ static void ggml_vec_dot_q5_0_q8_0(const int n, float * restrict s, const void *
 static void ggml_vec_dot_q5_1_q8_1(const int n, float * restrict s, const void * restrict vx, const void * restrict vy);
 static void ggml_vec_dot_q8_0_q8_0(const int n, float * restrict s, const void * restrict vx, const void * restrict vy);
 
-static const ggml_type_traits_t type_traits[GGML_TYPE_COUNT] = {
+static void ggml_vec_dot_x4_q4_0_q8_0(const int n, float * restrict s, size_t bs, const void * restrict vx, const void * restrict vy, size_t ys);
+static void ggml_vec_dot_x4_q4_1_q8_1(const int n, float * restrict s, size_t bs, const void * restrict vx, const void * restrict vy, size_t ys);
+static void ggml_vec_dot_x4_q5_0_q8_0(const int n, float * restrict s, size_t bs, const void * restrict vx, const void * restrict vy, size_t ys);
+static void ggml_vec_dot_x4_q5_1_q8_1(const int n, float * restrict s, size_t bs, const void * restrict vx, const void * restrict vy, size_t ys);
+static void ggml_vec_dot_x4_q8_0_q8_0(const int n, float * restrict s, size_t bs, const void * restrict vx, const void * restrict vy, size_t ys);
+
+#if defined(GGML_CPU_DISPATCH)
+// the kernels of ggml.c rebuilt for higher ISA levels, see ggml-cpu-*.c
+extern const ggml_type_traits_t ggml_type_traits_avx2       [GGML_TYPE_COUNT];
+extern const ggml_type_traits_t ggml_type_traits_avx_vnni   [GGML_TYPE_COUNT];
+extern const ggml_type_traits_t ggml_type_traits_avx512     [GGML_TYPE_COUNT];
+extern const ggml_type_traits_t ggml_type_traits_avx512_vnni[GGML_TYPE_COUNT];
+#endif
+
+#if defined(GGML_CPU_KERNELS_ONLY)
+#define GGML_TYPE_TRAITS_DECL const
+#elif defined(GGML_CPU_DISPATCH)
+// starts with the base build kernels, ggml_init swaps in the best level this CPU supports
+#define GGML_TYPE_TRAITS_DECL static
+#else
+#define GGML_TYPE_TRAITS_DECL static const
+#endif
+
+GGML_TYPE_TRAITS_DECL ggml_type_traits_t type_traits[GGML_TYPE_COUNT] = {
     [GGML_TYPE_F32] = {
         .vec_dot                  = (ggml_vec_dot_t) ggml_vec_dot_f32,
         .vec_dot_type             = GGML_TYPE_F32,
@@ -1660,6 +1782,7 @@ static const ggml_type_traits_t type_traits[GGML_TYPE_COUNT] = {
         .from_float_reference     = (ggml_from_float_t) quantize_row_q4_0_reference,
         .vec_dot                  = ggml_vec_dot_q4_0_q8_0,
         .vec_dot_type             = GGML_TYPE_Q8_0,
+        .vec_dot_x4               = ggml_vec_dot_x4_q4_0_q8_0,
     },
     [GGML_TYPE_Q4_1] = {
         .to_float                 = (ggml_to_float_t) dequantize_row_q4_1,
@@ -1667,6 +1790,7 @@ static const ggml_type_traits_t type_traits[GGML_TYPE_COUNT] = {
         .from_float_reference     = (ggml_from_float_t) quantize_row_q4_1_reference,
         .vec_dot                  = ggml_vec_dot_q4_1_q8_1,
         .vec_dot_type             = GGML_TYPE_Q8_1,
+        .vec_dot_x4               = ggml_vec_dot_x4_q4_1_q8_1,
     },
     [GGML_TYPE_Q5_0] = {
         .to_float                 = (ggml_to_float_t) dequantize_row_q5_0,
@@ -1674,6 +1798,7 @@ static const ggml_type_traits_t type_traits[GGML_TYPE_COUNT] = {
         .from_float_reference     = (ggml_from_float_t) quantize_row_q5_0_reference,
         .vec_dot                  = ggml_vec_dot_q5_0_q8_0,
         .vec_dot_type             = GGML_TYPE_Q8_0,
+        .vec_dot_x4               = ggml_vec_dot_x4_q5_0_q8_0,
     },
     [GGML_TYPE_Q5_1] = {
         .to_float                 = (ggml_to_float_t) dequantize_row_q5_1,
@@ -1681,6 +1806,7 @@ static const ggml_type_traits_t type_traits[GGML_TYPE_COUNT] = {
         .from_float_reference     = (ggml_from_float_t) quantize_row_q5_1_reference,
         .vec_dot                  = ggml_vec_dot_q5_1_q8_1,
         .vec_dot_type             = GGML_TYPE_Q8_1,
+        .vec_dot_x4               = ggml_vec_dot_x4_q5_1_q8_1,
     },
     [GGML_TYPE_Q8_0] = {
         .to_float                 = dequantize_row_q8_0,
@@ -1688,6 +1814,7 @@ static const ggml_type_traits_t type_traits[GGML_TYPE_COUNT] = {
         .from_float_reference     = (ggml_from_float_t) quantize_row_q8_0_reference,
         .vec_dot                  = ggml_vec_dot_q8_0_q8_0,
         .vec_dot_type             = GGML_TYPE_Q8_0,
+        .vec_dot_x4               = ggml_vec_dot_x4_q8_0_q8_0,
     },
     [GGML_TYPE_Q8_1] = {
         .from_float               = quantize_row_q8_1,
@@ -1736,11 +1863,13 @@ static const ggml_type_traits_t type_traits[GGML_TYPE_COUNT] = {
 #endif
 };
 
+#ifndef GGML_CPU_KERNELS_ONLY
 // For internal test use
 ggml_type_traits_t ggml_internal_get_type_traits(enum ggml_type i) {
     GGML_ASSERT(i < GGML_TYPE_COUNT);
     return type_traits[i];
 }
+#endif
 
 
 //
@@ -2431,6 +2560,22 @@ static void ggml_vec_dot_q4_0_q8_0(const int n, float * restrict s, const void *
     }
 
     *s = vaddvq_f32(sumv0) + vaddvq_f32(sumv1);
+#elif defined(__AVX2__) && defined(GGML_VNNI)
+    // with vpdpbusd the loop is bound by the fmadd latency, so even and odd blocks use separate accumulators
+    __m256 acc[2] = { _mm256_setzero_ps(), _mm256_setzero_ps() };
+
+    for (int i = 0; i < nb; i += 2) {
+        for (int k = 0; k < 2 && i + k < nb; ++k) {
+            const __m256 d = _mm256_set1_ps(GGML_FP16_TO_FP32(x[i + k].d) * GGML_FP16_TO_FP32(y[i + k].d));
+
+            const __m256i bx = bytes_from_nibbles_32(x[i + k].qs);
+            const __m256i by = _mm256_loadu_si256((const __m256i *) y[i + k].qs);
+
+            acc[k] = _mm256_fmadd_ps(d, mul_sum_q4_0_q8_pairs_float(bx, by), acc[k]);
+        }
+    }
+
+    *s = hsum_float_8(_mm256_add_ps(acc[0], acc[1]));
 #elif defined(__AVX2__)
     // Initialize accumulator with zeros
     __m256 acc = _mm256_setzero_ps();
@@ -2440,15 +2585,12 @@ static void ggml_vec_dot_q4_0_q8_0(const int n, float * restrict s, const void *
         /* Compute combined scale for the block */
         const __m256 d = _mm256_set1_ps( GGML_FP16_TO_FP32(x[i].d) * GGML_FP16_TO_FP32(y[i].d) );
 
-        __m256i bx = bytes_from_nibbles_32(x[i].qs);
-
-        // Now we have a vector with bytes in [ 0 .. 15 ] interval. Offset them into [ -8 .. +7 ] interval.
-        const __m256i off = _mm256_set1_epi8( 8 );
-        bx = _mm256_sub_epi8( bx, off );
+        // Bytes in [ 0 .. 15 ] interval, offset into [ -8 .. +7 ] by the product
+        const __m256i bx = bytes_from_nibbles_32(x[i].qs);
 
         __m256i by = _mm256_loadu_si256((const __m256i *)y[i].qs);
 
-        const __m256 q = mul_sum_i8_pairs_float(bx, by);
+        const __m256 q = mul_sum_q4_0_q8_pairs_float(bx, by);
 
         /* Multiply q with scale and accumulate */
         acc = _mm256_fmadd_ps( d, q, acc );
@@ -3312,6 +3454,22 @@ static void ggml_vec_dot_q8_0_q8_0(const int n, float * restrict s, const void *
     }
 
     *s = vaddvq_f32(sumv0) + vaddvq_f32(sumv1);
+#elif defined(__AVX2__) && defined(GGML_VNNI)
+    // with vpdpbusd the loop is bound by the fmadd latency, so even and odd blocks use separate accumulators
+    __m256 acc[2] = { _mm256_setzero_ps(), _mm256_setzero_ps() };
+
+    for (int i = 0; i < nb; i += 2) {
+        for (int k = 0; k < 2 && i + k < nb; ++k) {
+            const __m256 d = _mm256_set1_ps(GGML_FP16_TO_FP32(x[i + k].d) * GGML_FP16_TO_FP32(y[i + k].d));
+
+            const __m256i bx = _mm256_loadu_si256((const __m256i *) x[i + k].qs);
+            const __m256i by = _mm256_loadu_si256((const __m256i *) y[i + k].qs);
+
+            acc[k] = _mm256_fmadd_ps(d, mul_sum_i8_pairs_float(bx, by), acc[k]);
+        }
+    }
+
+    *s = hsum_float_8(_mm256_add_ps(acc[0], acc[1]));
 #elif defined(__AVX2__) || defined(__AVX__)
     // Initialize accumulator with zeros
     __m256 acc = _mm256_setzero_ps();
@@ -3352,6 +3510,252 @@ static void ggml_vec_dot_q8_0_q8_0(const int n, float * restrict s, const void *
 #endif
 }
 
+// 4 columns of y against each unpacked block of x, every column summed exactly as in the single vec_dot
+
+#define GGML_VEC_DOT_X4_Y(type) \
+    const type * restrict y[4] = { \
+        (const type *) ((const char *) vy + 0*ys), (const type *) ((const char *) vy + 1*ys), \
+        (const type *) ((const char *) vy + 2*ys), (const type *) ((const char *) vy + 3*ys), \
+    }
+
+static void ggml_vec_dot_x4_q4_0_q8_0(const int n, float * restrict s, size_t bs, const void * restrict vx, const void * restrict vy, size_t ys) {
+#if defined(__AVX2__) && defined(GGML_VNNI)
+    const int nb = n / QK8_0;
+
+    const block_q4_0 * restrict x = vx;
+    GGML_VEC_DOT_X4_Y(block_q8_0);
+
+    // the accumulators of ggml_vec_dot_q4_0_q8_0, for each column
+    __m256 acc[4][2];
+    for (int j = 0; j < 4; ++j) {
+        acc[j][0] = acc[j][1] = _mm256_setzero_ps();
+    }
+
+    for (int i = 0; i < nb; i += 2) {
+        for (int k = 0; k < 2 && i + k < nb; ++k) {
+            const float dx = GGML_FP16_TO_FP32(x[i + k].d);
+
+            const __m256i bx = bytes_from_nibbles_32(x[i + k].qs);
+
+            for (int j = 0; j < 4; ++j) {
+                const __m256 d = _mm256_set1_ps(dx * GGML_FP16_TO_FP32(y[j][i + k].d));
+                const __m256i by = _mm256_loadu_si256((const __m256i *) y[j][i + k].qs);
+
+                acc[j][k] = _mm256_fmadd_ps(d, mul_sum_q4_0_q8_pairs_float(bx, by), acc[j][k]);
+            }
+        }
+    }
+
+    for (int j = 0; j < 4; ++j) {
+        s[j*bs] = hsum_float_8(_mm256_add_ps(acc[j][0], acc[j][1]));
+    }
+#elif defined(__AVX2__)
+    const int nb = n / QK8_0;
+
+    const block_q4_0 * restrict x = vx;
+    GGML_VEC_DOT_X4_Y(block_q8_0);
+
+    __m256 acc[4] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+
+    for (int i = 0; i < nb; ++i) {
+        const float dx = GGML_FP16_TO_FP32(x[i].d);
+
+        const __m256i bx = bytes_from_nibbles_32(x[i].qs);
+
+        for (int j = 0; j < 4; ++j) {
+            const __m256 d = _mm256_set1_ps(dx * GGML_FP16_TO_FP32(y[j][i].d));
+            const __m256i by = _mm256_loadu_si256((const __m256i *) y[j][i].qs);
+
+            acc[j] = _mm256_fmadd_ps(d, mul_sum_q4_0_q8_pairs_float(bx, by), acc[j]);
+        }
+    }
+
+    for (int j = 0; j < 4; ++j) {
+        s[j*bs] = hsum_float_8(acc[j]);
+    }
+#else
+    for (int j = 0; j < 4; ++j) {
+        ggml_vec_dot_q4_0_q8_0(n, s + j*bs, vx, (const char *) vy + j*ys);
+    }
+#endif
+}
+
+static void ggml_vec_dot_x4_q4_1_q8_1(const int n, float * restrict s, size_t bs, const void * restrict vx, const void * restrict vy, size_t ys) {
+#if defined(__AVX2__)
+    const int nb = n / QK8_1;
+
+    const block_q4_1 * restrict x = vx;
+    GGML_VEC_DOT_X4_Y(block_q8_1);
+
+    __m256 acc[4] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+
+    float summs[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+    for (int i = 0; i < nb; ++i) {
+        const float d0 = GGML_FP16_TO_FP32(x[i].d);
+        const float m0 = GGML_FP16_TO_FP32(x[i].m);
+
+        const __m256i bx = bytes_from_nibbles_32(x[i].qs);
+
+        for (int j = 0; j < 4; ++j) {
+            summs[j] += m0 * y[j][i].s;
+
+            const __m256 d0d1 = _mm256_mul_ps(_mm256_set1_ps(d0), _mm256_set1_ps(y[j][i].d));
+            const __m256i by = _mm256_loadu_si256((const __m256i *) y[j][i].qs);
+
+            acc[j] = _mm256_fmadd_ps(d0d1, mul_sum_us8_pairs_float(bx, by), acc[j]);
+        }
+    }
+
+    for (int j = 0; j < 4; ++j) {
+        s[j*bs] = hsum_float_8(acc[j]) + summs[j];
+    }
+#else
+    for (int j = 0; j < 4; ++j) {
+        ggml_vec_dot_q4_1_q8_1(n, s + j*bs, vx, (const char *) vy + j*ys);
+    }
+#endif
+}
+
+static void ggml_vec_dot_x4_q5_0_q8_0(const int n, float * restrict s, size_t bs, const void * restrict vx, const void * restrict vy, size_t ys) {
+#if defined(__AVX2__)
+    const int nb = n / QK8_0;
+
+    const block_q5_0 * restrict x = vx;
+    GGML_VEC_DOT_X4_Y(block_q8_0);
+
+    __m256 acc[4] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+
+    for (int i = 0; i < nb; ++i) {
+        const float dx = GGML_FP16_TO_FP32(x[i].d);
+
+        __m256i bx = bytes_from_nibbles_32(x[i].qs);
+        __m256i bxhi = bytes_from_bits_32(x[i].qh);
+        bxhi = _mm256_andnot_si256(bxhi, _mm256_set1_epi8((char)0xF0));
+        bx = _mm256_or_si256(bx, bxhi);
+
+        for (int j = 0; j < 4; ++j) {
+            const __m256 d = _mm256_set1_ps(dx * GGML_FP16_TO_FP32(y[j][i].d));
+            const __m256i by = _mm256_loadu_si256((const __m256i *) y[j][i].qs);
+
+            acc[j] = _mm256_fmadd_ps(d, mul_sum_i8_pairs_float(bx, by), acc[j]);
+        }
+    }
+
+    for (int j = 0; j < 4; ++j) {
+        s[j*bs] = hsum_float_8(acc[j]);
+    }
+#else
+    for (int j = 0; j < 4; ++j) {
+        ggml_vec_dot_q5_0_q8_0(n, s + j*bs, vx, (const char *) vy + j*ys);
+    }
+#endif
+}
+
+static void ggml_vec_dot_x4_q5_1_q8_1(const int n, float * restrict s, size_t bs, const void * restrict vx, const void * restrict vy, size_t ys) {
+#if defined(__AVX2__)
+    const int nb = n / QK8_1;
+
+    const block_q5_1 * restrict x = vx;
+    GGML_VEC_DOT_X4_Y(block_q8_1);
+
+    __m256 acc[4] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+
+    float summs[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+
+    for (int i = 0; i < nb; ++i) {
+        const __m256 dx = _mm256_set1_ps(GGML_FP16_TO_FP32(x[i].d));
+        const float   m0 = GGML_FP16_TO_FP32(x[i].m);
+
+        __m256i bx = bytes_from_nibbles_32(x[i].qs);
+        __m256i bxhi = bytes_from_bits_32(x[i].qh);
+        bxhi = _mm256_and_si256(bxhi, _mm256_set1_epi8(0x10));
+        bx = _mm256_or_si256(bx, bxhi);
+
+        for (int j = 0; j < 4; ++j) {
+            summs[j] += m0 * y[j][i].s;
+
+            const __m256 dy = _mm256_set1_ps(y[j][i].d);
+            const __m256i by = _mm256_loadu_si256((const __m256i *) y[j][i].qs);
+
+            acc[j] = _mm256_fmadd_ps(mul_sum_us8_pairs_float(bx, by), _mm256_mul_ps(dx, dy), acc[j]);
+        }
+    }
+
+    for (int j = 0; j < 4; ++j) {
+        s[j*bs] = hsum_float_8(acc[j]) + summs[j];
+    }
+#else
+    for (int j = 0; j < 4; ++j) {
+        ggml_vec_dot_q5_1_q8_1(n, s + j*bs, vx, (const char *) vy + j*ys);
+    }
+#endif
+}
+
+static void ggml_vec_dot_x4_q8_0_q8_0(const int n, float * restrict s, size_t bs, const void * restrict vx, const void * restrict vy, size_t ys) {
+#if defined(__AVX2__) && defined(GGML_VNNI)
+    const int nb = n / QK8_0;
+
+    const block_q8_0 * restrict x = vx;
+    GGML_VEC_DOT_X4_Y(block_q8_0);
+
+    // the accumulators of ggml_vec_dot_q8_0_q8_0, for each column
+    __m256 acc[4][2];
+    for (int j = 0; j < 4; ++j) {
+        acc[j][0] = acc[j][1] = _mm256_setzero_ps();
+    }
+
+    for (int i = 0; i < nb; i += 2) {
+        for (int k = 0; k < 2 && i + k < nb; ++k) {
+            const float dx = GGML_FP16_TO_FP32(x[i + k].d);
+
+            const __m256i bx = _mm256_loadu_si256((const __m256i *) x[i + k].qs);
+
+            for (int j = 0; j < 4; ++j) {
+                const __m256 d = _mm256_set1_ps(dx * GGML_FP16_TO_FP32(y[j][i + k].d));
+                const __m256i by = _mm256_loadu_si256((const __m256i *) y[j][i + k].qs);
+
+                acc[j][k] = _mm256_fmadd_ps(d, mul_sum_i8_pairs_float(bx, by), acc[j][k]);
+            }
+        }
+    }
+
+    for (int j = 0; j < 4; ++j) {
+        s[j*bs] = hsum_float_8(_mm256_add_ps(acc[j][0], acc[j][1]));
+    }
+#elif defined(__AVX2__)
+    const int nb = n / QK8_0;
+
+    const block_q8_0 * restrict x = vx;
+    GGML_VEC_DOT_X4_Y(block_q8_0);
+
+    __m256 acc[4] = { _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps(), _mm256_setzero_ps() };
+
+    for (int i = 0; i < nb; ++i) {
+        const float dx = GGML_FP16_TO_FP32(x[i].d);
+
+        const __m256i bx = _mm256_loadu_si256((const __m256i *) x[i].qs);
+
+        for (int j = 0; j < 4; ++j) {
+            const __m256 d = _mm256_set1_ps(dx * GGML_FP16_TO_FP32(y[j][i].d));
+            const __m256i by = _mm256_loadu_si256((const __m256i *) y[j][i].qs);
+
+            acc[j] = _mm256_fmadd_ps(d, mul_sum_i8_pairs_float(bx, by), acc[j]);
+        }
+    }
+
+    for (int j = 0; j < 4; ++j) {
+        s[j*bs] = hsum_float_8(acc[j]);
+    }
+#else
+    for (int j = 0; j < 4; ++j) {
+        ggml_vec_dot_q8_0_q8_0(n, s + j*bs, vx, (const char *) vy + j*ys);
+    }
+#endif
+}
+
+#undef GGML_VEC_DOT_X4_Y
+
 // compute GGML_VEC_DOT_UNROLL dot products at once
 // xs - x row stride in bytes
 inline static void ggml_vec_dot_f16_unroll(const int n, const int xs, float * restrict s, void * restrict xv, ggml_fp16_t * restrict y) {
@@ -3648,6 +4052,9 @@ inline static void ggml_vec_argmax_f32(const int n, int * s, const float * x) {
     *s = idx;
 }
 
+// the rest of ggml.c is only built once, in the base build
+#ifndef GGML_CPU_KERNELS_ONLY
+
 //
 // data types
 //
@@ -3984,6 +4391,12 @@ struct ggml_numa_nodes {
     uint32_t total_cpus; // hardware threads on system
 };
 
+// physical core of each hardware thread, read by ggml_init()
+struct ggml_cpu_topology {
+    int32_t core[GGML_NUMA_MAX_CPUS]; // package << 16 | core_id, -1 when the CPU is offline or not allowed
+    int32_t n_cpus;                   // CPUs 0 .. n_cpus - 1 have an entry, 0 when unknown
+};
+
 //
 // ggml state
 //
@@ -3991,6 +4404,7 @@ struct ggml_numa_nodes {
 struct ggml_state {
     struct ggml_context_container contexts[GGML_MAX_CONTEXTS];
     struct ggml_numa_nodes numa;
+    struct ggml_cpu_topology topology;
 };
 
 // global state
@@ -4084,45 +4498,358 @@ bool ggml_is_numa(void) {
     return g_state.numa.n_nodes > 1;
 }
 
-////////////////////////////////////////////////////////////////////////////////
+static void ggml_cpu_topology_init(void) {
+    struct ggml_cpu_topology * topo = &g_state.topology;
 
-void ggml_print_object(const struct ggml_object * obj) {
-    GGML_PRINT(" - ggml_object: type = %d, offset = %zu, size = %zu, next = %p\n",
-            obj->type, obj->offs, obj->size, (const void *) obj->next);
-}
+    topo->n_cpus = 0;
 
-void ggml_print_objects(const struct ggml_context * ctx) {
-    struct ggml_object * obj = ctx->objects_begin;
+#ifdef __linux__
+    struct stat st;
+    char path[256];
+    int rv;
 
-    GGML_PRINT("%s: objects in context %p:\n", __func__, (const void *) ctx);
+#if !defined(__BIONIC__)
+    // CPUs outside of the affinity of the process (taskset, cgroup cpusets) count as offline
+    size_t setsize = CPU_ALLOC_SIZE(GGML_NUMA_MAX_CPUS);
 
-    while (obj != NULL) {
-        ggml_print_object(obj);
-        obj = obj->next;
+    cpu_set_t * allowed = CPU_ALLOC(GGML_NUMA_MAX_CPUS);
+    if (sched_getaffinity(0, setsize, allowed) != 0) {
+        CPU_FREE(allowed);
+        allowed = NULL;
     }
+#endif
 
-    GGML_PRINT("%s: --- end ---\n", __func__);
-}
+    while (topo->n_cpus < GGML_NUMA_MAX_CPUS) {
+        const int c = topo->n_cpus;
 
-int64_t ggml_nelements(const struct ggml_tensor * tensor) {
-    static_assert(GGML_MAX_DIMS == 4, "GGML_MAX_DIMS is not 4 - update this function");
+        rv = snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d", c);
+        GGML_ASSERT(rv > 0 && (unsigned)rv < sizeof(path));
+        if (stat(path, &st) != 0) { break; }
 
-    return tensor->ne[0]*tensor->ne[1]*tensor->ne[2]*tensor->ne[3];
-}
+        // an offline CPU has no topology, cpu0 usually has no online file at all
+        int online   = 1;
+        int package  = 0;
+        int core_id  = c;
 
-int64_t ggml_nrows(const struct ggml_tensor * tensor) {
-    static_assert(GGML_MAX_DIMS == 4, "GGML_MAX_DIMS is not 4 - update this function");
+        const char * names[3] = { "online", "topology/physical_package_id", "topology/core_id" };
+        int        * vals [3] = { &online,  &package,                      &core_id           };
 
-    return tensor->ne[1]*tensor->ne[2]*tensor->ne[3];
-}
+        for (int i = 0; i < 3; ++i) {
+            rv = snprintf(path, sizeof(path), "/sys/devices/system/cpu/cpu%d/%s", c, names[i]);
+            GGML_ASSERT(rv > 0 && (unsigned)rv < sizeof(path));
 
-size_t ggml_nbytes(const struct ggml_tensor * tensor) {
-    static_assert(GGML_MAX_DIMS == 4, "GGML_MAX_DIMS is not 4 - update this function");
+            FILE * f = fopen(path, "r");
+            if (f == NULL) {
+                continue;
+            }
+            if (fscanf(f, "%d", vals[i]) != 1) {
+                GGML_PRINT_DEBUG("%s: failed to read %s\n", __func__, path);
+            }
+            fclose(f);
+        }
 
-    // this should handle cases where the tensor is not contiguous in memory
-    // probaby just:
-    //
-    //     return tensor->ne[3]*tensor->nb[3]
+#if !defined(__BIONIC__)
+        if (allowed && !CPU_ISSET_S(c, setsize, allowed)) {
+            online = 0;
+        }
+#endif
+
+        topo->core[c] = online ? (package << 16) | (core_id & 0xffff) : -1;
+        topo->n_cpus++;
+    }
+
+#if !defined(__BIONIC__)
+    if (allowed) {
+        CPU_FREE(allowed);
+    }
+#endif
+#endif
+}
+
+// the CPUs of cand[0 .. n_cand) in order, skipping offline ones and those that share a core with an
+// earlier one; stops after n_max of them
+static int ggml_cpu_first_of_cores(const int * cand, int n_cand, int * cpus, int n_max) {
+    const struct ggml_cpu_topology * topo = &g_state.topology;
+
+    int n = 0;
+
+    for (int i = 0; i < n_cand && n < n_max; ++i) {
+        const int c = cand[i];
+        if (c < 0 || c >= topo->n_cpus || topo->core[c] < 0) {
+            continue;
+        }
+
+        bool seen = false;
+        for (int j = 0; j < n && !seen; ++j) {
+            seen = topo->core[cpus[j]] == topo->core[c];
+        }
+
+        if (!seen) {
+            cpus[n++] = c;
+        }
+    }
+
+    return n;
+}
+
+int ggml_cpu_physical_cores(int * cpus, int n_max) {
+    const int n_cpus = g_state.topology.n_cpus;
+
+    int all  [GGML_NUMA_MAX_CPUS];
+    int cores[GGML_NUMA_MAX_CPUS];
+
+    for (int c = 0; c < n_cpus; ++c) {
+        all[c] = c;
+    }
+
+    const int n = ggml_cpu_first_of_cores(all, n_cpus, cores, GGML_NUMA_MAX_CPUS);
+
+    if (n_max > 0) {
+        memcpy(cpus, cores, MIN(n, n_max)*sizeof(int));
+    }
+
+    return n;
+}
+
+// node of compute thread ith out of nth, the threads are spread evenly over the nodes
+static int ggml_numa_node_of(int ith, int nth) {
+    return (int) ((int64_t) ith*g_state.numa.n_nodes/nth);
+}
+
+// first compute thread on node n, n_nodes for one past the last thread
+static int ggml_numa_first_thread(int n, int nth) {
+    const int n_nodes = g_state.numa.n_nodes;
+    return (int) (((int64_t) n*nth + n_nodes - 1)/n_nodes);
+}
+
+#define GGML_MPOL_BIND    2
+#define GGML_MPOL_MF_MOVE (1 << 1)
+
+void ggml_numa_place(struct ggml_tensor * tensor) {
+    if (!ggml_is_numa()) {
+        return;
+    }
+
+#if defined(__linux__) && defined(SYS_mbind)
+    const uintptr_t page_size = (uintptr_t) sysconf(_SC_PAGESIZE);
+    const int n_nodes = g_state.numa.n_nodes;
+
+    for (int64_t i3 = 0; i3 < tensor->ne[3]; ++i3) {
+        for (int64_t i2 = 0; i2 < tensor->ne[2]; ++i2) {
+            const char * plane = (const char *) tensor->data + i2*tensor->nb[2] + i3*tensor->nb[3];
+
+            for (int n = 0; n < n_nodes; ++n) {
+                const int64_t ir0 = n*tensor->ne[1]/n_nodes;
+                const int64_t ir1 = (n + 1)*tensor->ne[1]/n_nodes;
+
+                // whole pages only, a page shared by two nodes stays where it is
+                const uintptr_t p0 = GGML_PAD((uintptr_t) (plane + ir0*tensor->nb[1]), page_size);
+                const uintptr_t p1 = (uintptr_t) (plane + ir1*tensor->nb[1]) & ~(page_size - 1);
+                if (p1 <= p0) {
+                    continue;
+                }
+
+                const unsigned long mask = 1UL << n;
+
+                if (syscall(SYS_mbind, (void *) p0, p1 - p0, GGML_MPOL_BIND, &mask, 8*sizeof(mask), GGML_MPOL_MF_MOVE) != 0) {
+                    fprintf(stderr, "warning: mbind() failed for %s: %s\n", tensor->name, strerror(errno));
+                    return;
+                }
+            }
+        }
+    }
+#else
+    UNUSED(tensor);
+#endif
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+static size_t ggml_page_size(void) {
+#if defined(_WIN32)
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwPageSize;
+#else
+    return (size_t) sysconf(_SC_PAGESIZE);
+#endif
+}
+
+bool ggml_mem_lock(const void * data, size_t size) {
+#if defined(_WIN32)
+    if (!VirtualLock((void *) data, size)) {
+        fprintf(stderr, "warning: failed to lock %.2f MB: error %lu (working set too small)\n",
+                size/(1024.0*1024.0), (unsigned long) GetLastError());
+        return false;
+    }
+#else
+    if (mlock(data, size) != 0) {
+        fprintf(stderr, "warning: failed to mlock %.2f MB: %s (raise the limit with ulimit -l)\n",
+                size/(1024.0*1024.0), strerror(errno));
+        return false;
+    }
+#endif
+    return true;
+}
+
+void ggml_mem_prefault(const void * data, size_t size) {
+    const size_t page_size = ggml_page_size();
+
+    // volatile reads, one per page
+    volatile const char * p = (volatile const char *) data;
+
+    for (size_t i = 0; i < size; i += page_size) {
+        (void) p[i];
+    }
+}
+
+#if defined(__linux__) && defined(MAP_HUGETLB) && !defined(MAP_HUGE_SHIFT)
+#define MAP_HUGE_SHIFT 26
+#endif
+
+struct ggml_mem_buffer ggml_mem_buffer_alloc(size_t size, int flags) {
+    struct ggml_mem_buffer buf = { NULL, 0, 0 };
+
+    const bool huge = flags & (GGML_MEM_HUGE_2M | GGML_MEM_HUGE_1G);
+
+#if defined(_WIN32)
+    // large pages need SeLockMemoryPrivilege, they are not attempted
+    buf.size = GGML_PAD(size, ggml_page_size());
+    buf.data = VirtualAlloc(NULL, buf.size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (buf.data == NULL) {
+        buf.size = 0;
+        return buf;
+    }
+#else
+#if defined(__linux__) && defined(MAP_HUGETLB)
+    // reserved huge pages, 1 GB before 2 MB
+    for (int shift = 30; huge && shift >= 21 && buf.data == NULL; shift -= 9) {
+        if (shift == 30 && !(flags & GGML_MEM_HUGE_1G)) {
+            continue;
+        }
+
+        const size_t size_huge = GGML_PAD(size, (size_t) 1 << shift);
+
+        void * addr = mmap(NULL, size_huge, PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | (shift << MAP_HUGE_SHIFT), -1, 0);
+        if (addr != MAP_FAILED) {
+            buf.data   = addr;
+            buf.size   = size_huge;
+            buf.flags |= shift == 30 ? GGML_MEM_HUGE_1G : GGML_MEM_HUGE_2M;
+        }
+    }
+#endif
+
+    if (buf.data == NULL) {
+        // with transparent huge pages, map 2 MB more and keep the 2 MB aligned part so that every page can be huge
+        const size_t align = huge ? (size_t) 2*1024*1024 : ggml_page_size();
+
+        buf.size = GGML_PAD(size, ggml_page_size());
+
+        const size_t size_map = huge ? buf.size + align : buf.size;
+
+        char * addr = mmap(NULL, size_map, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (addr == MAP_FAILED) {
+            buf.size = 0;
+            return buf;
+        }
+
+        char * data = (char *) GGML_PAD((uintptr_t) addr, align);
+        if (data > addr) {
+            munmap(addr, data - addr);
+        }
+        if (addr + size_map > data + buf.size) {
+            munmap(data + buf.size, addr + size_map - (data + buf.size));
+        }
+
+        buf.data = data;
+
+#if defined(MADV_HUGEPAGE)
+        if (huge && madvise(buf.data, buf.size, MADV_HUGEPAGE) == 0) {
+            buf.flags |= GGML_MEM_HUGE_2M;
+        }
+#endif
+    }
+#endif
+
+    if (huge && !(buf.flags & (GGML_MEM_HUGE_2M | GGML_MEM_HUGE_1G))) {
+        fprintf(stderr, "warning: no huge pages for %.2f MB, using normal pages\n", size/(1024.0*1024.0));
+    }
+
+    if ((flags & GGML_MEM_LOCK) && ggml_mem_lock(buf.data, buf.size)) {
+        buf.flags |= GGML_MEM_LOCK;
+    }
+
+    // a write, reading an untouched anonymous page only maps the shared zero page
+    if (flags & GGML_MEM_PREFAULT) {
+        const size_t page_size = ggml_page_size();
+
+        volatile char * p = (volatile char *) buf.data;
+        for (size_t i = 0; i < buf.size; i += page_size) {
+            p[i] = 0;
+        }
+
+        buf.flags |= GGML_MEM_PREFAULT;
+    }
+
+    return buf;
+}
+
+void ggml_mem_buffer_free(struct ggml_mem_buffer * buf) {
+    if (buf->data == NULL) {
+        return;
+    }
+
+#if defined(_WIN32)
+    VirtualFree(buf->data, 0, MEM_RELEASE);
+#else
+    munmap(buf->data, buf->size);
+#endif
+
+    buf->data  = NULL;
+    buf->size  = 0;
+    buf->flags = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ggml_print_object(const struct ggml_object * obj) {
+    GGML_PRINT(" - ggml_object: type = %d, offset = %zu, size = %zu, next = %p\n",
+            obj->type, obj->offs, obj->size, (const void *) obj->next);
+}
+
+void ggml_print_objects(const struct ggml_context * ctx) {
+    struct ggml_object * obj = ctx->objects_begin;
+
+    GGML_PRINT("%s: objects in context %p:\n", __func__, (const void *) ctx);
+
+    while (obj != NULL) {
+        ggml_print_object(obj);
+        obj = obj->next;
+    }
+
+    GGML_PRINT("%s: --- end ---\n", __func__);
+}
+
+int64_t ggml_nelements(const struct ggml_tensor * tensor) {
+    static_assert(GGML_MAX_DIMS == 4, "GGML_MAX_DIMS is not 4 - update this function");
+
+    return tensor->ne[0]*tensor->ne[1]*tensor->ne[2]*tensor->ne[3];
+}
+
+int64_t ggml_nrows(const struct ggml_tensor * tensor) {
+    static_assert(GGML_MAX_DIMS == 4, "GGML_MAX_DIMS is not 4 - update this function");
+
+    return tensor->ne[1]*tensor->ne[2]*tensor->ne[3];
+}
+
+size_t ggml_nbytes(const struct ggml_tensor * tensor) {
+    static_assert(GGML_MAX_DIMS == 4, "GGML_MAX_DIMS is not 4 - update this function");
+
+    // this should handle cases where the tensor is not contiguous in memory
+    // probaby just:
+    //
+    //     return tensor->ne[3]*tensor->nb[3]
     //
     // is enough, but just in case, adding the second part
 
@@ -4316,6 +5043,85 @@ static inline int ggml_up(int n, int m) {
 
 ////////////////////////////////////////////////////////////////////////////////
 
+#if defined(GGML_CPU_DISPATCH)
+// ISA level of the kernels in type_traits
+enum ggml_cpu_level {
+    GGML_CPU_LEVEL_BASE,
+    GGML_CPU_LEVEL_AVX2,
+    GGML_CPU_LEVEL_AVX_VNNI,
+    GGML_CPU_LEVEL_AVX512,
+    GGML_CPU_LEVEL_AVX512_VNNI,
+
+    GGML_CPU_LEVEL_COUNT,
+};
+
+static const char * GGML_CPU_LEVEL_NAME[GGML_CPU_LEVEL_COUNT] = {
+    "base",
+    "avx2",
+    "avx_vnni",
+    "avx512",
+    "avx512_vnni",
+};
+
+static const ggml_type_traits_t * const GGML_CPU_LEVEL_TRAITS[GGML_CPU_LEVEL_COUNT] = {
+    NULL,
+    ggml_type_traits_avx2,
+    ggml_type_traits_avx_vnni,
+    ggml_type_traits_avx512,
+    ggml_type_traits_avx512_vnni,
+};
+
+static enum ggml_cpu_level g_cpu_level = GGML_CPU_LEVEL_BASE;
+
+// AVX-VNNI is CPUID.(EAX=7,ECX=1):EAX[4], which __builtin_cpu_supports does not know in all compilers we support
+static bool ggml_cpu_supports_avx_vnni(void) {
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid_count(7, 1, &eax, &ebx, &ecx, &edx)) {
+        return false;
+    }
+    return (eax >> 4) & 1;
+}
+
+// picks the highest level the CPU supports, capped by the GGML_CPU_MAX_LEVEL environment variable if set
+// every AVX2 CPU also has F16C, which the GCC and Clang versions we support cannot all query
+static void ggml_cpu_dispatch_init(void) {
+    __builtin_cpu_init();
+
+    bool supported[GGML_CPU_LEVEL_COUNT] = { true };
+
+    supported[GGML_CPU_LEVEL_AVX2]        = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    supported[GGML_CPU_LEVEL_AVX_VNNI]    = supported[GGML_CPU_LEVEL_AVX2] && ggml_cpu_supports_avx_vnni();
+    supported[GGML_CPU_LEVEL_AVX512]      = supported[GGML_CPU_LEVEL_AVX2] &&
+        __builtin_cpu_supports("avx512f")  && __builtin_cpu_supports("avx512bw") &&
+        __builtin_cpu_supports("avx512vl") && __builtin_cpu_supports("avx512dq");
+    supported[GGML_CPU_LEVEL_AVX512_VNNI] = supported[GGML_CPU_LEVEL_AVX512] && __builtin_cpu_supports("avx512vnni");
+
+    int max_level = GGML_CPU_LEVEL_COUNT - 1;
+
+    const char * env = getenv("GGML_CPU_MAX_LEVEL");
+    if (env) {
+        max_level = -1;
+        for (int l = 0; l < GGML_CPU_LEVEL_COUNT; ++l) {
+            if (strcmp(env, GGML_CPU_LEVEL_NAME[l]) == 0) {
+                max_level = l;
+            }
+        }
+        if (max_level < 0) {
+            fprintf(stderr, "%s: unknown GGML_CPU_MAX_LEVEL '%s', using the best supported level\n", __func__, env);
+            max_level = GGML_CPU_LEVEL_COUNT - 1;
+        }
+    }
+
+    for (int l = max_level; l > GGML_CPU_LEVEL_BASE; --l) {
+        if (supported[l]) {
+            memcpy(type_traits, GGML_CPU_LEVEL_TRAITS[l], sizeof(type_traits));
+            g_cpu_level = l;
+            break;
+        }
+    }
+}
+#endif
+
 struct ggml_context * ggml_init(struct ggml_init_params params) {
     // make this function thread safe
     ggml_critical_section_start();
@@ -4326,6 +5132,10 @@ struct ggml_context * ggml_init(struct ggml_init_params params) {
         // initialize time system (required on Windows)
         ggml_time_init();
 
+#if defined(GGML_CPU_DISPATCH)
+        ggml_cpu_dispatch_init();
+#endif
+
         // initialize GELU, Quick GELU, SILU and EXP F32 tables
         {
             const uint64_t t_start = ggml_time_us(); UNUSED(t_start);
@@ -4350,18 +5160,13 @@ struct ggml_context * ggml_init(struct ggml_init_params params) {
         {
             const uint64_t t_start = ggml_time_us(); UNUSED(t_start);
 
-            g_state = (struct ggml_state) {
-                /*.contexts =*/ { { 0 } },
-                /*.numa =*/ {
-                    .n_nodes = 0,
-                    .total_cpus = 0,
-                },
-            };
-
+            // g_state starts zeroed, a ggml_numa_init() before the first ggml_init() is kept
             for (int i = 0; i < GGML_MAX_CONTEXTS; ++i) {
                 g_state.contexts[i].used = false;
             }
 
+            ggml_cpu_topology_init();
+
             const uint64_t t_end = ggml_time_us(); UNUSED(t_end);
 
             GGML_PRINT_DEBUG("%s: g_state initialized in %f ms\n", __func__, (t_end - t_start)/1000.0f);
@@ -5320,11 +6125,13 @@ static struct ggml_tensor * ggml_div_impl(
         struct ggml_tensor * a,
         struct ggml_tensor * b,
         bool inplace) {
-    GGML_ASSERT(ggml_are_same_shape(a, b));
+    GGML_ASSERT(ggml_can_repeat_rows(b, a));
 
     bool is_node = false;
 
     if (!inplace && (a->grad || b->grad)) {
+        // TODO: support backward pass for broadcasting
+        GGML_ASSERT(ggml_are_same_shape(a, b));
         is_node = true;
     }
 
@@ -9292,14 +10099,16 @@ static void ggml_compute_forward_div_f32(
         const struct ggml_tensor * src0,
         const struct ggml_tensor * src1,
         struct ggml_tensor * dst) {
-    assert(params->ith == 0);
-    assert(ggml_are_same_shape(src0, src1) && ggml_are_same_shape(src0, dst));
+    GGML_ASSERT(ggml_can_repeat_rows(src1, src0) && ggml_are_same_shape(src0, dst));
 
     if (params->type == GGML_TASK_INIT || params->type == GGML_TASK_FINALIZE) {
         return;
     }
 
-    const int nr  = ggml_nrows(src0);
+    const int ith = params->ith;
+    const int nth = params->nth;
+
+    const int64_t nr = ggml_nrows(src0);
 
     GGML_TENSOR_BINARY_OP_LOCALS;
 
@@ -9307,40 +10116,48 @@ static void ggml_compute_forward_div_f32(
     GGML_ASSERT(nb00 == sizeof(float));
 
     if (nb10 == sizeof(float)) {
-        for (int ir = 0; ir < nr; ++ir) {
-            // src0, src1 and dst are same shape => same indices
-            const int i3 = ir/(ne2*ne1);
-            const int i2 = (ir - i3*ne2*ne1)/ne1;
-            const int i1 = (ir - i3*ne2*ne1 - i2*ne1);
+        for (int64_t ir = ith; ir < nr; ir += nth) {
+            // src0 and dst are same shape => same indices
+            const int64_t i03 = ir/(ne02*ne01);
+            const int64_t i02 = (ir - i03*ne02*ne01)/ne01;
+            const int64_t i01 = (ir - i03*ne02*ne01 - i02*ne01);
+
+            const int64_t i13 = i03 % ne13;
+            const int64_t i12 = i02 % ne12;
+            const int64_t i11 = i01 % ne11;
 
+            float * dst_ptr  = (float *) ((char *) dst->data  + i03*nb3  + i02*nb2  + i01*nb1 );
+            float * src0_ptr = (float *) ((char *) src0->data + i03*nb03 + i02*nb02 + i01*nb01);
+            float * src1_ptr = (float *) ((char *) src1->data + i13*nb13 + i12*nb12 + i11*nb11);
 
 #ifdef GGML_USE_ACCELERATE
-            vDSP_vdiv(
-                    (float *) ((char *) src1->data + i3*nb13 + i2*nb12 + i1*nb11), 1,
-                    (float *) ((char *) src0->data + i3*nb03 + i2*nb02 + i1*nb01), 1,
-                    (float *) ((char *) dst->data  + i3*nb3  + i2*nb2  + i1*nb1 ), 1,
-                    ne0);
+            UNUSED(ggml_vec_div_f32);
+
+            vDSP_vdiv(src1_ptr, 1, src0_ptr, 1, dst_ptr, 1, ne00);
 #else
-            ggml_vec_div_f32(ne0,
-                    (float *) ((char *) dst->data  + i3*nb3  + i2*nb2  + i1*nb1 ),
-                    (float *) ((char *) src0->data + i3*nb03 + i2*nb02 + i1*nb01),
-                    (float *) ((char *) src1->data + i3*nb13 + i2*nb12 + i1*nb11));
+            ggml_vec_div_f32(ne00, dst_ptr, src0_ptr, src1_ptr);
 #endif
                 // }
             // }
         }
     } else {
         // src1 is not contiguous
-        for (int ir = 0; ir < nr; ++ir) {
-            // src0, src1 and dst are same shape => same indices
-            const int i3 = ir/(ne2*ne1);
-            const int i2 = (ir - i3*ne2*ne1)/ne1;
-            const int i1 = (ir - i3*ne2*ne1 - i2*ne1);
+        for (int64_t ir = ith; ir < nr; ir += nth) {
+            // src0 and dst are same shape => same indices
+            // src1 is broadcastable across src0 and dst in i1, i2, i3
+            const int64_t i03 = ir/(ne02*ne01);
+            const int64_t i02 = (ir - i03*ne02*ne01)/ne01;
+            const int64_t i01 = (ir - i03*ne02*ne01 - i02*ne01);
 
-            float * dst_ptr  = (float *) ((char *) dst->data  + i3*nb3  + i2*nb2  + i1*nb1 );
-            float * src0_ptr = (float *) ((char *) src0->data + i3*nb03 + i2*nb02 + i1*nb01);
-            for (int i0 = 0; i0 < ne0; i0++) {
-                float * src1_ptr = (float *) ((char *) src1->data + i3*nb13 + i2*nb12 + i1*nb11 + i0*nb10);
+            const int64_t i13 = i03 % ne13;
+            const int64_t i12 = i02 % ne12;
+            const int64_t i11 = i01 % ne11;
+
+            float * dst_ptr  = (float *) ((char *) dst->data  + i03*nb3  + i02*nb2  + i01*nb1 );
+            float * src0_ptr = (float *) ((char *) src0->data + i03*nb03 + i02*nb02 + i01*nb01);
+
+            for (int64_t i0 = 0; i0 < ne00; i0++) {
+                float * src1_ptr = (float *) ((char *) src1->data + i13*nb13 + i12*nb12 + i11*nb11 + i0*nb10);
 
                 dst_ptr[i0] = src0_ptr[i0] / (*src1_ptr);
             }
@@ -10402,6 +11219,15 @@ static void ggml_compute_forward_silu_back(
     }
 }
 
+// ops folded into NORM and MUL_MAT nodes by ggml_graph_fuse(), kept in op_params[0]
+// the extra operands follow the regular ones in src[], in the order of the flags
+enum ggml_fused_flags {
+    GGML_FUSED_ADD   = 1, // NORM:    src[0] = a + b is computed first and then normalized
+    GGML_FUSED_SCALE = 2, // NORM:    the result is multiplied by a row of weights
+    GGML_FUSED_SHIFT = 4, // NORM, MUL_MAT: a row of biases is added to the result
+    GGML_FUSED_ACT   = 8, // MUL_MAT: the unary op in op_params[1] is applied to the result
+};
+
 // ggml_compute_forward_norm
 
 static void ggml_compute_forward_norm_f32(
@@ -10423,12 +11249,26 @@ static void ggml_compute_forward_norm_f32(
 
     const float eps = 1e-5f; // TODO: make this a parameter
 
-    // TODO: optimize
+    const int32_t fused = ggml_get_op_params_i32(dst, 0);
+
+    int k = 1;
+    const struct ggml_tensor * a = fused & GGML_FUSED_ADD   ? dst->src[k++] : NULL;
+    const struct ggml_tensor * b = fused & GGML_FUSED_ADD   ? dst->src[k++] : NULL;
+    const struct ggml_tensor * w = fused & GGML_FUSED_SCALE ? dst->src[k++] : NULL;
+    const struct ggml_tensor * c = fused & GGML_FUSED_SHIFT ? dst->src[k++] : NULL;
+
+    // TODO: optimize
     for (int64_t i03 = 0; i03 < ne03; i03++) {
         for (int64_t i02 = 0; i02 < ne02; i02++) {
             for (int64_t i01 = ith; i01 < ne01; i01 += nth) {
                 const float * x = (float *) ((char *) src0->data + i01*nb01 + i02*nb02 + i03*nb03);
 
+                if (a) {
+                    ggml_vec_add_f32(ne00, (float *) ((char *) src0->data + i01*nb01 + i02*nb02 + i03*nb03),
+                            (float *) ((char *) a->data + i01*a->nb[1] + i02*a->nb[2] + i03*a->nb[3]),
+                            (float *) ((char *) b->data + i01*b->nb[1] + i02*b->nb[2] + i03*b->nb[3]));
+                }
+
                 ggml_float sum = 0.0;
                 for (int64_t i00 = 0; i00 < ne00; i00++) {
                     sum += (ggml_float)x[i00];
@@ -10449,6 +11289,13 @@ static void ggml_compute_forward_norm_f32(
                 const float scale = 1.0f/sqrtf(variance + eps);
 
                 ggml_vec_scale_f32(ne00, y, scale);
+
+                if (w) {
+                    ggml_vec_mul_f32(ne00, y, y, (const float *) w->data);
+                }
+                if (c) {
+                    ggml_vec_add_f32(ne00, y, y, (const float *) c->data);
+                }
             }
         }
     }
@@ -10738,6 +11585,373 @@ static bool ggml_compute_forward_mul_mat_use_blas(
 }
 #endif
 
+// the bias and activation folded into a MUL_MAT node, for n values of a dst column from row i0 on
+static void ggml_compute_forward_mul_mat_fused(const struct ggml_tensor * dst, float * y, int64_t i0, int64_t n) {
+    const int32_t fused = ggml_get_op_params_i32(dst, 0);
+
+    if (fused & GGML_FUSED_SHIFT) {
+        ggml_vec_add_f32(n, y, y, (const float *) dst->src[2]->data + i0);
+    }
+
+    if (fused & GGML_FUSED_ACT) {
+        switch ((enum ggml_unary_op) ggml_get_op_params_i32(dst, 1)) {
+            case GGML_UNARY_OP_RELU:       ggml_vec_relu_f32      (n, y, y); break;
+            case GGML_UNARY_OP_GELU:       ggml_vec_gelu_f32      (n, y, y); break;
+            case GGML_UNARY_OP_GELU_QUICK: ggml_vec_gelu_quick_f32(n, y, y); break;
+            case GGML_UNARY_OP_SILU:       ggml_vec_silu_f32      (n, y, y); break;
+            default:
+                GGML_ASSERT(false);
+        }
+    }
+}
+
+// dst rows [ir010, ir011) x columns [ir110, ir111)
+static void ggml_compute_forward_mul_mat_chunk(
+        const struct ggml_tensor * src0,
+        const struct ggml_tensor * src1,
+              struct ggml_tensor * dst,
+        const void * wdata,
+        const size_t row_size,
+        ggml_vec_dot_t const vec_dot,
+        const int64_t ir010, const int64_t ir011,
+        const int64_t ir110, const int64_t ir111) {
+    GGML_TENSOR_BINARY_OP_LOCALS;
+
+    const enum ggml_type vec_dot_type = type_traits[src0->type].vec_dot_type;
+
+    const bool src1_cont = ggml_is_contiguous(src1);
+    const bool fused     = ggml_get_op_params_i32(dst, 0) != 0;
+
+    // the src1 columns are row_size apart, so 4 of them from the same matrix can go through vec_dot_x4
+    ggml_vec_dot_x4_t const vec_dot_x4 = src1_cont || src1->type != vec_dot_type ? type_traits[src0->type].vec_dot_x4 : NULL;
+
+    if (ir010 >= ir011 || ir110 >= ir111) {
+        return;
+    }
+
+    assert(ne12 % ne02 == 0);
+    assert(ne13 % ne03 == 0);
+
+    // broadcast factors
+    const int64_t r2 = ne12/ne02;
+    const int64_t r3 = ne13/ne03;
+
+    // block-tiling attempt
+    const int64_t blck_0 = 16;
+    const int64_t blck_1 = 16;
+
+    // attempt to reduce false-sharing (does not seem to make a difference)
+    float tmp[4*16];
+
+    for (int64_t iir1 = ir110; iir1 < ir111; iir1 += blck_1) {
+        for (int64_t iir0 = ir010; iir0 < ir011; iir0 += blck_0) {
+            for (int64_t ir1 = iir1; ir1 < iir1 + blck_1 && ir1 < ir111; ) {
+                const int64_t i13 = (ir1/(ne12*ne11));
+                const int64_t i12 = (ir1 - i13*ne12*ne11)/ne11;
+                const int64_t i11 = (ir1 - i13*ne12*ne11 - i12*ne11);
+
+                // broadcast src0 into src1
+                const int64_t i03 = i13/r3;
+                const int64_t i02 = i12/r2;
+
+                const int64_t i1 = i11;
+                const int64_t i2 = i12;
+                const int64_t i3 = i13;
+
+                const char * src0_row = (const char *) src0->data + (0 + i02*nb02 + i03*nb03);
+
+                // desc: when src1 is not a contiguous memory block we have to calculate the offset using the strides
+                //       if it is, then we have either copied the data to params->wdata and made it contiguous or we are using
+                //       the original src1 data pointer, so we should index using the indices directly
+                // TODO: this is a bit of a hack, we should probably have a better way to handle this
+                const char * src1_col = (const char *) wdata +
+                    (src1_cont || src1->type != vec_dot_type
+                     ? (i11      + i12*ne11 + i13*ne12*ne11)*row_size
+                     : (i11*nb11 + i12*nb12 + i13*nb13));
+
+                float * dst_col = (float *) ((char *) dst->data + (i1*nb1 + i2*nb2 + i3*nb3));
+
+                const int64_t nc = vec_dot_x4 && ir1 + 4 <= MIN(iir1 + blck_1, ir111) && i11 + 4 <= ne11 ? 4 : 1;
+
+                //for (int64_t ir0 = iir0; ir0 < iir0 + blck_0 && ir0 < ir011; ++ir0) {
+                //    vec_dot(ne00, &dst_col[ir0], src0_row + ir0*nb01, src1_col);
+                //}
+
+                if (nc == 4) {
+                    for (int64_t ir0 = iir0; ir0 < iir0 + blck_0 && ir0 < ir011; ++ir0) {
+                        vec_dot_x4(ne00, &tmp[ir0 - iir0], blck_0, src0_row + ir0*nb01, src1_col, row_size);
+                    }
+                } else {
+                    for (int64_t ir0 = iir0; ir0 < iir0 + blck_0 && ir0 < ir011; ++ir0) {
+                        vec_dot(ne00, &tmp[ir0 - iir0], src0_row + ir0*nb01, src1_col);
+                    }
+                }
+
+                for (int64_t j = 0; j < nc; ++j) {
+                    float * col = (float *) ((char *) dst_col + j*nb1);
+                    if (fused) {
+                        ggml_compute_forward_mul_mat_fused(dst, &tmp[j*blck_0], iir0, MIN(iir0 + blck_0, ir011) - iir0);
+                    }
+                    memcpy(&col[iir0], &tmp[j*blck_0], (MIN(iir0 + blck_0, ir011) - iir0)*sizeof(float));
+                }
+
+                ir1 += nc;
+            }
+        }
+    }
+}
+
+// packed GEMM for F32 and F16 src0, used instead of one vec_dot per dst value when src1 has enough
+// columns to amortize the packing: a GGML_GEMM_MR x GGML_GEMM_NR tile of dst (MR rows in SIMD lanes)
+// is accumulated in registers over GGML_GEMM_KC values of the rows at a time, with the src0 slice
+// packed per MR rows and the src1 slice per GGML_GEMM_NC columns into the thread's work buffer
+#if defined(GGML_SIMD)
+#define GGML_GEMM_MR (2*GGML_F32_EPR)
+#else
+#define GGML_GEMM_MR 8
+#endif
+#define GGML_GEMM_NR    6
+#define GGML_GEMM_NC   96 // multiple of GGML_GEMM_NR
+#define GGML_GEMM_KC  256
+#define GGML_GEMM_MIN 32  // min src1 columns per matrix
+
+#define GGML_GEMM_WSIZE GGML_PAD((GGML_GEMM_MR + GGML_GEMM_NC)*GGML_GEMM_KC*sizeof(float), CACHE_LINE_SIZE)
+
+static bool ggml_compute_forward_mul_mat_use_gemm(
+        const struct ggml_tensor * src0,
+        const struct ggml_tensor * src1) {
+    return (src0->type == GGML_TYPE_F32 || src0->type == GGML_TYPE_F16) &&
+            src1->type == GGML_TYPE_F32 &&
+            src1->ne[1] >= GGML_GEMM_MIN;
+}
+
+// c[j*MR + i] = sum_k a[k*MR + i]*b[k*NR + j]
+static void ggml_gemm_f32_kernel(const int64_t kc, const float * restrict a, const float * restrict b, float * restrict c) {
+#if defined(GGML_SIMD)
+    GGML_F32_VEC c00 = GGML_F32_VEC_ZERO, c01 = GGML_F32_VEC_ZERO;
+    GGML_F32_VEC c10 = GGML_F32_VEC_ZERO, c11 = GGML_F32_VEC_ZERO;
+    GGML_F32_VEC c20 = GGML_F32_VEC_ZERO, c21 = GGML_F32_VEC_ZERO;
+    GGML_F32_VEC c30 = GGML_F32_VEC_ZERO, c31 = GGML_F32_VEC_ZERO;
+    GGML_F32_VEC c40 = GGML_F32_VEC_ZERO, c41 = GGML_F32_VEC_ZERO;
+    GGML_F32_VEC c50 = GGML_F32_VEC_ZERO, c51 = GGML_F32_VEC_ZERO;
+
+#define GGML_GEMM_FMA(j) {                                        \
+        const GGML_F32_VEC bj = GGML_F32_VEC_SET1(b[j]);          \
+        c##j##0 = GGML_F32_VEC_FMA(c##j##0, a0, bj);              \
+        c##j##1 = GGML_F32_VEC_FMA(c##j##1, a1, bj);              \
+    }
+
+    for (int64_t k = 0; k < kc; ++k) {
+        const GGML_F32_VEC a0 = GGML_F32_VEC_LOAD(a);
+        const GGML_F32_VEC a1 = GGML_F32_VEC_LOAD(a + GGML_F32_EPR);
+
+        GGML_GEMM_FMA(0) GGML_GEMM_FMA(1) GGML_GEMM_FMA(2)
+        GGML_GEMM_FMA(3) GGML_GEMM_FMA(4) GGML_GEMM_FMA(5)
+
+        a += GGML_GEMM_MR;
+        b += GGML_GEMM_NR;
+    }
+
+#undef GGML_GEMM_FMA
+
+    GGML_F32_VEC_STORE(c + 0*GGML_GEMM_MR, c00); GGML_F32_VEC_STORE(c + 0*GGML_GEMM_MR + GGML_F32_EPR, c01);
+    GGML_F32_VEC_STORE(c + 1*GGML_GEMM_MR, c10); GGML_F32_VEC_STORE(c + 1*GGML_GEMM_MR + GGML_F32_EPR, c11);
+    GGML_F32_VEC_STORE(c + 2*GGML_GEMM_MR, c20); GGML_F32_VEC_STORE(c + 2*GGML_GEMM_MR + GGML_F32_EPR, c21);
+    GGML_F32_VEC_STORE(c + 3*GGML_GEMM_MR, c30); GGML_F32_VEC_STORE(c + 3*GGML_GEMM_MR + GGML_F32_EPR, c31);
+    GGML_F32_VEC_STORE(c + 4*GGML_GEMM_MR, c40); GGML_F32_VEC_STORE(c + 4*GGML_GEMM_MR + GGML_F32_EPR, c41);
+    GGML_F32_VEC_STORE(c + 5*GGML_GEMM_MR, c50); GGML_F32_VEC_STORE(c + 5*GGML_GEMM_MR + GGML_F32_EPR, c51);
+#else
+    for (int i = 0; i < GGML_GEMM_NR*GGML_GEMM_MR; ++i) {
+        c[i] = 0.0f;
+    }
+
+    for (int64_t k = 0; k < kc; ++k) {
+        for (int j = 0; j < GGML_GEMM_NR; ++j) {
+            for (int i = 0; i < GGML_GEMM_MR; ++i) {
+                c[j*GGML_GEMM_MR + i] += a[k*GGML_GEMM_MR + i]*b[k*GGML_GEMM_NR + j];
+            }
+        }
+    }
+#endif
+}
+
+// dst rows [ir010, ir011) x columns [ir110, ir111), wpack is GGML_GEMM_WSIZE bytes owned by the thread
+static void ggml_compute_forward_mul_mat_gemm_chunk(
+        const struct ggml_tensor * src0,
+        const struct ggml_tensor * src1,
+              struct ggml_tensor * dst,
+        float * wpack,
+        const int64_t ir010, const int64_t ir011,
+        const int64_t ir110, const int64_t ir111) {
+    GGML_TENSOR_BINARY_OP_LOCALS;
+
+    const bool fused = ggml_get_op_params_i32(dst, 0) != 0;
+
+    if (ir010 >= ir011 || ir110 >= ir111) {
+        return;
+    }
+
+    // broadcast factors
+    const int64_t r2 = ne12/ne02;
+    const int64_t r3 = ne13/ne03;
+
+    float * pa = wpack;                             // [GGML_GEMM_KC][GGML_GEMM_MR]
+    float * pb = wpack + GGML_GEMM_MR*GGML_GEMM_KC; // [GGML_GEMM_NC/GGML_GEMM_NR][GGML_GEMM_KC][GGML_GEMM_NR]
+
+    float c[GGML_GEMM_NR*GGML_GEMM_MR];
+
+    // blocks of columns from the same src1 matrix, so that they share the src0 matrix
+    for (int64_t jc = ir110; jc < ir111; ) {
+        const int64_t i13 = (jc/(ne12*ne11));
+        const int64_t i12 = (jc - i13*ne12*ne11)/ne11;
+        const int64_t i11 = (jc - i13*ne12*ne11 - i12*ne11);
+
+        const int64_t jn = MIN(MIN(ir111 - jc, GGML_GEMM_NC), ne11 - i11);
+
+        const char * src0_mat = (const char *) src0->data + ((i12/r2)*nb02 + (i13/r3)*nb03);
+        const char * src1_mat = (const char *) src1->data + (i11*nb11 + i12*nb12 + i13*nb13);
+
+        char * dst_mat = (char *) dst->data + (i11*nb1 + i12*nb2 + i13*nb3);
+
+        for (int64_t k0 = 0; k0 < ne00; k0 += GGML_GEMM_KC) {
+            const int64_t kc = MIN(GGML_GEMM_KC, ne00 - k0);
+
+            // pack the columns, zero-padded to whole tiles
+            for (int64_t j = 0; j < jn; j += GGML_GEMM_NR) {
+                float * b = pb + j*kc;
+
+                for (int64_t jj = 0; jj < GGML_GEMM_NR; ++jj) {
+                    if (j + jj < jn) {
+                        const float * y = (const float *) (src1_mat + (j + jj)*nb11) + k0;
+                        for (int64_t k = 0; k < kc; ++k) {
+                            b[k*GGML_GEMM_NR + jj] = y[k];
+                        }
+                    } else {
+                        for (int64_t k = 0; k < kc; ++k) {
+                            b[k*GGML_GEMM_NR + jj] = 0.0f;
+                        }
+                    }
+                }
+            }
+
+            for (int64_t ic = ir010; ic < ir011; ic += GGML_GEMM_MR) {
+                const int64_t mr = MIN(GGML_GEMM_MR, ir011 - ic);
+
+                // pack the rows, zero-padded to a whole tile
+                for (int64_t i = 0; i < GGML_GEMM_MR; ++i) {
+                    if (i >= mr) {
+                        for (int64_t k = 0; k < kc; ++k) {
+                            pa[k*GGML_GEMM_MR + i] = 0.0f;
+                        }
+                    } else if (src0->type == GGML_TYPE_F32) {
+                        const float * x = (const float *) (src0_mat + (ic + i)*nb01) + k0;
+                        for (int64_t k = 0; k < kc; ++k) {
+                            pa[k*GGML_GEMM_MR + i] = x[k];
+                        }
+                    } else {
+                        float x[GGML_GEMM_KC];
+                        type_traits[GGML_TYPE_F16].to_float((const ggml_fp16_t *) (src0_mat + (ic + i)*nb01) + k0, x, kc);
+                        for (int64_t k = 0; k < kc; ++k) {
+                            pa[k*GGML_GEMM_MR + i] = x[k];
+                        }
+                    }
+                }
+
+                for (int64_t j = 0; j < jn; j += GGML_GEMM_NR) {
+                    ggml_gemm_f32_kernel(kc, pa, pb + j*kc, c);
+
+                    for (int64_t jj = 0; jj < MIN(GGML_GEMM_NR, jn - j); ++jj) {
+                        float * d = (float *) (dst_mat + (j + jj)*nb1) + ic;
+
+                        if (k0 == 0) {
+                            memcpy(d, c + jj*GGML_GEMM_MR, mr*sizeof(float));
+                        } else {
+                            ggml_vec_acc_f32(mr, d, c + jj*GGML_GEMM_MR);
+                        }
+                    }
+                }
+            }
+        }
+
+        if (fused) {
+            for (int64_t j = 0; j < jn; ++j) {
+                ggml_compute_forward_mul_mat_fused(dst, (float *) (dst_mat + j*nb1) + ir010, ir010, ir011 - ir010);
+            }
+        }
+
+        jc += jn;
+    }
+}
+
+// matrix-vector product for a single src1 column, as in decode: every src0 row is read once, so the
+// chunks are slabs of consecutive rows walked in memory order, with the rows GGML_GEMV_PREFETCH
+// ahead already on their way into the cache and the results going straight to dst
+#define GGML_GEMV_ROWS     64
+#define GGML_GEMV_PREFETCH  2
+
+#if defined(__GNUC__)
+#define GGML_PREFETCH(p) __builtin_prefetch(p)
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define GGML_PREFETCH(p) _mm_prefetch((const char *) (p), _MM_HINT_T0)
+#else
+#define GGML_PREFETCH(p) UNUSED(p)
+#endif
+
+// dst rows [ir0, ir1)
+static void ggml_compute_forward_mul_mat_gemv(
+        const struct ggml_tensor * src0,
+              struct ggml_tensor * dst,
+        const void * y,
+        ggml_vec_dot_t const vec_dot,
+        const int64_t ir0, const int64_t ir1) {
+    const int64_t ne00 = src0->ne[0];
+    const int64_t ne01 = src0->ne[1];
+    const size_t  nb01 = src0->nb[1];
+
+    const size_t row_size = ne00*GGML_TYPE_SIZE[src0->type]/GGML_BLCK_SIZE[src0->type];
+
+    const char * x = (const char *) src0->data;
+    float      * d = (float *) dst->data;
+
+    for (int64_t ir = ir0; ir < ir1; ++ir) {
+        if (ir + GGML_GEMV_PREFETCH < ne01) {
+            const char * next = x + (ir + GGML_GEMV_PREFETCH)*nb01;
+            for (size_t i = 0; i < row_size; i += CACHE_LINE_SIZE) {
+                GGML_PREFETCH(next + i);
+            }
+        }
+
+        vec_dot(ne00, &d[ir], x + ir*nb01, y);
+    }
+
+    if (ggml_get_op_params_i32(dst, 0) != 0) {
+        ggml_compute_forward_mul_mat_fused(dst, &d[ir0], ir0, ir1 - ir0);
+    }
+}
+
+// the range of chunks [*start, *end) that thread ith of ggml_compute_forward_mul_mat starts with
+// with NUMA the threads of a node share the chunks of the node's src0 rows, numbered along src1 first
+// so that they are contiguous - the node boundaries are those of ggml_numa_place() up to a chunk
+static void ggml_compute_forward_mul_mat_range(int ith, int nth, bool numa, int64_t nchunk0, int64_t nchunk1, int64_t * start, int64_t * end) {
+    if (!numa) {
+        *start = ith*nchunk0*nchunk1/nth;
+        *end   = (ith + 1)*nchunk0*nchunk1/nth;
+        return;
+    }
+
+    const int n_nodes = g_state.numa.n_nodes;
+
+    const int node = ggml_numa_node_of(ith, nth);
+    const int t0   = ggml_numa_first_thread(node,     nth);
+    const int t1   = ggml_numa_first_thread(node + 1, nth);
+
+    const int64_t c0 = node*nchunk0/n_nodes*nchunk1;
+    const int64_t c1 = (node + 1)*nchunk0/n_nodes*nchunk1;
+
+    *start = c0 + (ith - t0)*(c1 - c0)/(t1 - t0);
+    *end   = c0 + (ith - t0 + 1)*(c1 - c0)/(t1 - t0);
+}
+
 static void ggml_compute_forward_mul_mat(
         const struct ggml_compute_params * params,
         const struct ggml_tensor * src0,
@@ -10753,8 +11967,6 @@ static void ggml_compute_forward_mul_mat(
 
     const enum ggml_type type = src0->type;
 
-    const bool src1_cont = ggml_is_contiguous(src1);
-
     ggml_vec_dot_t    const vec_dot               = type_traits[type].vec_dot;
     enum ggml_type    const vec_dot_type          = type_traits[type].vec_dot_type;
     ggml_from_float_t const from_float_to_vec_dot = type_traits[vec_dot_type].from_float;
@@ -10786,6 +11998,12 @@ static void ggml_compute_forward_mul_mat(
 
         if (params->ith == 0 && params->type == GGML_TASK_COMPUTE) {
             ggml_cl_mul_mat(src0, src1, dst, params->wdata, params->wsize);
+
+            if (ggml_get_op_params_i32(dst, 0) != 0) {
+                for (int64_t ir1 = 0; ir1 < ne1*ne2*ne3; ++ir1) {
+                    ggml_compute_forward_mul_mat_fused(dst, (float *) dst->data + ir1*ne0, 0, ne0);
+                }
+            }
         }
         return;
     }
@@ -10836,6 +12054,12 @@ static void ggml_compute_forward_mul_mat(
                         1.0f,    y, ne10,
                                  x, ne00,
                         0.0f,    d, ne01);
+
+                if (ggml_get_op_params_i32(dst, 0) != 0) {
+                    for (int64_t i1 = 0; i1 < ne1; ++i1) {
+                        ggml_compute_forward_mul_mat_fused(dst, d + i1*ne01, 0, ne01);
+                    }
+                }
             }
         }
 
@@ -10845,10 +12069,52 @@ static void ggml_compute_forward_mul_mat(
     }
 #endif
 
+    const size_t row_size = ne10*GGML_TYPE_SIZE[vec_dot_type]/GGML_BLCK_SIZE[vec_dot_type];
+
+    const int64_t nr0 = ne01;           // src0 rows
+    const int64_t nr1 = ne11*ne12*ne13; // src1 rows
+
+    // the packed GEMM reads src1 as is and needs packing space per thread after the chunk cursors
+    const bool use_gemm = ggml_compute_forward_mul_mat_use_gemm(src0, src1) &&
+        params->wdata && params->wsize >= (nth + 1)*CACHE_LINE_SIZE + nth*GGML_GEMM_WSIZE;
+
+    // after the converted src1, the work buffer holds a barrier for converting it with all threads
+    // and the chunk cursors of the threads, one cache line each
+    const bool   convert    = src1->type != vec_dot_type && !use_gemm;
+    const size_t wsize_src1 = convert ? GGML_PAD(nr1*row_size, CACHE_LINE_SIZE) : 0;
+    const bool   use_steal  = params->wdata && params->wsize >= wsize_src1 + (nth + 1)*CACHE_LINE_SIZE;
+
+    atomic_int * barrier = use_steal ? (atomic_int *) ((char *) params->wdata + wsize_src1) : NULL;
+    char       * next    = use_steal ? (char *) params->wdata + wsize_src1 + CACHE_LINE_SIZE : NULL;
+
+    // an earlier MUL_MAT may have left this src1 converted in the work buffer, otherwise
+    // the threads convert their share of the rows at the start of COMPUTE
+    const bool convert_mt = convert && !params->src1_converted && use_steal && nth > 1 && nr1 > 1;
+
+    const bool use_gemv = nr1 == 1;
+
+    // split the output into chunks: 16x16 blocks (8 row tiles x GGML_GEMM_NC columns for the GEMM,
+    // GGML_GEMV_ROWS rows for a single column) when there are enough of them to balance,
+    // otherwise one chunk per thread along the larger side as before
+    int64_t nchunk0 = use_gemm ? (nr0 + 8*GGML_GEMM_MR - 1)/(8*GGML_GEMM_MR) :
+                      use_gemv ? (nr0 + GGML_GEMV_ROWS - 1)/GGML_GEMV_ROWS : (nr0 + 15)/16;
+    int64_t nchunk1 = use_gemm ? (nr1 + GGML_GEMM_NC   - 1)/GGML_GEMM_NC     : (nr1 + 15)/16;
+
+    if (!use_steal || nchunk0*nchunk1 < 4*nth) {
+        nchunk0 = nr0 > nr1 ? nth : 1;
+        nchunk1 = nr0 > nr1 ? 1 : nth;
+    }
+
+    const int64_t nchunk = nchunk0*nchunk1;
+
+    // with NUMA the threads of each node work on the rows of src0 that ggml_numa_place() put there
+    const bool numa = use_steal && ggml_is_numa() && nth >= (int) g_state.numa.n_nodes;
+
     if (params->type == GGML_TASK_INIT) {
-        if (src1->type != vec_dot_type) {
+        if (convert_mt) {
+            atomic_store(barrier, 0);
+        } else if (convert && !params->src1_converted) {
             char * wdata = params->wdata;
-            const size_t row_size = ne10*GGML_TYPE_SIZE[vec_dot_type]/GGML_BLCK_SIZE[vec_dot_type];
 
             for (int64_t i13 = 0; i13 < ne13; ++i13) {
                 for (int64_t i12 = 0; i12 < ne12; ++i12) {
@@ -10860,6 +12126,17 @@ static void ggml_compute_forward_mul_mat(
             }
         }
 
+        // thread i starts at the beginning of its own contiguous range of chunks
+        if (use_steal) {
+            for (int i = 0; i < nth; ++i) {
+                int64_t start;
+                int64_t end;
+                ggml_compute_forward_mul_mat_range(i, nth, numa, nchunk0, nchunk1, &start, &end);
+
+                atomic_store((atomic_int *) (next + i*CACHE_LINE_SIZE), (int) start);
+            }
+        }
+
         return;
     }
 
@@ -10867,95 +12144,80 @@ static void ggml_compute_forward_mul_mat(
         return;
     }
 
-    const void * wdata    = (src1->type == vec_dot_type) ? src1->data : params->wdata;
-    const size_t row_size = ne10*GGML_TYPE_SIZE[vec_dot_type]/GGML_BLCK_SIZE[vec_dot_type];
-
-    const int64_t nr0 = ne01;           // src0 rows
-    const int64_t nr1 = ne11*ne12*ne13; // src1 rows
-
-    //printf("nr0 = %lld, nr1 = %lld\n", nr0, nr1);
+    if (convert_mt) {
+        for (int64_t ir1 = ith*nr1/nth; ir1 < (ith + 1)*nr1/nth; ++ir1) {
+            const int64_t i13 = (ir1/(ne12*ne11));
+            const int64_t i12 = (ir1 - i13*ne12*ne11)/ne11;
+            const int64_t i11 = (ir1 - i13*ne12*ne11 - i12*ne11);
 
-    // distribute the thread work across the inner or outer loop based on which one is larger
-
-    const int64_t nth0 = nr0 > nr1 ? nth : 1; // parallelize by src0 rows
-    const int64_t nth1 = nr0 > nr1 ? 1 : nth; // parallelize by src1 rows
+            from_float_to_vec_dot((float *)((char *) src1->data + i13*nb13 + i12*nb12 + i11*nb11),
+                    (char *) params->wdata + ir1*row_size, ne10);
+        }
 
-    const int64_t ith0 = ith % nth0;
-    const int64_t ith1 = ith / nth0;
+        // every chunk reads rows converted by other threads
+        atomic_fetch_add(barrier, 1);
+        while (atomic_load(barrier) < nth) {
+            sched_yield();
+        }
+    }
 
-    const int64_t dr0 = (nr0 + nth0 - 1)/nth0;
-    const int64_t dr1 = (nr1 + nth1 - 1)/nth1;
+    const void * wdata = (src1->type == vec_dot_type) ? src1->data : params->wdata;
 
-    const int64_t ir010 = dr0*ith0;
-    const int64_t ir011 = MIN(ir010 + dr0, nr0);
+    const int64_t dr0 = (nr0 + nchunk0 - 1)/nchunk0;
+    const int64_t dr1 = (nr1 + nchunk1 - 1)/nchunk1;
 
-    const int64_t ir110 = dr1*ith1;
-    const int64_t ir111 = MIN(ir110 + dr1, nr1);
+    float * wpack = use_gemm ? (float *) (next + nth*CACHE_LINE_SIZE + ith*GGML_GEMM_WSIZE) : NULL;
 
-    //printf("ir010 = %6lld, ir011 = %6lld, ir110 = %6lld, ir111 = %6lld\n", ir010, ir011, ir110, ir111);
+    if (!use_steal) {
+        // static split, one chunk per thread
+        if (ith < nchunk) {
+            const int64_t ir0 = dr0*(ith % nchunk0);
+            const int64_t ir1 = dr1*(ith / nchunk0);
 
-    // threads with no work simply yield (not sure if it helps)
-    if (ir010 >= ir011 || ir110 >= ir111) {
-        sched_yield();
+            if (use_gemv) {
+                ggml_compute_forward_mul_mat_gemv(src0, dst, wdata, vec_dot, ir0, MIN(ir0 + dr0, nr0));
+            } else {
+                ggml_compute_forward_mul_mat_chunk(src0, src1, dst, wdata, row_size, vec_dot,
+                        ir0, MIN(ir0 + dr0, nr0), ir1, MIN(ir1 + dr1, nr1));
+            }
+        }
         return;
     }
 
-    assert(ne12 % ne02 == 0);
-    assert(ne13 % ne03 == 0);
+    // work through the own range first, then help the other threads, nearest first - with a compact
+    // thread placement the neighbours share the most cache, and an uneven core only delays its own
+    // last chunk instead of a whole 1/nth of the node
+    // with NUMA the threads [th0, th1) of the own node go first, the remote rows only at the end
+    const int th0 = numa ? ggml_numa_first_thread(ggml_numa_node_of(ith, nth),     nth) : 0;
+    const int th1 = numa ? ggml_numa_first_thread(ggml_numa_node_of(ith, nth) + 1, nth) : nth;
 
-    // broadcast factors
-    const int64_t r2 = ne12/ne02;
-    const int64_t r3 = ne13/ne03;
+    for (int v = 0; v < nth; ++v) {
+        const int victim = v < th1 - th0 ? th0 + (ith - th0 + v) % (th1 - th0) : (th0 + v) % nth;
 
-    // block-tiling attempt
-    const int64_t blck_0 = 16;
-    const int64_t blck_1 = 16;
+        atomic_int * cursor = (atomic_int *) (next + victim*CACHE_LINE_SIZE);
 
-    // attempt to reduce false-sharing (does not seem to make a difference)
-    float tmp[16];
+        int64_t start;
+        int64_t end;
+        ggml_compute_forward_mul_mat_range(victim, nth, numa, nchunk0, nchunk1, &start, &end);
 
-    for (int64_t iir1 = ir110; iir1 < ir111; iir1 += blck_1) {
-        for (int64_t iir0 = ir010; iir0 < ir011; iir0 += blck_0) {
-            for (int64_t ir1 = iir1; ir1 < iir1 + blck_1 && ir1 < ir111; ++ir1) {
-                const int64_t i13 = (ir1/(ne12*ne11));
-                const int64_t i12 = (ir1 - i13*ne12*ne11)/ne11;
-                const int64_t i11 = (ir1 - i13*ne12*ne11 - i12*ne11);
+        for (int64_t c = atomic_fetch_add(cursor, 1); c < end; c = atomic_fetch_add(cursor, 1)) {
+            const int64_t ir0 = dr0*(numa ? c / nchunk1 : c % nchunk0);
+            const int64_t ir1 = dr1*(numa ? c % nchunk1 : c / nchunk0);
 
-                // broadcast src0 into src1
-                const int64_t i03 = i13/r3;
-                const int64_t i02 = i12/r2;
+            if (use_gemm) {
+                ggml_compute_forward_mul_mat_gemm_chunk(src0, src1, dst, wpack,
+                        ir0, MIN(ir0 + dr0, nr0), ir1, MIN(ir1 + dr1, nr1));
+            } else if (use_gemv) {
+                ggml_compute_forward_mul_mat_gemv(src0, dst, wdata, vec_dot, ir0, MIN(ir0 + dr0, nr0));
+            } else {
+                ggml_compute_forward_mul_mat_chunk(src0, src1, dst, wdata, row_size, vec_dot,
+                        ir0, MIN(ir0 + dr0, nr0), ir1, MIN(ir1 + dr1, nr1));
+            }
+        }
+    }
+}
 
-                const int64_t i1 = i11;
-                const int64_t i2 = i12;
-                const int64_t i3 = i13;
-
-                const char * src0_row = (const char *) src0->data + (0 + i02*nb02 + i03*nb03);
-
-                // desc: when src1 is not a contiguous memory block we have to calculate the offset using the strides
-                //       if it is, then we have either copied the data to params->wdata and made it contiguous or we are using
-                //       the original src1 data pointer, so we should index using the indices directly
-                // TODO: this is a bit of a hack, we should probably have a better way to handle this
-                const char * src1_col = (const char *) wdata +
-                    (src1_cont || src1->type != vec_dot_type
-                     ? (i11      + i12*ne11 + i13*ne12*ne11)*row_size
-                     : (i11*nb11 + i12*nb12 + i13*nb13));
-
-                float * dst_col = (float *) ((char *) dst->data + (i1*nb1 + i2*nb2 + i3*nb3));
-
-                //for (int64_t ir0 = iir0; ir0 < iir0 + blck_0 && ir0 < ir011; ++ir0) {
-                //    vec_dot(ne00, &dst_col[ir0], src0_row + ir0*nb01, src1_col);
-                //}
-
-                for (int64_t ir0 = iir0; ir0 < iir0 + blck_0 && ir0 < ir011; ++ir0) {
-                    vec_dot(ne00, &tmp[ir0 - iir0], src0_row + ir0*nb01, src1_col);
-                }
-                memcpy(&dst_col[iir0], tmp, (MIN(iir0 + blck_0, ir011) - iir0)*sizeof(float));
-            }
-        }
-    }
-}
-
-// ggml_compute_forward_out_prod
+// ggml_compute_forward_out_prod
 
 static void ggml_compute_forward_out_prod_f32(
         const struct ggml_compute_params * params,
@@ -16408,9 +17670,11 @@ struct ggml_cgraph ggml_build_forward(struct ggml_tensor * tensor) {
         /*.grads        =*/ { NULL },
         /*.leafs        =*/ { NULL },
         /*.hash_table   =*/ { NULL },
-        /*.perf_runs    =*/ 0,
-        /*.perf_cycles  =*/ 0,
-        /*.perf_time_us =*/ 0,
+        /*.perf_runs     =*/ 0,
+        /*.perf_cycles   =*/ 0,
+        /*.perf_time_us  =*/ 0,
+        /*.perf_spin_us  =*/ 0,
+        /*.perf_sleep_us =*/ 0,
     };
 
     ggml_build_forward_impl(&result, tensor, false);
@@ -16467,9 +17731,11 @@ struct ggml_cgraph * ggml_new_graph(struct ggml_context * ctx) {
         /*.grads        =*/ { NULL },
         /*.leafs        =*/ { NULL },
         /*.hash_table   =*/ { NULL },
-        /*.perf_runs    =*/ 0,
-        /*.perf_cycles  =*/ 0,
-        /*.perf_time_us =*/ 0,
+        /*.perf_runs     =*/ 0,
+        /*.perf_cycles   =*/ 0,
+        /*.perf_time_us  =*/ 0,
+        /*.perf_spin_us  =*/ 0,
+        /*.perf_sleep_us =*/ 0,
     };
 
     return cgraph;
@@ -16485,6 +17751,329 @@ size_t ggml_graph_overhead(void) {
     return GGML_OBJECT_SIZE + GGML_PAD(GGML_GRAPH_SIZE, GGML_MEM_ALIGN);
 }
 
+//
+// graph fusion
+//
+// ggml_graph_fuse() folds chains of nodes into the last node of the chain, which then does the
+// work of the whole chain without writing the intermediate results to memory:
+//
+//   norm(x)*w + b          -> NORM    with SCALE and SHIFT
+//   norm(a + b)            -> NORM    with ADD, also writes a + b into the tensor of the add, when
+//                                        the other readers of the sum come after the fused node
+//   act(mul_mat(a, b) + c) -> MUL_MAT with SHIFT and ACT
+//
+// the rows w, b and c can be leafs or single-use repeats of leafs
+//
+
+struct ggml_fuse_state {
+    struct ggml_cgraph * cgraph;
+
+    void ** keys;  // hash table of the nodes
+    int   * index; // node index of keys[i]
+    int   * uses;  // number of times node i is a source of another node
+
+    struct ggml_tensor ** at; // the node that goes to position i in the end, NULL if it is removed
+};
+
+// chain of nodes that will be replaced by its last node
+struct ggml_fuse_chain {
+    struct ggml_tensor * dead[8];
+    int n_dead;
+};
+
+static int ggml_fuse_find(const struct ggml_fuse_state * st, struct ggml_tensor * t) {
+    size_t i = hash(t);
+
+    while (st->keys[i] != NULL) {
+        if (st->keys[i] == t) {
+            return st->index[i];
+        }
+        i = (i + 1) % GGML_GRAPH_HASHTABLE_SIZE;
+    }
+
+    return -1;
+}
+
+// t is a node that is still in place, read by a single other node
+static bool ggml_fuse_single_use(const struct ggml_fuse_state * st, struct ggml_tensor * t) {
+    const int i = ggml_fuse_find(st, t);
+
+    return i >= 0 && st->at[i] == t && st->uses[i] == 1;
+}
+
+// t = op(node, row) or op(row, node), returns the node; row is a single row of weights that
+// every row of t gets, directly or through a single-use repeat
+static struct ggml_tensor * ggml_fuse_binary_row(
+        const struct ggml_fuse_state * st,
+        struct ggml_fuse_chain * chain,
+        struct ggml_tensor * t,
+        enum ggml_op op,
+        struct ggml_tensor ** row) {
+    if (t->op != op) {
+        return NULL;
+    }
+
+    for (int i = 0; i < 2; ++i) {
+        struct ggml_tensor * node = t->src[i];
+        struct ggml_tensor * r    = t->src[1 - i];
+        struct ggml_tensor * w    = r;
+
+        if (!ggml_are_same_shape(node, t) || !ggml_fuse_single_use(st, node)) {
+            continue;
+        }
+
+        if (w->op == GGML_OP_REPEAT && ggml_fuse_single_use(st, w)) {
+            w = w->src[0];
+        }
+
+        if (w->op != GGML_OP_NONE || w->type != GGML_TYPE_F32 || !ggml_is_contiguous(w) ||
+            w->ne[0] != t->ne[0] || ggml_nelements(w) != w->ne[0]) {
+            continue;
+        }
+
+        if (w != r) {
+            chain->dead[chain->n_dead++] = r;
+        }
+        chain->dead[chain->n_dead++] = node;
+
+        *row = w;
+
+        return node;
+    }
+
+    return NULL;
+}
+
+static void ggml_fuse_remove(struct ggml_fuse_state * st, const struct ggml_fuse_chain * chain) {
+    for (int i = 0; i < chain->n_dead; ++i) {
+        st->at[ggml_fuse_find(st, chain->dead[i])] = NULL;
+    }
+}
+
+// node i is the last of norm(x)*w + b, or of norm(x) with x an add
+static bool ggml_fuse_norm(struct ggml_fuse_state * st, int i) {
+    struct ggml_tensor * o = st->cgraph->nodes[i];
+
+    if (o->type != GGML_TYPE_F32 || o->nb[0] != sizeof(float)) {
+        return false;
+    }
+
+    struct ggml_fuse_chain chain = { { NULL }, 0 };
+
+    struct ggml_tensor * w = NULL;
+    struct ggml_tensor * b = NULL;
+
+    struct ggml_tensor * cur  = o;
+    struct ggml_tensor * next = NULL;
+
+    if ((next = ggml_fuse_binary_row(st, &chain, cur, GGML_OP_ADD, &b)) != NULL) {
+        cur = next;
+    }
+    if ((next = ggml_fuse_binary_row(st, &chain, cur, GGML_OP_MUL, &w)) != NULL) {
+        cur = next;
+    }
+
+    if (cur->op != GGML_OP_NORM || ggml_get_op_params_i32(cur, 0) != 0) {
+        return false;
+    }
+
+    // the sum in front of the norm can be computed by the fused node, as long as nobody else reads
+    // it before the fused node runs
+    struct ggml_tensor * x = cur->src[0];
+
+    int ix = -1;
+    if (x->op == GGML_OP_ADD) {
+        ix = ggml_fuse_find(st, x);
+
+        bool ok = ix >= 0 && st->at[ix] == x &&
+            x->type         == GGML_TYPE_F32 && x->nb[0]         == sizeof(float) &&
+            x->src[0]->type == GGML_TYPE_F32 && x->src[0]->nb[0] == sizeof(float) &&
+            x->src[1]->type == GGML_TYPE_F32 && x->src[1]->nb[0] == sizeof(float) &&
+            ggml_are_same_shape(x, x->src[0]) && ggml_are_same_shape(x, x->src[1]);
+
+        for (int j = ix + 1; ok && j < i; ++j) {
+            const struct ggml_tensor * node = st->cgraph->nodes[j];
+            for (int k = 0; k < GGML_MAX_SRC; ++k) {
+                ok = ok && (node == cur || st->at[j] == NULL || node->src[k] != x);
+            }
+        }
+
+        if (!ok) {
+            ix = -1;
+        }
+    }
+
+    if (w == NULL && b == NULL && ix < 0) {
+        return false;
+    }
+
+    struct ggml_tensor * src[GGML_MAX_SRC] = { x };
+    int32_t fused = 0;
+    int n = 1;
+
+    if (ix >= 0) {
+        fused |= GGML_FUSED_ADD;
+        src[n++] = x->src[0];
+        src[n++] = x->src[1];
+    }
+    if (w) {
+        fused |= GGML_FUSED_SCALE;
+        src[n++] = w;
+    }
+    if (b) {
+        fused |= GGML_FUSED_SHIFT;
+        src[n++] = b;
+    }
+
+    o->op = GGML_OP_NORM;
+    memcpy(o->src, src, sizeof(src));
+    memset(o->op_params, 0, sizeof(o->op_params));
+    ggml_set_op_params_i32(o, 0, fused);
+
+    ggml_fuse_remove(st, &chain);
+
+    if (ix >= 0) {
+        st->at[ix] = NULL;
+    }
+
+    return true;
+}
+
+// node i is the last of act(mul_mat(a, b) + c), act(mul_mat(a, b)) or mul_mat(a, b) + c
+static bool ggml_fuse_mul_mat(struct ggml_fuse_state * st, int i) {
+    struct ggml_tensor * u = st->cgraph->nodes[i];
+
+    if (u->type != GGML_TYPE_F32 || !ggml_is_contiguous(u)) {
+        return false;
+    }
+
+    struct ggml_fuse_chain chain = { { NULL }, 0 };
+
+    struct ggml_tensor * c = NULL;
+
+    struct ggml_tensor * cur  = u;
+    struct ggml_tensor * next = NULL;
+
+    int32_t fused = 0;
+
+    if (u->op == GGML_OP_UNARY) {
+        switch (ggml_get_unary_op(u)) {
+            case GGML_UNARY_OP_RELU:
+            case GGML_UNARY_OP_GELU:
+            case GGML_UNARY_OP_GELU_QUICK:
+            case GGML_UNARY_OP_SILU:
+                break;
+            default:
+                return false;
+        }
+
+        cur = u->src[0];
+        if (!ggml_are_same_shape(cur, u) || !ggml_fuse_single_use(st, cur)) {
+            return false;
+        }
+        chain.dead[chain.n_dead++] = cur;
+
+        fused |= GGML_FUSED_ACT;
+    }
+
+    if ((next = ggml_fuse_binary_row(st, &chain, cur, GGML_OP_ADD, &c)) != NULL) {
+        cur = next;
+        fused |= GGML_FUSED_SHIFT;
+    }
+
+    if (cur == u || cur->op != GGML_OP_MUL_MAT || ggml_get_op_params_i32(cur, 0) != 0) {
+        return false;
+    }
+
+    const int32_t act = ggml_get_op_params_i32(u, 0);
+
+    struct ggml_tensor * src[GGML_MAX_SRC] = { cur->src[0], cur->src[1], c };
+
+    u->op = GGML_OP_MUL_MAT;
+    memcpy(u->src, src, sizeof(src));
+    memset(u->op_params, 0, sizeof(u->op_params));
+    ggml_set_op_params_i32(u, 0, fused);
+    ggml_set_op_params_i32(u, 1, act);
+
+    ggml_fuse_remove(st, &chain);
+
+    return true;
+}
+
+int ggml_graph_fuse(struct ggml_cgraph * cgraph) {
+    const int n_nodes = cgraph->n_nodes;
+
+    // the fused nodes have no backward pass
+    for (int i = 0; i < n_nodes; ++i) {
+        if (cgraph->nodes[i]->grad) {
+            return 0;
+        }
+    }
+
+    struct ggml_fuse_state st = {
+        /*.cgraph =*/ cgraph,
+        /*.keys   =*/ calloc(GGML_GRAPH_HASHTABLE_SIZE, sizeof(void *)),
+        /*.index  =*/ malloc(GGML_GRAPH_HASHTABLE_SIZE*sizeof(int)),
+        /*.uses   =*/ calloc(n_nodes + 1, sizeof(int)),
+        /*.at     =*/ malloc((n_nodes + 1)*sizeof(struct ggml_tensor *)),
+    };
+    GGML_ASSERT(st.keys && st.index && st.uses && st.at);
+
+    for (int i = 0; i < n_nodes; ++i) {
+        size_t h = hash(cgraph->nodes[i]);
+        while (st.keys[h] != NULL) {
+            h = (h + 1) % GGML_GRAPH_HASHTABLE_SIZE;
+        }
+        st.keys[h]  = cgraph->nodes[i];
+        st.index[h] = i;
+        st.at[i]    = cgraph->nodes[i];
+    }
+
+    // the second source of a repeat only gives the shape, it is not read
+    for (int i = 0; i < n_nodes; ++i) {
+        const int n_src = cgraph->nodes[i]->op == GGML_OP_REPEAT ? 1 : GGML_MAX_SRC;
+        for (int j = 0; j < n_src; ++j) {
+            struct ggml_tensor * src = cgraph->nodes[i]->src[j];
+            const int k = src ? ggml_fuse_find(&st, src) : -1;
+            if (k >= 0) {
+                st.uses[k]++;
+            }
+        }
+    }
+
+    // from the back, so that a chain is fused as a whole before its parts are looked at
+    int n_fused = 0;
+    for (int i = n_nodes - 1; i >= 0; --i) {
+        if (st.at[i] != cgraph->nodes[i]) {
+            continue;
+        }
+        if (ggml_fuse_norm(&st, i) || ggml_fuse_mul_mat(&st, i)) {
+            n_fused++;
+        }
+    }
+
+    int n = 0;
+    for (int i = 0; i < n_nodes; ++i) {
+        if (st.at[i] != NULL) {
+            cgraph->nodes[n] = st.at[i];
+            cgraph->grads[n] = NULL;
+            n++;
+        }
+    }
+    for (int i = n; i < n_nodes; ++i) {
+        cgraph->nodes[i] = NULL;
+        cgraph->grads[i] = NULL;
+    }
+    cgraph->n_nodes = n;
+
+    free(st.keys);
+    free(st.index);
+    free(st.uses);
+    free(st.at);
+
+    return n_fused;
+}
+
 //
 // thread data
 //
@@ -16548,6 +18137,18 @@ typedef pthread_t ggml_thread_t;
 
 #endif
 
+#if defined(__linux__)
+#include <linux/futex.h>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_AMD64) || defined(_M_IX86)
+#define ggml_cpu_relax() _mm_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define ggml_cpu_relax() __asm__ __volatile__("yield")
+#else
+#define ggml_cpu_relax()
+#endif
+
 // Android's libc implementation "bionic" does not support setting affinity
 #if defined(__linux__) && !defined(__BIONIC__)
 static void set_numa_thread_affinity(int thread_n, int n_threads) {
@@ -16555,9 +18156,7 @@ static void set_numa_thread_affinity(int thread_n, int n_threads) {
         return;
     }
 
-    // run thread on node_num thread_n / (threads per node)
-    const int node_num = thread_n / ((n_threads + g_state.numa.n_nodes - 1) / g_state.numa.n_nodes);
-    struct ggml_numa_node * node = &g_state.numa.nodes[node_num];
+    struct ggml_numa_node * node = &g_state.numa.nodes[ggml_numa_node_of(thread_n, n_threads)];
     size_t setsize = CPU_ALLOC_SIZE(g_state.numa.total_cpus);
 
     cpu_set_t * cpus = CPU_ALLOC(g_state.numa.total_cpus);
@@ -16596,13 +18195,109 @@ static void clear_numa_thread_affinity(void) {
 
     CPU_FREE(cpus);
 }
+
+// pin the calling thread to cpus[0..n_cpus), ggml_thread_restore_affinity() undoes it
+static void ggml_thread_set_cpus(const int * cpus, int n_cpus) {
+    size_t setsize = CPU_ALLOC_SIZE(GGML_NUMA_MAX_CPUS);
+
+    cpu_set_t * set = CPU_ALLOC(GGML_NUMA_MAX_CPUS);
+    CPU_ZERO_S(setsize, set);
+    for (int i = 0; i < n_cpus; ++i) {
+        CPU_SET_S(cpus[i], setsize, set);
+    }
+
+    int rv = pthread_setaffinity_np(pthread_self(), setsize, set);
+    if (rv) {
+        fprintf(stderr, "warning: pthread_setaffinity_np() failed for CPU %d (of %d): %s\n", cpus[0], n_cpus, strerror(rv));
+    }
+
+    CPU_FREE(set);
+}
+
+// the affinity of the calling thread, for ggml_thread_restore_affinity()
+static void * ggml_thread_save_affinity(void) {
+    size_t setsize = CPU_ALLOC_SIZE(GGML_NUMA_MAX_CPUS);
+
+    cpu_set_t * cpus = CPU_ALLOC(GGML_NUMA_MAX_CPUS);
+    if (pthread_getaffinity_np(pthread_self(), setsize, cpus) != 0) {
+        CPU_FREE(cpus);
+        return NULL;
+    }
+
+    return cpus;
+}
+
+// back to the saved affinity, which stays for ggml_thread_free_affinity()
+static void ggml_thread_restore_affinity(void * saved) {
+    if (saved == NULL) {
+        return;
+    }
+
+    int rv = pthread_setaffinity_np(pthread_self(), CPU_ALLOC_SIZE(GGML_NUMA_MAX_CPUS), (cpu_set_t *) saved);
+    if (rv) {
+        fprintf(stderr, "warning: pthread_setaffinity_np() failed: %s\n", strerror(rv));
+    }
+}
+
+static void ggml_thread_free_affinity(void * saved) {
+    if (saved) {
+        CPU_FREE((cpu_set_t *) saved);
+    }
+}
 #else
 // TODO: Windows etc.
 // (the linux implementation may also work on BSD, someone should test)
 static void set_numa_thread_affinity(int thread_n, int n_threads) { UNUSED(thread_n); UNUSED(n_threads);  }
 static void clear_numa_thread_affinity(void) {}
+static void ggml_thread_set_cpus(const int * cpus, int n_cpus) { UNUSED(cpus); UNUSED(n_cpus); }
+static void * ggml_thread_save_affinity(void) { return NULL; }
+static void ggml_thread_restore_affinity(void * saved) { UNUSED(saved); }
+static void ggml_thread_free_affinity(void * saved) { UNUSED(saved); }
 #endif
 
+// thread_cpus of a thread that may run on any of the CPUs of the plan
+#define GGML_THREAD_CPUS_ANY (-2)
+
+// the CPU of each of the n_threads compute threads under the affinity of the plan, -1 for none, and the
+// CPUs of the plan in cpus (GGML_NUMA_MAX_CPUS of them at most), returns their number
+// one thread per CPU: the threads past the CPUs of the plan share all of them, GGML_THREAD_CPUS_ANY, and
+// stay off the CPUs of everyone else
+static int ggml_graph_compute_thread_cpus(const struct ggml_cplan * cplan, int * thread_cpus, int n_threads, int * cpus) {
+    int n_cpus = 0;
+
+    if (cplan->affinity == GGML_AFFINITY_CPUS) {
+        for (int i = 0; i < cplan->n_affinity_cpus && n_cpus < GGML_NUMA_MAX_CPUS; ++i) {
+            if (cplan->affinity_cpus[i] >= 0 && cplan->affinity_cpus[i] < GGML_NUMA_MAX_CPUS) {
+                cpus[n_cpus++] = cplan->affinity_cpus[i];
+            }
+        }
+    } else if (cplan->affinity == GGML_AFFINITY_PHYSICAL) {
+        const int * cand   = cplan->affinity_cpus;
+        int         n_cand = cplan->n_affinity_cpus;
+
+        int all[GGML_NUMA_MAX_CPUS];
+        if (cand == NULL) {
+            n_cand = g_state.topology.n_cpus;
+            for (int c = 0; c < n_cand; ++c) {
+                all[c] = c;
+            }
+            cand = all;
+        }
+
+        // the first n_threads cores are all that is needed
+        n_cpus = ggml_cpu_first_of_cores(cand, n_cand, cpus, MIN(n_threads, GGML_NUMA_MAX_CPUS));
+    }
+
+    for (int i = 0; i < n_threads; ++i) {
+        thread_cpus[i] = i < n_cpus ? cpus[i] : n_cpus > 0 ? GGML_THREAD_CPUS_ANY : -1;
+    }
+
+    return n_cpus;
+}
+
+// max number of nodes that run at the same time
+#define GGML_MAX_WAVE 64
+
 struct ggml_compute_state_shared {
     const struct ggml_cgraph * cgraph;
     const struct ggml_cplan  * cplan;
@@ -16618,12 +18313,157 @@ struct ggml_compute_state_shared {
 
     bool (*abort_callback)(void * data); // abort ggml_graph_compute when true
     void * abort_callback_data;
+
+    // run of independent nodes published as one step, see ggml_graph_compute_find_wave()
+    int        wave_end;                   // one past the last node of the wave, 0 outside of a wave
+    int        wave_n;                     // number of nodes in wave_nodes
+    atomic_int wave_next;                  // next entry of wave_nodes to take, single-task waves only
+    int        wave_nodes[GGML_MAX_WAVE];  // the nodes of the wave that do work
+
+    // threads that gave up spinning on node_n, see ggml_graph_compute_wait()
+    const int  wait_spin_us;
+    atomic_int n_sleeping;
+
+    const int * thread_cpus; // CPU of each thread under cplan->affinity, -1 for none
+    const int * plan_cpus;   // all CPUs of cplan->affinity, for GGML_THREAD_CPUS_ANY
+    const int   n_plan_cpus;
+#if !defined(__linux__)
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+#endif
 };
 
 struct ggml_compute_state {
     ggml_thread_t thrd;
     int ith;
     struct ggml_compute_state_shared * shared;
+    struct ggml_threadpool * pool; // NULL for threads created by ggml_graph_compute()
+
+    int    cpu;      // the thread is pinned to this CPU by the affinity of a plan, -1 if not
+    void * affinity; // of the thread before it was first pinned, NULL until then
+
+    // time spent waiting for the other threads during the last graph
+    int64_t t_spin_us;
+    int64_t t_sleep_us;
+};
+
+// wake up the threads that sleep on node_n, call after changing it
+static void ggml_graph_compute_wake(struct ggml_compute_state_shared * shared) {
+    if (atomic_load(&shared->n_sleeping) > 0) {
+#if defined(__linux__)
+        syscall(SYS_futex, &shared->node_n, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
+#else
+        pthread_mutex_lock(&shared->mutex);
+        pthread_cond_broadcast(&shared->cond);
+        pthread_mutex_unlock(&shared->mutex);
+#endif
+    }
+}
+
+// wait for node_n to move on from last: spin for up to wait_spin_us, then sleep until published
+static int ggml_graph_compute_wait(struct ggml_compute_state * state, int last) {
+    struct ggml_compute_state_shared * shared = state->shared;
+
+    int node_n = atomic_load(&shared->node_n);
+    if (node_n != last) {
+        return node_n;
+    }
+
+    const int wait_spin_us = shared->wait_spin_us;
+
+    const int64_t t_start_us = ggml_time_us();
+    int64_t t_now_us = t_start_us;
+
+    // reading the clock is cheap but not free, look at it every 64 pauses
+    for (int i = 1; ; ++i) {
+        ggml_cpu_relax();
+
+        node_n = atomic_load(&shared->node_n);
+        if (node_n != last) {
+            state->t_spin_us += ggml_time_us() - t_start_us;
+            return node_n;
+        }
+
+        if (wait_spin_us >= 0 && i % 64 == 0) {
+            t_now_us = ggml_time_us();
+            if (t_now_us - t_start_us >= wait_spin_us) {
+                break;
+            }
+        }
+    }
+
+    state->t_spin_us += t_now_us - t_start_us;
+
+    // n_sleeping goes up before node_n is checked again, and the publisher stores node_n before
+    // it looks at n_sleeping, so either we see the new node or the publisher sees us
+    atomic_fetch_add(&shared->n_sleeping, 1);
+
+#if defined(__linux__)
+    while ((node_n = atomic_load(&shared->node_n)) == last) {
+        syscall(SYS_futex, &shared->node_n, FUTEX_WAIT_PRIVATE, last, NULL, NULL, 0);
+    }
+#else
+    pthread_mutex_lock(&shared->mutex);
+    while ((node_n = atomic_load(&shared->node_n)) == last) {
+        pthread_cond_wait(&shared->cond, &shared->mutex);
+    }
+    pthread_mutex_unlock(&shared->mutex);
+#endif
+
+    atomic_fetch_sub(&shared->n_sleeping, 1);
+
+    state->t_sleep_us += ggml_time_us() - t_now_us;
+
+    return node_n;
+}
+
+//
+// persistent compute threads
+//
+// the workers sleep on cond_work between graphs, ggml_graph_compute() publishes a graph by
+// bumping the generation and waits on cond_done until all of its workers are through
+//
+
+struct ggml_threadpool {
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond_work; // new graph or stop
+    pthread_cond_t  cond_done; // workers finished or the pool became free
+
+    int n_threads;  // including the thread calling ggml_graph_compute()
+    int n_active;   // threads taking part in the current graph
+    int n_pending;  // workers of the current graph that are not through yet
+    unsigned generation; // bumped for every graph, wraps around - only compared for equality
+
+    bool busy;      // a graph is running on the pool
+    bool stop;
+
+    struct ggml_compute_state * workers; // [0] is unused, the caller brings its own
+
+    // graphs of ggml_graph_compute_async(), computed in order by the driver thread, which takes the part of the caller
+    pthread_cond_t cond_jobs;   // a graph was queued or stop
+    pthread_cond_t cond_future; // a queued graph is done
+
+    struct ggml_compute_future * jobs;      // the running graph, then the ones waiting
+    struct ggml_compute_future * jobs_tail;
+
+    ggml_thread_t driver;
+    bool          has_driver; // started by the first ggml_graph_compute_async()
+
+    size_t task_min_bytes; // of the graphs planned for this pool, 0 for the process default
+};
+
+struct ggml_compute_future {
+    struct ggml_cgraph * cgraph;
+    struct ggml_cplan    cplan;
+
+    void (*callback)(void * data, int status);
+    void * callback_data;
+
+    struct ggml_threadpool     * pool;
+    struct ggml_compute_future * next;
+
+    int  status;
+    bool done;
 };
 
 static void ggml_graph_compute_perf_stats_node(struct ggml_tensor * node, const struct ggml_compute_state_shared * st) {
@@ -16635,6 +18475,249 @@ static void ggml_graph_compute_perf_stats_node(struct ggml_tensor * node, const
     node->perf_time_us += time_us_cur;
 }
 
+//
+// concurrent nodes
+//
+// a wave is a run of consecutive nodes with no data hazards between them, published to the
+// threads as one step: either single-task nodes that the threads take one by one, or up to
+// n_threads/2 multi-task nodes, each run by its own group of threads
+//
+
+// nodes that only move or reinterpret data, nothing to compute
+static bool ggml_op_is_noop(enum ggml_op op) {
+    switch (op) {
+        case GGML_OP_NONE:
+        case GGML_OP_RESHAPE:
+        case GGML_OP_VIEW:
+        case GGML_OP_PERMUTE:
+        case GGML_OP_TRANSPOSE:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// ops that can run next to other nodes: they do not use the shared work buffer
+static bool ggml_node_can_overlap(const struct ggml_tensor * node) {
+    switch (node->op) {
+        case GGML_OP_ADD:
+        case GGML_OP_ADD1:
+            return !ggml_is_quantized(node->src[0]->type);
+        case GGML_OP_DUP:
+        case GGML_OP_CPY:
+            return !(node->src[0]->type == GGML_TYPE_F16 && ggml_is_quantized(node->type));
+        case GGML_OP_NORM:
+            // a norm with a fused add also writes its first source
+            return !(ggml_get_op_params_i32(node, 0) & GGML_FUSED_ADD);
+        case GGML_OP_ACC:
+        case GGML_OP_SUB:
+        case GGML_OP_MUL:
+        case GGML_OP_DIV:
+        case GGML_OP_SQR:
+        case GGML_OP_SQRT:
+        case GGML_OP_LOG:
+        case GGML_OP_SUM:
+        case GGML_OP_SUM_ROWS:
+        case GGML_OP_MEAN:
+        case GGML_OP_ARGMAX:
+        case GGML_OP_REPEAT:
+        case GGML_OP_REPEAT_BACK:
+        case GGML_OP_RMS_NORM:
+        case GGML_OP_SCALE:
+        case GGML_OP_SET:
+        case GGML_OP_CONT:
+        case GGML_OP_GET_ROWS:
+        case GGML_OP_DIAG:
+        case GGML_OP_DIAG_MASK_INF:
+        case GGML_OP_DIAG_MASK_ZERO:
+        case GGML_OP_SOFT_MAX:
+        case GGML_OP_ROPE:
+        case GGML_OP_ALIBI:
+        case GGML_OP_CLAMP:
+        case GGML_OP_POOL_1D:
+        case GGML_OP_POOL_2D:
+        case GGML_OP_WIN_PART:
+        case GGML_OP_WIN_UNPART:
+        case GGML_OP_GET_REL_POS:
+        case GGML_OP_UNARY:
+            return true;
+        default:
+            return false;
+    }
+}
+
+// the bytes between the first and one past the last element of a tensor
+static bool ggml_tensors_overlap(const struct ggml_tensor * a, const struct ggml_tensor * b) {
+    if (a->data == NULL || b->data == NULL) {
+        return true;
+    }
+
+    if (ggml_nelements(a) == 0 || ggml_nelements(b) == 0) {
+        return false;
+    }
+
+    size_t size_a = ggml_nbytes_split(a, 1);
+    size_t size_b = ggml_nbytes_split(b, 1);
+    for (int i = 1; i < GGML_MAX_DIMS; ++i) {
+        size_a += (a->ne[i] - 1)*a->nb[i];
+        size_b += (b->ne[i] - 1)*b->nb[i];
+    }
+
+    const char * begin_a = (const char *) a->data;
+    const char * begin_b = (const char *) b->data;
+
+    return begin_a < begin_b + size_b && begin_b < begin_a + size_a;
+}
+
+// b comes after a in the graph, can they run at the same time?
+static bool ggml_nodes_independent(const struct ggml_tensor * a, const struct ggml_tensor * b) {
+    if (ggml_tensors_overlap(a, b)) {
+        return false;
+    }
+
+    for (int i = 0; i < GGML_MAX_SRC; ++i) {
+        if (b->src[i] && ggml_tensors_overlap(b->src[i], a)) {
+            return false;
+        }
+        if (a->src[i] && ggml_tensors_overlap(a->src[i], b)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// look for a wave starting at node_n, returns its end or 0 if there is nothing to run concurrently
+static int ggml_graph_compute_find_wave(struct ggml_compute_state_shared * shared, int node_n) {
+    const struct ggml_cgraph * cgraph = shared->cgraph;
+
+    const int * n_tasks_arr = shared->cplan->n_tasks;
+    const int   n_threads   = shared->n_threads;
+
+    int n = 0;
+    int end = node_n;
+    int n_tasks_wave = 0;
+
+    for (int i = node_n; i < cgraph->n_nodes; ++i) {
+        struct ggml_tensor * node = cgraph->nodes[i];
+
+        if (ggml_op_is_noop(node->op)) {
+            end = i + 1;
+            continue;
+        }
+
+        if (n == GGML_MAX_WAVE || !ggml_node_can_overlap(node)) {
+            break;
+        }
+
+        // either all nodes are single-task, or all have the same number of tasks and no extra passes
+        const int n_tasks = n_tasks_arr[i];
+        if (n == 0) {
+            n_tasks_wave = n_tasks;
+        } else if (n_tasks != n_tasks_wave) {
+            break;
+        }
+
+        if (n_tasks > 1 && (GGML_OP_HAS_INIT[node->op] || GGML_OP_HAS_FINALIZE[node->op] || 2*(n + 1) > n_threads)) {
+            break;
+        }
+
+        bool independent = true;
+        for (int j = 0; j < n && independent; ++j) {
+            independent = ggml_nodes_independent(cgraph->nodes[shared->wave_nodes[j]], node);
+        }
+        if (!independent) {
+            break;
+        }
+
+        shared->wave_nodes[n++] = i;
+        end = i + 1;
+    }
+
+    if (n < 2) {
+        return 0;
+    }
+
+    shared->wave_n = n;
+    atomic_store(&shared->wave_next, 0);
+
+    return end;
+}
+
+// the part of the wave of this thread
+static void ggml_graph_compute_wave(struct ggml_compute_state * state) {
+    struct ggml_compute_state_shared * shared = state->shared;
+
+    const struct ggml_cgraph * cgraph = shared->cgraph;
+    const struct ggml_cplan  * cplan  = shared->cplan;
+
+    const int * n_tasks_arr = cplan->n_tasks;
+    const int   n_threads   = shared->n_threads;
+    const int   n           = shared->wave_n;
+
+    struct ggml_compute_params params = {
+        /*.type           =*/ GGML_TASK_COMPUTE,
+        /*.ith            =*/ 0,
+        /*.nth            =*/ 1,
+        /*.wsize          =*/ cplan->work_size,
+        /*.wdata          =*/ cplan->work_data,
+        /*.src1_converted =*/ false,
+    };
+
+    if (n_tasks_arr[shared->wave_nodes[0]] == 1) {
+        // single-task nodes go to whichever thread is free
+        for (int i = atomic_fetch_add(&shared->wave_next, 1); i < n; i = atomic_fetch_add(&shared->wave_next, 1)) {
+            struct ggml_tensor * node = cgraph->nodes[shared->wave_nodes[i]];
+
+            const int64_t perf_start_cycles  = ggml_perf_cycles();
+            const int64_t perf_start_time_us = ggml_perf_time_us();
+
+            if (GGML_OP_HAS_INIT[node->op]) {
+                params.type = GGML_TASK_INIT;
+                ggml_compute_forward(&params, node);
+            }
+
+            params.type = GGML_TASK_COMPUTE;
+            ggml_compute_forward(&params, node);
+
+            if (GGML_OP_HAS_FINALIZE[node->op]) {
+                params.type = GGML_TASK_FINALIZE;
+                ggml_compute_forward(&params, node);
+            }
+
+            node->perf_runs++;
+            node->perf_cycles  += ggml_perf_cycles()  - perf_start_cycles;
+            node->perf_time_us += ggml_perf_time_us() - perf_start_time_us;
+        }
+    } else {
+        // thread ith works on node ith % n, together with the other threads of the same residue
+        const int i = state->ith % n;
+        const int node_i = shared->wave_nodes[i];
+
+        params.ith = state->ith / n;
+        params.nth = MIN((n_threads - i + n - 1)/n, n_tasks_arr[node_i]);
+
+        if (params.ith < params.nth) {
+            ggml_compute_forward(&params, cgraph->nodes[node_i]);
+        }
+    }
+}
+
+// called by the last thread out of a wave
+static void ggml_graph_compute_wave_done(struct ggml_compute_state_shared * shared, int node_n) {
+    const struct ggml_cgraph * cgraph = shared->cgraph;
+
+    // single-task nodes have their own stats, multi-task nodes share the time of the wave
+    const bool single = shared->cplan->n_tasks[shared->wave_nodes[0]] == 1;
+
+    for (int i = node_n; i < shared->wave_end; ++i) {
+        struct ggml_tensor * node = cgraph->nodes[i];
+        if (!single || ggml_op_is_noop(node->op)) {
+            ggml_graph_compute_perf_stats_node(node, shared);
+        }
+    }
+}
+
 static thread_ret_t ggml_graph_compute_thread(void * data) {
     struct ggml_compute_state * state = (struct ggml_compute_state *) data;
 
@@ -16644,27 +18727,58 @@ static thread_ret_t ggml_graph_compute_thread(void * data) {
     const int * n_tasks_arr = cplan->n_tasks;
     const int   n_threads   = state->shared->n_threads;
 
-    set_numa_thread_affinity(state->ith, n_threads);
+    // persistent threads stay pinned from the last graph when the CPU is the same - the CPUs of
+    // the plan can change from graph to graph - and go back to the affinity they had before,
+    // not to all CPUs, when unpinned
+    const int cpu = state->shared->thread_cpus[state->ith];
+    if (cpu != state->cpu || cpu == GGML_THREAD_CPUS_ANY) {
+        if (cpu != -1) {
+            if (state->affinity == NULL) {
+                state->affinity = ggml_thread_save_affinity();
+            }
+            if (cpu >= 0) {
+                ggml_thread_set_cpus(&cpu, 1);
+            } else {
+                ggml_thread_set_cpus(state->shared->plan_cpus, state->shared->n_plan_cpus);
+            }
+        } else {
+            ggml_thread_restore_affinity(state->affinity);
+        }
+        state->cpu = cpu;
+    }
+    if (cpu == -1) {
+        set_numa_thread_affinity(state->ith, n_threads);
+    }
+
+    state->t_spin_us  = 0;
+    state->t_sleep_us = 0;
 
     int node_n = -1;
 
     while (true) {
         if (cplan->abort_callback && cplan->abort_callback(cplan->abort_callback_data)) {
-            state->shared->node_n += 1;
+            atomic_fetch_add(&state->shared->node_n, 1);
+            ggml_graph_compute_wake(state->shared);
             return (thread_ret_t) GGML_EXIT_ABORTED;
         }
         if (atomic_fetch_sub(&state->shared->n_active, 1) == 1) {
             // all other threads are finished and spinning
             // do finalize and init here so we don't have synchronize again
             struct ggml_compute_params params = {
-                /*.type  =*/ GGML_TASK_FINALIZE,
-                /*.ith   =*/ 0,
-                /*.nth   =*/ 0,
-                /*.wsize =*/ cplan->work_size,
-                /*.wdata =*/ cplan->work_data,
+                /*.type           =*/ GGML_TASK_FINALIZE,
+                /*.ith            =*/ 0,
+                /*.nth            =*/ 0,
+                /*.wsize          =*/ cplan->work_size,
+                /*.wdata          =*/ cplan->work_data,
+                /*.src1_converted =*/ false,
             };
 
-            if (node_n != -1) {
+            if (node_n != -1 && state->shared->wave_end > 0) {
+                // the wave is done, carry on after it
+                ggml_graph_compute_wave_done(state->shared, node_n);
+                node_n = state->shared->wave_end - 1;
+                state->shared->wave_end = 0;
+            } else if (node_n != -1) {
                 /* FINALIZE */
                 struct ggml_tensor * node = state->shared->cgraph->nodes[node_n];
                 if (GGML_OP_HAS_FINALIZE[node->op]) {
@@ -16678,89 +18792,340 @@ static thread_ret_t ggml_graph_compute_thread(void * data) {
             while (++node_n < cgraph->n_nodes) {
                 GGML_PRINT_DEBUG_5("%s: %d/%d\n", __func__, node_n, cgraph->n_nodes);
 
-                struct ggml_tensor * node = cgraph->nodes[node_n];
-                const int n_tasks = n_tasks_arr[node_n];
+                struct ggml_tensor * node = cgraph->nodes[node_n];
+                const int n_tasks = n_tasks_arr[node_n];
+
+                state->shared->perf_node_start_cycles  = ggml_perf_cycles();
+                state->shared->perf_node_start_time_us = ggml_perf_time_us();
+
+                if (n_threads > 1 && cplan->concurrent_nodes) {
+                    const int wave_end = ggml_graph_compute_find_wave(state->shared, node_n);
+                    if (wave_end > 0) {
+                        state->shared->wave_end = wave_end;
+                        break;
+                    }
+                }
+
+                params.nth = n_tasks;
+                params.src1_converted = cplan->src1_converted[node_n];
+
+                /* INIT */
+                if (GGML_OP_HAS_INIT[node->op]) {
+                    params.type = GGML_TASK_INIT;
+                    ggml_compute_forward(&params, node);
+                }
+
+                if (n_tasks == 1) {
+                    // TODO: maybe push node_n to the atomic but if other threads see n_tasks is 1,
+                    // they do something more efficient than spinning (?)
+                    params.type = GGML_TASK_COMPUTE;
+                    ggml_compute_forward(&params, node);
+
+                    if (GGML_OP_HAS_FINALIZE[node->op]) {
+                        params.type = GGML_TASK_FINALIZE;
+                        ggml_compute_forward(&params, node);
+                    }
+
+                    ggml_graph_compute_perf_stats_node(node, state->shared);
+                } else {
+                    break;
+                }
+
+                if (cplan->abort_callback && cplan->abort_callback(cplan->abort_callback_data)) {
+                    break;
+                }
+            }
+
+            atomic_store(&state->shared->n_active, n_threads);
+            atomic_store(&state->shared->node_n, node_n);
+            ggml_graph_compute_wake(state->shared);
+        } else {
+            // wait for other threads to finish
+            node_n = ggml_graph_compute_wait(state, node_n);
+        }
+
+        // check if we should stop
+        if (node_n >= cgraph->n_nodes) break;
+
+        if (state->shared->wave_end > node_n) {
+            ggml_graph_compute_wave(state);
+            continue;
+        }
+
+        /* COMPUTE */
+        struct ggml_tensor * node = cgraph->nodes[node_n];
+        const int n_tasks = n_tasks_arr[node_n];
+
+        struct ggml_compute_params params = {
+            /*.type           =*/ GGML_TASK_COMPUTE,
+            /*.ith            =*/ state->ith,
+            /*.nth            =*/ n_tasks,
+            /*.wsize          =*/ cplan->work_size,
+            /*.wdata          =*/ cplan->work_data,
+            /*.src1_converted =*/ cplan->src1_converted[node_n],
+        };
+
+        if (state->ith < n_tasks) {
+            ggml_compute_forward(&params, node);
+        }
+    }
+
+    return GGML_EXIT_SUCCESS;
+}
+
+static thread_ret_t ggml_threadpool_thread(void * data) {
+    struct ggml_compute_state * state = (struct ggml_compute_state *) data;
+    struct ggml_threadpool    * pool  = state->pool;
+
+    unsigned generation = 0;
+
+    pthread_mutex_lock(&pool->mutex);
+
+    while (true) {
+        while (pool->generation == generation && !pool->stop) {
+            pthread_cond_wait(&pool->cond_work, &pool->mutex);
+        }
+
+        if (pool->stop) {
+            break;
+        }
+
+        generation = pool->generation;
+
+        if (state->ith >= pool->n_active) {
+            continue;
+        }
+
+        pthread_mutex_unlock(&pool->mutex);
+
+        ggml_graph_compute_thread(state);
+
+        pthread_mutex_lock(&pool->mutex);
+
+        if (--pool->n_pending == 0) {
+            pthread_cond_broadcast(&pool->cond_done);
+        }
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+
+    return 0;
+}
+
+struct ggml_threadpool * ggml_threadpool_new(int n_threads) {
+    if (n_threads <= 0) {
+        n_threads = GGML_DEFAULT_N_THREADS;
+    }
+
+    struct ggml_threadpool * pool = malloc(sizeof(struct ggml_threadpool));
+    GGML_ASSERT(pool);
+
+    pthread_mutex_init(&pool->mutex,     NULL);
+    pthread_cond_init (&pool->cond_work, NULL);
+    pthread_cond_init (&pool->cond_done, NULL);
+    pthread_cond_init (&pool->cond_jobs, NULL);
+    pthread_cond_init (&pool->cond_future, NULL);
+
+    pool->jobs       = NULL;
+    pool->jobs_tail  = NULL;
+    pool->has_driver = false;
+
+    pool->task_min_bytes = 0;
+
+    pool->n_threads  = n_threads;
+    pool->n_active   = 0;
+    pool->n_pending  = 0;
+    pool->generation = 0;
+    pool->busy       = false;
+    pool->stop       = false;
+    pool->workers    = malloc(sizeof(struct ggml_compute_state)*n_threads);
+    GGML_ASSERT(pool->workers);
+
+    for (int j = 1; j < n_threads; ++j) {
+        pool->workers[j] = (struct ggml_compute_state) {
+            .thrd   = 0,
+            .ith    = j,
+            .shared = NULL,
+            .pool     = pool,
+            .cpu      = -1,
+            .affinity = NULL,
+        };
+
+        const int rc = ggml_thread_create(&pool->workers[j].thrd, NULL, ggml_threadpool_thread, &pool->workers[j]);
+        GGML_ASSERT(rc == 0);
+        UNUSED(rc);
+    }
+
+    return pool;
+}
+
+void ggml_threadpool_free(struct ggml_threadpool * pool) {
+    if (pool == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&pool->mutex);
+
+    // the queued graphs still need the workers
+    while (pool->jobs) {
+        pthread_cond_wait(&pool->cond_future, &pool->mutex);
+    }
+
+    pool->stop = true;
+    pthread_cond_broadcast(&pool->cond_work);
+    pthread_cond_broadcast(&pool->cond_jobs);
+    pthread_mutex_unlock(&pool->mutex);
+
+    for (int j = 1; j < pool->n_threads; ++j) {
+        const int rc = ggml_thread_join(pool->workers[j].thrd, NULL);
+        GGML_ASSERT(rc == 0);
+        UNUSED(rc);
+
+        ggml_thread_free_affinity(pool->workers[j].affinity);
+    }
+
+    if (pool->has_driver) {
+        const int rc = ggml_thread_join(pool->driver, NULL);
+        GGML_ASSERT(rc == 0);
+        UNUSED(rc);
+    }
+
+    pthread_cond_destroy (&pool->cond_future);
+    pthread_cond_destroy (&pool->cond_jobs);
+    pthread_cond_destroy (&pool->cond_done);
+    pthread_cond_destroy (&pool->cond_work);
+    pthread_mutex_destroy(&pool->mutex);
+
+    free(pool->workers);
+    free(pool);
+}
+
+int ggml_threadpool_n_threads(const struct ggml_threadpool * pool) {
+    return pool->n_threads;
+}
+
+// hand the graph to the first n_threads - 1 workers of the pool, waits if another graph is running
+static void ggml_threadpool_start(struct ggml_threadpool * pool, struct ggml_compute_state_shared * shared, int n_threads) {
+    GGML_ASSERT(n_threads <= pool->n_threads);
+
+    pthread_mutex_lock(&pool->mutex);
+
+    while (pool->busy) {
+        pthread_cond_wait(&pool->cond_done, &pool->mutex);
+    }
+
+    for (int j = 1; j < n_threads; ++j) {
+        pool->workers[j].shared = shared;
+    }
 
-                state->shared->perf_node_start_cycles  = ggml_perf_cycles();
-                state->shared->perf_node_start_time_us = ggml_perf_time_us();
+    pool->busy      = true;
+    pool->n_active  = n_threads;
+    pool->n_pending = n_threads - 1;
+    pool->generation++;
 
-                params.nth = n_tasks;
+    pthread_cond_broadcast(&pool->cond_work);
+    pthread_mutex_unlock(&pool->mutex);
+}
 
-                /* INIT */
-                if (GGML_OP_HAS_INIT[node->op]) {
-                    params.type = GGML_TASK_INIT;
-                    ggml_compute_forward(&params, node);
-                }
+static void ggml_threadpool_finish(struct ggml_threadpool * pool) {
+    pthread_mutex_lock(&pool->mutex);
 
-                if (n_tasks == 1) {
-                    // TODO: maybe push node_n to the atomic but if other threads see n_tasks is 1,
-                    // they do something more efficient than spinning (?)
-                    params.type = GGML_TASK_COMPUTE;
-                    ggml_compute_forward(&params, node);
+    while (pool->n_pending > 0) {
+        pthread_cond_wait(&pool->cond_done, &pool->mutex);
+    }
 
-                    if (GGML_OP_HAS_FINALIZE[node->op]) {
-                        params.type = GGML_TASK_FINALIZE;
-                        ggml_compute_forward(&params, node);
-                    }
+    pool->busy = false;
 
-                    ggml_graph_compute_perf_stats_node(node, state->shared);
-                } else {
-                    break;
-                }
+    pthread_cond_broadcast(&pool->cond_done);
+    pthread_mutex_unlock(&pool->mutex);
+}
 
-                if (cplan->abort_callback && cplan->abort_callback(cplan->abort_callback_data)) {
-                    break;
-                }
-            }
+// the process default, threadpools can have their own
+static atomic_int g_task_min_bytes = GGML_DEFAULT_TASK_MIN_BYTES;
 
-            atomic_store(&state->shared->n_active, n_threads);
-            atomic_store(&state->shared->node_n,   node_n);
-        } else {
-            // wait for other threads to finish
-            const int last = node_n;
-            do {
-                //sched_yield();
-                node_n = atomic_load(&state->shared->node_n);
-            } while (node_n == last);
-        }
+void ggml_set_task_min_bytes(size_t task_min_bytes) {
+    atomic_store(&g_task_min_bytes, (int) MIN(MAX(task_min_bytes, 1), (size_t) INT_MAX));
+}
 
-        // check if we should stop
-        if (node_n >= cgraph->n_nodes) break;
+size_t ggml_get_task_min_bytes(void) {
+    return (size_t) atomic_load(&g_task_min_bytes);
+}
 
-        /* COMPUTE */
-        struct ggml_tensor * node = cgraph->nodes[node_n];
-        const int n_tasks = n_tasks_arr[node_n];
+void ggml_threadpool_set_task_min_bytes(struct ggml_threadpool * pool, size_t task_min_bytes) {
+    pool->task_min_bytes = task_min_bytes;
+}
 
-        struct ggml_compute_params params = {
-            /*.type  =*/ GGML_TASK_COMPUTE,
-            /*.ith   =*/ state->ith,
-            /*.nth   =*/ n_tasks,
-            /*.wsize =*/ cplan->work_size,
-            /*.wdata =*/ cplan->work_data,
-        };
+size_t ggml_threadpool_get_task_min_bytes(const struct ggml_threadpool * pool) {
+    return pool && pool->task_min_bytes > 0 ? pool->task_min_bytes : ggml_get_task_min_bytes();
+}
 
-        if (state->ith < n_tasks) {
-            ggml_compute_forward(&params, node);
+// the work of a node in bytes moved, 0 for the ops that keep the n_tasks of their case in ggml_graph_plan
+static size_t ggml_graph_plan_node_cost(const struct ggml_tensor * node) {
+    size_t bytes = ggml_nbytes(node);
+    for (int j = 0; j < GGML_MAX_SRC; ++j) {
+        if (node->src[j]) {
+            bytes += ggml_nbytes(node->src[j]);
         }
     }
 
-    return GGML_EXIT_SUCCESS;
+    switch (node->op) {
+        case GGML_OP_CPY:
+        case GGML_OP_DUP:
+        case GGML_OP_ADD:
+        case GGML_OP_ADD1:
+        case GGML_OP_ACC:
+        case GGML_OP_MUL:
+        case GGML_OP_DIV:
+        case GGML_OP_DIAG_MASK_ZERO:
+        case GGML_OP_DIAG_MASK_INF:
+        case GGML_OP_ADD_REL_POS:
+            return bytes;
+        // two passes over each row, or a function per element
+        case GGML_OP_NORM:
+        case GGML_OP_RMS_NORM:
+        case GGML_OP_RMS_NORM_BACK:
+        case GGML_OP_SILU_BACK:
+        case GGML_OP_UNARY:
+            return 2*bytes;
+        case GGML_OP_SOFT_MAX:
+        case GGML_OP_SOFT_MAX_BACK:
+        case GGML_OP_ROPE:
+        case GGML_OP_ROPE_BACK:
+            return 4*bytes;
+        case GGML_OP_MUL_MAT:
+            // with NUMA the rows of src0 are placed for the threads of all nodes
+            if (ggml_is_numa()) {
+                return 0;
+            }
+            // and a multiply-add per element of src0 and column of src1, about 8 of them per byte moved
+            return bytes + (size_t) ggml_nelements(node)*node->src[0]->ne[0]/8;
+        default:
+            return 0;
+    }
 }
 
-struct ggml_cplan ggml_graph_plan(struct ggml_cgraph * cgraph, int n_threads) {
+struct ggml_cplan ggml_graph_plan_pool(struct ggml_cgraph * cgraph, int n_threads, struct ggml_threadpool * pool) {
     if (n_threads <= 0) {
         n_threads = GGML_DEFAULT_N_THREADS;
     }
 
     size_t work_size = 0;
 
+    const size_t task_min_bytes = ggml_threadpool_get_task_min_bytes(pool);
+
     struct ggml_cplan cplan;
     memset(&cplan, 0, sizeof(struct ggml_cplan));
 
+    // the src1 that the last node using the work buffer converted into it, if any
+    const struct ggml_tensor * converted      = NULL;
+    enum ggml_type             converted_type = GGML_TYPE_COUNT;
+
     // thread scheduling for the different operations + work buffer size estimation
     for (int i = 0; i < cgraph->n_nodes; i++) {
         int n_tasks = 1;
 
+        bool converts_src1 = false;
+
         struct ggml_tensor * node = cgraph->nodes[i];
 
         switch (node->op) {
@@ -16802,7 +19167,6 @@ struct ggml_cplan ggml_graph_plan(struct ggml_cgraph * cgraph, int n_threads) {
                     work_size = MAX(work_size, cur);
                 } break;
             case GGML_OP_SUB:
-            case GGML_OP_DIV:
             case GGML_OP_SQR:
             case GGML_OP_SQRT:
             case GGML_OP_LOG:
@@ -16840,6 +19204,7 @@ struct ggml_cplan ggml_graph_plan(struct ggml_cgraph * cgraph, int n_threads) {
                 } break;
             case GGML_OP_SILU_BACK:
             case GGML_OP_MUL:
+            case GGML_OP_DIV:
             case GGML_OP_NORM:
             case GGML_OP_RMS_NORM:
             case GGML_OP_RMS_NORM_BACK:
@@ -16883,10 +19248,19 @@ struct ggml_cplan ggml_graph_plan(struct ggml_cgraph * cgraph, int n_threads) {
                         }
                     } else
 #endif
-                    if (node->src[1]->type != vec_dot_type) {
-                        cur = GGML_TYPE_SIZE[vec_dot_type]*ggml_nelements(node->src[1])/GGML_BLCK_SIZE[vec_dot_type];
+                    if (node->op == GGML_OP_MUL_MAT && ggml_compute_forward_mul_mat_use_gemm(node->src[0], node->src[1])) {
+                        // barrier, chunk cursors and packing space for the GEMM, src1 is not converted
+                        cur = CACHE_LINE_SIZE*(n_tasks + 1) + GGML_GEMM_WSIZE*n_tasks;
                     } else {
-                        cur = 0;
+                        if (node->src[1]->type != vec_dot_type) {
+                            cur = GGML_PAD(GGML_TYPE_SIZE[vec_dot_type]*ggml_nelements(node->src[1])/GGML_BLCK_SIZE[vec_dot_type], CACHE_LINE_SIZE);
+                            converts_src1 = node->op == GGML_OP_MUL_MAT;
+                        }
+
+                        // conversion barrier and chunk cursors for ggml_compute_forward_mul_mat, one cache line each
+                        if (node->op == GGML_OP_MUL_MAT) {
+                            cur += CACHE_LINE_SIZE*(n_tasks + 1);
+                        }
                     }
 
                     work_size = MAX(work_size, cur);
@@ -17137,7 +19511,27 @@ struct ggml_cplan ggml_graph_plan(struct ggml_cgraph * cgraph, int n_threads) {
                 } break;
         }
 
+        // a node too small for all threads runs on fewer of them, a node of one task does not wake the others
+        const size_t cost = ggml_graph_plan_node_cost(node);
+        if (cost > 0 && n_tasks > 1) {
+            n_tasks = (int) MIN((size_t) n_tasks, MAX(cost/task_min_bytes, 1));
+        }
+
         cplan.n_tasks[i] = n_tasks;
+
+        // a MUL_MAT of the same src1 as the last node that used the work buffer finds it still converted there,
+        // unless a node in between wrote to src1
+        if (converts_src1) {
+            const enum ggml_type vec_dot_type = type_traits[node->src[0]->type].vec_dot_type;
+
+            cplan.src1_converted[i] = converted == node->src[1] && converted_type == vec_dot_type;
+
+            converted      = node->src[1];
+            converted_type = vec_dot_type;
+        } else if (converted && !ggml_op_is_noop(node->op) &&
+                   (!ggml_node_can_overlap(node) || ggml_tensors_overlap(node, converted))) {
+            converted = NULL;
+        }
     }
 
     if (work_size > 0) {
@@ -17145,12 +19539,19 @@ struct ggml_cplan ggml_graph_plan(struct ggml_cgraph * cgraph, int n_threads) {
     }
 
     cplan.n_threads = n_threads;
+    cplan.wait_spin_us = GGML_DEFAULT_WAIT_SPIN_US;
+    cplan.concurrent_nodes = true;
     cplan.work_size = work_size;
     cplan.work_data = NULL;
+    cplan.threadpool = pool;
 
     return cplan;
 }
 
+struct ggml_cplan ggml_graph_plan(struct ggml_cgraph * cgraph, int n_threads) {
+    return ggml_graph_plan_pool(cgraph, n_threads, NULL);
+}
+
 int ggml_graph_compute(struct ggml_cgraph * cgraph, struct ggml_cplan * cplan) {
     {
         GGML_ASSERT(cplan);
@@ -17169,6 +19570,11 @@ int ggml_graph_compute(struct ggml_cgraph * cgraph, struct ggml_cplan * cplan) {
 
     const int n_threads = cplan->n_threads;
 
+    int * thread_cpus = alloca(sizeof(int)*n_threads);
+    int * plan_cpus   = alloca(sizeof(int)*GGML_NUMA_MAX_CPUS);
+
+    const int n_plan_cpus = ggml_graph_compute_thread_cpus(cplan, thread_cpus, n_threads, plan_cpus);
+
     struct ggml_compute_state_shared state_shared = {
         /*.cgraph                  =*/ cgraph,
         /*.cgraph_plan             =*/ cplan,
@@ -17179,16 +19585,36 @@ int ggml_graph_compute(struct ggml_cgraph * cgraph, struct ggml_cplan * cplan) {
         /*.node_n                  =*/ -1,
         /*.abort_callback          =*/ NULL,
         /*.abort_callback_data     =*/ NULL,
+        /*.wave_end                =*/ 0,
+        /*.wave_n                  =*/ 0,
+        /*.wave_next               =*/ 0,
+        /*.wave_nodes              =*/ { 0 },
+        /*.wait_spin_us            =*/ cplan->wait_spin_us,
+        /*.n_sleeping              =*/ 0,
+        /*.thread_cpus             =*/ thread_cpus,
+        /*.plan_cpus               =*/ plan_cpus,
+        /*.n_plan_cpus             =*/ n_plan_cpus,
     };
+#if !defined(__linux__)
+    pthread_mutex_init(&state_shared.mutex, NULL);
+    pthread_cond_init (&state_shared.cond,  NULL);
+#endif
+    struct ggml_threadpool * pool = cplan->threadpool;
+
     struct ggml_compute_state * workers = alloca(sizeof(struct ggml_compute_state)*n_threads);
 
-    // create thread pool
-    if (n_threads > 1) {
+    // create thread pool, or wake up the persistent one
+    if (pool) {
+        ggml_threadpool_start(pool, &state_shared, n_threads);
+    } else if (n_threads > 1) {
         for (int j = 1; j < n_threads; ++j) {
             workers[j] = (struct ggml_compute_state) {
                 .thrd   = 0,
-                .ith = j,
+                .ith    = j,
                 .shared = &state_shared,
+                .pool     = NULL,
+                .cpu      = -1,
+                .affinity = NULL,
             };
 
             const int rc = ggml_thread_create(&workers[j].thrd, NULL, ggml_graph_compute_thread, &workers[j]);
@@ -17199,6 +19625,9 @@ int ggml_graph_compute(struct ggml_cgraph * cgraph, struct ggml_cplan * cplan) {
 
     workers[0].ith = 0;
     workers[0].shared = &state_shared;
+    workers[0].pool = pool;
+    workers[0].cpu = -1;
+    workers[0].affinity = NULL;
 
     const int64_t perf_start_cycles  = ggml_perf_cycles();
     const int64_t perf_start_time_us = ggml_perf_time_us();
@@ -17206,14 +19635,41 @@ int ggml_graph_compute(struct ggml_cgraph * cgraph, struct ggml_cplan * cplan) {
     // this is a work thread too
     int compute_status = (size_t) ggml_graph_compute_thread(&workers[0]);
 
-    // don't leave affinity set on the main thread
-    clear_numa_thread_affinity();
+    // don't leave affinity set on the main thread, it is pinned as thread 0 for the duration of the graph only
+    if (thread_cpus[0] != -1) {
+        ggml_thread_restore_affinity(workers[0].affinity);
+        ggml_thread_free_affinity(workers[0].affinity);
+    } else {
+        clear_numa_thread_affinity();
+    }
 
-    // join or kill thread pool
-    if (n_threads > 1) {
+    // join or kill thread pool, persistent workers go back to sleep
+    if (pool) {
+        ggml_threadpool_finish(pool);
+    } else if (n_threads > 1) {
         for (int j = 1; j < n_threads; j++) {
             const int rc = ggml_thread_join(workers[j].thrd, NULL);
             GGML_ASSERT(rc == 0);
+
+            ggml_thread_free_affinity(workers[j].affinity);
+        }
+    }
+
+#if !defined(__linux__)
+    pthread_cond_destroy (&state_shared.cond);
+    pthread_mutex_destroy(&state_shared.mutex);
+#endif
+
+    // time the threads spent waiting for each other
+    {
+        const struct ggml_compute_state * states = pool ? pool->workers : workers;
+
+        cgraph->perf_spin_us  += workers[0].t_spin_us;
+        cgraph->perf_sleep_us += workers[0].t_sleep_us;
+
+        for (int j = 1; j < n_threads; ++j) {
+            cgraph->perf_spin_us  += states[j].t_spin_us;
+            cgraph->perf_sleep_us += states[j].t_sleep_us;
         }
     }
 
@@ -17237,6 +19693,129 @@ int ggml_graph_compute(struct ggml_cgraph * cgraph, struct ggml_cplan * cplan) {
     return compute_status;
 }
 
+// computes the queued graphs one after the other, each as the thread calling ggml_graph_compute()
+static thread_ret_t ggml_threadpool_driver(void * data) {
+    struct ggml_threadpool * pool = (struct ggml_threadpool *) data;
+
+    pthread_mutex_lock(&pool->mutex);
+
+    while (true) {
+        while (pool->jobs == NULL && !pool->stop) {
+            pthread_cond_wait(&pool->cond_jobs, &pool->mutex);
+        }
+
+        struct ggml_compute_future * f = pool->jobs;
+        if (f == NULL) {
+            break;
+        }
+
+        pthread_mutex_unlock(&pool->mutex);
+
+        const int status = ggml_graph_compute(f->cgraph, &f->cplan);
+
+        if (f->callback) {
+            f->callback(f->callback_data, status);
+        }
+
+        pthread_mutex_lock(&pool->mutex);
+
+        // off the queue only now, ggml_threadpool_free() waits for an empty one
+        pool->jobs = f->next;
+        if (pool->jobs == NULL) {
+            pool->jobs_tail = NULL;
+        }
+
+        // f may be freed by its owner from here on
+        f->status = status;
+        f->done   = true;
+
+        pthread_cond_broadcast(&pool->cond_future);
+    }
+
+    pthread_mutex_unlock(&pool->mutex);
+
+    return 0;
+}
+
+struct ggml_compute_future * ggml_graph_compute_async(
+        struct ggml_cgraph * cgraph,
+        const struct ggml_cplan * cplan,
+        void (*callback)(void * data, int status),
+        void * callback_data) {
+    struct ggml_threadpool * pool = cplan->threadpool;
+
+    GGML_ASSERT(pool);
+    GGML_ASSERT(cplan->n_threads <= pool->n_threads);
+
+    struct ggml_compute_future * f = malloc(sizeof(struct ggml_compute_future));
+    GGML_ASSERT(f);
+
+    f->cgraph        = cgraph;
+    f->cplan         = *cplan;
+    f->callback      = callback;
+    f->callback_data = callback_data;
+    f->pool          = pool;
+    f->next          = NULL;
+    f->status        = GGML_EXIT_SUCCESS;
+    f->done          = false;
+
+    pthread_mutex_lock(&pool->mutex);
+
+    GGML_ASSERT(!pool->stop);
+
+    if (!pool->has_driver) {
+        const int rc = ggml_thread_create(&pool->driver, NULL, ggml_threadpool_driver, pool);
+        GGML_ASSERT(rc == 0);
+        UNUSED(rc);
+
+        pool->has_driver = true;
+    }
+
+    if (pool->jobs_tail) {
+        pool->jobs_tail->next = f;
+    } else {
+        pool->jobs = f;
+    }
+    pool->jobs_tail = f;
+
+    pthread_cond_broadcast(&pool->cond_jobs);
+    pthread_mutex_unlock(&pool->mutex);
+
+    return f;
+}
+
+bool ggml_compute_future_poll(struct ggml_compute_future * f) {
+    pthread_mutex_lock(&f->pool->mutex);
+    const bool done = f->done;
+    pthread_mutex_unlock(&f->pool->mutex);
+
+    return done;
+}
+
+int ggml_compute_future_wait(struct ggml_compute_future * f) {
+    pthread_mutex_lock(&f->pool->mutex);
+
+    while (!f->done) {
+        pthread_cond_wait(&f->pool->cond_future, &f->pool->mutex);
+    }
+
+    const int status = f->status;
+
+    pthread_mutex_unlock(&f->pool->mutex);
+
+    return status;
+}
+
+void ggml_compute_future_free(struct ggml_compute_future * f) {
+    if (f == NULL) {
+        return;
+    }
+
+    ggml_compute_future_wait(f);
+
+    free(f);
+}
+
 void ggml_graph_reset(struct ggml_cgraph * cgraph) {
     for (int i = 0; i < cgraph->n_nodes; i++) {
         struct ggml_tensor * grad = cgraph->grads[i];
@@ -17257,6 +19836,247 @@ void ggml_graph_compute_with_ctx(struct ggml_context * ctx, struct ggml_cgraph *
     ggml_graph_compute(cgraph, &cplan);
 }
 
+// everything of a node that ggml_graph_plan() looks at: op, type, shape and where the data is, which decides
+// the src1 that mul_mat nodes can reuse, and the same of its sources
+struct ggml_plan_node_sig {
+    enum ggml_op   op;
+    enum ggml_type type;
+    int64_t        ne[GGML_MAX_DIMS];
+    size_t         nb[GGML_MAX_DIMS];
+    void         * data;
+    int32_t        op_params[GGML_MAX_OP_PARAMS / sizeof(int32_t)];
+
+    struct {
+        const struct ggml_tensor * tensor;
+        enum ggml_type             type;
+        int64_t                    ne[GGML_MAX_DIMS];
+        size_t                     nb[GGML_MAX_DIMS];
+        void                     * data;
+    } src[GGML_MAX_SRC];
+};
+
+struct ggml_compute_cache {
+    struct ggml_cplan plan;
+    bool              has_plan;
+
+    // of the graph that plan is for, and the settings of the cost model then
+    struct ggml_plan_node_sig * sig;
+    struct ggml_plan_node_sig * sig_new; // of the graph asked for
+    int                         n_sig;   // allocated, of both
+    int                         n_nodes;
+    int                         n_threads;
+    size_t                      task_min_bytes;
+    bool                        numa;
+
+    uint8_t * work;
+    size_t    work_size; // allocated, the largest of the plans so far
+};
+
+struct ggml_compute_cache * ggml_compute_cache_new(void) {
+    struct ggml_compute_cache * cache = malloc(sizeof(struct ggml_compute_cache));
+    GGML_ASSERT(cache);
+
+    memset(cache, 0, sizeof(struct ggml_compute_cache));
+
+    return cache;
+}
+
+void ggml_compute_cache_free(struct ggml_compute_cache * cache) {
+    if (cache == NULL) {
+        return;
+    }
+
+    if (cache->work) {
+        GGML_ALIGNED_FREE(cache->work);
+    }
+
+    free(cache->sig);
+    free(cache->sig_new);
+    free(cache);
+}
+
+// zeroed first, so that the padding compares equal too
+static void ggml_plan_node_sig_set(struct ggml_plan_node_sig * sig, const struct ggml_tensor * node) {
+    memset(sig, 0, sizeof(*sig));
+
+    sig->op   = node->op;
+    sig->type = node->type;
+    sig->data = node->data;
+    memcpy(sig->ne,        node->ne,        sizeof(sig->ne));
+    memcpy(sig->nb,        node->nb,        sizeof(sig->nb));
+    memcpy(sig->op_params, node->op_params, sizeof(sig->op_params));
+
+    for (int j = 0; j < GGML_MAX_SRC; ++j) {
+        const struct ggml_tensor * src = node->src[j];
+        if (src == NULL) {
+            continue;
+        }
+
+        sig->src[j].tensor = src;
+        sig->src[j].type   = src->type;
+        sig->src[j].data   = src->data;
+        memcpy(sig->src[j].ne, src->ne, sizeof(sig->src[j].ne));
+        memcpy(sig->src[j].nb, src->nb, sizeof(sig->src[j].nb));
+    }
+}
+
+struct ggml_cplan * ggml_compute_cache_plan(struct ggml_compute_cache * cache, struct ggml_cgraph * cgraph, int n_threads, struct ggml_threadpool * pool) {
+    if (n_threads <= 0) {
+        n_threads = GGML_DEFAULT_N_THREADS;
+    }
+
+    const int    n_nodes        = cgraph->n_nodes;
+    const size_t task_min_bytes = ggml_threadpool_get_task_min_bytes(pool);
+    const bool   numa           = ggml_is_numa();
+
+    if (n_nodes > cache->n_sig) {
+        free(cache->sig);
+        free(cache->sig_new);
+
+        cache->sig      = malloc(n_nodes*sizeof(struct ggml_plan_node_sig));
+        cache->sig_new  = malloc(n_nodes*sizeof(struct ggml_plan_node_sig));
+        cache->n_sig    = n_nodes;
+        cache->has_plan = false; // its signature is gone
+        GGML_ASSERT(cache->sig && cache->sig_new);
+    }
+
+    for (int i = 0; i < n_nodes; ++i) {
+        ggml_plan_node_sig_set(&cache->sig_new[i], cgraph->nodes[i]);
+    }
+
+    if (cache->has_plan &&
+        cache->plan.threadpool == pool &&
+        cache->n_nodes         == n_nodes &&
+        cache->n_threads       == n_threads &&
+        cache->task_min_bytes  == task_min_bytes &&
+        cache->numa            == numa &&
+        memcmp(cache->sig, cache->sig_new, n_nodes*sizeof(struct ggml_plan_node_sig)) == 0) {
+        return &cache->plan;
+    }
+
+    struct ggml_cplan plan = ggml_graph_plan_pool(cgraph, n_threads, pool);
+
+    // the options the caller set on the last plan stay
+    if (cache->has_plan) {
+        plan.abort_callback      = cache->plan.abort_callback;
+        plan.abort_callback_data = cache->plan.abort_callback_data;
+        plan.wait_spin_us        = cache->plan.wait_spin_us;
+        plan.concurrent_nodes    = cache->plan.concurrent_nodes;
+        plan.affinity            = cache->plan.affinity;
+        plan.affinity_cpus       = cache->plan.affinity_cpus;
+        plan.n_affinity_cpus     = cache->plan.n_affinity_cpus;
+    }
+
+    if (plan.work_size > cache->work_size) {
+        if (cache->work) {
+            GGML_ALIGNED_FREE(cache->work);
+        }
+
+        cache->work      = GGML_ALIGNED_MALLOC(plan.work_size);
+        cache->work_size = plan.work_size;
+        GGML_ASSERT(cache->work);
+    }
+
+    plan.work_data = cache->work;
+
+    struct ggml_plan_node_sig * sig = cache->sig;
+    cache->sig     = cache->sig_new;
+    cache->sig_new = sig;
+
+    cache->plan           = plan;
+    cache->has_plan       = true;
+    cache->n_nodes        = n_nodes;
+    cache->n_threads      = n_threads;
+    cache->task_min_bytes = task_min_bytes;
+    cache->numa           = numa;
+
+    return &cache->plan;
+}
+
+int ggml_graph_compute_with_cache(struct ggml_compute_cache * cache, struct ggml_cgraph * cgraph, int n_threads) {
+    return ggml_graph_compute(cgraph, ggml_compute_cache_plan(cache, cgraph, n_threads, NULL));
+}
+
+// best of 3 runs of the graph in us, every node on n_tasks threads
+static int64_t ggml_task_cost_time(struct ggml_cgraph * cgraph, int n_threads, int n_tasks, struct ggml_threadpool * pool) {
+    struct ggml_cplan cplan = ggml_graph_plan(cgraph, n_threads);
+    GGML_ASSERT(cplan.work_size == 0);
+
+    for (int i = 0; i < cgraph->n_nodes; ++i) {
+        cplan.n_tasks[i] = n_tasks;
+    }
+    cplan.threadpool = pool;
+
+    int64_t t_best = INT64_MAX;
+
+    for (int run = 0; run < 3; ++run) {
+        const int64_t t_start = ggml_time_us();
+        ggml_graph_compute(cgraph, &cplan);
+        t_best = MIN(t_best, ggml_time_us() - t_start);
+    }
+
+    return t_best;
+}
+
+size_t ggml_task_cost_calibrate(int n_threads, struct ggml_threadpool * pool) {
+    if (n_threads <= 1) {
+        return ggml_threadpool_get_task_min_bytes(pool);
+    }
+
+    const int64_t n_big   = 1024*1024;
+    const int     n_chain = 64;
+
+    struct ggml_init_params params = {
+        /*.mem_size   =*/ 3*n_big*sizeof(float) + 2*ggml_graph_overhead() + (n_chain + 8)*(ggml_tensor_overhead() + 64),
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ false,
+    };
+
+    struct ggml_context * ctx = ggml_init(params);
+
+    // the waking and the barrier of a chain of nodes too small to take any time of their own
+    struct ggml_tensor * x = ggml_new_tensor_1d(ctx, GGML_TYPE_F32, 16);
+    struct ggml_tensor * y = ggml_new_tensor_1d(ctx, GGML_TYPE_F32, 16);
+    ggml_set_f32(x, 0.0f);
+    ggml_set_f32(y, 1.0f);
+
+    struct ggml_tensor * chain = x;
+    for (int i = 0; i < n_chain; ++i) {
+        chain = ggml_add(ctx, chain, y);
+    }
+
+    struct ggml_cgraph * gf_sync = ggml_new_graph(ctx);
+    ggml_build_forward_expand(gf_sync, chain);
+
+    // the bytes one thread moves per us through a node that does not fit in the caches
+    struct ggml_tensor * a = ggml_new_tensor_1d(ctx, GGML_TYPE_F32, n_big);
+    struct ggml_tensor * b = ggml_new_tensor_1d(ctx, GGML_TYPE_F32, n_big);
+    ggml_set_f32(a, 1.0f);
+    ggml_set_f32(b, 2.0f);
+
+    struct ggml_cgraph * gf_bw = ggml_new_graph(ctx);
+    ggml_build_forward_expand(gf_bw, ggml_add(ctx, a, b));
+
+    const int64_t t_mt = ggml_task_cost_time(gf_sync, n_threads, n_threads, pool);
+    const int64_t t_st = ggml_task_cost_time(gf_sync, n_threads, 1,         pool);
+    const int64_t t_bw = ggml_task_cost_time(gf_bw,   n_threads, 1,         pool);
+
+    ggml_free(ctx);
+
+    const double sync_us      = (double) MAX(t_mt - t_st, 0)/n_chain;
+    const double bytes_per_us = 3.0*n_big*sizeof(float)/MAX(t_bw, 1);
+
+    const size_t task_min_bytes = MIN(MAX((size_t) (sync_us*bytes_per_us), 4*1024), 4*1024*1024);
+
+    if (pool) {
+        ggml_threadpool_set_task_min_bytes(pool, task_min_bytes);
+    } else {
+        ggml_set_task_min_bytes(task_min_bytes);
+    }
+
+    return task_min_bytes;
+}
+
 struct ggml_tensor * ggml_graph_get_tensor(struct ggml_cgraph * cgraph, const char * name) {
     for (int i = 0; i < cgraph->n_leafs; i++) {
         struct ggml_tensor * leaf = cgraph->leafs[i];
@@ -17784,6 +20604,12 @@ void ggml_graph_print(const struct ggml_cgraph * cgraph) {
         GGML_PRINT("perf_total_per_op_us[%16s] = %7.3f ms\n", ggml_op_name(i), (double) perf_total_per_op_us[i] / 1000.0);
     }
 
+    if (cgraph->perf_runs > 0) {
+        GGML_PRINT("perf_wait: spin = %7.3f ms, sleep = %7.3f ms (per run, summed over threads)\n",
+                (double) cgraph->perf_spin_us  / 1000.0 / cgraph->perf_runs,
+                (double) cgraph->perf_sleep_us / 1000.0 / cgraph->perf_runs);
+    }
+
     GGML_PRINT("========================================\n");
 }
 
@@ -18974,7 +21800,9 @@ size_t ggml_quantize_chunk(enum ggml_type type, const float * src, void * dst, i
 ////////////////////////////////////////////////////////////////////////////////
 
 int ggml_cpu_has_avx(void) {
-#if defined(__AVX__)
+#if defined(GGML_CPU_DISPATCH)
+    return g_cpu_level >= GGML_CPU_LEVEL_AVX2;
+#elif defined(__AVX__)
     return 1;
 #else
     return 0;
@@ -18982,7 +21810,9 @@ int ggml_cpu_has_avx(void) {
 }
 
 int ggml_cpu_has_avx2(void) {
-#if defined(__AVX2__)
+#if defined(GGML_CPU_DISPATCH)
+    return g_cpu_level >= GGML_CPU_LEVEL_AVX2;
+#elif defined(__AVX2__)
     return 1;
 #else
     return 0;
@@ -18990,7 +21820,9 @@ int ggml_cpu_has_avx2(void) {
 }
 
 int ggml_cpu_has_avx512(void) {
-#if defined(__AVX512F__)
+#if defined(GGML_CPU_DISPATCH)
+    return g_cpu_level >= GGML_CPU_LEVEL_AVX512;
+#elif defined(__AVX512F__)
     return 1;
 #else
     return 0;
@@ -19006,7 +21838,19 @@ int ggml_cpu_has_avx512_vbmi(void) {
 }
 
 int ggml_cpu_has_avx512_vnni(void) {
-#if defined(__AVX512VNNI__)
+#if defined(GGML_CPU_DISPATCH)
+    return g_cpu_level == GGML_CPU_LEVEL_AVX512_VNNI;
+#elif defined(__AVX512VNNI__)
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+int ggml_cpu_has_avx_vnni(void) {
+#if defined(GGML_CPU_DISPATCH)
+    return g_cpu_level == GGML_CPU_LEVEL_AVX_VNNI;
+#elif defined(__AVXVNNI__)
     return 1;
 #else
     return 0;
@@ -19014,7 +21858,9 @@ int ggml_cpu_has_avx512_vnni(void) {
 }
 
 int ggml_cpu_has_fma(void) {
-#if defined(__FMA__)
+#if defined(GGML_CPU_DISPATCH)
+    return g_cpu_level >= GGML_CPU_LEVEL_AVX2;
+#elif defined(__FMA__)
     return 1;
 #else
     return 0;
@@ -19038,7 +21884,9 @@ int ggml_cpu_has_arm_fma(void) {
 }
 
 int ggml_cpu_has_f16c(void) {
-#if defined(__F16C__)
+#if defined(GGML_CPU_DISPATCH)
+    return g_cpu_level >= GGML_CPU_LEVEL_AVX2;
+#elif defined(__F16C__)
     return 1;
 #else
     return 0;
@@ -19106,3 +21954,5 @@ int ggml_cpu_has_vsx(void) {
 }
 
 ////////////////////////////////////////////////////////////////////////////////
+
+#endif // GGML_CPU_KERNELS_ONLY
@@ -0,0 +1,160 @@
+#define _GNU_SOURCE // sched_getcpu, CPU_* on Linux
+
+#include "ggml/ggml.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#define N_THREADS 3
+
+// records the CPU of every compute thread
+static void record_cpu(struct ggml_tensor * dst, const struct ggml_tensor * a, int ith, int nth, void * userdata) {
+    (void) dst;
+    (void) a;
+    (void) nth;
+#if defined(__linux__)
+    ((int *) userdata)[ith] = sched_getcpu();
+#else
+    ((int *) userdata)[ith] = -1;
+#endif
+}
+
+// thread i runs on expect[i] under the affinity with the given CPUs, the threads past n_expect on any of
+// expect, and all of them on any CPU of the process if n_expect is 0 - persistent workers pinned by an
+// earlier graph too
+static int run(struct ggml_context * ctx, struct ggml_threadpool * pool, enum ggml_affinity affinity,
+        const int * cpus, int n_cpus, const int * expect, int n_expect, const char * what) {
+    int thread_cpus[N_THREADS];
+    for (int i = 0; i < N_THREADS; ++i) {
+        thread_cpus[i] = -2;
+    }
+
+    struct ggml_tensor * a = ggml_new_tensor_1d(ctx, GGML_TYPE_F32, 16);
+    struct ggml_tensor * r = ggml_map_custom1(ctx, a, record_cpu, GGML_N_TASKS_MAX, thread_cpus);
+
+    struct ggml_cgraph gf = ggml_build_forward(r);
+
+    struct ggml_cplan plan = ggml_graph_plan(&gf, N_THREADS);
+    plan.threadpool      = pool;
+    plan.affinity        = affinity;
+    plan.affinity_cpus   = cpus;
+    plan.n_affinity_cpus = n_cpus;
+
+    uint8_t * work = malloc(plan.work_size + 1);
+    plan.work_data = work;
+
+#if defined(__linux__)
+    cpu_set_t before;
+    cpu_set_t after;
+    sched_getaffinity(0, sizeof(before), &before);
+#endif
+
+    ggml_graph_compute(&gf, &plan);
+
+    free(work);
+
+    int n_fail = 0;
+
+#if defined(__linux__)
+    sched_getaffinity(0, sizeof(after), &after);
+    if (!CPU_EQUAL(&before, &after)) {
+        fprintf(stderr, "%s: the affinity of the calling thread changed\n", what);
+        n_fail++;
+    }
+
+    for (int i = 0; i < N_THREADS; ++i) {
+        bool in_expect = n_expect == 0;
+        for (int j = 0; j < n_expect; ++j) {
+            in_expect = in_expect || thread_cpus[i] == expect[j];
+        }
+
+        if (thread_cpus[i] < 0 || !CPU_ISSET(thread_cpus[i], &before) || !in_expect ||
+            (i < n_expect && thread_cpus[i] != expect[i])) {
+            fprintf(stderr, "%s: thread %d ran on CPU %d\n", what, i, thread_cpus[i]);
+            n_fail++;
+        }
+    }
+#else
+    (void) expect;
+    (void) n_expect;
+#endif
+
+    for (int i = 0; i < N_THREADS; ++i) {
+        if (thread_cpus[i] == -2) {
+            fprintf(stderr, "%s: thread %d did not run\n", what, i);
+            n_fail++;
+        }
+    }
+
+    return n_fail;
+}
+
+int main(void) {
+    struct ggml_init_params params = {
+        /*.mem_size   =*/ 1024*1024,
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ false,
+    };
+
+    struct ggml_context * ctx = ggml_init(params);
+
+    int n_fail = 0;
+
+    const int n_cores = ggml_cpu_physical_cores(NULL, 0);
+
+    int * cores = malloc((n_cores + 1)*sizeof(int));
+    if (ggml_cpu_physical_cores(cores, n_cores) != n_cores) {
+        fprintf(stderr, "the number of physical cores changed\n");
+        n_fail++;
+    }
+
+    int allowed[2];
+    int n_allowed = 0;
+
+#if defined(__linux__)
+    if (n_cores < 1) {
+        fprintf(stderr, "no physical cores found\n");
+        n_fail++;
+    }
+
+    // the last two CPUs this process may run on
+    cpu_set_t mask;
+    sched_getaffinity(0, sizeof(mask), &mask);
+    for (int c = CPU_SETSIZE - 1; c >= 0 && n_allowed < 2; --c) {
+        if (CPU_ISSET(c, &mask)) {
+            allowed[n_allowed++] = c;
+        }
+    }
+#endif
+
+    struct ggml_threadpool * pool = ggml_threadpool_new(N_THREADS);
+
+    for (int p = 0; p < 2; ++p) {
+        struct ggml_threadpool * tp = p ? pool : NULL;
+
+        // one thread per core, as many cores as there are threads
+        const int n_used = n_cores < N_THREADS ? n_cores : N_THREADS;
+
+        n_fail += run(ctx, tp, GGML_AFFINITY_CPUS,     allowed, n_allowed, allowed, n_allowed, "cpus");
+        n_fail += run(ctx, tp, GGML_AFFINITY_NONE,     NULL,    0,         NULL,    0,         "none");
+        n_fail += run(ctx, tp, GGML_AFFINITY_PHYSICAL, NULL,    0,         cores,   n_used,    "physical");
+        n_fail += run(ctx, tp, GGML_AFFINITY_PHYSICAL, cores,   n_cores,   cores,   n_used,    "physical of a list");
+    }
+
+    ggml_threadpool_free(pool);
+    free(cores);
+    ggml_free(ctx);
+
+    if (n_fail > 0) {
+        return 1;
+    }
+
+    printf("OK\n");
+
+    return 0;
+}
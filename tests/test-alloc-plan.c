@@ -0,0 +1,226 @@
+#include "ggml/ggml.h"
+#include "ggml/ggml-alloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_LAYERS 4
+#define N_EMBD   64
+#define N_FF     256
+#define N_TOKENS 8
+
+#define ALIGNMENT 32
+
+// weights, shapes and the input, in a context that holds their data
+struct model {
+    struct ggml_context * ctx;
+    struct ggml_tensor  * inp;
+    struct ggml_tensor  * w_up[N_LAYERS];
+    struct ggml_tensor  * w_down[N_LAYERS];
+    struct ggml_tensor  * shape[3];
+};
+
+typedef struct ggml_tensor * (*build_t)(struct ggml_context * ctx, const struct model * m, struct ggml_tensor * x, struct ggml_cgraph * gf);
+
+static void randomize(struct ggml_tensor * t) {
+    for (int i = 0; i < ggml_nelements(t); ++i) {
+        ((float *) t->data)[i] = (float) rand()/RAND_MAX - 0.5f;
+    }
+}
+
+static struct model make_model(void) {
+    struct ggml_init_params params = {
+        /*.mem_size   =*/ 4*1024*1024,
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ false,
+    };
+
+    struct model m;
+    m.ctx = ggml_init(params);
+
+    srand(1);
+
+    m.inp = ggml_new_tensor_2d(m.ctx, GGML_TYPE_F32, N_EMBD, N_TOKENS);
+    randomize(m.inp);
+
+    for (int l = 0; l < N_LAYERS; ++l) {
+        m.w_up[l]   = ggml_new_tensor_2d(m.ctx, GGML_TYPE_F32, N_EMBD, N_FF);
+        m.w_down[l] = ggml_new_tensor_2d(m.ctx, GGML_TYPE_F32, N_FF, N_EMBD);
+        randomize(m.w_up[l]);
+        randomize(m.w_down[l]);
+    }
+
+    m.shape[0] = ggml_new_tensor_2d(m.ctx, GGML_TYPE_F32, N_EMBD, 2*N_TOKENS);
+    m.shape[1] = ggml_new_tensor_2d(m.ctx, GGML_TYPE_F32, N_EMBD, 2*N_TOKENS);
+    m.shape[2] = ggml_new_tensor_2d(m.ctx, GGML_TYPE_F32, N_EMBD, 3*N_TOKENS);
+
+    return m;
+}
+
+// an MLP stack with residuals
+static struct ggml_tensor * build_mlp(struct ggml_context * ctx, const struct model * m, struct ggml_tensor * x, struct ggml_cgraph * gf) {
+    for (int l = 0; l < N_LAYERS; ++l) {
+        struct ggml_tensor * h = ggml_gelu(ctx, ggml_mul_mat(ctx, m->w_up[l], ggml_norm(ctx, x)));
+        x = ggml_add(ctx, x, ggml_mul_mat(ctx, m->w_down[l], h));
+    }
+
+    struct ggml_tensor * out = ggml_soft_max(ctx, ggml_scale(ctx, x, ggml_new_f32(ctx, 0.5f)));
+
+    *gf = ggml_build_forward(out);
+
+    return out;
+}
+
+// b is freed while a is still live and c does not fit the hole b left, which the greedy allocator
+// places past a and the planner places over b
+static struct ggml_tensor * build_holes(struct ggml_context * ctx, const struct model * m, struct ggml_tensor * x, struct ggml_cgraph * gf) {
+    struct ggml_tensor * b  = ggml_repeat(ctx, x, m->shape[0]);
+    struct ggml_tensor * a  = ggml_repeat(ctx, x, m->shape[1]);
+    struct ggml_tensor * sb = ggml_sum(ctx, b);
+    struct ggml_tensor * c  = ggml_repeat(ctx, x, m->shape[2]);
+
+    struct ggml_tensor * out = ggml_add(ctx, ggml_add(ctx, sb, ggml_sum(ctx, c)), ggml_sum(ctx, a));
+
+    *gf = ggml_build_forward(b);
+    ggml_build_forward_expand(gf, a);
+    ggml_build_forward_expand(gf, sb);
+    ggml_build_forward_expand(gf, c);
+    ggml_build_forward_expand(gf, out);
+
+    return out;
+}
+
+#define GRAPH_CTX_SIZE (ggml_tensor_overhead()*GGML_MAX_NODES + ggml_graph_overhead())
+
+// in mem_buffer if set, then a graph built again gets the same tensors
+static struct ggml_context * make_graph_ctx(void * mem_buffer) {
+    struct ggml_init_params params = {
+        /*.mem_size   =*/ GRAPH_CTX_SIZE,
+        /*.mem_buffer =*/ mem_buffer,
+        /*.no_alloc   =*/ true,
+    };
+
+    return ggml_init(params);
+}
+
+// the graph size from a measure allocator, with or without the planner
+static size_t measure(const struct model * m, build_t build, bool planned) {
+    struct ggml_context * ctx   = make_graph_ctx(NULL);
+    struct ggml_allocr  * alloc = ggml_allocr_new_measure(ALIGNMENT);
+
+    struct ggml_tensor * x = ggml_dup_tensor(ctx, m->inp);
+    ggml_allocr_alloc(alloc, x);
+
+    struct ggml_cgraph gf;
+    build(ctx, m, x, &gf);
+
+    const size_t size = planned ? ggml_allocr_alloc_graph_planned(alloc, &gf) : ggml_allocr_alloc_graph(alloc, &gf);
+
+    ggml_allocr_free(alloc);
+    ggml_free(ctx);
+
+    return size;
+}
+
+static int test_graph(const struct model * m, build_t build, const char * name, bool fragmented) {
+    int n_fail = 0;
+
+    // reference in a context that holds every tensor
+    struct ggml_init_params params = {
+        /*.mem_size   =*/ 16*1024*1024,
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ false,
+    };
+    struct ggml_context * ctx_ref = ggml_init(params);
+
+    struct ggml_tensor * x_ref = ggml_dup_tensor(ctx_ref, m->inp);
+    memcpy(x_ref->data, m->inp->data, ggml_nbytes(x_ref));
+
+    struct ggml_cgraph gf_ref;
+    struct ggml_tensor * ref = build(ctx_ref, m, x_ref, &gf_ref);
+    ggml_graph_compute_with_ctx(ctx_ref, &gf_ref, 2);
+
+    const size_t greedy_size  = measure(m, build, false);
+    const size_t planned_size = measure(m, build, true);
+
+    if (planned_size > greedy_size || (fragmented && planned_size == greedy_size)) {
+        fprintf(stderr, "%s: planned %zu bytes, greedy %zu bytes\n", name, planned_size, greedy_size);
+        n_fail++;
+    }
+
+    // evaluations in a buffer of the planned size, plus room to align its start,
+    // the first one plans and the next ones reuse the plan: of the same tensors in a context
+    // that is built again in the same memory, without the walk, then of other tensors
+    uint8_t * buf = malloc(planned_size + ALIGNMENT);
+    struct ggml_allocr * alloc = ggml_allocr_new(buf, planned_size + ALIGNMENT, ALIGNMENT);
+
+    void * ctx_buf = malloc(GRAPH_CTX_SIZE);
+
+    void * out_data = NULL;
+
+    for (int it = 0; it < 4; ++it) {
+        struct ggml_context * ctx = make_graph_ctx(it < 3 ? ctx_buf : NULL);
+
+        ggml_allocr_reset(alloc);
+
+        struct ggml_tensor * x = ggml_dup_tensor(ctx, m->inp);
+        ggml_allocr_alloc(alloc, x);
+        memcpy(x->data, m->inp->data, ggml_nbytes(x));
+
+        struct ggml_cgraph gf;
+        struct ggml_tensor * out = build(ctx, m, x, &gf);
+
+        ggml_allocr_alloc_graph_planned(alloc, &gf);
+
+        // the reported sizes are those of the graph, without the input
+        if (ggml_allocr_planned_size(alloc) > ggml_allocr_greedy_size(alloc) ||
+            ggml_allocr_greedy_size(alloc) - ggml_allocr_planned_size(alloc) != greedy_size - planned_size) {
+            fprintf(stderr, "%s: iteration %d reports planned %zu bytes, greedy %zu\n", name, it,
+                    ggml_allocr_planned_size(alloc), ggml_allocr_greedy_size(alloc));
+            n_fail++;
+        }
+
+        // the same graph gets the same offsets
+        if (it > 0 && out->data != out_data) {
+            fprintf(stderr, "%s: iteration %d: output at %p, was at %p\n", name, it, out->data, out_data);
+            n_fail++;
+        }
+        out_data = out->data;
+
+        ggml_graph_compute_with_ctx(ctx, &gf, 2);
+
+        if (memcmp(ref->data, out->data, ggml_nelements(ref)*sizeof(float)) != 0) {
+            fprintf(stderr, "%s: iteration %d differs from a graph of its own tensors\n", name, it);
+            n_fail++;
+        }
+
+        ggml_free(ctx);
+    }
+
+    ggml_allocr_free(alloc);
+    free(ctx_buf);
+    free(buf);
+    ggml_free(ctx_ref);
+
+    return n_fail;
+}
+
+int main(void) {
+    struct model m = make_model();
+
+    int n_fail = 0;
+
+    n_fail += test_graph(&m, build_mlp,   "mlp",   false);
+    n_fail += test_graph(&m, build_holes, "holes", true);
+
+    ggml_free(m.ctx);
+
+    if (n_fail > 0) {
+        return 1;
+    }
+
+    printf("OK\n");
+
+    return 0;
+}
@@ -0,0 +1,84 @@
+#include "ggml/ggml.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct ggml_tensor * (*binary_op_t)(struct ggml_context * ctx, struct ggml_tensor * a, struct ggml_tensor * b);
+
+static void randomize(struct ggml_tensor * t) {
+    for (int i = 0; i < ggml_nelements(t); ++i) {
+        ((float *) t->data)[i] = (float) rand()/RAND_MAX + 0.5f;
+    }
+}
+
+// op(a, b) with b broadcast over the rows of a must match op(a, repeat(b, a))
+static int test_op(const char * name, binary_op_t op, const int64_t * ne_a, const int64_t * ne_b, int n_threads) {
+    struct ggml_init_params params = {
+        /*.mem_size   =*/ 16*1024*1024,
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ false,
+    };
+
+    struct ggml_context * ctx = ggml_init(params);
+
+    struct ggml_tensor * a = ggml_new_tensor(ctx, GGML_TYPE_F32, 4, ne_a);
+    struct ggml_tensor * b = ggml_new_tensor(ctx, GGML_TYPE_F32, 4, ne_b);
+
+    randomize(a);
+    randomize(b);
+
+    struct ggml_tensor * ref = op(ctx, a, ggml_repeat(ctx, b, a));
+    struct ggml_tensor * res = op(ctx, a, b);
+
+    struct ggml_cgraph gf = ggml_build_forward(ref);
+    ggml_build_forward_expand(&gf, res);
+
+    ggml_graph_compute_with_ctx(ctx, &gf, n_threads);
+
+    const int ok = memcmp(ref->data, res->data, ggml_nbytes(ref)) == 0;
+    if (!ok) {
+        fprintf(stderr, "%s: broadcast of [%d, %d, %d, %d] over [%d, %d, %d, %d] with %d threads differs from repeat\n",
+                name, (int) ne_b[0], (int) ne_b[1], (int) ne_b[2], (int) ne_b[3],
+                (int) ne_a[0], (int) ne_a[1], (int) ne_a[2], (int) ne_a[3], n_threads);
+    }
+
+    ggml_free(ctx);
+
+    return ok ? 0 : 1;
+}
+
+int main(void) {
+    // the threads split every node, however small
+    ggml_set_task_min_bytes(1);
+
+    const int64_t ne_a[4] = { 32, 6, 4, 2 };
+
+    const int64_t ne_b[][4] = {
+        { 32, 1, 1, 1 },
+        { 32, 6, 1, 1 },
+        { 32, 3, 2, 1 },
+        { 32, 1, 4, 2 },
+        { 32, 6, 4, 2 },
+    };
+
+    srand(1);
+
+    int n_fail = 0;
+
+    for (int i = 0; i < (int) (sizeof(ne_b)/sizeof(ne_b[0])); ++i) {
+        for (int n_threads = 1; n_threads <= 3; n_threads += 2) {
+            n_fail += test_op("add", ggml_add, ne_a, ne_b[i], n_threads);
+            n_fail += test_op("mul", ggml_mul, ne_a, ne_b[i], n_threads);
+            n_fail += test_op("div", ggml_div, ne_a, ne_b[i], n_threads);
+        }
+    }
+
+    if (n_fail > 0) {
+        return 1;
+    }
+
+    printf("OK\n");
+
+    return 0;
+}
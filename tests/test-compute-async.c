@@ -0,0 +1,135 @@
+#include "test-graph.h"
+
+#define N_THREADS 4
+#define N_GRAPHS  3
+
+// with a plan and work buffer that stay until the async compute is done
+struct graph {
+    struct test_graph   t;
+    struct ggml_cplan   plan;
+    uint8_t           * work;
+};
+
+static struct graph make_graph(int seed, int n_threads, struct ggml_threadpool * pool) {
+    struct graph g;
+    g.t = test_graph_mul_mat(seed, 256, 192, 9);
+
+    g.plan = ggml_graph_plan(&g.t.gf, n_threads);
+    g.plan.threadpool = pool;
+
+    g.work = g.plan.work_size > 0 ? malloc(g.plan.work_size) : NULL;
+    g.plan.work_data = g.work;
+
+    return g;
+}
+
+static void free_graph(struct graph * g) {
+    free(g->work);
+    ggml_free(g->t.ctx);
+}
+
+struct done {
+    int n_calls;
+    int status;
+};
+
+static void on_done(void * data, int status) {
+    struct done * d = (struct done *) data;
+    d->n_calls++;
+    d->status = status;
+}
+
+static bool abort_now(void * data) {
+    (void) data;
+    return true;
+}
+
+int main(void) {
+    // the threads split every node, however small
+    ggml_set_task_min_bytes(1);
+
+    struct graph ref[N_GRAPHS];
+    struct graph res[N_GRAPHS];
+
+    struct ggml_threadpool * pool = ggml_threadpool_new(N_THREADS);
+
+    for (int k = 0; k < N_GRAPHS; ++k) {
+        ref[k] = make_graph(k + 1, N_THREADS, NULL);
+        res[k] = make_graph(k + 1, 1 + k % N_THREADS, pool);
+
+        ggml_graph_compute(&ref[k].t.gf, &ref[k].plan);
+    }
+
+    int n_fail = 0;
+
+    for (int it = 0; it < 8; ++it) {
+        struct done done[N_GRAPHS];
+        struct ggml_compute_future * futures[N_GRAPHS];
+
+        for (int k = 0; k < N_GRAPHS; ++k) {
+            memset(res[k].t.out->data, 0, ggml_nbytes(res[k].t.out));
+
+            done[k].n_calls = 0;
+            done[k].status  = -1;
+
+            futures[k] = ggml_graph_compute_async(&res[k].t.gf, &res[k].plan, k == 0 ? NULL : on_done, &done[k]);
+        }
+
+        // a synchronous graph on the same pool waits for its turn, then the host gets on with its own work
+        struct ggml_cplan plan = ref[0].plan;
+        plan.threadpool = pool;
+
+        ggml_graph_compute(&ref[0].t.gf, &plan);
+
+        int n_polls = 0;
+        while (!ggml_compute_future_poll(futures[N_GRAPHS - 1])) {
+            n_polls++;
+        }
+        (void) n_polls;
+
+        for (int k = 0; k < N_GRAPHS; ++k) {
+            const int status = ggml_compute_future_wait(futures[k]);
+            if (status != GGML_EXIT_SUCCESS) {
+                fprintf(stderr, "graph %d: status %d\n", k, status);
+                n_fail++;
+            }
+            if (k > 0 && (done[k].n_calls != 1 || done[k].status != status)) {
+                fprintf(stderr, "graph %d: callback called %d times with %d\n", k, done[k].n_calls, done[k].status);
+                n_fail++;
+            }
+            if (memcmp(ref[k].t.out->data, res[k].t.out->data, ggml_nbytes(ref[k].t.out)) != 0) {
+                fprintf(stderr, "graph %d: differs from ggml_graph_compute\n", k);
+                n_fail++;
+            }
+
+            ggml_compute_future_free(futures[k]);
+        }
+    }
+
+    // the abort callback of the plan, and a future freed before its graph is done
+    {
+        struct ggml_cplan plan = res[0].plan;
+        plan.abort_callback = abort_now;
+
+        struct ggml_compute_future * f0 = ggml_graph_compute_async(&res[0].t.gf, &plan, NULL, NULL);
+        struct ggml_compute_future * f1 = ggml_graph_compute_async(&res[1].t.gf, &res[1].plan, NULL, NULL);
+
+        ggml_compute_future_free(f1);
+
+        if (!ggml_compute_future_poll(f0) || ggml_compute_future_wait(f0) != GGML_EXIT_ABORTED) {
+            fprintf(stderr, "aborted graph not done before the next one or not aborted\n");
+            n_fail++;
+        }
+
+        ggml_compute_future_free(f0);
+    }
+
+    ggml_threadpool_free(pool);
+
+    for (int k = 0; k < N_GRAPHS; ++k) {
+        free_graph(&ref[k]);
+        free_graph(&res[k]);
+    }
+
+    return test_done(__func__, n_fail);
+}
@@ -0,0 +1,111 @@
+#include "test-graph.h"
+
+#define N_THREADS 3
+
+// a quantized mul_mat that needs a work buffer for src1 of n columns
+static struct test_graph make_graph(int n) {
+    struct test_graph g;
+    g.ctx = test_ctx_new(16*1024*1024);
+
+    struct ggml_tensor * w = ggml_new_tensor_2d(g.ctx, GGML_TYPE_F32, 128, 48);
+    struct ggml_tensor * q = ggml_new_tensor_2d(g.ctx, GGML_TYPE_Q8_0, 128, 48);
+    struct ggml_tensor * x = ggml_new_tensor_2d(g.ctx, GGML_TYPE_F32, 128, n);
+
+    srand(1);
+    test_randomize(w);
+    test_randomize(x);
+
+    struct ggml_cgraph gq = ggml_build_forward(ggml_cpy(g.ctx, w, q));
+    ggml_graph_compute_with_ctx(g.ctx, &gq, 1);
+
+    g.out = ggml_soft_max(g.ctx, ggml_mul_mat(g.ctx, q, x));
+    g.gf  = ggml_build_forward(g.out);
+
+    return g;
+}
+
+// the graph with the cache against the same graph of a context of its own
+static int check(struct ggml_compute_cache * cache, struct ggml_threadpool * pool, struct test_graph * g, int n, const char * what) {
+    struct test_graph ref = make_graph(n);
+    ggml_graph_compute_with_ctx(ref.ctx, &ref.gf, N_THREADS);
+
+    memset(g->out->data, 0, ggml_nbytes(g->out));
+
+    int n_fail = 0;
+
+    if (ggml_graph_compute(&g->gf, ggml_compute_cache_plan(cache, &g->gf, N_THREADS, pool)) != GGML_EXIT_SUCCESS ||
+        memcmp(ref.out->data, g->out->data, ggml_nbytes(ref.out)) != 0) {
+        fprintf(stderr, "%s: differs from ggml_graph_compute_with_ctx\n", what);
+        n_fail++;
+    }
+
+    ggml_free(ref.ctx);
+
+    return n_fail;
+}
+
+int main(void) {
+    // the threads split every node, so that a plan of its own has N_THREADS tasks for it
+    ggml_set_task_min_bytes(1);
+
+    struct ggml_compute_cache * cache = ggml_compute_cache_new();
+    struct ggml_threadpool    * pool  = ggml_threadpool_new(N_THREADS);
+
+    struct test_graph g_small = make_graph(4);
+    struct test_graph g_large = make_graph(32);
+
+    int n_fail = 0;
+
+    struct ggml_cplan * plan = ggml_compute_cache_plan(cache, &g_small.gf, N_THREADS, pool);
+    if (plan->work_size == 0 || plan->work_data == NULL) {
+        fprintf(stderr, "no work buffer for a quantized mul_mat\n");
+        n_fail++;
+    }
+    plan->wait_spin_us = 7;
+
+    uint8_t * work_small = plan->work_data;
+
+    // a plan that is reused is not planned again, so this stays
+    plan->n_tasks[0] = 1;
+
+    n_fail += check(cache, pool, &g_small, 4, "small");
+
+    plan = ggml_compute_cache_plan(cache, &g_small.gf, N_THREADS, pool);
+    if (plan->n_tasks[0] != 1 || plan->work_data != work_small) {
+        fprintf(stderr, "the plan of the same graph was not reused\n");
+        n_fail++;
+    }
+
+    // other shapes are planned again, keep the options and grow the work buffer
+    n_fail += check(cache, pool, &g_large, 32, "large");
+
+    plan = ggml_compute_cache_plan(cache, &g_large.gf, N_THREADS, pool);
+    if (plan->n_tasks[0] == 1 || plan->threadpool != pool || plan->wait_spin_us != 7) {
+        fprintf(stderr, "the plan of another graph was reused or lost its options\n");
+        n_fail++;
+    }
+
+    uint8_t * work_large = plan->work_data;
+
+    // the same shapes in another context, and back to a smaller graph with the larger buffer
+    struct test_graph g_other = make_graph(32);
+    plan->n_tasks[0] = 1;
+
+    n_fail += check(cache, pool, &g_other, 32, "other");
+    n_fail += check(cache, pool, &g_small, 4,  "small again");
+
+    plan = ggml_compute_cache_plan(cache, &g_small.gf, N_THREADS, pool);
+    if (plan->n_tasks[0] == 1 || plan->work_data != work_large) {
+        fprintf(stderr, "the plan of another context was reused or the work buffer shrank\n");
+        n_fail++;
+    }
+
+    ggml_free(g_other.ctx);
+    ggml_free(g_large.ctx);
+    ggml_free(g_small.ctx);
+
+    ggml_threadpool_free(pool);
+    ggml_compute_cache_free(cache);
+
+    return test_done(__func__, n_fail);
+}
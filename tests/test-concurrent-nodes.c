@@ -0,0 +1,133 @@
+#include "test-graph.h"
+
+#define N_THREADS 4
+
+struct graph {
+    struct ggml_context * ctx;
+    struct ggml_cgraph    gf;
+    struct ggml_tensor  * outs[8];
+    int                   n_outs;
+};
+
+static void add_out(struct graph * g, struct ggml_tensor * t) {
+    g->outs[g->n_outs++] = t;
+    ggml_build_forward_expand(&g->gf, t);
+}
+
+// independent branches, with read-after-write, write-after-write and write-after-read hazards in between
+static struct graph make_graph(void) {
+    struct graph g;
+    memset(&g, 0, sizeof(g));
+    g.ctx = test_ctx_new(16*1024*1024);
+
+    const int ne0 = 64;
+    const int ne1 = 32;
+
+    struct ggml_tensor * x     = ggml_new_tensor_2d(g.ctx, GGML_TYPE_F32, ne0, ne1);
+    struct ggml_tensor * y     = ggml_new_tensor_2d(g.ctx, GGML_TYPE_F32, ne0, ne1);
+    struct ggml_tensor * s     = ggml_new_f32(g.ctx, 0.5f);
+    struct ggml_tensor * cache = ggml_new_tensor_1d(g.ctx, GGML_TYPE_F32, 2*ne0*ne1);
+
+    srand(1);
+    test_randomize(x);
+    test_randomize(y);
+    memset(cache->data, 0, ggml_nbytes(cache));
+
+    // single-task nodes that only read x
+    struct ggml_tensor * a = ggml_scale(g.ctx, x, s);
+    struct ggml_tensor * b = ggml_sqr(g.ctx, x);
+    struct ggml_tensor * c = ggml_sum_rows(g.ctx, x);
+    struct ggml_tensor * d = ggml_sqr(g.ctx, y);
+
+    ggml_build_forward_expand(&g.gf, a);
+    ggml_build_forward_expand(&g.gf, b);
+    ggml_build_forward_expand(&g.gf, c);
+    ggml_build_forward_expand(&g.gf, d);
+
+    // writes y right after d has read it
+    struct ggml_tensor * e = ggml_scale_inplace(g.ctx, y, s);
+    ggml_build_forward_expand(&g.gf, e);
+
+    // reads a and b
+    add_out(&g, ggml_sub(g.ctx, a, b));
+    add_out(&g, c);
+    add_out(&g, d);
+
+    // multi-task copies into disjoint halves of the cache
+    const size_t half = ne0*ne1*sizeof(float);
+    ggml_build_forward_expand(&g.gf, ggml_cpy(g.ctx, a, ggml_view_2d(g.ctx, cache, ne0, ne1, ne0*sizeof(float), 0)));
+    ggml_build_forward_expand(&g.gf, ggml_cpy(g.ctx, b, ggml_view_2d(g.ctx, cache, ne0, ne1, ne0*sizeof(float), half)));
+
+    // copies into overlapping parts, the second one has to win
+    ggml_build_forward_expand(&g.gf, ggml_cpy(g.ctx, e, ggml_view_2d(g.ctx, cache, ne0, ne1, ne0*sizeof(float), half/2)));
+    ggml_build_forward_expand(&g.gf, ggml_cpy(g.ctx, x, ggml_view_2d(g.ctx, cache, ne0, ne1, ne0*sizeof(float), half)));
+
+    // reads the whole cache
+    add_out(&g, ggml_scale(g.ctx, ggml_view_1d(g.ctx, cache, 2*ne0*ne1, 0), s));
+
+    return g;
+}
+
+static size_t result_size(const struct graph * g) {
+    size_t size = 0;
+    for (int i = 0; i < g->n_outs; ++i) {
+        size += ggml_nbytes(g->outs[i]);
+    }
+    return size;
+}
+
+static void compute(int n_threads, bool concurrent_nodes, char * result) {
+    struct graph g = make_graph();
+
+    struct ggml_cplan plan = ggml_graph_plan(&g.gf, n_threads);
+    plan.concurrent_nodes = concurrent_nodes;
+
+    test_compute(&g.gf, &plan);
+
+    // every node is accounted for exactly once
+    for (int i = 0; i < g.gf.n_nodes; ++i) {
+        if (g.gf.nodes[i]->perf_runs != 1) {
+            fprintf(stderr, "node %d (%s): perf_runs = %d\n", i, ggml_op_name(g.gf.nodes[i]->op), g.gf.nodes[i]->perf_runs);
+            exit(1);
+        }
+    }
+
+    for (int i = 0; i < g.n_outs; ++i) {
+        memcpy(result, g.outs[i]->data, ggml_nbytes(g.outs[i]));
+        result += ggml_nbytes(g.outs[i]);
+    }
+
+    ggml_free(g.ctx);
+}
+
+int main(void) {
+    // the threads split every node, however small
+    ggml_set_task_min_bytes(1);
+
+    size_t size;
+    {
+        struct graph g = make_graph();
+        size = result_size(&g);
+        ggml_free(g.ctx);
+    }
+
+    char * ref = malloc(size);
+    char * res = malloc(size);
+
+    compute(1, false, ref);
+
+    int n_fail = 0;
+
+    for (int n_threads = 1; n_threads <= N_THREADS; ++n_threads) {
+        compute(n_threads, true, res);
+        if (memcmp(ref, res, size) != 0) {
+            fprintf(stderr, "concurrent nodes with %d threads differ from the sequential result\n", n_threads);
+            n_fail++;
+        }
+    }
+
+    free(ref);
+    free(res);
+
+    return test_done(__func__, n_fail);
+}
@@ -0,0 +1,222 @@
+#include "ggml/ggml.h"
+#include "ggml/ggml-alloc.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_THREADS 4
+
+struct layer {
+    struct ggml_context * ctx;
+    struct ggml_cgraph    gf;
+    struct ggml_tensor  * sum; // residual sum, read back after the norm took it over
+    struct ggml_tensor  * out;
+};
+
+static void randomize(struct ggml_tensor * t) {
+    for (int i = 0; i < ggml_nelements(t); ++i) {
+        ((float *) t->data)[i] = (float) rand()/RAND_MAX - 0.5f;
+    }
+}
+
+// a transformer-like block: ln -> fc + bias -> gelu -> residual -> ln
+static struct layer make_layer(enum ggml_type wtype, bool repeat) {
+    struct ggml_init_params params = {
+        /*.mem_size   =*/ 16*1024*1024,
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ false,
+    };
+
+    struct layer l;
+    l.ctx = ggml_init(params);
+
+    const int n_embd   = 64;
+    const int n_tokens = 5;
+
+    struct ggml_tensor * inp  = ggml_new_tensor_2d(l.ctx, GGML_TYPE_F32, n_embd, n_tokens);
+    struct ggml_tensor * ln_g = ggml_new_tensor_1d(l.ctx, GGML_TYPE_F32, n_embd);
+    struct ggml_tensor * ln_b = ggml_new_tensor_1d(l.ctx, GGML_TYPE_F32, n_embd);
+    struct ggml_tensor * fc_w = ggml_new_tensor_2d(l.ctx, GGML_TYPE_F32, n_embd, n_embd);
+    struct ggml_tensor * fc_b = ggml_new_tensor_1d(l.ctx, GGML_TYPE_F32, n_embd);
+    struct ggml_tensor * ln2  = ggml_new_tensor_1d(l.ctx, GGML_TYPE_F32, n_embd);
+
+    srand(1);
+    randomize(inp);
+    randomize(ln_g);
+    randomize(ln_b);
+    randomize(fc_w);
+    randomize(fc_b);
+    randomize(ln2);
+
+    if (wtype != GGML_TYPE_F32) {
+        struct ggml_tensor * q = ggml_new_tensor_2d(l.ctx, wtype, n_embd, n_embd);
+        struct ggml_cgraph gq = ggml_build_forward(ggml_cpy(l.ctx, fc_w, q));
+        ggml_graph_compute_with_ctx(l.ctx, &gq, 1);
+        fc_w = q;
+    }
+
+    struct ggml_tensor * cur = ggml_norm(l.ctx, inp);
+    if (repeat) {
+        cur = ggml_add(l.ctx, ggml_mul(l.ctx, ggml_repeat(l.ctx, ln_g, cur), cur), ggml_repeat(l.ctx, ln_b, cur));
+    } else {
+        cur = ggml_add(l.ctx, ggml_mul(l.ctx, cur, ln_g), ln_b);
+    }
+
+    cur = ggml_mul_mat(l.ctx, fc_w, cur);
+    cur = ggml_add(l.ctx, cur, repeat ? ggml_repeat(l.ctx, fc_b, cur) : fc_b);
+    cur = ggml_gelu(l.ctx, cur);
+
+    l.sum = ggml_add(l.ctx, cur, inp);
+
+    cur = ggml_norm(l.ctx, l.sum);
+    l.out = ggml_mul(l.ctx, cur, repeat ? ggml_repeat(l.ctx, ln2, cur) : ln2);
+
+    l.gf = ggml_build_forward(l.out);
+
+    return l;
+}
+
+// mul_mat -> residual add -> norm*g -> mul_mat -> scale -> add(., residual), with the tensors of the
+// graph in a ggml_allocr buffer: the residual sum is only a source of the fused norm and of the last add
+static struct ggml_tensor * build_alloc(struct ggml_context * ctx, struct ggml_tensor ** w, struct ggml_cgraph * gf) {
+    struct ggml_tensor * cur = ggml_mul_mat(ctx, w[0], w[1]);
+    struct ggml_tensor * x   = ggml_add(ctx, cur, w[1]);
+
+    cur = ggml_mul(ctx, ggml_norm(ctx, x), w[2]);
+    cur = ggml_mul_mat(ctx, w[0], cur);
+    cur = ggml_scale(ctx, cur, w[3]);
+    cur = ggml_add(ctx, cur, x);
+
+    *gf = ggml_build_forward(cur);
+
+    return cur;
+}
+
+static int test_alloc(bool fuse, float * result) {
+    const int n_embd   = 64;
+    const int n_tokens = 5;
+
+    struct ggml_init_params params = {
+        /*.mem_size   =*/ 1024*1024,
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ false,
+    };
+    struct ggml_context * ctx_w = ggml_init(params);
+
+    struct ggml_tensor * w[4] = {
+        ggml_new_tensor_2d(ctx_w, GGML_TYPE_F32, n_embd, n_embd),
+        ggml_new_tensor_2d(ctx_w, GGML_TYPE_F32, n_embd, n_tokens),
+        ggml_new_tensor_1d(ctx_w, GGML_TYPE_F32, n_embd),
+        ggml_new_f32(ctx_w, 0.5f),
+    };
+
+    srand(1);
+    randomize(w[0]);
+    randomize(w[1]);
+    randomize(w[2]);
+
+    params.mem_size = ggml_tensor_overhead()*GGML_MAX_NODES + ggml_graph_overhead();
+    params.no_alloc = true;
+
+    struct ggml_cgraph gf;
+    size_t size;
+    {
+        struct ggml_context * ctx   = ggml_init(params);
+        struct ggml_allocr  * alloc = ggml_allocr_new_measure(32);
+
+        build_alloc(ctx, w, &gf);
+        if (fuse) {
+            ggml_graph_fuse(&gf);
+        }
+        size = ggml_allocr_alloc_graph(alloc, &gf) + 32;
+
+        ggml_allocr_free(alloc);
+        ggml_free(ctx);
+    }
+
+    uint8_t * buf = malloc(size);
+
+    struct ggml_context * ctx   = ggml_init(params);
+    struct ggml_allocr  * alloc = ggml_allocr_new(buf, size, 32);
+
+    struct ggml_tensor * out = build_alloc(ctx, w, &gf);
+
+    const int n_fused = fuse ? ggml_graph_fuse(&gf) : 0;
+
+    ggml_allocr_alloc_graph(alloc, &gf);
+    ggml_graph_compute_with_ctx(ctx_w, &gf, N_THREADS);
+
+    memcpy(result, out->data, ggml_nbytes(out));
+
+    ggml_allocr_free(alloc);
+    ggml_free(ctx);
+    free(buf);
+    ggml_free(ctx_w);
+
+    return n_fused;
+}
+
+static int check(const struct ggml_tensor * ref, const struct ggml_tensor * res, const char * what) {
+    if (memcmp(ref->data, res->data, ggml_nbytes(ref)) != 0) {
+        fprintf(stderr, "%s differs from the unfused graph\n", what);
+        return 1;
+    }
+    return 0;
+}
+
+int main(void) {
+    // the threads split every node, however small
+    ggml_set_task_min_bytes(1);
+
+    const enum ggml_type wtypes[] = { GGML_TYPE_F32, GGML_TYPE_F16, GGML_TYPE_Q8_0 };
+
+    for (int t = 0; t < (int) (sizeof(wtypes)/sizeof(wtypes[0])); ++t) {
+        for (int n_threads = 1; n_threads <= N_THREADS; n_threads += N_THREADS - 1) {
+            const bool repeat = n_threads == 1;
+
+            struct layer ref = make_layer(wtypes[t], repeat);
+            struct layer res = make_layer(wtypes[t], repeat);
+
+            const int n_nodes = res.gf.n_nodes;
+            const int n_fused = ggml_graph_fuse(&res.gf);
+
+            // ln + scale + shift, fc + bias + gelu, residual + ln + scale
+            if (n_fused != 3) {
+                fprintf(stderr, "fused %d chains, expected 3\n", n_fused);
+                return 1;
+            }
+            if (res.gf.n_nodes != 3) {
+                fprintf(stderr, "%d of %d nodes left, expected 3\n", res.gf.n_nodes, n_nodes);
+                return 1;
+            }
+
+            ggml_graph_compute_with_ctx(ref.ctx, &ref.gf, n_threads);
+            ggml_graph_compute_with_ctx(res.ctx, &res.gf, n_threads);
+
+            if (check(ref.sum, res.sum, "residual sum") || check(ref.out, res.out, "output")) {
+                fprintf(stderr, "type %s, %d threads\n", ggml_type_name(wtypes[t]), n_threads);
+                return 1;
+            }
+
+            ggml_free(ref.ctx);
+            ggml_free(res.ctx);
+        }
+    }
+
+    // the residual sum the fused norm writes keeps its own memory in a ggml_allocr buffer
+    {
+        float ref[64*5];
+        float res[64*5];
+
+        test_alloc(false, ref);
+        if (test_alloc(true, res) == 0 || memcmp(ref, res, sizeof(ref)) != 0) {
+            fprintf(stderr, "allocated graph differs from the unfused graph\n");
+            return 1;
+        }
+    }
+
+    printf("OK\n");
+
+    return 0;
+}
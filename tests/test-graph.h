@@ -0,0 +1,77 @@
+#pragma once
+
+// the fixtures of the tests of the graph compute: the threadpool, async compute, concurrent nodes,
+// the compute cache and the cost model
+
+#include "ggml/ggml.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct test_graph {
+    struct ggml_context * ctx;
+    struct ggml_cgraph    gf;
+    struct ggml_tensor  * out;
+};
+
+static inline struct ggml_context * test_ctx_new(size_t mem_size) {
+    struct ggml_init_params params = {
+        /*.mem_size   =*/ mem_size,
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ false,
+    };
+
+    return ggml_init(params);
+}
+
+// uniform in [-0.5, 0.5), of the sequence that srand() started
+static inline void test_randomize(struct ggml_tensor * t) {
+    for (int i = 0; i < ggml_nelements(t); ++i) {
+        ((float *) t->data)[i] = (float) rand()/RAND_MAX - 0.5f;
+    }
+}
+
+// soft_max(gelu(a*b + a*b)) of a [ne0, ne1] and b [ne0, n] filled from seed
+static inline struct test_graph test_graph_mul_mat(int seed, int ne0, int ne1, int n) {
+    struct test_graph g;
+    g.ctx = test_ctx_new(16*1024*1024);
+
+    struct ggml_tensor * a = ggml_new_tensor_2d(g.ctx, GGML_TYPE_F32, ne0, ne1);
+    struct ggml_tensor * b = ggml_new_tensor_2d(g.ctx, GGML_TYPE_F32, ne0, n);
+
+    srand(seed);
+    test_randomize(a);
+    test_randomize(b);
+
+    struct ggml_tensor * x = ggml_mul_mat(g.ctx, a, b);
+    x = ggml_add(g.ctx, x, x);
+    x = ggml_gelu(g.ctx, x);
+    x = ggml_soft_max(g.ctx, x);
+
+    g.out = x;
+    g.gf  = ggml_build_forward(x);
+
+    return g;
+}
+
+// computes gf with plan and a work buffer of its own, exits on failure
+static inline void test_compute(struct ggml_cgraph * gf, struct ggml_cplan * plan) {
+    uint8_t * work = plan->work_size > 0 ? malloc(plan->work_size) : NULL;
+    plan->work_data = work;
+
+    const int rc = ggml_graph_compute(gf, plan);
+    if (rc != GGML_EXIT_SUCCESS) {
+        fprintf(stderr, "ggml_graph_compute failed: %d\n", rc);
+        exit(1);
+    }
+
+    plan->work_data = NULL;
+    free(work);
+}
+
+static inline int test_done(const char * name, int n_fail) {
+    printf("%s: %s\n", name, n_fail == 0 ? "ok" : "FAILED");
+
+    return n_fail == 0 ? 0 : 1;
+}
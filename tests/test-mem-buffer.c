@@ -0,0 +1,85 @@
+#include "ggml/ggml.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+// every combination of flags gives zeroed, writable, page-aligned memory that a context can use,
+// the flags that did not take effect are dropped but never invented
+static int test_flags(int flags) {
+    const size_t size = 3*1024*1024 + 123;
+
+    struct ggml_mem_buffer buf = ggml_mem_buffer_alloc(size, flags);
+
+    if (buf.data == NULL || buf.size < size || ((uintptr_t) buf.data) % 4096 != 0) {
+        fprintf(stderr, "flags %d: got %p with %zu bytes for %zu\n", flags, buf.data, buf.size, size);
+        return 1;
+    }
+
+    int n_fail = 0;
+
+    if ((buf.flags & ~flags & ~GGML_MEM_HUGE_2M) != 0 || ((buf.flags & GGML_MEM_HUGE_2M) && !(flags & (GGML_MEM_HUGE_2M | GGML_MEM_HUGE_1G)))) {
+        fprintf(stderr, "flags %d: took effect %d\n", flags, buf.flags);
+        n_fail++;
+    }
+
+    const unsigned char * p = (const unsigned char *) buf.data;
+    for (size_t i = 0; i < buf.size; ++i) {
+        if (p[i] != 0) {
+            fprintf(stderr, "flags %d: byte %zu is not zero\n", flags, i);
+            n_fail++;
+            break;
+        }
+    }
+
+    struct ggml_init_params params = {
+        /*.mem_size   =*/ buf.size,
+        /*.mem_buffer =*/ buf.data,
+        /*.no_alloc   =*/ false,
+    };
+
+    struct ggml_context * ctx = ggml_init(params);
+
+    struct ggml_tensor * a = ggml_new_tensor_1d(ctx, GGML_TYPE_F32, 256*1024);
+    struct ggml_tensor * b = ggml_new_tensor_1d(ctx, GGML_TYPE_F32, 256*1024);
+    ggml_set_f32(a, 1.5f);
+    ggml_set_f32(b, 2.0f);
+
+    struct ggml_tensor * c = ggml_mul(ctx, a, b);
+    struct ggml_cgraph gf = ggml_build_forward(c);
+    ggml_graph_compute_with_ctx(ctx, &gf, 2);
+
+    if (ggml_get_f32_1d(c, 256*1024 - 1) != 3.0f) {
+        fprintf(stderr, "flags %d: wrong result %f\n", flags, ggml_get_f32_1d(c, 256*1024 - 1));
+        n_fail++;
+    }
+
+    ggml_mem_prefault(buf.data, buf.size);
+
+    ggml_free(ctx);
+    ggml_mem_buffer_free(&buf);
+
+    if (buf.data != NULL || buf.size != 0) {
+        fprintf(stderr, "flags %d: not reset by free\n", flags);
+        n_fail++;
+    }
+
+    return n_fail;
+}
+
+int main(void) {
+    int n_fail = 0;
+
+    for (int flags = 0; flags <= (GGML_MEM_HUGE_2M | GGML_MEM_HUGE_1G | GGML_MEM_LOCK | GGML_MEM_PREFAULT); ++flags) {
+        n_fail += test_flags(flags);
+    }
+
+    if (n_fail > 0) {
+        return 1;
+    }
+
+    printf("OK\n");
+
+    return 0;
+}
@@ -0,0 +1,200 @@
+#include "ggml/ggml.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_THREADS 3
+
+static void randomize(float * x, int64_t n) {
+    for (int64_t i = 0; i < n; ++i) {
+        x[i] = (float) rand()/RAND_MAX - 0.5f;
+    }
+}
+
+static struct ggml_context * make_ctx(void) {
+    struct ggml_init_params params = {
+        /*.mem_size   =*/ 64*1024*1024,
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ false,
+    };
+
+    return ggml_init(params);
+}
+
+static struct ggml_tensor * make_weights(struct ggml_context * ctx, enum ggml_type wtype, const int64_t * ne) {
+    struct ggml_tensor * w = ggml_new_tensor(ctx, GGML_TYPE_F32, 4, ne);
+    randomize((float *) w->data, ggml_nelements(w));
+
+    if (wtype == GGML_TYPE_F32) {
+        return w;
+    }
+
+    struct ggml_tensor * q = ggml_new_tensor(ctx, wtype, 4, ne);
+    struct ggml_cgraph gq = ggml_build_forward(ggml_cpy(ctx, w, q));
+    ggml_graph_compute_with_ctx(ctx, &gq, 1);
+
+    return q;
+}
+
+static float get_weight(const struct ggml_tensor * w, int64_t k, int64_t i, int64_t i2, int64_t i3) {
+    const char * p = (const char *) w->data + k*w->nb[0] + i*w->nb[1] + i2*w->nb[2] + i3*w->nb[3];
+    return w->type == GGML_TYPE_F32 ? *(const float *) p : ggml_fp16_to_fp32(*(const ggml_fp16_t *) p);
+}
+
+// src0 [K, M, ne02, ne03] x src1 [K, N, ne12, ne13] with non-contiguous src1 columns, against a double precision reference
+static int test_mul_mat(enum ggml_type wtype, const int64_t * ne0, const int64_t * ne1) {
+    struct ggml_context * ctx = make_ctx();
+
+    struct ggml_tensor * w = make_weights(ctx, wtype, ne0);
+
+    const int64_t pad = 5;
+    struct ggml_tensor * y_buf = ggml_new_tensor_4d(ctx, GGML_TYPE_F32, ne1[0] + pad, ne1[1], ne1[2], ne1[3]);
+    randomize((float *) y_buf->data, ggml_nelements(y_buf));
+
+    struct ggml_tensor * y = ggml_view_4d(ctx, y_buf, ne1[0], ne1[1], ne1[2], ne1[3],
+            y_buf->nb[1], y_buf->nb[2], y_buf->nb[3], 0);
+
+    struct ggml_tensor * out = ggml_mul_mat(ctx, w, y);
+    struct ggml_cgraph gf = ggml_build_forward(out);
+
+    float * ref = malloc(ggml_nbytes(out));
+
+    int n_fail = 0;
+
+    for (int n_threads = 1; n_threads <= N_THREADS; n_threads += N_THREADS - 1) {
+        ggml_graph_compute_with_ctx(ctx, &gf, n_threads);
+
+        if (n_threads == 1) {
+            memcpy(ref, out->data, ggml_nbytes(out));
+
+            double max_err = 0.0;
+
+            for (int64_t i3 = 0; i3 < ne1[3]; ++i3) {
+                for (int64_t i2 = 0; i2 < ne1[2]; ++i2) {
+                    for (int64_t j = 0; j < ne1[1]; ++j) {
+                        const float * yj = (const float *) ((const char *) y->data + j*y->nb[1] + i2*y->nb[2] + i3*y->nb[3]);
+
+                        for (int64_t i = 0; i < ne0[1]; ++i) {
+                            double sum = 0.0;
+                            for (int64_t k = 0; k < ne0[0]; ++k) {
+                                sum += (double) get_weight(w, k, i, i2/(ne1[2]/ne0[2]), i3/(ne1[3]/ne0[3]))*yj[k];
+                            }
+
+                            const float res = *(const float *) ((const char *) out->data + i*out->nb[0] + j*out->nb[1] + i2*out->nb[2] + i3*out->nb[3]);
+
+                            max_err = fmax(max_err, fabs(res - sum));
+                        }
+                    }
+                }
+            }
+
+            if (max_err > 1e-4) {
+                fprintf(stderr, "%s [%d, %d, %d, %d] x [%d, %d, %d, %d]: max error %g\n", ggml_type_name(wtype),
+                        (int) ne0[0], (int) ne0[1], (int) ne0[2], (int) ne0[3],
+                        (int) ne1[0], (int) ne1[1], (int) ne1[2], (int) ne1[3], max_err);
+                n_fail++;
+            }
+        } else if (memcmp(ref, out->data, ggml_nbytes(out)) != 0) {
+            fprintf(stderr, "%s: %d threads differ from 1 thread\n", ggml_type_name(wtype), n_threads);
+            n_fail++;
+        }
+    }
+
+    free(ref);
+    ggml_free(ctx);
+
+    return n_fail;
+}
+
+static struct ggml_tensor * make_fc(struct ggml_context * ctx, enum ggml_type wtype, struct ggml_cgraph * gf) {
+    const int64_t n_embd   = 96;
+    const int64_t n_tokens = 40;
+
+    srand(2);
+
+    const int64_t ne[4] = { n_embd, n_embd, 1, 1 };
+    struct ggml_tensor * w = make_weights(ctx, wtype, ne);
+    struct ggml_tensor * b = ggml_new_tensor_1d(ctx, GGML_TYPE_F32, n_embd);
+    struct ggml_tensor * x = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, n_embd, n_tokens);
+
+    randomize((float *) b->data, n_embd);
+    randomize((float *) x->data, n_embd*n_tokens);
+
+    struct ggml_tensor * out = ggml_gelu(ctx, ggml_add(ctx, ggml_mul_mat(ctx, w, x), b));
+
+    *gf = ggml_build_forward(out);
+
+    return out;
+}
+
+// the fused bias and activation are applied once the whole row range is summed
+static int test_fused(enum ggml_type wtype) {
+    struct ggml_context * ctx_ref = make_ctx();
+    struct ggml_context * ctx_res = make_ctx();
+
+    struct ggml_cgraph gf_ref;
+    struct ggml_cgraph gf_res;
+
+    struct ggml_tensor * ref = make_fc(ctx_ref, wtype, &gf_ref);
+    struct ggml_tensor * res = make_fc(ctx_res, wtype, &gf_res);
+
+    int n_fail = 0;
+
+    if (ggml_graph_fuse(&gf_res) != 1) {
+        fprintf(stderr, "%s: fc + bias + gelu was not fused\n", ggml_type_name(wtype));
+        n_fail++;
+    }
+
+    ggml_graph_compute_with_ctx(ctx_ref, &gf_ref, N_THREADS);
+    ggml_graph_compute_with_ctx(ctx_res, &gf_res, N_THREADS);
+
+    if (memcmp(ref->data, res->data, ggml_nbytes(ref)) != 0) {
+        fprintf(stderr, "%s: fused fc differs from the unfused graph\n", ggml_type_name(wtype));
+        n_fail++;
+    }
+
+    ggml_free(ctx_ref);
+    ggml_free(ctx_res);
+
+    return n_fail;
+}
+
+int main(void) {
+    // the threads split every node, however small
+    ggml_set_task_min_bytes(1);
+
+    const enum ggml_type wtypes[] = { GGML_TYPE_F32, GGML_TYPE_F16 };
+
+    // odd sizes: partial row and column tiles, several K slices, broadcast src0 and columns past a single block
+    const int64_t ne0[][4] = {
+        { 300, 70, 1, 1 },
+        { 300, 70, 2, 1 },
+        {  64, 17, 1, 2 },
+    };
+    const int64_t ne1[][4] = {
+        { 300, 50, 1, 1 },
+        { 300, 33, 4, 1 },
+        {  64, 97, 1, 2 },
+    };
+
+    srand(1);
+
+    int n_fail = 0;
+
+    for (int t = 0; t < (int) (sizeof(wtypes)/sizeof(wtypes[0])); ++t) {
+        for (int i = 0; i < (int) (sizeof(ne0)/sizeof(ne0[0])); ++i) {
+            n_fail += test_mul_mat(wtypes[t], ne0[i], ne1[i]);
+        }
+        n_fail += test_fused(wtypes[t]);
+    }
+
+    if (n_fail > 0) {
+        return 1;
+    }
+
+    printf("OK\n");
+
+    return 0;
+}
@@ -0,0 +1,135 @@
+#include "ggml/ggml.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_THREADS 4
+
+static void randomize(struct ggml_tensor * t) {
+    for (int i = 0; i < ggml_nelements(t); ++i) {
+        ((float *) t->data)[i] = (float) rand()/RAND_MAX - 0.5f;
+    }
+}
+
+static struct ggml_context * make_ctx(void) {
+    struct ggml_init_params params = {
+        /*.mem_size   =*/ 16*1024*1024,
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ false,
+    };
+
+    return ggml_init(params);
+}
+
+static struct ggml_tensor * make_weights(struct ggml_context * ctx, enum ggml_type type, int ne0, int ne1) {
+    struct ggml_tensor * w = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, ne0, ne1);
+    randomize(w);
+
+    struct ggml_tensor * q = ggml_new_tensor_2d(ctx, type, ne0, ne1);
+    struct ggml_cgraph gq = ggml_build_forward(ggml_cpy(ctx, w, q));
+    ggml_graph_compute_with_ctx(ctx, &gq, 1);
+
+    return q;
+}
+
+// w x in a graph of its own
+static int check(const struct ggml_tensor * res, struct ggml_tensor * w, const float * x, int n, const char * what) {
+    struct ggml_context * ctx = make_ctx();
+
+    struct ggml_tensor * y = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, w->ne[0], n);
+    memcpy(y->data, x, ggml_nbytes(y));
+
+    struct ggml_tensor * ref = ggml_mul_mat(ctx, w, y);
+    struct ggml_cgraph gf = ggml_build_forward(ref);
+    ggml_graph_compute_with_ctx(ctx, &gf, 1);
+
+    const int ok = memcmp(ref->data, res->data, w->ne[1]*n*sizeof(float)) == 0;
+    if (!ok) {
+        fprintf(stderr, "%s differs from a mul_mat of its own\n", what);
+    }
+
+    ggml_free(ctx);
+
+    return ok ? 0 : 1;
+}
+
+int main(void) {
+    // the threads split every node, however small
+    ggml_set_task_min_bytes(1);
+
+    const int ne0 = 128;
+    const int ne1 = 40;
+    const int n   = 9;
+
+    srand(1);
+
+    int n_fail = 0;
+
+    for (int n_threads = 1; n_threads <= N_THREADS; n_threads += N_THREADS - 1) {
+        struct ggml_context * ctx = make_ctx();
+
+        struct ggml_tensor * wq = make_weights(ctx, GGML_TYPE_Q4_0, ne0, ne1);
+        struct ggml_tensor * wk = make_weights(ctx, GGML_TYPE_Q8_0, ne0, ne1);
+        struct ggml_tensor * wv = make_weights(ctx, GGML_TYPE_Q4_1, ne0, ne1);
+        struct ggml_tensor * wo = make_weights(ctx, GGML_TYPE_Q4_0, ne0, ne1);
+
+        struct ggml_tensor * x = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, ne0, n);
+        struct ggml_tensor * y = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, ne0, n);
+        randomize(x);
+        randomize(y);
+
+        float * x0 = malloc(ggml_nbytes(x));
+        memcpy(x0, x->data, ggml_nbytes(x));
+
+        // v converts x to Q8_1, q converts it to Q8_0 and k finds that still there after a scale,
+        // o reads x after it was overwritten by a node that does not use the work buffer
+        struct ggml_tensor * v = ggml_mul_mat(ctx, wv, x);
+        struct ggml_tensor * q = ggml_mul_mat(ctx, wq, x);
+        struct ggml_tensor * k = ggml_mul_mat(ctx, wk, x);
+        struct ggml_tensor * o = ggml_mul_mat(ctx, wo, x);
+
+        struct ggml_cgraph gf = ggml_build_forward(v);
+        ggml_build_forward_expand(&gf, ggml_scale(ctx, q, ggml_new_f32(ctx, 2.0f)));
+        ggml_build_forward_expand(&gf, k);
+        ggml_build_forward_expand(&gf, ggml_cpy(ctx, y, x));
+        ggml_build_forward_expand(&gf, o);
+
+        struct ggml_cplan plan = ggml_graph_plan(&gf, n_threads);
+
+        int n_converted = 0;
+        for (int i = 0; i < gf.n_nodes; ++i) {
+            if (plan.src1_converted[i] && gf.nodes[i] != k) {
+                fprintf(stderr, "node %d (%s) reuses src1\n", i, ggml_op_name(gf.nodes[i]->op));
+                n_fail++;
+            }
+            n_converted += plan.src1_converted[i];
+        }
+        if (n_converted != 1) {
+            fprintf(stderr, "%d nodes reuse src1, expected 1\n", n_converted);
+            n_fail++;
+        }
+
+        uint8_t * work = malloc(plan.work_size);
+        plan.work_data = work;
+
+        ggml_graph_compute(&gf, &plan);
+
+        n_fail += check(q, wq, x0,                 n, "q");
+        n_fail += check(k, wk, x0,                 n, "k");
+        n_fail += check(v, wv, x0,                 n, "v");
+        n_fail += check(o, wo, (float *) y->data,  n, "o");
+
+        free(work);
+        free(x0);
+        ggml_free(ctx);
+    }
+
+    if (n_fail > 0) {
+        return 1;
+    }
+
+    printf("OK\n");
+
+    return 0;
+}
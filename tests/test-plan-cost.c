@@ -0,0 +1,118 @@
+#include "test-graph.h"
+
+#define N_THREADS 4
+
+struct graph {
+    struct ggml_context * ctx;
+    struct ggml_cgraph    gf;
+    struct ggml_tensor  * small; // a few rows, too little work for more than one thread
+    struct ggml_tensor  * large; // a few MB, enough for all of them
+};
+
+static struct graph make_graph(void) {
+    struct graph g;
+    g.ctx = test_ctx_new(64*1024*1024);
+
+    struct ggml_tensor * a = ggml_new_tensor_2d(g.ctx, GGML_TYPE_F32, 32, 32);
+    struct ggml_tensor * b = ggml_new_tensor_2d(g.ctx, GGML_TYPE_F32, 32, 32);
+    struct ggml_tensor * c = ggml_new_tensor_2d(g.ctx, GGML_TYPE_F32, 1024, 1024);
+    struct ggml_tensor * d = ggml_new_tensor_2d(g.ctx, GGML_TYPE_F32, 1024, 1024);
+
+    srand(1);
+    test_randomize(a);
+    test_randomize(b);
+    test_randomize(c);
+    test_randomize(d);
+
+    g.small = ggml_soft_max(g.ctx, ggml_add(g.ctx, a, b));
+    g.large = ggml_soft_max(g.ctx, ggml_mul(g.ctx, c, d));
+
+    g.gf = ggml_build_forward(g.small);
+    ggml_build_forward_expand(&g.gf, g.large);
+
+    return g;
+}
+
+// n_tasks of the nodes of g with task_min_bytes, and their results against a graph on one thread
+static int check(size_t task_min_bytes, int n_tasks_small, int n_tasks_large) {
+    struct graph ref = make_graph();
+    struct graph res = make_graph();
+
+    ggml_set_task_min_bytes(task_min_bytes);
+
+    struct ggml_cplan plan = ggml_graph_plan(&res.gf, N_THREADS);
+
+    int n_fail = 0;
+
+    for (int i = 0; i < res.gf.n_nodes; ++i) {
+        struct ggml_tensor * node = res.gf.nodes[i];
+
+        const bool small = node == res.small || node == res.small->src[0];
+        const int  n_exp = small ? n_tasks_small : n_tasks_large;
+
+        if (plan.n_tasks[i] != n_exp) {
+            fprintf(stderr, "task_min_bytes %d: %s of %d elements has %d tasks, expected %d\n", (int) task_min_bytes,
+                    ggml_op_name(node->op), (int) ggml_nelements(node), plan.n_tasks[i], n_exp);
+            n_fail++;
+        }
+    }
+
+    test_compute(&res.gf, &plan);
+    ggml_graph_compute_with_ctx(ref.ctx, &ref.gf, 1);
+
+    if (memcmp(ref.small->data, res.small->data, ggml_nbytes(ref.small)) != 0 ||
+        memcmp(ref.large->data, res.large->data, ggml_nbytes(ref.large)) != 0) {
+        fprintf(stderr, "task_min_bytes %d: results differ from one thread\n", (int) task_min_bytes);
+        n_fail++;
+    }
+
+    ggml_free(ref.ctx);
+    ggml_free(res.ctx);
+
+    return n_fail;
+}
+
+int main(void) {
+    int n_fail = 0;
+
+    n_fail += check(GGML_DEFAULT_TASK_MIN_BYTES, 1, N_THREADS);
+    n_fail += check(1, N_THREADS, N_THREADS);
+    n_fail += check((size_t) 1 << 40, 1, 1);
+
+    // a pool keeps its own value, the graphs of everyone else stay with the default
+    {
+        struct ggml_threadpool * pool = ggml_threadpool_new(N_THREADS);
+        struct graph g = make_graph();
+
+        ggml_set_task_min_bytes(GGML_DEFAULT_TASK_MIN_BYTES);
+        ggml_threadpool_set_task_min_bytes(pool, 1);
+
+        const struct ggml_cplan plan_pool = ggml_graph_plan_pool(&g.gf, N_THREADS, pool);
+        const struct ggml_cplan plan      = ggml_graph_plan(&g.gf, N_THREADS);
+
+        if (plan_pool.threadpool != pool || plan_pool.n_tasks[0] != N_THREADS || plan.n_tasks[0] != 1) {
+            fprintf(stderr, "task_min_bytes of the pool: %d tasks on the pool, %d without it\n",
+                    plan_pool.n_tasks[0], plan.n_tasks[0]);
+            n_fail++;
+        }
+
+        const size_t task_min_bytes = ggml_task_cost_calibrate(2, pool);
+        if (ggml_threadpool_get_task_min_bytes(pool) != task_min_bytes ||
+            ggml_get_task_min_bytes() != GGML_DEFAULT_TASK_MIN_BYTES) {
+            fprintf(stderr, "calibrating a pool changed the default task_min_bytes\n");
+            n_fail++;
+        }
+
+        ggml_free(g.ctx);
+        ggml_threadpool_free(pool);
+    }
+
+    // a clamped measure, whatever this machine is like
+    const size_t task_min_bytes = ggml_task_cost_calibrate(2, NULL);
+    if (task_min_bytes < 4*1024 || task_min_bytes > 4*1024*1024 || ggml_get_task_min_bytes() != task_min_bytes) {
+        fprintf(stderr, "calibrated task_min_bytes %d out of range\n", (int) task_min_bytes);
+        n_fail++;
+    }
+
+    return test_done(__func__, n_fail);
+}
@@ -135,6 +135,9 @@ void usage(char * argv[]) {
     printf("                        set alignment offset as OFFSET (0)\n");
     printf("  -i NUM, --iterations NUM\n");
     printf("                        set test iteration number (%d)\n", ITERATIONS);
+    printf("\n");
+    printf("GGML_CPU_MAX_LEVEL=LEVEL in the environment caps the kernels picked at runtime by a GGML_CPU_DISPATCH build\n");
+    printf("as base, avx2, avx_vnni, avx512 or avx512_vnni, to compare two levels on the same CPU\n");
 }
 
 int main(int argc, char * argv[]) {
@@ -269,6 +272,9 @@ int main(int argc, char * argv[]) {
     };
     struct ggml_context * ctx = ggml_init(ggml_params);
 
+    printf("kernels: AVX2 = %d | AVX_VNNI = %d | AVX512 = %d | AVX512_VNNI = %d\n\n",
+            ggml_cpu_has_avx2(), ggml_cpu_has_avx_vnni(), ggml_cpu_has_avx512(), ggml_cpu_has_avx512_vnni());
+
     for (int i = 0; i < GGML_TYPE_COUNT; i++) {
         ggml_type type = (ggml_type) i;
         ggml_type_traits_t qfns = ggml_internal_get_type_traits(type);
@@ -339,8 +345,9 @@ int main(int argc, char * argv[]) {
 
             if (params.op_vec_dot_q) {
                 printf("  vec_dot_q\n");
+                auto vdot = ggml_internal_get_type_traits(qfns.vec_dot_type);
                 qfns.from_float(test_data1, test_q1, largest);
-                qfns.from_float(test_data2, test_q2, largest);
+                vdot.from_float(test_data2, test_q2, largest);
                 for (size_t size : params.test_sizes) {
                     printf("    %zu values (%.2f MB)\n", size, 4*size/(float)(1024*1024));
                     auto quantize_fn = [&](void ) {
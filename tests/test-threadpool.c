@@ -0,0 +1,85 @@
+#include "test-graph.h"
+
+#include <math.h>
+
+#define N_THREADS 4
+
+static void compute(struct test_graph * g, int n_threads, struct ggml_threadpool * pool, int wait_spin_us, float * result) {
+    struct ggml_cplan plan = ggml_graph_plan(&g->gf, n_threads);
+    plan.threadpool   = pool;
+    plan.wait_spin_us = wait_spin_us;
+
+    test_compute(&g->gf, &plan);
+
+    memcpy(result, g->out->data, ggml_nbytes(g->out));
+}
+
+static int check(const float * ref, const float * res, int n, const char * what) {
+    for (int i = 0; i < n; ++i) {
+        if (fabsf(ref[i] - res[i]) > 1e-6f) {
+            fprintf(stderr, "%s: mismatch at %d: %f != %f\n", what, i, ref[i], res[i]);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int main(void) {
+    // the threads split every node, however small
+    ggml_set_task_min_bytes(1);
+
+    struct test_graph g0 = test_graph_mul_mat(1, 64, 96, 7);
+    struct test_graph g1 = test_graph_mul_mat(2, 64, 96, 7);
+
+    const int n = ggml_nelements(g0.out);
+
+    float * ref0 = malloc(n*sizeof(float));
+    float * ref1 = malloc(n*sizeof(float));
+    float * res  = malloc(n*sizeof(float));
+
+    compute(&g0, N_THREADS, NULL, GGML_DEFAULT_WAIT_SPIN_US, ref0);
+    compute(&g1, N_THREADS, NULL, GGML_DEFAULT_WAIT_SPIN_US, ref1);
+
+    struct ggml_threadpool * pool = ggml_threadpool_new(N_THREADS);
+    if (ggml_threadpool_n_threads(pool) != N_THREADS) {
+        fprintf(stderr, "unexpected pool size %d\n", ggml_threadpool_n_threads(pool));
+        return 1;
+    }
+
+    int n_fail = 0;
+
+    // the same pool, reused across calls, graphs from two contexts and smaller thread counts,
+    // with workers that always spin, sleep right away or do both
+    const int wait_spin_us[3] = { -1, 0, GGML_DEFAULT_WAIT_SPIN_US };
+
+    for (int it = 0; it < 24; ++it) {
+        const int n_threads = 1 + it % N_THREADS;
+        const int spin      = wait_spin_us[(it / N_THREADS) % 3];
+
+        compute(&g0, n_threads, pool, spin, res);
+        n_fail += check(ref0, res, n, "ctx0");
+
+        compute(&g1, n_threads, pool, spin, res);
+        n_fail += check(ref1, res, n, "ctx1");
+
+        compute(&g0, n_threads, NULL, spin, res);
+        n_fail += check(ref0, res, n, "ctx0, no pool");
+    }
+
+    if (g0.gf.perf_runs == 0 || g0.gf.perf_spin_us < 0 || g0.gf.perf_sleep_us < 0) {
+        fprintf(stderr, "bad wait stats: runs = %d, spin = %lld us, sleep = %lld us\n",
+                g0.gf.perf_runs, (long long) g0.gf.perf_spin_us, (long long) g0.gf.perf_sleep_us);
+        n_fail++;
+    }
+
+    ggml_threadpool_free(pool);
+
+    free(res);
+    free(ref1);
+    free(ref0);
+
+    ggml_free(g1.ctx);
+    ggml_free(g0.ctx);
+
+    return test_done(__func__, n_fail);
+}
@@ -0,0 +1,133 @@
+#include "ggml/ggml.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define N_THREADS 3
+
+static void randomize(float * x, int64_t n) {
+    for (int64_t i = 0; i < n; ++i) {
+        x[i] = (float) rand()/RAND_MAX - 0.5f;
+    }
+}
+
+// vec_dot_x4 has to give the exact vec_dot results of each column
+static int test_traits(enum ggml_type type, int n) {
+    const ggml_type_traits_t qx = ggml_internal_get_type_traits(type);
+    const ggml_type_traits_t qy = ggml_internal_get_type_traits(qx.vec_dot_type);
+
+    const size_t xs = ggml_type_size(type)*n/ggml_blck_size(type);
+    const size_t ys = ggml_type_size(qx.vec_dot_type)*n/ggml_blck_size(qx.vec_dot_type);
+
+    float * f  = malloc(n*sizeof(float));
+    char  * vx = malloc(xs);
+    char  * vy = malloc(4*ys);
+
+    randomize(f, n);
+    qx.from_float(f, vx, n);
+
+    for (int j = 0; j < 4; ++j) {
+        randomize(f, n);
+        qy.from_float(f, vy + j*ys, n);
+    }
+
+    float ref[4];
+    float res[4*3];
+
+    for (int j = 0; j < 4; ++j) {
+        qx.vec_dot(n, &ref[j], vx, vy + j*ys);
+    }
+    qx.vec_dot_x4(n, res, 3, vx, vy, ys);
+
+    int n_fail = 0;
+
+    for (int j = 0; j < 4; ++j) {
+        if (memcmp(&ref[j], &res[j*3], sizeof(float)) != 0) {
+            fprintf(stderr, "%s: column %d: vec_dot_x4 %f, vec_dot %f\n", ggml_type_name(type), j, res[j*3], ref[j]);
+            n_fail++;
+        }
+    }
+
+    free(f);
+    free(vx);
+    free(vy);
+
+    return n_fail;
+}
+
+// a mul_mat over several columns against one mul_mat per column, across src1 matrices
+static int test_mul_mat(enum ggml_type type) {
+    struct ggml_init_params params = {
+        /*.mem_size   =*/ 16*1024*1024,
+        /*.mem_buffer =*/ NULL,
+        /*.no_alloc   =*/ false,
+    };
+
+    struct ggml_context * ctx = ggml_init(params);
+
+    const int64_t ne00 = 128;
+    const int64_t ne01 = 37;
+    const int64_t ne11 = 11;
+    const int64_t ne12 = 2;
+
+    struct ggml_tensor * wf = ggml_new_tensor_2d(ctx, GGML_TYPE_F32, ne00, ne01);
+    struct ggml_tensor * w  = ggml_new_tensor_2d(ctx, type,          ne00, ne01);
+    struct ggml_tensor * x  = ggml_new_tensor_3d(ctx, GGML_TYPE_F32, ne00, ne11, ne12);
+
+    randomize((float *) wf->data, ggml_nelements(wf));
+    randomize((float *) x->data,  ggml_nelements(x));
+
+    struct ggml_cgraph gq = ggml_build_forward(ggml_cpy(ctx, wf, w));
+    ggml_graph_compute_with_ctx(ctx, &gq, 1);
+
+    struct ggml_tensor * out = ggml_mul_mat(ctx, w, x);
+    struct ggml_cgraph gf = ggml_build_forward(out);
+
+    struct ggml_tensor * cols[2*11];
+    for (int64_t i = 0; i < ne11*ne12; ++i) {
+        cols[i] = ggml_mul_mat(ctx, w, ggml_view_1d(ctx, x, ne00, i*x->nb[1]));
+        ggml_build_forward_expand(&gf, cols[i]);
+    }
+
+    ggml_graph_compute_with_ctx(ctx, &gf, N_THREADS);
+
+    int n_fail = 0;
+
+    for (int64_t i = 0; i < ne11*ne12; ++i) {
+        if (memcmp((char *) out->data + i*out->nb[1], cols[i]->data, ne01*sizeof(float)) != 0) {
+            fprintf(stderr, "%s: column %d differs from its own mul_mat\n", ggml_type_name(type), (int) i);
+            n_fail++;
+        }
+    }
+
+    ggml_free(ctx);
+
+    return n_fail;
+}
+
+int main(void) {
+    // the threads split every node, however small
+    ggml_set_task_min_bytes(1);
+
+    const enum ggml_type types[] = {
+        GGML_TYPE_Q4_0, GGML_TYPE_Q4_1, GGML_TYPE_Q5_0, GGML_TYPE_Q5_1, GGML_TYPE_Q8_0,
+    };
+
+    srand(1);
+
+    int n_fail = 0;
+
+    for (int t = 0; t < (int) (sizeof(types)/sizeof(types[0])); ++t) {
+        n_fail += test_traits(types[t], 256);
+        n_fail += test_mul_mat(types[t]);
+    }
+
+    if (n_fail > 0) {
+        return 1;
+    }
+
+    printf("OK\n");
+
+    return 0;
+}